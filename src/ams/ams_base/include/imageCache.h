@@ -54,6 +54,29 @@ extern "C" {
 int loadImageFromCache(SuiteIdType suiteID, const pcsl_string * resName,
                        unsigned char **bufPtr);
 
+/**
+ * Gets a native image from cache, if present. When the cache file is
+ * mapped into memory the image is not copied, the returned pointer stays
+ * valid until the cache of another suite is used or releaseImageCache()
+ * is called.
+ *
+ * @param suiteID   Suite id
+ * @param resName   Name of the image resource
+ * @param pData     [out] points to the native image
+ * @param pCopy     [out] buffer allocated for the image when the cache
+ *                  is not mapped, NULL otherwise. Caller will need
+ *                  to free this on return.
+ *
+ * @return -1 if the image is not cached, else length of the image
+ */
+int getImageFromCache(SuiteIdType suiteID, const pcsl_string * resName,
+                      const unsigned char **pData, unsigned char **pCopy);
+
+/**
+ * Releases the cache file loaded by getImageFromCache() and
+ * loadImageFromCache().
+ */
+void releaseImageCache(void);
 
 /**
  * Creates a cache of natives images by iterating over all png images in the jar
@@ -87,7 +87,7 @@ typedef struct HuffmanCodeTableHeader {
 
 #define LITXLEN_BASE 257
 
-#define INFLATEBUFFERSIZE 256
+#define INFLATEBUFFERSIZE 1024
 
 /* A normal sized huffman code table with a 9-bit quick bit */
 typedef struct _HuffmanCodeTable {
@@ -104,6 +104,47 @@ typedef struct _HuffmanCodeTable {
     unsigned short entries[512];
 } HuffmanCodeTable;
 
+/*
+ * The literal/length and distance codes are decoded with lookup tables
+ * that give the symbol together with its base value and the number of
+ * extra bits, so that one probe of the root table is enough for all
+ * codes up to rootBits long. Longer codes have a link in the root table
+ * to a subtable indexed by the next bits of the code.
+ */
+typedef struct _InflateCode {
+    unsigned char op;   /* kind of the entry, one of INFLATE_OP_* */
+    unsigned char bits; /* bits of the code consumed at this table level */
+    unsigned short val; /* literal, base value or offset of the subtable */
+} InflateCode;
+
+#define INFLATE_OP_LITERAL 0x00 /* val is a literal byte */
+#define INFLATE_OP_BASE    0x10 /* val is a length or a distance base, the
+                                 * low 4 bits give the number of extra bits */
+#define INFLATE_OP_END     0x20 /* end of block */
+#define INFLATE_OP_LINK    0x40 /* val is the index of the subtable, the
+                                 * low 4 bits give its number of index bits */
+#define INFLATE_OP_BAD     0x60 /* the symbol is not allowed */
+#define INFLATE_OP_INVALID 0x70 /* no code of an incomplete code set */
+
+#define INFLATE_OP_MASK    0xF0
+#define INFLATE_OP_BITS    0x0F
+
+/* Root table bits of the literal/length and distance tables */
+#define INFLATE_LITLEN_ROOT_BITS 10
+#define INFLATE_DIST_ROOT_BITS   8
+
+typedef struct _InflateCodeTableHeader {
+    unsigned short rootBits;   /* index bits of the root table */
+    unsigned short maxCodeLen; /* Max number of bits in any code */
+} InflateCodeTableHeader;
+
+typedef struct _InflateCodeTable {
+    InflateCodeTableHeader h;
+    /* There are 1 << rootBits root entries followed by the subtables.
+     * 1024 is just an example. */
+    InflateCode entries[1 << INFLATE_LITLEN_ROOT_BITS];
+} InflateCodeTable;
+
 /* A small sized huffman code table with a 9-bit quick bit.  We have
  * this so that we can initialize fixedHuffmanDistanceTable in jartables.h
  */
@@ -133,6 +174,14 @@ typedef struct _InflaterState {
     int outBufferIsAHandle; /* non-zero if decompBuffer is mem handle that
                        must be given to heapObj.addrFromHandle before using */
 
+    /* The output sink, NULL if the whole output fits into outBuffer */
+    InflateSinkFunction sink;
+    void* sinkState;
+    unsigned long outFlushed;  /* outBuffer offset of the first byte
+                                  not given to the sink yet */
+    unsigned long outDropped;  /* output bytes moved out of outBuffer */
+    unsigned long outExpected; /* total length of the output */
+
     int inflateBufferIndex;
     int inflateBufferCount;
     unsigned char inflateBuffer[INFLATEBUFFERSIZE];
@@ -192,9 +241,30 @@ typedef struct _InflaterState {
     result = huff >> 4;                                            \
 }
 
-#define NEXTBYTE ((state->inflateBufferCount)-- > 0 ? (unsigned long)(state->inflateBuffer[state->inflateBufferIndex++]) : \
-    ((state->inflateBufferCount = getBytes(fileState, state->inflateBuffer, INFLATEBUFFERSIZE)) > 0 ? \
-    (state->inflateBufferIndex = 1, state->inflateBufferCount--, (unsigned long)(state->inflateBuffer[0])) : 0xff))
+/* Read bits from the input stream and decode a literal/length or a
+ * distance code using the specified lookup table. The entry of the
+ * code is placed into "result" with the bits of the code consumed.
+ * If there is a problem, we set error and break or of the loop.
+ *
+ * The caller must make sure that MAX_BITS bits are available.
+ */
+#define GET_INFLATE_CODE(table, result, badError) {                     \
+    result = table->entries[NEXTBITS(table->h.rootBits)];              \
+    if ((result.op & INFLATE_OP_MASK) == INFLATE_OP_LINK) {            \
+        DUMPBITS(table->h.rootBits);                                   \
+        result = table->entries[result.val +                           \
+                                NEXTBITS(result.op & INFLATE_OP_BITS)]; \
+    }                                                                  \
+    if ((result.op & INFLATE_OP_MASK) == INFLATE_OP_INVALID) {         \
+        error = INFLATE_HUFFMAN_ENTRY_ERROR;                           \
+        break;                                                         \
+    }                                                                  \
+    if ((result.op & INFLATE_OP_MASK) == INFLATE_OP_BAD) {             \
+        error = badError;                                              \
+        break;                                                         \
+    }                                                                  \
+    DUMPBITS(result.bits);                                             \
+}
 
 #define DECLARE_IN_VARIABLES                         \
     register void* fileState = state->fileState;     \
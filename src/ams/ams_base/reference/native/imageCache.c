@@ -25,6 +25,7 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
 
 #include <kni.h>
 
@@ -38,6 +39,27 @@
 #include <img_image.h>
 #include <midpUtilKni.h>
 #include <fileCache.h>
+#include <imageCache.h>
+
+/**
+ * Decode images on several threads while the cache is created. It is
+ * set by USE_IMAGE_CACHE_THREADS, which the makefiles only accept with
+ * the putpixel image decoders and the system malloc: the worker
+ * threads allocate through midpMalloc, and the MIDP heap is not
+ * thread-safe.
+ */
+#ifndef ENABLE_IMAGE_CACHE_THREADS
+#define ENABLE_IMAGE_CACHE_THREADS 0
+#endif
+
+#if ENABLE_IMAGE_CACHE_THREADS && ENABLE_MIDP_MALLOC
+#error "ENABLE_IMAGE_CACHE_THREADS requires ENABLE_MIDP_MALLOC=0"
+#endif
+
+#if ENABLE_IMAGE_CACHE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 /**
  * @file
@@ -45,33 +67,109 @@
  * Implements a cache for native images.
  * <p>
  * All images are loaded from the Jar file, converted to the native platform
- * representation, and stored as files. When an ImmutableImage is created then
- * loadCachedImage() is called to check if that particular image has been
- * cached, and if yes the native representation is loaded from the file. This
- * significantly reduce the time spent instantiating an ImmutableImage.
+ * representation, and stored in one cache file per suite. When an
+ * ImmutableImage is created then loadImageFromCache() is called to check if
+ * that particular image has been cached, and if yes the native
+ * representation is taken from the cache file. This significantly reduce
+ * the time spent instantiating an ImmutableImage.
  * <p>
- * Each cached image is stored with the following naming conventions:
+ * The cache file is named like the other cached resources:
  * <blockquote>
- *   <suite Id><image resource name>".tmp"
+ *   <suite Id>"images.cache"".tmp"
  * </blockquote>
- * All cache files are deleted when a suite is updated or removed.
+ * so it is deleted when a suite is updated or removed and moved together
+ * with the suite like the font cache files. The file consists of
+ * <pre>
+ *   ImageCacheHeader
+ *   native images, each one aligned to IMAGE_CACHE_ALIGN bytes
+ *   ImageCacheEntry table sorted by name hash and name
+ *   UTF-16 resource names referenced from the table
+ * </pre>
+ * in the native byte order, the cache is never shared between devices.
+ * The file of the suite being run is mapped into memory when the platform
+ * supports it, so images are copied straight from the mapping into the
+ * ImageData arrays. Otherwise only the table is kept in memory and every
+ * image is read with one seek and one read.
+ * <p>
+ * With ENABLE_IMAGE_CACHE_THREADS the images are decoded on up to
+ * IMAGE_CACHE_MAX_THREADS threads while the creating thread reads the
+ * JAR entries ahead and writes the decoded images in JAR order.
  * <p>
  * Note: Currently, only png and jpeg images are supported.
  */
 
-/**
- * Holds the suite ID. It is initialized during createImageCache() call
- * and used in image_cache_action() to avoid passing an additional parameter to it
- * because this function is called for each image entry in the suite's jar file.
- */
-static SuiteIdType globalSuiteId;
+/** Magic number of the cache file, "MIC1" */
+#define IMAGE_CACHE_MAGIC   0x4D494331
+
+/** Alignment of the native images in the cache file */
+#define IMAGE_CACHE_ALIGN   8
+
+/** Rounds an offset in the cache file up to IMAGE_CACHE_ALIGN */
+#define IMAGE_CACHE_ALIGN_UP(x) \
+    (((x) + (IMAGE_CACHE_ALIGN - 1)) & ~(long)(IMAGE_CACHE_ALIGN - 1))
+
+/** Header at the start of the cache file */
+typedef struct _ImageCacheHeader {
+    /** IMAGE_CACHE_MAGIC, zero while the file is being written */
+    jint magic;
+    /** Number of entries in the table */
+    jint entryCount;
+    /** Offset of the entry table, the names follow the table */
+    jint tableOffset;
+    /** Length of all names, in characters */
+    jint namesLength;
+    /** Size of the whole file, detects truncated files */
+    jint fileSize;
+    /** Keeps the first image aligned */
+    jint reserved;
+} ImageCacheHeader;
+
+/** Table entry describing one cached image */
+typedef struct _ImageCacheEntry {
+    /** Hash of the resource name, see hashName() */
+    jint hash;
+    /** Offset of the resource name in the names, in characters */
+    jint nameOffset;
+    /** Length of the resource name, in characters */
+    jint nameLength;
+    /** Offset of the native image in the file */
+    jint dataOffset;
+    /** Length of the native image, in bytes */
+    jint dataLength;
+} ImageCacheEntry;
+
+/** Cache file of the suite whose images were looked up last */
+typedef struct _ImageCacheFile {
+    /** Suite of the loaded cache, UNUSED_SUITE_ID if none */
+    SuiteIdType suiteId;
+    /** Whole cache file when it is mapped, NULL otherwise */
+    const unsigned char* map;
+    /** Size of the mapping */
+    long mapSize;
+    /** Header, table and names read from the file when it is not mapped */
+    unsigned char* index;
+    /** Path of the cache file, images are read from it if not mapped */
+    pcsl_string path;
+    /** Header of the cache, NULL if the suite has no usable cache */
+    const ImageCacheHeader* header;
+    /** Entry table */
+    const ImageCacheEntry* entries;
+    /** Resource names */
+    const jchar* names;
+} ImageCacheFile;
+
+PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_START(IMAGE_CACHE_NAME)
+    {'i', 'm', 'a', 'g', 'e', 's', '.', 'c', 'a', 'c', 'h', 'e', '\0'}
+PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_END(IMAGE_CACHE_NAME);
 
 /**
- * Holds the storage ID where the cached images will be saved. It is initialized
- * during createImageCache() call and used in image_cache_action() to avoid
- * passing an additional parameter to it.
+ * Cache file used by loadImageFromCache(). Only one suite is running
+ * images at a time, so a single file is kept loaded.
  */
-static StorageIdType globalStorageId;
+static ImageCacheFile loadedCache = {
+    UNUSED_SUITE_ID, NULL, 0, NULL, PCSL_STRING_NULL_INITIALIZER,
+    NULL, NULL, NULL
+};
 
 /**
  * Handle to the opened jar file with the midlet suite. It is used to
@@ -87,11 +185,25 @@ static void *handle;
 static jlong remainingSpace;
 
 /**
- * Holds the amount of cached data placed into the storage. It is initialized
- * during createImageCache() call and used in image_cache_action() to avoid
- * passing an additional parameter to it.
+ * Handle of the cache file being written by createImageCache(),
+ * -1 when writing has failed.
  */
-static long cachedDataSize;
+static int packHandle;
+
+/** Offset of the end of the data written to the cache file */
+static long packOffset;
+
+/** Entries of the images written to the cache file so far */
+static ImageCacheEntry* packEntries;
+
+/** Number of used and allocated packEntries */
+static int packCount, packCapacity;
+
+/** Names of the images written to the cache file so far */
+static jchar* packNames;
+
+/** Number of used and allocated characters of packNames */
+static int packNamesLength, packNamesCapacity;
 
 PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_START(PNG_EXT1)
     {'.', 'p', 'n', 'g', '\0'}
@@ -118,6 +230,186 @@ PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_START(JPEG_EXT4)
 PCSL_DEFINE_STATIC_ASCII_STRING_LITERAL_END(JPEG_EXT4);
 
 
+/**
+ * Computes the FNV-1a hash of a resource name.
+ */
+static jint hashName(const jchar* name, jsize length) {
+    unsigned long hash = 2166136261UL;
+    jsize i;
+
+    for (i = 0; i < length; i++) {
+        hash = ((hash ^ (name[i] & 0xFF)) * 16777619UL) & 0xFFFFFFFFUL;
+        hash = ((hash ^ (name[i] >> 8)) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    return (jint)hash;
+}
+
+/**
+ * Orders table entries by name hash, then by name.
+ */
+static int compareEntries(const void* a, const void* b) {
+    const ImageCacheEntry* e1 = (const ImageCacheEntry*)a;
+    const ImageCacheEntry* e2 = (const ImageCacheEntry*)b;
+    jsize len;
+    int cmp;
+
+    if (e1->hash != e2->hash) {
+        return ((unsigned long)(unsigned int)e1->hash <
+                (unsigned long)(unsigned int)e2->hash) ? -1 : 1;
+    }
+
+    len = (e1->nameLength < e2->nameLength) ?
+        e1->nameLength : e2->nameLength;
+    cmp = memcmp(packNames + e1->nameOffset, packNames + e2->nameOffset,
+                 len * sizeof(jchar));
+    if (cmp != 0) {
+        return cmp;
+    }
+
+    return e1->nameLength - e2->nameLength;
+}
+
+/**
+ * Writes to the cache file being created, stops writing on the first
+ * error.
+ *
+ * @return KNI_TRUE if the data was written
+ */
+static jboolean pack_write(const void* data, long length) {
+    char* pszError;
+
+    if (packHandle == -1) {
+        return KNI_FALSE;
+    }
+    if (length == 0) {
+        return KNI_TRUE;
+    }
+
+    storageWrite(&pszError, packHandle, (char*)data, length);
+    if (pszError != NULL) {
+        REPORT_WARN1(LC_LOWUI, "Warning: could not save image cache; %s\n",
+                     pszError);
+        storageFreeError(pszError);
+        storageClose(&pszError, packHandle);
+        storageFreeError(pszError);
+        packHandle = -1;
+        return KNI_FALSE;
+    }
+
+    packOffset += length;
+    return KNI_TRUE;
+}
+
+/**
+ * Appends a native image to the cache file being created.
+ *
+ * @param entry resource name of the image
+ * @param data native image
+ * @param length length of the native image
+ * @return KNI_TRUE if the image was added
+ */
+static jboolean pack_add_image(const pcsl_string* entry,
+                               const unsigned char* data, long length) {
+    static const unsigned char padding[IMAGE_CACHE_ALIGN] = {0};
+    const jchar* name;
+    jsize nameLength = pcsl_string_length(entry);
+    long alignedOffset = IMAGE_CACHE_ALIGN_UP(packOffset);
+    ImageCacheEntry* e;
+
+    if (packCount == packCapacity) {
+        int capacity = (packCapacity == 0) ? 32 : packCapacity * 2;
+        void* p = midpRealloc(packEntries, capacity * sizeof(ImageCacheEntry));
+        if (p == NULL) {
+            return KNI_FALSE;
+        }
+        packEntries = (ImageCacheEntry*)p;
+        packCapacity = capacity;
+    }
+
+    if (packNamesLength + nameLength > packNamesCapacity) {
+        int capacity = (packNamesCapacity == 0) ? 1024 : packNamesCapacity;
+        void* p;
+
+        while (capacity < packNamesLength + nameLength) {
+            capacity *= 2;
+        }
+        p = midpRealloc(packNames, capacity * sizeof(jchar));
+        if (p == NULL) {
+            return KNI_FALSE;
+        }
+        packNames = (jchar*)p;
+        packNamesCapacity = capacity;
+    }
+
+    if (!pack_write(padding, alignedOffset - packOffset) ||
+            !pack_write(data, length)) {
+        return KNI_FALSE;
+    }
+
+    name = pcsl_string_get_utf16_data(entry);
+    if (name == NULL && nameLength > 0) {
+        return KNI_FALSE;
+    }
+    memcpy(packNames + packNamesLength, name, nameLength * sizeof(jchar));
+
+    e = &packEntries[packCount++];
+    e->hash = hashName(name, nameLength);
+    e->nameOffset = packNamesLength;
+    e->nameLength = nameLength;
+    e->dataOffset = (jint)alignedOffset;
+    e->dataLength = (jint)length;
+
+    pcsl_string_release_utf16_data(name, entry);
+    packNamesLength += nameLength;
+
+    return KNI_TRUE;
+}
+
+/**
+ * Writes the table and the header closing the cache file being created.
+ *
+ * @return KNI_TRUE if the cache file is complete
+ */
+static jboolean pack_finish(void) {
+    static const unsigned char padding[IMAGE_CACHE_ALIGN] = {0};
+    ImageCacheHeader header;
+    char* pszError;
+    long tableOffset = IMAGE_CACHE_ALIGN_UP(packOffset);
+
+    if (packCount > 1) {
+        qsort(packEntries, packCount, sizeof(ImageCacheEntry),
+              compareEntries);
+    }
+
+    if (!pack_write(padding, tableOffset - packOffset) ||
+            !pack_write(packEntries, packCount * sizeof(ImageCacheEntry)) ||
+            !pack_write(packNames, packNamesLength * sizeof(jchar))) {
+        return KNI_FALSE;
+    }
+
+    header.magic = IMAGE_CACHE_MAGIC;
+    header.entryCount = packCount;
+    header.tableOffset = (jint)tableOffset;
+    header.namesLength = packNamesLength;
+    header.fileSize = (jint)packOffset;
+    header.reserved = 0;
+
+    /* The header is written last, so an incomplete file is never used */
+    storagePosition(&pszError, packHandle, 0);
+    if (pszError != NULL) {
+        storageFreeError(pszError);
+        return KNI_FALSE;
+    }
+
+    if (!pack_write(&header, sizeof(header))) {
+        return KNI_FALSE;
+    }
+
+    packOffset = header.fileSize;
+    return KNI_TRUE;
+}
+
 /**
  * Tests if JAR entry is a PNG or JPEG image, by name extension
  */
@@ -136,6 +428,40 @@ static jboolean image_filter(const pcsl_string * entry) {
     return KNI_FALSE;
 }
 
+/**
+ * Appends a decoded image to the cache file if the storage has space
+ * left for it.
+ *
+ * @param entry resource name of the image
+ * @param nativeBufPtr native image
+ * @param nativeBufLen length of the native image
+ * @return KNI_TRUE if the image was cached
+ */
+static jboolean store_image(const pcsl_string * entry,
+                            unsigned char *nativeBufPtr,
+                            unsigned int nativeBufLen) {
+    long spaceUsed;
+
+    if (packHandle == -1) {
+        /* The cache file is broken already, skip remaining images */
+        return KNI_FALSE;
+    }
+
+    /* Check if we can store this image in the remaining storage space */
+    spaceUsed = IMAGE_CACHE_ALIGN_UP(packOffset) - packOffset + nativeBufLen;
+    if (remainingSpace - IMAGE_CACHE_THRESHOLD < spaceUsed) {
+        return KNI_FALSE;
+    }
+
+    /* append native buffer to the cache file */
+    if (!pack_add_image(entry, nativeBufPtr, nativeBufLen)) {
+        return KNI_FALSE;
+    }
+
+    remainingSpace -= spaceUsed;
+    return KNI_TRUE;
+}
+
 /**
  * Loads PNG or JPEG image from JAR, decodes it and writes as native
  */
@@ -147,6 +473,10 @@ static jboolean image_cache_action(const pcsl_string * entry) {
     jboolean status = KNI_FALSE;
 
     do {
+        if (packHandle == -1) {
+            break;
+        }
+
         pngBufLen = midpGetJarEntry(handle, entry, &pngBufPtr);
         if (pngBufLen < 0) {
             break;
@@ -157,23 +487,10 @@ static jboolean image_cache_action(const pcsl_string * entry) {
             break;
         }
 
-        /* Check if we can store this file in the remaining storage space */
-        if (remainingSpace - IMAGE_CACHE_THRESHOLD < (long)nativeBufLen) {
-            break;
-        }
-
-        /* write native buffer to persistent store */
-        /* status = KNI_TRUE on success */
-        status = storeFileToCache(globalSuiteId, globalStorageId, entry,
-                                   nativeBufPtr, nativeBufLen);
+        status = store_image(entry, nativeBufPtr, nativeBufLen);
 
     } while (0);
 
-    if (status != KNI_FALSE) {
-        remainingSpace -= nativeBufLen;
-        cachedDataSize += nativeBufLen;
-    }
-
     if (nativeBufPtr != NULL) {
         midpFree(nativeBufPtr);
     }
@@ -184,6 +501,282 @@ static jboolean image_cache_action(const pcsl_string * entry) {
     return status;
 }
 
+#if ENABLE_IMAGE_CACHE_THREADS
+
+/** Upper limit of decoding threads */
+#ifndef IMAGE_CACHE_MAX_THREADS
+#define IMAGE_CACHE_MAX_THREADS     4
+#endif
+
+/**
+ * Bytes of JAR entries and decoded images that may wait for decoding
+ * or writing. Every decoding thread may exceed it by one image, since
+ * the size of an image is known after it is decoded only.
+ */
+#ifndef IMAGE_CACHE_DECODE_BUDGET
+#define IMAGE_CACHE_DECODE_BUDGET   (4 * 1024 * 1024)
+#endif
+
+/** One image of the JAR to be cached */
+typedef struct _ImageCacheJob {
+    /** JAR entry name */
+    pcsl_string name;
+    /** JAR entry data, owned by the decoding thread once queued */
+    unsigned char* source;
+    /** Length of the JAR entry data */
+    int sourceLength;
+    /** Decoded image, NULL if decoding failed */
+    unsigned char* native;
+    /** Length of the decoded image */
+    unsigned int nativeLength;
+    /** Set when a decoding thread has finished with the job */
+    jboolean decoded;
+} ImageCacheJob;
+
+/**
+ * Jobs shared by the thread creating the cache and the decoding threads.
+ * <p>
+ * Only the creating thread reads the JAR and writes the cache file, so
+ * jobs are read and written in JAR order and the storage, JAR and string
+ * APIs are never called concurrently. Decoding threads take the jobs in
+ * the same order. The fields below the lock are guarded by it.
+ */
+typedef struct _ImageCacheQueue {
+    pthread_mutex_t lock;
+    /** Signalled when a job is queued or the threads should stop */
+    pthread_cond_t jobQueued;
+    /** Signalled when a job is decoded */
+    pthread_cond_t jobDecoded;
+    /** All images of the JAR */
+    ImageCacheJob* jobs;
+    /** Number of used and allocated jobs */
+    int count, capacity;
+    /** Jobs before this one have their entry read and are queued */
+    int nextQueued;
+    /** Next job to be taken by a decoding thread */
+    int nextDecoded;
+    /** Bytes of entries and images that are not written yet */
+    long inFlight;
+    /** Set when decoding threads should exit */
+    jboolean stop;
+} ImageCacheQueue;
+
+/**
+ * Queue filled by image_collect_action(), the JAR iteration does not
+ * pass a context to its callbacks.
+ */
+static ImageCacheQueue* collectQueue;
+
+/**
+ * Remembers an image of the JAR, the images are cached after all
+ * have been collected.
+ */
+static jboolean image_collect_action(const pcsl_string * entry) {
+    ImageCacheQueue* q = collectQueue;
+    ImageCacheJob* job;
+
+    if (q->count == q->capacity) {
+        int capacity = (q->capacity == 0) ? 32 : q->capacity * 2;
+        void* p = midpRealloc(q->jobs, capacity * sizeof(ImageCacheJob));
+        if (p == NULL) {
+            return KNI_FALSE;
+        }
+        q->jobs = (ImageCacheJob*)p;
+        q->capacity = capacity;
+    }
+
+    job = &q->jobs[q->count];
+    memset(job, 0, sizeof(ImageCacheJob));
+    if (PCSL_STRING_OK != pcsl_string_dup(entry, &job->name)) {
+        return KNI_FALSE;
+    }
+
+    q->count++;
+    return KNI_TRUE;
+}
+
+/**
+ * Body of the decoding threads: decodes queued jobs in order until the
+ * queue is stopped.
+ */
+static void* decode_images(void* param) {
+    ImageCacheQueue* q = (ImageCacheQueue*)param;
+
+    pthread_mutex_lock(&q->lock);
+    for (;;) {
+        ImageCacheJob* job;
+        unsigned char* nativeBufPtr = NULL;
+        unsigned int nativeBufLen = 0;
+
+        while (!q->stop && q->nextDecoded == q->nextQueued) {
+            pthread_cond_wait(&q->jobQueued, &q->lock);
+        }
+        if (q->nextDecoded == q->nextQueued) {
+            break;
+        }
+
+        job = &q->jobs[q->nextDecoded++];
+        pthread_mutex_unlock(&q->lock);
+
+        if (job->source != NULL) {
+            if (img_decode_data2cache(job->source, job->sourceLength,
+                    &nativeBufPtr, &nativeBufLen) != MIDP_ERROR_NONE) {
+                nativeBufPtr = NULL;
+                nativeBufLen = 0;
+            }
+            midpFree(job->source);
+        }
+
+        pthread_mutex_lock(&q->lock);
+        q->inFlight += (long)nativeBufLen - job->sourceLength;
+        job->source = NULL;
+        job->native = nativeBufPtr;
+        job->nativeLength = nativeBufLen;
+        job->decoded = KNI_TRUE;
+        pthread_cond_signal(&q->jobDecoded);
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    return NULL;
+}
+
+/**
+ * Reads the collected images from the JAR, lets the decoding threads
+ * decode them and writes them to the cache file in JAR order.
+ *
+ * @param q collected images
+ * @param threads number of decoding threads to start
+ * @return KNI_FALSE if no decoding thread could be started
+ */
+static jboolean cache_images_in_parallel(ImageCacheQueue* q, int threads) {
+    pthread_t thread[IMAGE_CACHE_MAX_THREADS];
+    int started = 0;
+    int nextWritten = 0;
+    int i;
+
+    for (i = 0; i < threads; i++) {
+        if (pthread_create(&thread[started], NULL, decode_images, q) == 0) {
+            started++;
+        }
+    }
+    if (started == 0) {
+        return KNI_FALSE;
+    }
+
+    REPORT_INFO2(LC_LOWUI, "Caching %d images on %d threads\n",
+                 q->count, started);
+
+    pthread_mutex_lock(&q->lock);
+    while (nextWritten < q->count) {
+        ImageCacheJob* job = &q->jobs[nextWritten];
+
+        if (job->decoded) {
+            /* Write images in order as soon as they are decoded */
+            pthread_mutex_unlock(&q->lock);
+            if (job->native != NULL) {
+                (void)store_image(&job->name, job->native,
+                                  job->nativeLength);
+                midpFree(job->native);
+            }
+            pthread_mutex_lock(&q->lock);
+            q->inFlight -= job->nativeLength;
+            nextWritten++;
+        } else if (q->nextQueued < q->count &&
+                   (q->inFlight < IMAGE_CACHE_DECODE_BUDGET ||
+                    q->nextQueued == nextWritten)) {
+            /* Read the next entry while the threads decode */
+            ImageCacheJob* next = &q->jobs[q->nextQueued];
+            unsigned char* source = NULL;
+            int len;
+
+            pthread_mutex_unlock(&q->lock);
+            len = (packHandle == -1) ? -1 :
+                midpGetJarEntry(handle, &next->name, &source);
+            if (len <= 0 && source != NULL) {
+                midpFree(source);
+                source = NULL;
+            }
+            pthread_mutex_lock(&q->lock);
+
+            next->source = source;
+            next->sourceLength = (source != NULL) ? len : 0;
+            q->inFlight += next->sourceLength;
+            q->nextQueued++;
+            pthread_cond_signal(&q->jobQueued);
+        } else {
+            pthread_cond_wait(&q->jobDecoded, &q->lock);
+        }
+    }
+    q->stop = KNI_TRUE;
+    pthread_cond_broadcast(&q->jobQueued);
+    pthread_mutex_unlock(&q->lock);
+
+    for (i = 0; i < started; i++) {
+        pthread_join(thread[i], NULL);
+    }
+
+    return KNI_TRUE;
+}
+
+/**
+ * Returns the number of threads worth decoding images on.
+ */
+static int get_decode_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (cpus < 1) {
+        return 1;
+    }
+    return (cpus > IMAGE_CACHE_MAX_THREADS) ?
+        IMAGE_CACHE_MAX_THREADS : (int)cpus;
+}
+
+/**
+ * Caches all images of the open JAR using several decoding threads.
+ *
+ * @param filter Pointer to filter function
+ * @return 1 if all was successful, <= 0 if some error
+ */
+static int cacheJarFileEntriesInParallel(
+        jboolean (*filter)(const pcsl_string *)) {
+    ImageCacheQueue q;
+    int status;
+    int i;
+
+    memset(&q, 0, sizeof(q));
+    pthread_mutex_init(&q.lock, NULL);
+    pthread_cond_init(&q.jobQueued, NULL);
+    pthread_cond_init(&q.jobDecoded, NULL);
+
+    collectQueue = &q;
+    status = midpIterateJarEntries(handle, filter,
+        (jboolean (*)(const pcsl_string *))&image_collect_action);
+    collectQueue = NULL;
+
+    if (status == 1 && q.count > 0 &&
+            !cache_images_in_parallel(&q, get_decode_threads())) {
+        /* No threads available, cache the images one by one */
+        for (i = 0; i < q.count; i++) {
+            (void)image_cache_action(&q.jobs[i].name);
+        }
+    }
+
+    for (i = 0; i < q.count; i++) {
+        pcsl_string_free(&q.jobs[i].name);
+    }
+    if (q.jobs != NULL) {
+        midpFree(q.jobs);
+    }
+
+    pthread_cond_destroy(&q.jobDecoded);
+    pthread_cond_destroy(&q.jobQueued);
+    pthread_mutex_destroy(&q.lock);
+
+    return status;
+}
+
+#endif /* ENABLE_IMAGE_CACHE_THREADS */
+
 /**
  * Iterates over all images in a jar, and tries to load and cached them.
  *
@@ -207,6 +800,11 @@ static int loadAndCacheJarFileEntries(const pcsl_string * jarFileName,
         handle = NULL;
         return status;
     }
+#if ENABLE_IMAGE_CACHE_THREADS
+    if (action == image_cache_action && get_decode_threads() > 1) {
+        status = cacheJarFileEntriesInParallel(filter);
+    } else
+#endif
     status = midpIterateJarEntries(handle, filter, action);
 
     midpCloseJar(handle);
@@ -215,6 +813,26 @@ static int loadAndCacheJarFileEntries(const pcsl_string * jarFileName,
     return status;
 }
 
+/**
+ * Releases the cache file loaded by loadImageFromCache().
+ */
+void releaseImageCache(void) {
+    if (loadedCache.map != NULL) {
+        storage_unmap_file(loadedCache.map, loadedCache.mapSize);
+    }
+    if (loadedCache.index != NULL) {
+        midpFree(loadedCache.index);
+    }
+    pcsl_string_free(&loadedCache.path);
+
+    loadedCache.suiteId = UNUSED_SUITE_ID;
+    loadedCache.map = NULL;
+    loadedCache.mapSize = 0;
+    loadedCache.index = NULL;
+    loadedCache.header = NULL;
+    loadedCache.entries = NULL;
+    loadedCache.names = NULL;
+}
 
 /**
  * Creates a cache of natives images by iterating over all png and jpeg images
@@ -229,28 +847,24 @@ static int loadAndCacheJarFileEntries(const pcsl_string * jarFileName,
 void createImageCache(SuiteIdType suiteId, StorageIdType storageId,
                       jint* pOutDataSize) {
     pcsl_string jarFileName;
+    pcsl_string packFileName;
     int result;
     jint errorCode;
+    char* pszError;
 
     if (suiteId == UNUSED_SUITE_ID) {
         return;
     }
 
-    /*
-     * This makes the code non-reentrant and unsafe for threads,
-     * but that is ok
-     */
-    globalSuiteId   = suiteId;
-    globalStorageId = storageId;
-
-    cachedDataSize = 0;
-    
     /*
      * First, blow away any existing cache. Note: when a suite is
      * removed, midp_remove_suite() removes all files associated with
      * a suite, including the cache, so we don't have to do it
      * explicitly.
      */
+    if (loadedCache.suiteId == suiteId) {
+        releaseImageCache();
+    }
     deleteFileCache(suiteId, storageId);
 
     /* Get the amount of space available at this point */
@@ -263,9 +877,69 @@ void createImageCache(SuiteIdType suiteId, StorageIdType storageId,
         return;
     }
 
-    result = loadAndCacheJarFileEntries(&jarFileName,
-        (jboolean (*)(const pcsl_string *))&image_filter,
-        (jboolean (*)(const pcsl_string *))&image_cache_action);
+    errorCode = midp_suite_get_cached_resource_filename(suiteId, storageId,
+                                                        &IMAGE_CACHE_NAME,
+                                                        &packFileName);
+    if (errorCode != MIDP_ERROR_NONE) {
+        pcsl_string_free(&jarFileName);
+        return;
+    }
+
+    packHandle = storage_open(&pszError, &packFileName,
+                              OPEN_READ_WRITE_TRUNCATE);
+    if (pszError != NULL) {
+        REPORT_WARN1(LC_LOWUI, "Warning: could not open image cache; %s\n",
+                     pszError);
+        storageFreeError(pszError);
+        packHandle = -1;
+    }
+
+    /*
+     * This makes the code non-reentrant and unsafe for threads,
+     * but that is ok
+     */
+    packOffset = 0;
+    packEntries = NULL;
+    packCount = packCapacity = 0;
+    packNames = NULL;
+    packNamesLength = packNamesCapacity = 0;
+
+    result = 0;
+    if (packHandle != -1) {
+        ImageCacheHeader header;
+
+        /* Reserve the space for the header written by pack_finish() */
+        memset(&header, 0, sizeof(header));
+        if (pack_write(&header, sizeof(header))) {
+            result = loadAndCacheJarFileEntries(&jarFileName,
+                (jboolean (*)(const pcsl_string *))&image_filter,
+                (jboolean (*)(const pcsl_string *))&image_cache_action);
+        }
+
+        if (result == 1 && !pack_finish()) {
+            result = 0;
+        }
+
+        if (packHandle != -1) {
+            storageClose(&pszError, packHandle);
+            if (pszError != NULL) {
+                storageFreeError(pszError);
+                result = 0;
+            }
+            packHandle = -1;
+        } else {
+            result = 0;
+        }
+    }
+
+    if (packEntries != NULL) {
+        midpFree(packEntries);
+        packEntries = NULL;
+    }
+    if (packNames != NULL) {
+        midpFree(packNames);
+        packNames = NULL;
+    }
 
     /* If something went wrong then clean up anything that was created */
     if (result != 1) {
@@ -278,10 +952,12 @@ void createImageCache(SuiteIdType suiteId, StorageIdType storageId,
         }
     } else {
         if (pOutDataSize != NULL) {
-            *pOutDataSize = (jint)cachedDataSize;
+            /* Header, table and names are accounted as well */
+            *pOutDataSize = (jint)packOffset;
         }
     }
 
+    pcsl_string_free(&packFileName);
     pcsl_string_free(&jarFileName);
 }
 
@@ -296,9 +972,299 @@ void createImageCache(SuiteIdType suiteId, StorageIdType storageId,
  */
 void moveImageCache(SuiteIdType suiteId, StorageIdType storageIdFrom,
                     StorageIdType storageIdTo) {
+    if (loadedCache.suiteId == suiteId) {
+        releaseImageCache();
+    }
     moveFileCache(suiteId, storageIdFrom, storageIdTo);
 }
 
+/**
+ * Checks the header of a cache file against the size of the file.
+ *
+ * @return KNI_TRUE if the table and the names lie within the file
+ */
+static jboolean check_header(const ImageCacheHeader* header, long size) {
+    long tableEnd;
+
+    if (header->magic != IMAGE_CACHE_MAGIC || header->fileSize != size ||
+            header->entryCount < 0 || header->namesLength < 0 ||
+            header->tableOffset < (jint)sizeof(ImageCacheHeader) ||
+            (header->tableOffset & (IMAGE_CACHE_ALIGN - 1)) != 0) {
+        return KNI_FALSE;
+    }
+
+    tableEnd = (long)header->tableOffset +
+        (long)header->entryCount * (long)sizeof(ImageCacheEntry);
+    if (tableEnd > size || tableEnd < header->tableOffset ||
+            (size - tableEnd) / (long)sizeof(jchar) != header->namesLength) {
+        return KNI_FALSE;
+    }
+
+    return KNI_TRUE;
+}
+
+/**
+ * Reads the header, the table and the names of a cache file that
+ * could not be mapped.
+ *
+ * @return KNI_TRUE if the index was read
+ */
+static jboolean read_index(ImageCacheFile* cache) {
+    ImageCacheHeader header;
+    char* pszError;
+    long indexSize;
+    long bytesRead;
+    jboolean status = KNI_FALSE;
+    int fd;
+
+    fd = storage_open(&pszError, &cache->path, OPEN_READ);
+    if (pszError != NULL) {
+        storageFreeError(pszError);
+        return KNI_FALSE;
+    }
+
+    do {
+        bytesRead = storageRead(&pszError, fd, (char*)&header,
+                                sizeof(header));
+        if (pszError != NULL) {
+            storageFreeError(pszError);
+            break;
+        }
+        if (bytesRead != sizeof(header) ||
+                !check_header(&header, storageSizeOf(&pszError, fd))) {
+            storageFreeError(pszError);
+            break;
+        }
+
+        indexSize = header.fileSize - header.tableOffset;
+        cache->index = (unsigned char*)midpMalloc(sizeof(header) + indexSize);
+        if (cache->index == NULL) {
+            break;
+        }
+        memcpy(cache->index, &header, sizeof(header));
+
+        storagePosition(&pszError, fd, header.tableOffset);
+        if (pszError != NULL) {
+            storageFreeError(pszError);
+            break;
+        }
+        bytesRead = storageRead(&pszError, fd,
+            (char*)cache->index + sizeof(header), indexSize);
+        if (pszError != NULL) {
+            storageFreeError(pszError);
+            break;
+        }
+        if (bytesRead != indexSize && indexSize != 0) {
+            break;
+        }
+
+        cache->header = (const ImageCacheHeader*)cache->index;
+        cache->entries = (const ImageCacheEntry*)
+            (cache->index + sizeof(header));
+        status = KNI_TRUE;
+    } while (0);
+
+    storageClose(&pszError, fd);
+    storageFreeError(pszError);
+
+    if (!status && cache->index != NULL) {
+        midpFree(cache->index);
+        cache->index = NULL;
+    }
+
+    return status;
+}
+
+/**
+ * Makes the cache file of the given suite the loaded one.
+ *
+ * @param suiteId The suite ID
+ * @return KNI_TRUE if the suite has a usable image cache
+ */
+static jboolean load_cache(SuiteIdType suiteId) {
+    ImageCacheFile* cache = &loadedCache;
+    StorageIdType storageId;
+    char* pszError;
+
+    if (cache->suiteId == suiteId) {
+        return (cache->header != NULL) ? KNI_TRUE : KNI_FALSE;
+    }
+
+    releaseImageCache();
+
+    /*
+     * IMPL_NOTE: here is assumed that the image cache is located in
+     * the same storage as the midlet suite. This may not be true.
+     */
+    if (midp_suite_get_suite_storage(suiteId, &storageId) != ALL_OK) {
+        return KNI_FALSE;
+    }
+
+    if (midp_suite_get_cached_resource_filename(suiteId, storageId,
+            &IMAGE_CACHE_NAME, &cache->path) != ALL_OK) {
+        return KNI_FALSE;
+    }
+
+    /* The result is remembered, so a suite without cache is checked once */
+    cache->suiteId = suiteId;
+
+    cache->map = storage_map_file(&pszError, &cache->path, &cache->mapSize);
+    if (cache->map != NULL) {
+        if (cache->mapSize >= (long)sizeof(ImageCacheHeader) &&
+                check_header((const ImageCacheHeader*)cache->map,
+                             cache->mapSize)) {
+            cache->header = (const ImageCacheHeader*)cache->map;
+            cache->entries = (const ImageCacheEntry*)
+                (cache->map + cache->header->tableOffset);
+        } else {
+            storage_unmap_file(cache->map, cache->mapSize);
+            cache->map = NULL;
+            cache->mapSize = 0;
+        }
+    } else {
+        storageFreeError(pszError);
+        (void)read_index(cache);
+    }
+
+    if (cache->header == NULL) {
+        return KNI_FALSE;
+    }
+
+    cache->names = (const jchar*)(cache->entries + cache->header->entryCount);
+    return KNI_TRUE;
+}
+
+/**
+ * Looks up an image in the loaded cache file.
+ *
+ * @param name resource name of the image
+ * @param nameLength length of the name, in characters
+ * @return the entry of the image, NULL if it is not cached
+ */
+static const ImageCacheEntry* find_image(const jchar* name,
+                                         jsize nameLength) {
+    const ImageCacheHeader* header = loadedCache.header;
+    const ImageCacheEntry* entries = loadedCache.entries;
+    unsigned int hash = (unsigned int)hashName(name, nameLength);
+    int low = 0;
+    int high = header->entryCount;
+
+    /* Find the first entry with the hash */
+    while (low < high) {
+        int mid = (low + high) >> 1;
+        if ((unsigned int)entries[mid].hash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    for (; low < header->entryCount &&
+             (unsigned int)entries[low].hash == hash; low++) {
+        const ImageCacheEntry* e = &entries[low];
+
+        if (e->nameLength == nameLength && e->nameOffset >= 0 &&
+                e->nameOffset <= header->namesLength - nameLength &&
+                memcmp(loadedCache.names + e->nameOffset, name,
+                       nameLength * sizeof(jchar)) == 0) {
+            /* Never trust offsets taken from a file */
+            if (e->dataOffset < (jint)sizeof(ImageCacheHeader) ||
+                    e->dataLength < 0 ||
+                    e->dataOffset > header->tableOffset - e->dataLength) {
+                return NULL;
+            }
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Gets a native image from cache, if present, without copying it when
+ * the cache file is mapped into memory.
+ *
+ * @param suiteId    The suite id
+ * @param resName    The image resource name
+ * @param pData      [out] points to the native image
+ * @param pCopy      [out] buffer allocated for the image when the cache
+ *                   is not mapped, NULL otherwise; caller must free it
+ * @return           -1 if failed, else length of the image
+ */
+int getImageFromCache(SuiteIdType suiteId, const pcsl_string * resName,
+                      const unsigned char **pData, unsigned char **pCopy) {
+    const ImageCacheEntry* e;
+    const jchar* name;
+    jsize nameLength;
+    int len = -1;
+
+    *pData = NULL;
+    *pCopy = NULL;
+
+    if (suiteId == UNUSED_SUITE_ID || pcsl_string_is_null(resName)) {
+        return -1;
+    }
+
+    if (!load_cache(suiteId)) {
+        return -1;
+    }
+
+    name = pcsl_string_get_utf16_data(resName);
+    nameLength = pcsl_string_length(resName);
+    if (name == NULL) {
+        return -1;
+    }
+
+    /* If resource starts with slash, skip it */
+    if (nameLength > 0 && name[0] == '/') {
+        e = find_image(name + 1, nameLength - 1);
+    } else {
+        e = find_image(name, nameLength);
+    }
+    pcsl_string_release_utf16_data(name, resName);
+
+    if (e == NULL) {
+        return -1;
+    }
+
+    if (loadedCache.map != NULL) {
+        *pData = loadedCache.map + e->dataOffset;
+        return e->dataLength;
+    }
+
+    /* Not mapped: read the image with one seek and one read */
+    *pCopy = (unsigned char*)midpMalloc(e->dataLength);
+    if (*pCopy != NULL) {
+        char* pszError;
+        int fd = storage_open(&pszError, &loadedCache.path, OPEN_READ);
+
+        if (pszError != NULL) {
+            REPORT_WARN1(LC_LOWUI, "Warning: could not load cached image; %s\n",
+                         pszError);
+            storageFreeError(pszError);
+        } else {
+            storagePosition(&pszError, fd, e->dataOffset);
+            if (pszError != NULL) {
+                storageFreeError(pszError);
+            } else if (storageRead(&pszError, fd, (char*)*pCopy,
+                                   e->dataLength) == e->dataLength) {
+                len = e->dataLength;
+            }
+            storageFreeError(pszError);
+            storageClose(&pszError, fd);
+            storageFreeError(pszError);
+        }
+
+        if (len == -1) {
+            midpFree(*pCopy);
+            *pCopy = NULL;
+        } else {
+            *pData = *pCopy;
+        }
+    }
+
+    return len;
+}
 
 /**
  * Loads a native image from cache, if present.
@@ -310,7 +1276,23 @@ void moveImageCache(SuiteIdType suiteId, StorageIdType storageIdFrom,
  */
 int loadImageFromCache(SuiteIdType suiteId, const pcsl_string * resName,
                        unsigned char **bufPtr) {
+    const unsigned char* data;
+    unsigned char* copy;
+    int len;
 
-    return loadFileFromCache(suiteId, resName, bufPtr);
-}
+    len = getImageFromCache(suiteId, resName, &data, &copy);
+    if (len == -1) {
+        return -1;
+    }
 
+    if (copy == NULL) {
+        copy = (unsigned char*)midpMalloc(len > 0 ? len : 1);
+        if (copy == NULL) {
+            return -1;
+        }
+        memcpy(copy, data, len);
+    }
+
+    *bufPtr = copy;
+    return len;
+}
@@ -40,11 +40,60 @@ static int makeCodeTable(InflaterState *state,
                          unsigned maxQuickBits,
                          void** result);
 
+static int makeFastTable(InflaterState *state,
+                         unsigned char *codelen,
+                         unsigned numElems,
+                         unsigned rootBits,
+                         int distances,
+                         void** result);
+
 static int inflateHuffman(InflaterState *state, int fixedHuffman);
+static int inflateFast(InflaterState *state,
+                       const InflateCodeTable *lcodes,
+                       const InflateCodeTable *dcodes,
+                       unsigned char *outBuffer, int *endOfBlock);
 static int inflateStored(InflaterState *state);
+static int inflateBlocks(InflaterState *state);
+static int flushOutput(InflaterState *state);
 
 #define INFLATER_EXTRA_BYTES 4
 
+/* The longest match a length code can produce */
+#define MAX_MATCH_LENGTH 258
+
+/*
+ * The fast loop decodes a whole length/distance pair from its bit
+ * buffer, which takes up to 48 bits, and tops it up to at least 56
+ * bits before every code.
+ */
+typedef unsigned long long InflateBits;
+
+/* Bytes of input a refill of the fast loop can look at */
+#define FAST_INPUT_BYTES 8
+
+/*
+ * On little endian CPUs the fast loop refills its bit buffer with one
+ * unaligned 8 byte load, the bytes beyond the refill are loaded again
+ * by the next one.
+ */
+#if !defined(INFLATE_LOAD_WORDS)
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define INFLATE_LOAD_WORDS 1
+#else
+#define INFLATE_LOAD_WORDS 0
+#endif
+#endif
+
+/*
+ * True when the output of a sink mode inflater has to be flushed to
+ * make room for the next <n> bytes. Output that fits into the rest of
+ * the buffer is kept there until the end.
+ */
+#define OUTPUT_FULL(n)                                        \
+    (outOffset + (n) > outLength && state->sink != NULL &&    \
+     state->outDropped + outLength < state->outExpected)
+
 /**
  * Inflates the data in a file.
  * <p>
@@ -76,7 +125,6 @@ int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
     /* The macros LOAD_IN, LOAD_OUT,etc. use a variable called "state" */
     InflaterState stateStruct;
     InflaterState* state = &stateStruct;
-    int result = 0;
 
     state->outBuffer = decompBuffer;
     state->outOffset = 0;
@@ -98,6 +146,115 @@ int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
     state->inflateBufferIndex = 0;
     state->inflateBufferCount = 0;
 
+    state->sink = NULL;
+    state->sinkState = NULL;
+    state->outFlushed = 0;
+    state->outDropped = 0;
+    state->outExpected = decompLen;
+
+    return inflateBlocks(state);
+}
+
+/**
+ * Inflates the data in a file passing it to a sink function in pieces.
+ * The output is collected in the buffer and given to the sink when
+ * the buffer is full, then the last INFLATE_WINDOW_SIZE bytes are
+ * moved to the buffer start to serve back references.
+ *
+ * @param fileObj File object for reading the compressed data with the
+ *                current file position set to the beginning of the data
+ * @param heapManObj Heap manager object for temp data
+ * @param compLen Length of the compressed data
+ * @param buffer inflater window, not a memory handle
+ * @param bufferLen size of the buffer
+ * @param decompLen Expected length of the uncompressed data
+ * @param sink function receiving the uncompressed data in order
+ * @param sinkState value passed to the sink function
+ *
+ * @return 0 if the data was inflated and the size of the decoded data
+ *         is exactly <decompLen>, one of the inflate errors otherwise
+ */
+int inflateDataToSink(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
+                      unsigned char* buffer, int bufferLen, int decompLen,
+                      InflateSinkFunction sink, void* sinkState) {
+    InflaterState stateStruct;
+    InflaterState* state = &stateStruct;
+
+    if (bufferLen < decompLen && bufferLen < INFLATE_MIN_SINK_BUFFER_SIZE) {
+        return INFLATE_OUTPUT_OVERFLOW;
+    }
+
+    state->outBuffer = buffer;
+    state->outOffset = 0;
+    state->outLength = (bufferLen < decompLen) ? bufferLen : decompLen;
+    state->outBufferIsAHandle = 0;
+
+    state->fileState = fileObj->state;
+    state->getBytes = fileObj->read;
+
+    state->heapState = heapManObj->state;
+    state->mallocBytes = heapManObj->alloc;
+    state->freeBytes = heapManObj->free;
+    state->addrFromHandle = heapManObj->addrFromHandle;
+
+    state->inData = 0;
+    state->inDataSize = 0;
+    state->inRemaining = compLen + INFLATER_EXTRA_BYTES;
+
+    state->inflateBufferIndex = 0;
+    state->inflateBufferCount = 0;
+
+    state->sink = sink;
+    state->sinkState = sinkState;
+    state->outFlushed = 0;
+    state->outDropped = 0;
+    state->outExpected = decompLen;
+
+    return inflateBlocks(state);
+}
+
+/**
+ * Gives the output not seen by the sink yet to it. If more output is
+ * expected than fits into the buffer, moves the last
+ * INFLATE_WINDOW_SIZE bytes to the buffer start.
+ *
+ * @return 0 on success, an inflate error otherwise
+ */
+static int flushOutput(InflaterState *state) {
+    unsigned char *outBuffer = state->outBuffer;
+    unsigned long outOffset = state->outOffset;
+
+    if (state->outDropped + outOffset > state->outExpected) {
+        return INFLATE_OUTPUT_OVERFLOW;
+    }
+
+    if (outOffset > state->outFlushed) {
+        if (state->sink(state->sinkState, outBuffer + state->outFlushed,
+                        (int)(outOffset - state->outFlushed)) != 0) {
+            return INFLATE_SINK_ERROR;
+        }
+        state->outFlushed = outOffset;
+    }
+
+    if (outOffset > INFLATE_WINDOW_SIZE &&
+            state->outDropped + state->outLength < state->outExpected) {
+        memmove(outBuffer, outBuffer + outOffset - INFLATE_WINDOW_SIZE,
+                INFLATE_WINDOW_SIZE);
+        state->outDropped += outOffset - INFLATE_WINDOW_SIZE;
+        state->outOffset = state->outFlushed = INFLATE_WINDOW_SIZE;
+    }
+
+    return 0;
+}
+
+/**
+ * Inflates the blocks of deflated data up to the final one.
+ *
+ * @return 0 on success, an inflate error otherwise
+ */
+static int inflateBlocks(InflaterState *state) {
+    int result = 0;
+
     for (; ; ) {
         int type;
         DECLARE_IN_VARIABLES
@@ -138,6 +295,19 @@ int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
                 break;
             }
 
+            if (state->sink != NULL) {
+                result = flushOutput(state);
+                if (result != 0) {
+                    break;
+                }
+
+                if (state->outDropped + state->outOffset !=
+                        state->outExpected) {
+                    result = INFLATE_OUTPUT_BIT_ERROR;
+                }
+                break;
+            }
+
             if (state->outOffset != state->outLength) {
                 result = INFLATE_OUTPUT_BIT_ERROR;
                 break;
@@ -171,10 +341,11 @@ static int inflateStored(InflaterState *state) {
         return INFLATE_BAD_LENGTH_FIELD;
     } else if (inRemaining < len) {
         return INFLATE_INPUT_OVERFLOW;
-    } else if (outOffset + len > outLength) {
+    } else if (state->sink == NULL && outOffset + len > outLength) {
         return INFLATE_OUTPUT_OVERFLOW;
     } else {
         int count;
+        int error;
 
         if (state->outBufferIsAHandle) {
             /* This is to support heaps with memory compaction. */
@@ -183,12 +354,29 @@ static int inflateStored(InflaterState *state) {
         }
 
         while (len > 0) {
+            if (OUTPUT_FULL(1)) {
+                STORE_OUT;
+                error = flushOutput(state);
+                if (error != 0) {
+                    return error;
+                }
+                LOAD_OUT;
+            }
+
+            if (outOffset >= outLength) {
+                return INFLATE_OUTPUT_OVERFLOW;
+            }
+
             if (state->inflateBufferCount > 0) {
                 /* we have data buffered, copy it first */
+                count = (state->inflateBufferCount <= len ?
+                         state->inflateBufferCount : len);
+                if ((unsigned long)count > outLength - outOffset) {
+                    count = (int)(outLength - outOffset);
+                }
                 memcpy(&outBuffer[outOffset],
                        &(state->inflateBuffer[state->inflateBufferIndex]),
-                       (count = (state->inflateBufferCount <= len ?
-                                 state->inflateBufferCount : len)));
+                       count);
                 len -= count;
                 (state->inflateBufferCount) -= count;
                 (state->inflateBufferIndex) += count;
@@ -196,7 +384,7 @@ static int inflateStored(InflaterState *state) {
                 inRemaining -= count;
             }
 
-            if (len > 0) {
+            if (len > 0 && outOffset < outLength) {
                 /* need more, refill the buffer */
                 outBuffer[outOffset++] = (unsigned char)(NEXTBYTE);
                 len--;
@@ -215,32 +403,44 @@ static int inflateHuffman(InflaterState *state, int fixedHuffman) {
     DECLARE_IN_VARIABLES
     DECLARE_OUT_VARIABLES
 
-    unsigned int quickDataSize = 0;
-    unsigned int quickDistanceSize = 0;
-    unsigned int code;
-    unsigned int litxlen;
+    InflateCode code;
+    int endOfBlock = 0;
     void* lcodesMemHandle = NULL;
     void* dcodesMemHandle = NULL;
-    HuffmanCodeTable* lcodes = NULL;
-    HuffmanCodeTable* dcodes = NULL;
-
-    if (!fixedHuffman) {
+    InflateCodeTable* lcodes = NULL;
+    InflateCodeTable* dcodes = NULL;
+
+    if (fixedHuffman) {
+        unsigned char codelen[288 + 32];
+
+        /* The fixed codes of section 3.2.6 of RFC 1951 */
+        memset(codelen, 8, 144);
+        memset(codelen + 144, 9, 256 - 144);
+        memset(codelen + 256, 7, 280 - 256);
+        memset(codelen + 280, 8, 288 - 280);
+        memset(codelen + 288, 5, 32);
+
+        error = makeFastTable(state, codelen, 288, INFLATE_LITLEN_ROOT_BITS,
+                              0, &lcodesMemHandle);
+        if (error == 0) {
+            error = makeFastTable(state, codelen + 288, 32,
+                                  INFLATE_DIST_ROOT_BITS, 1,
+                                  &dcodesMemHandle);
+        }
+    } else {
         error = decodeDynamicHuffmanTables(state, &lcodesMemHandle,
                                            &dcodesMemHandle);
-        if (error != 0) {
-            return error;
-        }
-
-        /* This is to support heaps with memory compaction. */
-        lcodes = state->addrFromHandle(state->heapState,
-                                       lcodesMemHandle);
-        dcodes = state->addrFromHandle(state->heapState,
-                                       dcodesMemHandle);
+    }
 
-        quickDataSize = lcodes->h.quickBits;
-        quickDistanceSize = dcodes->h.quickBits;
+    if (error != 0) {
+        state->freeBytes(state->heapState, lcodesMemHandle);
+        return error;
     }
 
+    /* This is to support heaps with memory compaction. */
+    lcodes = state->addrFromHandle(state->heapState, lcodesMemHandle);
+    dcodes = state->addrFromHandle(state->heapState, dcodesMemHandle);
+
     LOAD_IN;
     LOAD_OUT;
 
@@ -256,76 +456,69 @@ static int inflateHuffman(InflaterState *state, int fixedHuffman) {
             break;
         }
 
-        NEEDBITS(MAX_BITS + MAX_ZIP_EXTRA_LENGTH_BITS);
+        if (OUTPUT_FULL(MAX_MATCH_LENGTH)) {
+            STORE_OUT;
+            error = flushOutput(state);
+            if (error != 0) {
+                break;
+            }
+            LOAD_OUT;
+        }
 
-        if (fixedHuffman) {
-            /*   literal (hex)
-             * 0x100 - 0x117   7   0.0000.00   -  0.0101.11
-             *     0 -    8f   8   0.0110.000  -  1.0111.111
-             *   118 -   11f   8   1.1000.000  -  1.1000.111
-             *    90 -    ff   9   1.1001.0000 -  1.1111.1111
-             */
+        if (state->inflateBufferCount >= FAST_INPUT_BYTES &&
+                inRemaining >= FAST_INPUT_BYTES &&
+                outOffset + MAX_MATCH_LENGTH <= outLength) {
+            /* Decode as much as possible without checks per byte */
+            STORE_IN;
+            STORE_OUT;
+            error = inflateFast(state, lcodes, dcodes, outBuffer,
+                                &endOfBlock);
+            LOAD_IN;
+            LOAD_OUT;
+            if (error != 0 || endOfBlock) {
+                break;
+            }
 
-            /* Get 9 bits, and reverse them. */
-            code = NEXTBITS(9);
-            code = REVERSE_9BITS(code);
-
-            if (code <  0x060) {
-                /* A 7-bit code  */
-                DUMPBITS(7);
-                litxlen = 0x100 + (code >> 2);
-            } else if (code < 0x190) {
-                DUMPBITS(8);
-                litxlen = (code >> 1) + ((code < 0x180) ? (0x000 - 0x030)
-                                         : (0x118 - 0x0c0));
-            } else {
-                DUMPBITS(9);
-                litxlen = 0x90 + code - 0x190;
+            /* Out of buffered input or output space, go on slowly */
+            if (inRemaining < 0) {
+                error = INFLATE_EARLY_END_OF_INPUT;
+                break;
+            }
+
+            if (OUTPUT_FULL(MAX_MATCH_LENGTH)) {
+                continue;
             }
-        } else {
-            GET_HUFFMAN_ENTRY(lcodes, quickDataSize, litxlen);
         }
 
-        if (litxlen <= 255) {
+        NEEDBITS(MAX_BITS + MAX_ZIP_EXTRA_LENGTH_BITS);
+        GET_INFLATE_CODE(lcodes, code, INFLATE_INVALID_LITERAL_OR_LENGTH);
+
+        if (code.op == INFLATE_OP_LITERAL) {
             if (outOffset < outLength) {
-                outBuffer[outOffset] = litxlen;
+                outBuffer[outOffset] = (unsigned char)code.val;
                 outOffset++;
             } else {
                 /* success */
                 break;
             }
-        } else if (litxlen == 256) {               /* end of block */
+        } else if (code.op == INFLATE_OP_END) {     /* end of block */
             /* success */
             break;
-        } else if (litxlen > 285) {
-            error = INFLATE_INVALID_LITERAL_OR_LENGTH;
-            break;
         } else {
-            unsigned int n = litxlen - LITXLEN_BASE;
-            unsigned int length = ll_length_base[n];
-            unsigned int moreBits = ll_extra_bits[n];
-            unsigned int d0, distance;
+            unsigned int length = code.val;
+            unsigned int moreBits = code.op & INFLATE_OP_BITS;
+            unsigned int distance;
 
             /* The NEEDBITS(..) above took care of this */
             length += NEXTBITS(moreBits);
             DUMPBITS(moreBits);
 
             NEEDBITS(MAX_BITS);
-            if (fixedHuffman) {
-                d0 = REVERSE_5BITS(NEXTBITS(5));
-                DUMPBITS(5);
-            } else {
-                GET_HUFFMAN_ENTRY(dcodes, quickDistanceSize, d0);
-            }
-
-            if (d0 > MAX_ZIP_DISTANCE_CODE) {
-                error = INFLATE_BAD_DISTANCE_CODE;
-                break;
-            }
+            GET_INFLATE_CODE(dcodes, code, INFLATE_BAD_DISTANCE_CODE);
 
             NEEDBITS(MAX_ZIP_EXTRA_DISTANCE_BITS)
-            distance = dist_base[d0];
-            moreBits = dist_extra_bits[d0];
+            distance = code.val;
+            moreBits = code.op & INFLATE_OP_BITS;
             distance += NEXTBITS(moreBits);
             DUMPBITS(moreBits);
 
@@ -352,11 +545,193 @@ static int inflateHuffman(InflaterState *state, int fixedHuffman) {
     STORE_IN;
     STORE_OUT;
 
-    if (!fixedHuffman) {
-        state->freeBytes(state->heapState, lcodesMemHandle);
-        state->freeBytes(state->heapState, dcodesMemHandle);
+    state->freeBytes(state->heapState, lcodesMemHandle);
+    state->freeBytes(state->heapState, dcodesMemHandle);
+
+    return error;
+}
+
+/**
+ * Decodes literal/length and distance codes while there are enough
+ * bytes in the input buffer for a refill of the 64-bit bit buffer and
+ * enough room in the output buffer for the longest match, so that
+ * neither has to be checked per byte. Matches are copied 8 bytes at
+ * a time where they do not overlap within a word.
+ * <p>
+ * On return the whole bytes of the bit buffer loaded by this function
+ * are given back to the input buffer.</p>
+ *
+ * @param lcodes literal/length code table
+ * @param dcodes distance code table
+ * @param outBuffer address of the output buffer
+ * @param endOfBlock set to non-zero if the end of block code was read
+ *
+ * @return 0 on success, an inflate error otherwise
+ */
+static int inflateFast(InflaterState *state,
+                       const InflateCodeTable *lcodes,
+                       const InflateCodeTable *dcodes,
+                       unsigned char *outBuffer, int *endOfBlock) {
+    InflateBits hold = state->inData;
+    unsigned int bitsIn = state->inDataSize;
+    const unsigned char *in =
+        state->inflateBuffer + state->inflateBufferIndex;
+    long avail = state->inflateBufferCount;
+    long loaded = 0;
+    long inRemaining = state->inRemaining;
+    unsigned long outOffset = state->outOffset;
+    unsigned long outLength = state->outLength;
+    unsigned long outLimit = outLength - MAX_MATCH_LENGTH;
+    InflateBits lmask = ((InflateBits)1 << lcodes->h.rootBits) - 1;
+    InflateBits dmask = ((InflateBits)1 << dcodes->h.rootBits) - 1;
+    InflateCode code;
+    unsigned int op;
+    unsigned long n;
+    int error = 0;
+
+    *endOfBlock = 0;
+
+    while (avail >= FAST_INPUT_BYTES && inRemaining >= FAST_INPUT_BYTES &&
+           outOffset <= outLimit) {
+        if (bitsIn <= 56) {
+            /* Top up the bit buffer to 56..63 bits */
+            unsigned int count = (63 - bitsIn) >> 3;
+#if INFLATE_LOAD_WORDS
+            InflateBits word;
+
+            memcpy(&word, in, sizeof (word));
+            hold |= word << bitsIn;
+            in += count;
+#else
+            unsigned int i;
+
+            for (i = 0; i < count; i++) {
+                hold |= (InflateBits)(*in++) << (bitsIn + (i << 3));
+            }
+#endif
+            bitsIn += count << 3;
+            avail -= count;
+            loaded += count;
+            inRemaining -= count;
+        }
+
+        code = lcodes->entries[hold & lmask];
+        if ((code.op & INFLATE_OP_MASK) == INFLATE_OP_LINK) {
+            hold >>= lcodes->h.rootBits;
+            bitsIn -= lcodes->h.rootBits;
+            code = lcodes->entries[code.val +
+                (hold & (((InflateBits)1 << (code.op & INFLATE_OP_BITS)) - 1))];
+        }
+        hold >>= code.bits;
+        bitsIn -= code.bits;
+        op = code.op & INFLATE_OP_MASK;
+
+        if (op == INFLATE_OP_LITERAL) {
+            outBuffer[outOffset++] = (unsigned char)code.val;
+
+            /* More than 41 bits are left, enough for another literal */
+            code = lcodes->entries[hold & lmask];
+            if (code.op != INFLATE_OP_LITERAL) {
+                continue;
+            }
+            hold >>= code.bits;
+            bitsIn -= code.bits;
+            outBuffer[outOffset++] = (unsigned char)code.val;
+            continue;
+        }
+
+        if (op != INFLATE_OP_BASE) {
+            if (op == INFLATE_OP_END) {
+                *endOfBlock = 1;
+            } else {
+                error = (op == INFLATE_OP_BAD) ?
+                    INFLATE_INVALID_LITERAL_OR_LENGTH :
+                    INFLATE_HUFFMAN_ENTRY_ERROR;
+            }
+            break;
+        }
+
+        /* A length and a distance follow */
+        n = code.op & INFLATE_OP_BITS;
+        {
+            unsigned long length = code.val +
+                (unsigned long)(hold & (((InflateBits)1 << n) - 1));
+            unsigned long distance;
+            unsigned char *dst;
+            const unsigned char *src;
+
+            hold >>= n;
+            bitsIn -= n;
+
+            code = dcodes->entries[hold & dmask];
+            if ((code.op & INFLATE_OP_MASK) == INFLATE_OP_LINK) {
+                hold >>= dcodes->h.rootBits;
+                bitsIn -= dcodes->h.rootBits;
+                code = dcodes->entries[code.val +
+                    (hold & (((InflateBits)1 <<
+                              (code.op & INFLATE_OP_BITS)) - 1))];
+            }
+            hold >>= code.bits;
+            bitsIn -= code.bits;
+            op = code.op & INFLATE_OP_MASK;
+
+            if (op != INFLATE_OP_BASE) {
+                error = (op == INFLATE_OP_BAD) ? INFLATE_BAD_DISTANCE_CODE :
+                    INFLATE_HUFFMAN_ENTRY_ERROR;
+                break;
+            }
+
+            n = code.op & INFLATE_OP_BITS;
+            distance = code.val +
+                (unsigned long)(hold & (((InflateBits)1 << n) - 1));
+            hold >>= n;
+            bitsIn -= n;
+
+            if (outOffset < distance) {
+                error = INFLATE_COPY_UNDERFLOW;
+                break;
+            }
+
+            dst = outBuffer + outOffset;
+            src = dst - distance;
+            if (distance >= 8 && outOffset + length + 8 <= outLength) {
+                /* Whole words, the last one may write past the match */
+                unsigned char *end = dst + length;
+                do {
+                    memcpy(dst, src, 8);
+                    dst += 8;
+                    src += 8;
+                } while (dst < end);
+            } else if (distance == 1) {
+                memset(dst, *src, length);
+            } else {
+                unsigned char *end = dst + length;
+                do {
+                    *dst++ = *src++;
+                } while (dst < end);
+            }
+            outOffset += length;
+        }
     }
 
+    /* Give back the whole bytes not used yet */
+    n = bitsIn >> 3;
+    if ((long)n > loaded) {
+        n = loaded;
+    }
+    in -= n;
+    avail += n;
+    inRemaining += n;
+    bitsIn -= n << 3;
+    hold &= ((InflateBits)1 << bitsIn) - 1;
+
+    state->inData = (unsigned long)hold;
+    state->inDataSize = bitsIn;
+    state->inRemaining = inRemaining;
+    state->inflateBufferIndex = (int)(in - state->inflateBuffer);
+    state->inflateBufferCount = (int)avail;
+    state->outOffset = outOffset;
+
     return error;
 }
 
@@ -381,7 +756,7 @@ static int decodeDynamicHuffmanTables(InflaterState *state,
     int hlit, hdist, hclen;
     int i;
     unsigned int quickBits;
-    unsigned char codelen[286 + 32];
+    unsigned char codelen[288 + 32];
     unsigned char *codePtr, *endCodePtr;
     int error = 0;
     LOAD_IN;
@@ -398,6 +773,10 @@ static int decodeDynamicHuffmanTables(InflaterState *state,
     hclen = 4 + NEXTBITS(4);
     DUMPBITS(4);
 
+    if (hlit > 286 || hdist > 30) {
+        return INFLATE_CODE_TABLE_LENGTH_ERROR;
+    }
+
     /*
      *  hclen x 3 bits: code lengths for the code length
      *  alphabet given just above, in the order: 16, 17, 18,
@@ -505,14 +884,14 @@ static int decodeDynamicHuffmanTables(InflaterState *state,
 
     while (error == 0) {
 
-        error = makeCodeTable(state, codelen, hlit, MAX_QUICK_LXL,
-                lcodesMemHandle);
+        error = makeFastTable(state, codelen, hlit, INFLATE_LITLEN_ROOT_BITS,
+                              0, lcodesMemHandle);
         if (error != 0) {
             break;
         }
 
-        error = makeCodeTable(state, codelen + hlit, hdist, MAX_QUICK_CXD,
-                              dcodesMemHandle);
+        error = makeFastTable(state, codelen + hlit, hdist,
+                              INFLATE_DIST_ROOT_BITS, 1, dcodesMemHandle);
         if (error != 0) {
             break;
         }
@@ -593,6 +972,11 @@ static int makeCodeTable(InflaterState *state,
         }
     }
 
+    if (code > (1 << MAX_BITS)) {
+        /* Oversubscribed code lengths of corrupt data */
+        return INFLATE_HUFFMAN_ENTRY_ERROR;
+    }
+
     /* Calculate the size of the code table and allocate it. */
     if (maxCodeLen <= maxQuickBits) {
         /* We don't need any subtables.  We may even be able to get
@@ -682,3 +1066,169 @@ static int makeCodeTable(InflaterState *state,
 }
 
 
+
+/**
+ * Creates a lookup table for literal/length or distance codes.
+ * Codes up to <rootBits> long are decoded by one probe of the root
+ * table, longer codes by one more probe of a subtable.
+ *
+ * @param codelen code lengths of the symbols of the alphabet
+ * @param numElems number of elements of the alphabet
+ * @param rootBits index bits of the root table
+ * @param distances non-zero for the distance alphabet, zero for the
+ *                  literal/length alphabet
+ * @param result mem handle to the code table created if successful or
+ *               NULL if an error occurs
+ *
+ * @return 0 for success or an error
+ */
+static int makeFastTable(InflaterState *state,
+                         unsigned char *codelen,
+                         unsigned numElems,
+                         unsigned rootBits,
+                         int distances,
+                         void** result) {
+    unsigned int bitLengthCount[MAX_BITS + 1];
+    unsigned int codes[MAX_BITS + 1];
+    unsigned bits, maxCodeLen = 0;
+    unsigned int code, rootMask, sym;
+    int left;
+    void* tableMemHandle;
+    InflateCodeTable* table;
+    unsigned int mainTableLength, subTableLength, numSubTables;
+    unsigned int nextSubTable;
+    int tableSize;
+    unsigned int j;
+
+    *result = NULL;
+
+    /* Count the number of codes for each code length */
+    memset(bitLengthCount, 0, sizeof(bitLengthCount));
+    for (sym = 0; sym < numElems; sym++) {
+        bitLengthCount[codelen[sym]]++;
+    }
+
+    /* Assign the first code of each length, reject oversubscribed sets */
+    left = 1;
+    code = 0;
+    for (bits = 1; bits <= MAX_BITS; bits++) {
+        left = (left << 1) - (int)bitLengthCount[bits];
+        if (left < 0) {
+            return INFLATE_HUFFMAN_ENTRY_ERROR;
+        }
+
+        codes[bits] = code;
+        if (bitLengthCount[bits] != 0) {
+            maxCodeLen = bits;
+            code += bitLengthCount[bits] << (MAX_BITS - bits);
+        }
+    }
+
+    if (maxCodeLen == 0) {
+        /* Empty code table is allowed, every code is invalid then */
+        maxCodeLen = 1;
+    }
+
+    /* Calculate the size of the code table and allocate it. */
+    if (maxCodeLen <= rootBits) {
+        rootBits = maxCodeLen;
+        numSubTables = subTableLength = 0;
+    } else {
+        /* The long codes take the top of the code space */
+        numSubTables = ((1 << MAX_BITS) - codes[rootBits + 1])
+                       >> (MAX_BITS - rootBits);
+        subTableLength = 1 << (maxCodeLen - rootBits);
+    }
+    mainTableLength = 1 << rootBits;
+
+    tableSize = sizeof(InflateCodeTableHeader)
+                + (mainTableLength + numSubTables * subTableLength)
+                * sizeof(table->entries[0]);
+
+    tableMemHandle = state->mallocBytes(state->heapState, tableSize);
+
+    if (tableMemHandle == NULL) {
+        return OUT_OF_MEMORY_ERROR;
+    }
+
+    /* This is to support heaps with memory compaction. */
+    table = state->addrFromHandle(state->heapState, tableMemHandle);
+
+    table->h.rootBits = rootBits;
+    table->h.maxCodeLen = maxCodeLen;
+
+    for (j = 0; j < mainTableLength + numSubTables * subTableLength; j++) {
+        table->entries[j].op = INFLATE_OP_INVALID;
+        table->entries[j].bits = 0;
+        table->entries[j].val = 0;
+    }
+
+    rootMask = mainTableLength - 1;
+    nextSubTable = mainTableLength;
+
+    for (sym = 0; sym < numElems; sym++) {
+        InflateCode entry;
+
+        bits = codelen[sym];
+        if (bits == 0) {
+            continue;
+        }
+
+        if (distances) {
+            if (sym <= MAX_ZIP_DISTANCE_CODE) {
+                entry.op = INFLATE_OP_BASE | dist_extra_bits[sym];
+                entry.val = (unsigned short)dist_base[sym];
+            } else {
+                entry.op = INFLATE_OP_BAD;
+                entry.val = 0;
+            }
+        } else if (sym < 256) {
+            entry.op = INFLATE_OP_LITERAL;
+            entry.val = (unsigned short)sym;
+        } else if (sym == 256) {
+            entry.op = INFLATE_OP_END;
+            entry.val = 0;
+        } else if (sym <= 285) {
+            entry.op = INFLATE_OP_BASE | ll_extra_bits[sym - LITXLEN_BASE];
+            entry.val = ll_length_base[sym - LITXLEN_BASE];
+        } else {
+            entry.op = INFLATE_OP_BAD;
+            entry.val = 0;
+        }
+
+        /* Get the next code of the current length */
+        code = codes[bits];
+        codes[bits] += 1 << (MAX_BITS - bits);
+        code = REVERSE_15BITS(code);
+
+        if (bits <= rootBits) {
+            unsigned int stride = 1 << bits;
+
+            entry.bits = (unsigned char)bits;
+            for (j = code & rootMask; j < mainTableLength; j += stride) {
+                table->entries[j] = entry;
+            }
+        } else {
+            InflateCode *root = &table->entries[code & rootMask];
+            unsigned int stride = 1 << (bits - rootBits);
+
+            if (root->op != INFLATE_OP_LINK + (maxCodeLen - rootBits)) {
+                /* This is the first long code with this prefix */
+                root->op = INFLATE_OP_LINK + (maxCodeLen - rootBits);
+                root->bits = (unsigned char)rootBits;
+                root->val = (unsigned short)nextSubTable;
+                nextSubTable += subTableLength;
+            }
+
+            entry.bits = (unsigned char)(bits - rootBits);
+            for (j = code >> rootBits; j < subTableLength; j += stride) {
+                table->entries[root->val + j] = entry;
+            }
+        }
+    }
+
+    ASSERT(nextSubTable <= mainTableLength + numSubTables * subTableLength);
+
+    *result = tableMemHandle;
+    return 0;
+}
@@ -32,6 +32,7 @@
 #include <midpResourceLimit.h>
 #include <midp_properties_port.h>
 #include <midpInit.h>
+#include <midpJar.h>
 #include <suitestore_common.h>
 #if !ENABLE_CDC
 #include <pcsl_network.h>
@@ -45,6 +46,10 @@
 #include <midp_links.h>
 #endif
 
+#if ENABLE_IMAGE_CACHE
+#include <imageCache.h>
+#endif
+
 #if ENABLE_ICON_CACHE
 #include <suitestore_icon_cache.h>
 #endif
@@ -294,6 +299,10 @@ void midpFinalize() {
     midp_free_suites_icons();
 #endif    
     midp_suite_storage_cleanup();
+    midpJarFlushCache();
+#if ENABLE_IMAGE_CACHE
+    releaseImageCache();
+#endif
 
     /** Now it makes no sense to process suspend/resume requests. */
 #if !ENABLE_CDC
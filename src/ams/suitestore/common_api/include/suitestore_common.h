@@ -179,8 +179,10 @@ typedef struct _variableLenSuiteData {
 /**
  * A structure containing all of the information about the installed
  * midlet suites required at the strartup time.
- * The first field in _suites.dat is "int suitesNum" - number of the
- * installed suites, then there is a list of MidletSuiteData structures.
+ * _suites.dat starts with a header of three ints: a magic value, the
+ * format version and the number of the installed suites, then there is
+ * a list of MidletSuiteData structures. Files written before the header
+ * was introduced start right with "int suitesNum".
  */
 typedef struct _midletSuiteData {
     /**
@@ -802,30 +802,19 @@ get_suite_or_component_id(ComponentType type, SuiteIdType suiteId,
         return status;
     }
 
-    pData = g_pSuitesData;
-
     /* try to find a suite */
-    while (pData != NULL) {
-        if (pcsl_string_equals(&pData->varSuiteData.suiteName, name) &&
-                pcsl_string_equals(&pData->varSuiteData.suiteVendor, vendor)
-#if ENABLE_DYNAMIC_COMPONENTS
-                    && (type == pData->type) && (type != COMPONENT_DYNAMIC ||
-                        (type == COMPONENT_DYNAMIC && suiteId == pData->suiteId))
-#endif
-        ) {
+    pData = get_suite_data_by_name(type, suiteId, vendor, name);
+    if (pData != NULL) {
 #if ENABLE_DYNAMIC_COMPONENTS
-            if (type != COMPONENT_DYNAMIC) {
-                *pId = (jint)pData->suiteId;
-            } else {
-                *pId = (jint)pData->componentId;
-            }
-#else
+        if (type != COMPONENT_DYNAMIC) {
             *pId = (jint)pData->suiteId;
-#endif /* ENABLE_DYNAMIC_COMPONENTS */
-            return ALL_OK; /* IMPL_NOTE: consider SUITE_CORRUPTED_ERROR */
+        } else {
+            *pId = (jint)pData->componentId;
         }
-
-        pData = pData->nextEntry;
+#else
+        *pId = (jint)pData->suiteId;
+#endif /* ENABLE_DYNAMIC_COMPONENTS */
+        return ALL_OK; /* IMPL_NOTE: consider SUITE_CORRUPTED_ERROR */
     }
 
     /* suite or component was not found - create a new suite or component ID */
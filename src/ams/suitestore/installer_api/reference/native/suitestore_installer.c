@@ -40,6 +40,7 @@
 #include <pcsl_memory.h>
 #include <midpInit.h>
 #include <midpStorage.h>
+#include <midpJar.h>
 #include <imageCache.h>
 #include <fontCache.h>
 
@@ -769,6 +770,8 @@ store_jar(char** ppszError, ComponentType type, SuiteIdType suiteId,
     }
 
     *ppszError = NULL;
+    /* The old JAR of an updated suite is replaced */
+    midpJarFlushCache();
     storage_rename_file(ppszError, pJarName, &filename);
 
     if (*ppszError != NULL) {
@@ -864,6 +867,8 @@ add_to_suite_list_and_save(MidletSuiteData* pMsd) {
         free_suite_data_entry(pExistingSuite);
     }
 
+    invalidate_suites_index();
+
     status = write_suites_data(&pszError);
     storageFreeError(pszError);
 
@@ -877,6 +882,7 @@ add_to_suite_list_and_save(MidletSuiteData* pMsd) {
         }
         pMsd->nextEntry = NULL;
         g_pSuitesData = pPrev;
+        invalidate_suites_index();
     }
 
     return status;
@@ -182,6 +182,30 @@ MidletSuiteData* get_suite_data(SuiteIdType suiteId);
 MidletSuiteData* get_component_data(ComponentIdType componentId);
 #endif /* ENABLE_DYNAMIC_COMPONENTS */
 
+/**
+ * Search for a structure describing the suite or the dynamic component
+ * by its vendor and name.
+ *
+ * @param type type of the component to search for
+ * @param suiteId ID of the suite the dynamic component belongs to
+ *                (ignored when looking for a suite)
+ * @param vendor vendor of the suite or component
+ * @param name name of the suite or component
+ *
+ * @return pointer to the MidletSuiteData structure containing
+ * the attributes or NULL if nothing was found
+ */
+MidletSuiteData* get_suite_data_by_name(ComponentType type, SuiteIdType suiteId,
+                                        const pcsl_string* vendor,
+                                        const pcsl_string* name);
+
+/**
+ * Drops the hash index over the list of the installed suites.
+ * Must be called each time an entry is added to or removed from
+ * g_pSuitesData, the index will be rebuilt on the next lookup.
+ */
+void invalidate_suites_index();
+
 /**
  * Reads the file with information about the installed suites.
  *
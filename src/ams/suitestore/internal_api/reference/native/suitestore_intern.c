@@ -152,6 +152,28 @@ MidletSuiteData* g_pSuitesData = NULL;
 /** Indicates if the suite storage is already initialized. */
 static int g_suiteStorageInitDone = 0;
 
+/** Number of entries starting from which the lookups use the hash index. */
+#define SUITES_INDEX_MIN_ENTRIES 8
+
+#if ENABLE_DYNAMIC_COMPONENTS
+/** Suite ID, component ID and name tables. */
+#define SUITES_INDEX_TABLES 3
+#else
+/** Suite ID and name tables. */
+#define SUITES_INDEX_TABLES 2
+#endif
+
+/**
+ * Hash index over g_pSuitesData: SUITES_INDEX_TABLES open addressing
+ * tables of g_suitesIndexSize slots each, keyed by the suite ID, by the
+ * suite name and by the component ID. The index is built on the first
+ * lookup after the list was loaded or changed, NULL if not built.
+ */
+static MidletSuiteData** g_pSuitesIndex = NULL;
+
+/** Number of slots in each table of the index, a power of 2. */
+static int g_suitesIndexSize = 0;
+
 /** Indicates if a transaction was started. */
 static int g_transactionStarted = 0;
 
@@ -245,6 +267,8 @@ suite_storage_cleanup_impl() {
         }
     }
 
+    invalidate_suites_index();
+
     g_pSuitesData        = NULL;
     g_numberOfSuites     = 0;
     g_isSuitesDataLoaded = 0;
@@ -304,6 +328,8 @@ static void
 free_suites_data() {
     MidletSuiteData *pData = g_pSuitesData, *pNextData;
 
+    invalidate_suites_index();
+
     while (pData != NULL) {
         pNextData = pData->nextEntry;
         free_suite_data_entry(pData);
@@ -315,6 +341,139 @@ free_suites_data() {
     g_isSuitesDataLoaded = 0;
 }
 
+/**
+ * Drops the hash index over the list of the installed suites.
+ * Must be called each time an entry is added to or removed from
+ * g_pSuitesData, the index will be rebuilt on the next lookup.
+ */
+void
+invalidate_suites_index() {
+    if (g_pSuitesIndex != NULL) {
+        pcsl_mem_free(g_pSuitesIndex);
+        g_pSuitesIndex = NULL;
+    }
+    g_suitesIndexSize = 0;
+}
+
+/**
+ * Returns the home slot of a suite or component ID in a table
+ * of the index.
+ *
+ * @param id suite or component ID
+ *
+ * @return slot number
+ */
+static int
+hash_suite_id(jint id) {
+    return (int)(((unsigned int)id * 2654435761U) &
+        (unsigned int)(g_suitesIndexSize - 1));
+}
+
+/**
+ * Returns the home slot of a suite name in a table of the index.
+ * FNV-1a hash of the UTF-16 characters is used.
+ *
+ * @param name suite name
+ *
+ * @return slot number
+ */
+static int
+hash_suite_name(const pcsl_string* name) {
+    unsigned int hash = 2166136261U;
+    const jchar* pChars;
+    jint i, len;
+
+    len = pcsl_string_utf16_length(name);
+    pChars = pcsl_string_get_utf16_data(name);
+    if (pChars != NULL) {
+        for (i = 0; i < len; i++) {
+            hash = (hash ^ pChars[i]) * 16777619U;
+        }
+        pcsl_string_release_utf16_data(pChars, name);
+    }
+
+    return (int)(hash & (unsigned int)(g_suitesIndexSize - 1));
+}
+
+/**
+ * Puts an entry into the first free slot starting from the given one.
+ * Entries with equal keys are kept in the order of the list, so the
+ * lookups find the same entry as a walk through the list would.
+ *
+ * @param pTable table of the index
+ * @param slot home slot of the entry
+ * @param pData entry to put
+ */
+static void
+put_into_suites_index(MidletSuiteData** pTable, int slot,
+                      MidletSuiteData* pData) {
+    while (pTable[slot] != NULL) {
+        slot = (slot + 1) & (g_suitesIndexSize - 1);
+    }
+    pTable[slot] = pData;
+}
+
+/**
+ * Builds the hash index over g_pSuitesData if it was not built yet.
+ * The tables are kept at most half full.
+ *
+ * @return 1 if the index can be used, 0 if the caller must walk
+ *         through the list
+ */
+static int
+build_suites_index() {
+    MidletSuiteData* pData;
+    MidletSuiteData** pTables;
+    int size, count = 0;
+
+    if (g_pSuitesIndex != NULL) {
+        return 1;
+    }
+
+    if (g_numberOfSuites < SUITES_INDEX_MIN_ENTRIES) {
+        return 0;
+    }
+
+    for (size = 2 * SUITES_INDEX_MIN_ENTRIES; size < 2 * g_numberOfSuites;
+            size <<= 1) {
+    }
+
+    pTables = (MidletSuiteData**) pcsl_mem_malloc(
+        SUITES_INDEX_TABLES * size * sizeof(MidletSuiteData*));
+    if (pTables == NULL) {
+        /* not fatal, the lookups will walk through the list */
+        return 0;
+    }
+
+    memset(pTables, 0, SUITES_INDEX_TABLES * size * sizeof(MidletSuiteData*));
+    g_pSuitesIndex = pTables;
+    g_suitesIndexSize = size;
+
+    for (pData = g_pSuitesData; pData != NULL; pData = pData->nextEntry) {
+        if (++count > g_numberOfSuites) {
+            /* the list is longer than expected, don't overfill the tables */
+            invalidate_suites_index();
+            return 0;
+        }
+
+#if ENABLE_DYNAMIC_COMPONENTS
+        if (pData->type == COMPONENT_DYNAMIC) {
+            put_into_suites_index(pTables + 2 * size,
+                hash_suite_id(pData->componentId), pData);
+        } else
+#endif
+        {
+            put_into_suites_index(pTables,
+                hash_suite_id(pData->suiteId), pData);
+        }
+
+        put_into_suites_index(pTables + size,
+            hash_suite_name(&pData->varSuiteData.suiteName), pData);
+    }
+
+    return 1;
+}
+
 /**
  * Search for a structure describing the suite by the suite's ID.
  *
@@ -327,6 +486,20 @@ MidletSuiteData*
 get_suite_data(SuiteIdType suiteId) {
     MidletSuiteData* pData;
 
+    if (build_suites_index()) {
+        int slot = hash_suite_id(suiteId);
+
+        /* dynamic components are not in this table */
+        while ((pData = g_pSuitesIndex[slot]) != NULL) {
+            if (pData->suiteId == suiteId) {
+                return pData;
+            }
+            slot = (slot + 1) & (g_suitesIndexSize - 1);
+        }
+
+        return NULL;
+    }
+
     pData = g_pSuitesData;
 
     /* walk through the linked list */
@@ -358,6 +531,20 @@ MidletSuiteData*
 get_component_data(ComponentIdType componentId) {
     MidletSuiteData* pData;
 
+    if (build_suites_index()) {
+        MidletSuiteData** pTable = g_pSuitesIndex + 2 * g_suitesIndexSize;
+        int slot = hash_suite_id(componentId);
+
+        while ((pData = pTable[slot]) != NULL) {
+            if (pData->componentId == componentId) {
+                return pData;
+            }
+            slot = (slot + 1) & (g_suitesIndexSize - 1);
+        }
+
+        return NULL;
+    }
+
     pData = g_pSuitesData;
 
     /* walk through the linked list */
@@ -373,6 +560,78 @@ get_component_data(ComponentIdType componentId) {
 }
 #endif /* ENABLE_DYNAMIC_COMPONENTS */
 
+/**
+ * Checks if the given entry describes the suite or the dynamic component
+ * with the given vendor and name.
+ *
+ * @param pData entry to check
+ * @param type type of the component to search for
+ * @param suiteId ID of the suite the dynamic component belongs to
+ * @param vendor vendor of the suite or component
+ * @param name name of the suite or component
+ *
+ * @return 1 if the entry matches, 0 otherwise
+ */
+static int
+suite_data_matches_name(const MidletSuiteData* pData, ComponentType type,
+                        SuiteIdType suiteId, const pcsl_string* vendor,
+                        const pcsl_string* name) {
+#if !ENABLE_DYNAMIC_COMPONENTS
+    (void)type;
+    (void)suiteId;
+#endif
+
+    return pcsl_string_equals(&pData->varSuiteData.suiteName, name) &&
+        pcsl_string_equals(&pData->varSuiteData.suiteVendor, vendor)
+#if ENABLE_DYNAMIC_COMPONENTS
+        && (type == pData->type) && (type != COMPONENT_DYNAMIC ||
+            (type == COMPONENT_DYNAMIC && suiteId == pData->suiteId))
+#endif
+        ;
+}
+
+/**
+ * Search for a structure describing the suite or the dynamic component
+ * by its vendor and name.
+ *
+ * @param type type of the component to search for
+ * @param suiteId ID of the suite the dynamic component belongs to
+ *                (ignored when looking for a suite)
+ * @param vendor vendor of the suite or component
+ * @param name name of the suite or component
+ *
+ * @return pointer to the MidletSuiteData structure containing
+ * the attributes or NULL if nothing was found
+ */
+MidletSuiteData*
+get_suite_data_by_name(ComponentType type, SuiteIdType suiteId,
+                       const pcsl_string* vendor, const pcsl_string* name) {
+    MidletSuiteData* pData;
+
+    if (build_suites_index()) {
+        MidletSuiteData** pTable = g_pSuitesIndex + g_suitesIndexSize;
+        int slot = hash_suite_name(name);
+
+        while ((pData = pTable[slot]) != NULL) {
+            if (suite_data_matches_name(pData, type, suiteId, vendor, name)) {
+                return pData;
+            }
+            slot = (slot + 1) & (g_suitesIndexSize - 1);
+        }
+
+        return NULL;
+    }
+
+    /* walk through the linked list */
+    for (pData = g_pSuitesData; pData != NULL; pData = pData->nextEntry) {
+        if (suite_data_matches_name(pData, type, suiteId, vendor, name)) {
+            return pData;
+        }
+    }
+
+    return NULL;
+}
+
 /**
  * Allocates a memory buffer enough to hold the whole file
  * and reads the given file into the buffer.
@@ -514,6 +773,22 @@ write_file(char** ppszError, const pcsl_string* pFileName,
     pos += n; \
     bufferLen -= n;
 
+/**
+ * First field of a versioned _suites.dat. Files written by the older
+ * versions start right with the (non-negative) number of the entries,
+ * so the value is negative to tell them apart.
+ */
+#define SUITES_DATA_MAGIC ((int)0x8D5A7E01)
+
+/**
+ * Version of the _suites.dat format written by write_suites_data().
+ * Version 1 is the legacy file without the header.
+ */
+#define SUITES_DATA_VERSION 2
+
+/** Size of the _suites.dat header: magic, version, number of the entries */
+#define SUITES_DATA_HEADER_SIZE (3 * sizeof(int))
+
 /**
  * Reads the file with information about the installed suites.
  *
@@ -531,8 +806,9 @@ MIDPError
 read_suites_data(char** ppszError) {
     MIDPError status;
     int i;
-    long bufferLen, pos;
-    char* buffer = NULL;
+    long bufferLen, fileSize, pos;
+    const char* buffer = NULL;
+    char* pReadBuffer = NULL;
     pcsl_string_status rc;
     pcsl_string suitesDataFile;
     MidletSuiteData *pSuitesData = NULL;
@@ -558,24 +834,34 @@ read_suites_data(char** ppszError) {
         return OUT_OF_MEMORY;
     }
 
-    /* read the file */
-    status = read_file(ppszError, &suitesDataFile, &buffer, &bufferLen);
+    /*
+     * Map the file, the entries are copied out of it while parsing.
+     * If the mapping is not supported, read the file as a whole.
+     */
+    buffer = (const char*)storage_map_file(ppszError, &suitesDataFile,
+                                           &bufferLen);
+    storageFreeError(*ppszError);
+    *ppszError = NULL;
+
+    if (buffer != NULL) {
+        status = ALL_OK;
+    } else {
+        status = read_file(ppszError, &suitesDataFile, &pReadBuffer,
+                           &bufferLen);
+        buffer = pReadBuffer;
+    }
     pcsl_string_free(&suitesDataFile);
+    fileSize = bufferLen;
 
     if (status == NOT_FOUND || (status == ALL_OK && bufferLen == 0)) {
         /* _suites.dat is absent or empty, it's a normal situation */
+        invalidate_suites_index();
         g_pSuitesData        = NULL;
         g_numberOfSuites     = 0;
         g_isSuitesDataLoaded = 1;
         return ALL_OK;
     }
 
-    if (status == ALL_OK && bufferLen < (long) sizeof(int)) {
-        pcsl_mem_free(buffer);
-        status = SUITE_CORRUPTED_ERROR; /* _suites.dat is corrupted */
-        REPORT_ERROR(LC_AMS, "read_suites_data(): failed to read "
-                             "'_suites.dat', file is corrupted (1)");
-    }
     if (status != ALL_OK) {
         /*
          * if read_file() returned not ALL_OK, buffer is NULL,
@@ -586,8 +872,34 @@ read_suites_data(char** ppszError) {
 
     /* parse contents of the suite database */
     pos = 0;
-    numOfSuites = *(int*)&buffer[pos];
-    ADJUST_POS_IN_BUF(pos, bufferLen, sizeof(int));
+    numOfSuites = -1;
+
+    if (bufferLen >= (long)sizeof(int)) {
+        numOfSuites = *(const int*)&buffer[pos];
+        ADJUST_POS_IN_BUF(pos, bufferLen, sizeof(int));
+
+        if (numOfSuites == SUITES_DATA_MAGIC) {
+            /* versioned file, otherwise it is the number of the entries */
+            numOfSuites = -1;
+            if (bufferLen >= (long)(SUITES_DATA_HEADER_SIZE - sizeof(int)) &&
+                    *(const int*)&buffer[pos] == SUITES_DATA_VERSION) {
+                ADJUST_POS_IN_BUF(pos, bufferLen, sizeof(int));
+                numOfSuites = *(const int*)&buffer[pos];
+                ADJUST_POS_IN_BUF(pos, bufferLen, sizeof(int));
+            }
+        }
+    }
+
+    if (numOfSuites < 0) {
+        if (pReadBuffer != NULL) {
+            pcsl_mem_free(pReadBuffer);
+        } else {
+            storage_unmap_file((const unsigned char*)buffer, fileSize);
+        }
+        REPORT_ERROR(LC_AMS, "read_suites_data(): failed to read "
+                             "'_suites.dat', file is corrupted (1)");
+        return SUITE_CORRUPTED_ERROR;
+    }
 
     for (i = 0; i < numOfSuites; i++) {
         if (bufferLen < (long)MIDLET_SUITE_DATA_SIZE) {
@@ -605,7 +917,7 @@ read_suites_data(char** ppszError) {
         }
 
         /* IMPL_NOTE: introduce pcsl_mem_copy() */
-        memcpy((char*)pData, (char*)&buffer[pos], MIDLET_SUITE_DATA_SIZE);
+        memcpy((char*)pData, (const char*)&buffer[pos], MIDLET_SUITE_DATA_SIZE);
         ADJUST_POS_IN_BUF(pos, bufferLen, MIDLET_SUITE_DATA_SIZE);
         
         /*
@@ -641,7 +953,7 @@ read_suites_data(char** ppszError) {
                 REPORT_CRIT(LC_AMS, "read_suites_data(): OUT OF MEMORY !! (3)");
                 break;
             }
-            memcpy(pData->varSuiteData.pJarHash, (char*)&buffer[pos],
+            memcpy(pData->varSuiteData.pJarHash, (const char*)&buffer[pos],
                 pData->jarHashLen);
             ADJUST_POS_IN_BUF(pos, bufferLen, pData->jarHashLen);
         } else {
@@ -681,10 +993,10 @@ read_suites_data(char** ppszError) {
                  * on RISC CPUs.
                  */
                 pos = SUITESTORE_ALIGN_4(pos);
-                strLen = *(jint*)&buffer[pos];
+                strLen = *(const jint*)&buffer[pos];
                 ADJUST_POS_IN_BUF(pos, bufferLen, sizeof(jint));
 
-                if (bufferLen < (long)strLen) {
+                if (bufferLen < (long)strLen * (long)sizeof(jchar)) {
                     /* _suites.dat is corrupted */
                     status = SUITE_CORRUPTED_ERROR;
                     REPORT_ERROR(LC_AMS, "read_suites_data(): failed to read "
@@ -694,7 +1006,7 @@ read_suites_data(char** ppszError) {
 
                 if (strLen > 0) {
                     rc = pcsl_string_convert_from_utf16(
-                        (jchar*)&buffer[pos], strLen, pStrings[i]);
+                        (const jchar*)&buffer[pos], strLen, pStrings[i]);
 
                     if (rc != PCSL_STRING_OK) {
                         status = OUT_OF_MEMORY;
@@ -716,8 +1028,13 @@ read_suites_data(char** ppszError) {
 
     } /* end for (numOfSuites) */
 
-    pcsl_mem_free(buffer);
+    if (pReadBuffer != NULL) {
+        pcsl_mem_free(pReadBuffer);
+    } else {
+        storage_unmap_file((const unsigned char*)buffer, fileSize);
+    }
 
+    invalidate_suites_index();
     g_numberOfSuites = numOfSuites;
     g_pSuitesData = pSuitesData;
     g_isSuitesDataLoaded = 1;
@@ -769,8 +1086,8 @@ write_suites_data(char** ppszError) {
     /* allocate a buffer where the information about all suites will be saved */
     bufferLen = g_numberOfSuites * (sizeof(MidletSuiteData) +
         MAX_VAR_SUITE_DATA_LEN);
-    /* space to store the number of suites */
-    bufferLen += sizeof(int);
+    /* space to store the header */
+    bufferLen += SUITES_DATA_HEADER_SIZE;
     buffer = pcsl_mem_malloc(bufferLen);
     if (buffer == NULL) {
         pcsl_string_free(&suitesDataFile);
@@ -781,6 +1098,10 @@ write_suites_data(char** ppszError) {
     pos = 0;
     pData = g_pSuitesData;
 
+    *(int*)&buffer[pos] = SUITES_DATA_MAGIC;
+    ADJUST_POS_IN_BUF(pos, bufferLen, sizeof(int));
+    *(int*)&buffer[pos] = SUITES_DATA_VERSION;
+    ADJUST_POS_IN_BUF(pos, bufferLen, sizeof(int));
     *(int*)&buffer[pos] = g_numberOfSuites;
     ADJUST_POS_IN_BUF(pos, bufferLen, sizeof(int));
 
@@ -1379,6 +1700,7 @@ remove_from_list_and_save_impl(SuiteIdType suiteId, ComponentIdType componentId,
 
             /* decrease the number of the installed suites and components */
             g_numberOfSuites--;
+            invalidate_suites_index();
 
             /*
              * Save the database later, after removing all dynamic components
@@ -40,6 +40,7 @@
 #include <midpInit.h>
 #include <midpStorage.h>
 #include <midpRMS.h>
+#include <midpJar.h>
 #include <push_server_export.h>
 #include <pcsl_memory.h>
 #include <imageCache.h>
@@ -443,6 +444,12 @@ midp_remove_suite(SuiteIdType suiteId) {
         midp_remove_suite_icons(suiteId);
 #endif        
 
+#if ENABLE_IMAGE_CACHE
+        releaseImageCache();
+#endif
+
+        midpJarFlushCache();
+
         for (;;) {
             rc = storage_get_next_file_in_iterator(&suiteRoot,
                 fileIteratorHandle, &filename);
@@ -609,6 +616,7 @@ midp_change_suite_storage(SuiteIdType suiteId, StorageIdType newStorageId) {
                 break;
             }
 
+            midpJarFlushCache();
             storage_rename_file(&pszError, &filePath, &newFilePath);
             if (pszError != NULL) {
                 status = IO_ERROR;
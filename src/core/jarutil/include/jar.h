@@ -176,6 +176,8 @@ typedef struct _JarInfo {
     int status; /**< error code, 0 for success */
     unsigned long locOffset; /**< Offset of first local entry */
     unsigned long cenOffset; /**< Offset of central directory */
+    unsigned long cenSize; /**< Size of central directory */
+    unsigned long entries; /**< Number of entries in central directory */
 } JarInfo;
 
 /** State needed to get the name or uncompressed data of an entry. */
@@ -224,6 +226,24 @@ JarEntryInfo findJarEntryInfo(FileObj* pFileObj, JarInfo* jarInfo,
     const unsigned char *name, unsigned int nameLen,
     unsigned char* compBuffer);
 
+/**
+ * Reads an information for an entry from a central directory header
+ * that is already in memory, for example when the whole central
+ * directory of the JAR has been read at once. Does not perform memory
+ * allocation.
+ *
+ * @param jarInfo info returned by getJarInfo
+ * @param header central directory header of the entry
+ * @param length number of bytes available at header
+ * @param offset offset of the header in the JAR
+ *
+ * @return entry info with a status of zero for success, JAR_ENTRY_NOT_FOUND
+ * at the end of the central directory or JAR_CORRUPT if the header
+ * does not fit into length bytes
+ */
+JarEntryInfo parseJarEntryInfo(JarInfo* jarInfo, const unsigned char* header,
+                               unsigned long length, unsigned long offset);
+
 /**
  * Reads an information for the first entry in a JAR. Does not perform
  * memory allocation.
@@ -309,6 +329,52 @@ int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
                 unsigned char* decompBuffer, int decompLen,
                 int bufferIsAHandle);
 
+/**
+ * The type of the function receiving the data inflated by
+ * inflateDataToSink().
+ *
+ * @param state the <var>sinkState</var> given to inflateDataToSink()
+ * @param data inflated bytes, valid only during the call
+ * @param length number of inflated bytes
+ *
+ * @return 0 to continue inflating, non-zero to abort it
+ */
+typedef int (*InflateSinkFunction)(void* state, unsigned char* data,
+                                   int length);
+
+/** Distance of the farthest back reference in deflated data */
+#define INFLATE_WINDOW_SIZE 32768
+
+/**
+ * Minimal size of the buffer given to inflateDataToSink() for data
+ * that does not fit into it at once: the window plus a maximal match.
+ */
+#define INFLATE_MIN_SINK_BUFFER_SIZE (INFLATE_WINDOW_SIZE + 258)
+
+/**
+ * Inflates the data in a file passing it to a sink function in pieces,
+ * so that the whole uncompressed data never has to be in memory.
+ * The buffer keeps the last INFLATE_WINDOW_SIZE bytes of the output for
+ * back references, the larger it is the less often the window is moved.
+ *
+ * @param fileObj File object for reading the compressed data with the
+ *                current file position set to the beginning of the data
+ * @param heapManObj Heap manager object for temp data
+ * @param compLen Length of the compressed data
+ * @param buffer inflater window, not a memory handle
+ * @param bufferLen size of the buffer, at least the smaller of
+ *        <decompLen> and INFLATE_MIN_SINK_BUFFER_SIZE
+ * @param decompLen Expected length of the uncompressed data
+ * @param sink function receiving the uncompressed data in order
+ * @param sinkState value passed to the sink function
+ *
+ * @return 0 if the data was inflated and the size of the decoded data
+ *         is exactly <decompLen>, one of the inflate errors otherwise
+ */
+int inflateDataToSink(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
+                      unsigned char* buffer, int bufferLen, int decompLen,
+                      InflateSinkFunction sink, void* sinkState);
+
 /**
  * @name Inflate errors.
  * @{
@@ -331,6 +397,7 @@ int inflateData(FileObj* fileObj, HeapManObj* heapManObj, int compLen,
 #define INFLATE_BAD_REPEAT_CODE            (INFLATE_LEVEL_ERROR - 15)
 #define INFLATE_BAD_CODELENGTH_CODE        (INFLATE_LEVEL_ERROR - 16)
 #define INFLATE_CODE_TABLE_EMPTY           (INFLATE_LEVEL_ERROR - 17)
+#define INFLATE_SINK_ERROR                 (INFLATE_LEVEL_ERROR - 18)
 /** @} */
 
 /**
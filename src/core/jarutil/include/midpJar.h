@@ -70,6 +70,14 @@ void* midpOpenJar(int* pError, const pcsl_string * name);
  */
 void midpCloseJar(void* handle);
 
+/**
+ * Drop the cached central directory index of the last closed JAR.
+ * The index is reused when the same JAR is opened again, so this
+ * should be called when a JAR file is replaced or removed and when
+ * MIDP is finalized.
+ */
+void midpJarFlushCache(void);
+
 /**
  * Get the size of JAR file previously opened by midpOpenJar.
  *
@@ -148,6 +148,43 @@ jarCRC32(unsigned char *data, unsigned long length) {
     return ~crc;
 }
 
+/**
+ * Gets the entry information from a central directory header.
+ *
+ * @param jarInfo JAR info object
+ * @param header CENHDRSIZ bytes of a central directory header
+ * @param offset offset of the header in the JAR
+ *
+ * @return entry info with a status of zero for success or a non-zero
+ * error code.
+ */
+static JarEntryInfo
+decodeJarEntryInfo(JarInfo* jarInfo, const unsigned char* header,
+        unsigned long offset) {
+    JarEntryInfo entry;
+
+    memset(&entry, 0, sizeof (entry));
+
+    /* header should contain the current central header */
+    if (GETSIG(header) != CENSIG) {
+        /* We've reached the end of the headers */
+        entry.status = JAR_ENTRY_NOT_FOUND;
+        return entry;
+    }
+
+    entry.nameLen = CENNAM(header);
+    entry.nameOffset = offset + CENHDRSIZ;
+    entry.decompLen = CENLEN(header); /* the decompressed length */
+    entry.compLen   = CENSIZ(header); /* the compressed length */
+    entry.method    = CENHOW(header); /* how it is stored */
+    entry.expectedCRC = CENCRC(header); /* expected CRC */
+    entry.encrypted = (CENFLG(header) & 1) == 1;
+    entry.offset = jarInfo->locOffset + CENOFF(header);
+    entry.nextCenEntryOffset = entry.nameOffset + entry.nameLen +
+                               CENEXT(header) + CENCOM(header);
+    return entry;
+}
+
 /**
  * Reads the entry at at given file offset. Does not perform
  * memory allocation.
@@ -165,7 +202,16 @@ readJarEntryInfo(FileObj* fileObj, JarInfo* jarInfo,
     JarEntryInfo entry;
     unsigned char header[CENHDRSIZ];
 
-    memset(&entry, 0, sizeof (entry));
+    if (jarInfo->cenSize != 0 &&
+            offset >= jarInfo->cenOffset + jarInfo->cenSize) {
+        /*
+         * The end record can be shorter than a central header, so do not
+         * read past the directory.
+         */
+        memset(&entry, 0, sizeof (entry));
+        entry.status = JAR_ENTRY_NOT_FOUND;
+        return entry;
+    }
 
     /*
      * Offset contains the offset of the next central header. Read the
@@ -175,27 +221,43 @@ readJarEntryInfo(FileObj* fileObj, JarInfo* jarInfo,
     /* Go to the header and Read the bytes */
     if ((fileObj->seek(fileObj->state, offset, SEEK_SET) < 0) 
         || (fileObj->read(fileObj->state, header, CENHDRSIZ) != CENHDRSIZ)) {
+        memset(&entry, 0, sizeof (entry));
         entry.status = JAR_CORRUPT;
         return entry;
     }
 
-    /* header should contain the current central header */
-    if (GETSIG(header) != CENSIG) {
-        /* We've reached the end of the headers */
-        entry.status = JAR_ENTRY_NOT_FOUND;
+    return decodeJarEntryInfo(jarInfo, header, offset);
+}
+
+/**
+ * Reads an information for an entry from a central directory header
+ * that is already in memory. Does not perform memory allocation.
+ *
+ * @param jarInfo JAR info object
+ * @param header central directory header of the entry
+ * @param length number of bytes available at header
+ * @param offset offset of the header in the JAR
+ *
+ * @return entry info with a status of zero for success or a non-zero
+ * error code.
+ */
+JarEntryInfo
+parseJarEntryInfo(JarInfo* jarInfo, const unsigned char* header,
+                  unsigned long length, unsigned long offset) {
+    JarEntryInfo entry;
+
+    if (length < CENHDRSIZ) {
+        memset(&entry, 0, sizeof (entry));
+        entry.status = JAR_CORRUPT;
         return entry;
     }
 
-    entry.nameLen = CENNAM(header);
-    entry.nameOffset = offset + CENHDRSIZ;
-    entry.decompLen = CENLEN(header); /* the decompressed length */
-    entry.compLen   = CENSIZ(header); /* the compressed length */
-    entry.method    = CENHOW(header); /* how it is stored */
-    entry.expectedCRC = CENCRC(header); /* expected CRC */
-    entry.encrypted = (CENFLG(header) & 1) == 1;
-    entry.offset = jarInfo->locOffset + CENOFF(header);
-    entry.nextCenEntryOffset = entry.nameOffset + entry.nameLen +
-                               CENEXT(header) + CENCOM(header);
+    entry = decodeJarEntryInfo(jarInfo, header, offset);
+    if (entry.status == 0 && entry.nextCenEntryOffset - offset > length) {
+        /* The name, extra field or comment is cut off */
+        entry.status = JAR_CORRUPT;
+    }
+
     return entry;
 }
 
@@ -295,6 +357,8 @@ getJarInfo(FileObj* fileObj) {
                             && fileObj->readChar(fileObj->state) == 3
                             && fileObj->readChar(fileObj->state) == 4) {
                         jarInfo.cenOffset = cenOffset;
+                        jarInfo.cenSize = ENDSIZ(bp);
+                        jarInfo.entries = ENDTOT(bp);
                         jarInfo.locOffset = locOffset;
                         return jarInfo;
                     }
@@ -33,11 +33,51 @@
 #include <midpJar.h>
 #include <pcsl_string.h>
 
+/**
+ * By default the central directory of an opened JAR is read into memory
+ * at once and indexed by a hash table of entry names, define to 0 to
+ * search the central directory in the file for every entry.
+ */
+#ifndef ENABLE_JAR_INDEX
+#define ENABLE_JAR_INDEX 1
+#endif
+
+#if ENABLE_JAR_INDEX
+/** Offset of an empty hash table slot */
+#define JAR_INDEX_EMPTY ((unsigned long)-1)
+
+/** Hash table slot referring to a central directory header */
+typedef struct _MidpJarSlot {
+    unsigned long hash; /**< hash of the entry name */
+    unsigned long offset; /**< offset of the header in the directory */
+} MidpJarSlot;
+
+/** In-memory copy of a central directory with a hash table of names */
+typedef struct _MidpJarIndex {
+    pcsl_string name; /**< name of the JAR file */
+    long fileSize; /**< size of the JAR file when it was indexed */
+    JarInfo jarInfo; /**< JAR info the index was built for */
+    unsigned char* directory; /**< the whole central directory */
+    MidpJarSlot* slots; /**< open addressing hash table of entries */
+    unsigned long slotMask; /**< number of slots minus one */
+} MidpJarIndex;
+
+/**
+ * Index of the last closed JAR. Suites open the same JAR over and over
+ * (a resource at a time), so the index is kept until another JAR is
+ * closed or midpJarFlushCache is called.
+ */
+static MidpJarIndex* cachedIndex = NULL;
+#endif
+
 typedef struct _MidpJarInfo {
     FileObj fileObj;
     HeapManObj heapManObj;
     int status;
     JarInfo jarInfo;
+#if ENABLE_JAR_INDEX
+    MidpJarIndex* index; /**< NULL if the directory is searched in the file */
+#endif
 } MidpJarInfo;
 
 static long
@@ -122,6 +162,297 @@ addrFromHandleFunction(void* state, void* handle) {
     return handle;
 }
 
+#if ENABLE_JAR_INDEX
+/**
+ * FNV-1a hash of an entry name.
+ *
+ * @param name UTF-8 name of the entry
+ * @param nameLen length of the name in bytes
+ *
+ * @return hash of the name
+ */
+static unsigned long
+hashName(const unsigned char* name, unsigned long nameLen) {
+    unsigned long hash = 2166136261UL;
+
+    while (nameLen-- > 0) {
+        hash = ((hash ^ *name++) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+
+    return hash;
+}
+
+/**
+ * Frees an index and everything it refers to.
+ *
+ * @param index index to free, can be NULL
+ */
+static void
+freeIndex(MidpJarIndex* index) {
+    if (index == NULL) {
+        return;
+    }
+
+    pcsl_string_free(&index->name);
+    midpFree(index->directory);
+    midpFree(index->slots);
+    midpFree(index);
+}
+
+/**
+ * Checks if a hash table slot refers to the named entry.
+ *
+ * @param index index of the JAR
+ * @param slot slot to check
+ * @param hash hash of the name
+ * @param name UTF-8 name of the entry
+ * @param nameLen length of the name in bytes
+ * @param pEntryInfo where to put the info of the entry if it matches
+ *
+ * @return non-zero if the slot refers to the entry
+ */
+static int
+slotMatches(MidpJarIndex* index, MidpJarSlot* slot, unsigned long hash,
+            const unsigned char* name, unsigned long nameLen,
+            JarEntryInfo* pEntryInfo) {
+    JarInfo* jarInfo = &index->jarInfo;
+
+    if (slot->hash != hash) {
+        return 0;
+    }
+
+    *pEntryInfo = parseJarEntryInfo(jarInfo, index->directory + slot->offset,
+                                    jarInfo->cenSize - slot->offset,
+                                    jarInfo->cenOffset + slot->offset);
+
+    return pEntryInfo->nameLen == nameLen &&
+        memcmp(index->directory +
+               (pEntryInfo->nameOffset - jarInfo->cenOffset),
+               name, nameLen) == 0;
+}
+
+/**
+ * Reads the central directory of an opened JAR with a single read and
+ * builds a hash table of the entry names.
+ *
+ * @param pJarInfo opened JAR
+ * @param name name of the JAR file
+ * @param fileSize size of the JAR file
+ *
+ * @return index or NULL if the JAR cannot be indexed, the entries are
+ * searched in the file then
+ */
+static MidpJarIndex*
+buildIndex(MidpJarInfo* pJarInfo, const pcsl_string* name, long fileSize) {
+    JarInfo* jarInfo = &pJarInfo->jarInfo;
+    MidpJarIndex* index;
+    JarEntryInfo entryInfo;
+    JarEntryInfo dupInfo;
+    unsigned long numSlots;
+    unsigned long pos;
+    unsigned long count;
+    unsigned long i;
+
+    if (jarInfo->cenSize == 0 ||
+            jarInfo->cenOffset + jarInfo->cenSize > (unsigned long)fileSize) {
+        return NULL;
+    }
+
+    index = (MidpJarIndex*)midpMalloc(sizeof (MidpJarIndex));
+    if (index == NULL) {
+        return NULL;
+    }
+
+    memset(index, 0, sizeof (MidpJarIndex));
+    index->name = PCSL_STRING_NULL;
+    index->fileSize = fileSize;
+    index->jarInfo = *jarInfo;
+
+    /* Keep the load factor under 1/2 */
+    for (numSlots = 16; numSlots < 2 * jarInfo->entries; numSlots <<= 1) {
+    }
+    index->slotMask = numSlots - 1;
+
+    index->directory = (unsigned char*)midpMalloc(jarInfo->cenSize);
+    index->slots = (MidpJarSlot*)midpMalloc(numSlots * sizeof (MidpJarSlot));
+    if (index->directory == NULL || index->slots == NULL ||
+            pcsl_string_dup(name, &index->name) != PCSL_STRING_OK) {
+        freeIndex(index);
+        return NULL;
+    }
+
+    for (i = 0; i < numSlots; i++) {
+        index->slots[i].offset = JAR_INDEX_EMPTY;
+    }
+
+    if (pJarInfo->fileObj.seek(pJarInfo->fileObj.state,
+                               jarInfo->cenOffset, SEEK_SET) < 0 ||
+            pJarInfo->fileObj.read(pJarInfo->fileObj.state,
+                index->directory, jarInfo->cenSize) != (long)jarInfo->cenSize) {
+        freeIndex(index);
+        return NULL;
+    }
+
+    for (pos = 0, count = 0; pos < jarInfo->cenSize; count++) {
+        unsigned char* pName;
+        unsigned long hash;
+
+        entryInfo = parseJarEntryInfo(jarInfo, index->directory + pos,
+                                      jarInfo->cenSize - pos,
+                                      jarInfo->cenOffset + pos);
+        if (entryInfo.status == JAR_ENTRY_NOT_FOUND) {
+            break;
+        }
+
+        if (entryInfo.status != 0 || count >= numSlots / 2) {
+            /* Let the file search report the problem */
+            freeIndex(index);
+            return NULL;
+        }
+
+        pName = index->directory + (entryInfo.nameOffset - jarInfo->cenOffset);
+        hash = hashName(pName, entryInfo.nameLen);
+        for (i = hash & index->slotMask;
+                index->slots[i].offset != JAR_INDEX_EMPTY;
+                i = (i + 1) & index->slotMask) {
+            if (slotMatches(index, &index->slots[i], hash, pName,
+                            entryInfo.nameLen, &dupInfo)) {
+                /* The file search finds the first one of duplicates */
+                break;
+            }
+        }
+
+        if (index->slots[i].offset == JAR_INDEX_EMPTY) {
+            index->slots[i].hash = hash;
+            index->slots[i].offset = pos;
+        }
+
+        pos = entryInfo.nextCenEntryOffset - jarInfo->cenOffset;
+    }
+
+    return index;
+}
+
+/**
+ * Takes the cached index if it was built for the same JAR file.
+ *
+ * @param pJarInfo opened JAR
+ * @param name name of the JAR file
+ * @param fileSize size of the JAR file
+ *
+ * @return index or NULL if the cached index cannot be used
+ */
+static MidpJarIndex*
+takeCachedIndex(MidpJarInfo* pJarInfo, const pcsl_string* name,
+                long fileSize) {
+    MidpJarIndex* index = cachedIndex;
+    JarInfo* jarInfo = &pJarInfo->jarInfo;
+
+    if (index == NULL) {
+        return NULL;
+    }
+
+    cachedIndex = NULL;
+
+    /*
+     * The storage does not keep modification times, a replaced JAR is
+     * detected by its size and the location of its central directory.
+     */
+    if (index->fileSize == fileSize &&
+            index->jarInfo.locOffset == jarInfo->locOffset &&
+            index->jarInfo.cenOffset == jarInfo->cenOffset &&
+            index->jarInfo.cenSize == jarInfo->cenSize &&
+            index->jarInfo.entries == jarInfo->entries &&
+            pcsl_string_equals(&index->name, name)) {
+        return index;
+    }
+
+    freeIndex(index);
+    return NULL;
+}
+
+/**
+ * Finds an entry using the index of an opened JAR.
+ *
+ * @param index index of the JAR
+ * @param name UTF-8 name of the entry
+ * @param nameLen length of the name in bytes
+ *
+ * @return entry info with a status of zero for success or
+ * JAR_ENTRY_NOT_FOUND
+ */
+static JarEntryInfo
+findIndexedEntryInfo(MidpJarIndex* index, const unsigned char* name,
+                     unsigned long nameLen) {
+    JarEntryInfo entryInfo;
+    unsigned long hash = hashName(name, nameLen);
+    unsigned long i;
+
+    for (i = hash & index->slotMask;
+            index->slots[i].offset != JAR_INDEX_EMPTY;
+            i = (i + 1) & index->slotMask) {
+        if (slotMatches(index, &index->slots[i], hash, name, nameLen,
+                        &entryInfo)) {
+            return entryInfo;
+        }
+    }
+
+    memset(&entryInfo, 0, sizeof (entryInfo));
+    entryInfo.status = JAR_ENTRY_NOT_FOUND;
+    return entryInfo;
+}
+#endif /* ENABLE_JAR_INDEX */
+
+/**
+ * Finds an entry of an opened JAR using its index if there is one,
+ * otherwise searches the central directory in the file.
+ *
+ * @param pJarInfo opened JAR
+ * @param name name of the entry
+ *
+ * @return entry info with a status of zero for success,
+ * JAR_ENTRY_NOT_FOUND, JAR_CORRUPT or MIDP_JAR_OUT_OF_MEM_ERROR
+ */
+static JarEntryInfo
+findEntryInfo(MidpJarInfo* pJarInfo, const pcsl_string * name) {
+    JarEntryInfo entryInfo;
+    unsigned char* pName;
+    int nameLen;
+    unsigned char* pCompBuffer;
+
+    memset(&entryInfo, 0, sizeof (entryInfo));
+
+    /* Jar entry names are UTF-8 */
+    pName = (unsigned char *)pcsl_string_get_utf8_data(name);
+    if (pName == NULL) {
+        entryInfo.status = MIDP_JAR_OUT_OF_MEM_ERROR;
+        return entryInfo;
+    }
+
+    nameLen = pcsl_string_utf8_length(name);
+
+#if ENABLE_JAR_INDEX
+    if (pJarInfo->index != NULL) {
+        entryInfo = findIndexedEntryInfo(pJarInfo->index, pName, nameLen);
+        pcsl_string_release_utf8_data((jbyte*)pName, name);
+        return entryInfo;
+    }
+#endif
+
+    pCompBuffer = midpMalloc(nameLen);
+    if (pCompBuffer == NULL) {
+        pcsl_string_release_utf8_data((jbyte*)pName, name);
+        entryInfo.status = MIDP_JAR_OUT_OF_MEM_ERROR;
+        return entryInfo;
+    }
+
+    entryInfo = findJarEntryInfo(&pJarInfo->fileObj, &pJarInfo->jarInfo,
+                pName, nameLen, pCompBuffer);
+    pcsl_string_release_utf8_data((jbyte*)pName, name);
+    midpFree(pCompBuffer);
+    return entryInfo;
+}
+
 void*
 midpOpenJar(int* pError, const pcsl_string * name) {
     MidpJarInfo* pJarInfo;
@@ -163,6 +494,17 @@ midpOpenJar(int* pError, const pcsl_string * name) {
         return NULL;
     }
 
+#if ENABLE_JAR_INDEX
+    {
+        long fileSize = sizeOfFile(pJarInfo->fileObj.state);
+
+        pJarInfo->index = takeCachedIndex(pJarInfo, name, fileSize);
+        if (pJarInfo->index == NULL) {
+            pJarInfo->index = buildIndex(pJarInfo, name, fileSize);
+        }
+    }
+#endif
+
     return pJarInfo;
 }
 
@@ -178,9 +520,24 @@ midpCloseJar(void* handle) {
     storageClose(&pszError, (int)(pJarInfo->fileObj.state));
     storageFreeError(pszError);
 
+#if ENABLE_JAR_INDEX
+    if (pJarInfo->index != NULL) {
+        freeIndex(cachedIndex);
+        cachedIndex = pJarInfo->index;
+    }
+#endif
+
     midpFree(pJarInfo);
 }
 
+void
+midpJarFlushCache(void) {
+#if ENABLE_JAR_INDEX
+    freeIndex(cachedIndex);
+    cachedIndex = NULL;
+#endif
+}
+
 /* If the jar size is less than zero it is an error code. */
 long
 midpGetJarSize(void* handle) {
@@ -205,29 +562,14 @@ midpGetJarEntry(void* handle, const pcsl_string * name,
     JarEntryInfo entryInfo;
     char*  entryData = NULL;
     int status;
-    unsigned char* pName;
-    int nameLen;
-    unsigned char* pCompBuffer;
 
     *ppEntry = NULL;
 
-    /* Jar entry names are UTF-8 */
-    pName = (unsigned char *)pcsl_string_get_utf8_data(name);
-    if (pName == NULL) {
+    entryInfo = findEntryInfo(pJarInfo, name);
+    if (entryInfo.status == MIDP_JAR_OUT_OF_MEM_ERROR) {
         return MIDP_JAR_OUT_OF_MEM_ERROR;
     }
 
-    nameLen = pcsl_string_utf8_length(name);
-    pCompBuffer = midpMalloc(nameLen);
-    if (pCompBuffer == NULL) {
-        pcsl_string_release_utf8_data((jbyte*)pName, name);
-        return MIDP_JAR_OUT_OF_MEM_ERROR;
-    }
-    
-    entryInfo = findJarEntryInfo(&pJarInfo->fileObj, &pJarInfo->jarInfo,
-                pName, nameLen, pCompBuffer);
-    pcsl_string_release_utf8_data((jbyte*)pName, name);
-    midpFree(pCompBuffer);
     if (entryInfo.status == JAR_ENTRY_NOT_FOUND) {
         return 0;
     }
@@ -256,27 +598,12 @@ int
 midpJarEntryExists(void* handle, const pcsl_string * name) {
     MidpJarInfo* pJarInfo = (MidpJarInfo*)handle;
     JarEntryInfo entryInfo;
-    unsigned char* pName;
-    int nameLen;
-    unsigned char* pCompBuffer;
 
-    /* Jar entry names are UTF-8 */
-    pName = (unsigned char *)pcsl_string_get_utf8_data(name);
-    if (NULL == pName) {
+    entryInfo = findEntryInfo(pJarInfo, name);
+    if (MIDP_JAR_OUT_OF_MEM_ERROR == entryInfo.status) {
         return MIDP_JAR_OUT_OF_MEM_ERROR;
     }
 
-    nameLen = pcsl_string_utf8_length(name);
-    pCompBuffer = midpMalloc(nameLen);
-    if (NULL == pCompBuffer) {
-        pcsl_string_release_utf8_data((jbyte*)pName, name);
-        return MIDP_JAR_OUT_OF_MEM_ERROR;
-    }
-    
-    entryInfo = findJarEntryInfo(&pJarInfo->fileObj, &pJarInfo->jarInfo,
-                pName, nameLen, pCompBuffer);
-    pcsl_string_release_utf8_data((jbyte*)pName, name);
-    midpFree(pCompBuffer);
     if (JAR_ENTRY_NOT_FOUND == entryInfo.status) {
         return 0;
     }
@@ -288,6 +615,33 @@ midpJarEntryExists(void* handle, const pcsl_string * name) {
     return 1;
 }
 
+#if ENABLE_JAR_INDEX
+/**
+ * Gets the info of the next entry from the in-memory central directory.
+ *
+ * @param index index of the JAR
+ * @param offset offset of the entry header in the JAR
+ *
+ * @return entry info with a status of zero for success or a non-zero
+ * error code including JAR_ENTRY_NOT_FOUND at the end of the entries
+ */
+static JarEntryInfo
+getIndexedEntryInfo(MidpJarIndex* index, unsigned long offset) {
+    JarInfo* jarInfo = &index->jarInfo;
+    JarEntryInfo entryInfo;
+
+    if (offset - jarInfo->cenOffset >= jarInfo->cenSize) {
+        memset(&entryInfo, 0, sizeof (entryInfo));
+        entryInfo.status = JAR_ENTRY_NOT_FOUND;
+        return entryInfo;
+    }
+
+    return parseJarEntryInfo(jarInfo,
+        index->directory + (offset - jarInfo->cenOffset),
+        jarInfo->cenSize - (offset - jarInfo->cenOffset), offset);
+}
+#endif
+
 int 
 midpIterateJarEntries(void *handle, filterFuncT *filter, actionFuncT *action) {
 
@@ -298,8 +652,37 @@ midpIterateJarEntries(void *handle, filterFuncT *filter, actionFuncT *action) {
     int status = 1;
     pcsl_string_status res;
 
-    entryInfo = getFirstJarEntryInfo(&pJarInfo->fileObj, &pJarInfo->jarInfo);
+#if ENABLE_JAR_INDEX
+    if (pJarInfo->index != NULL) {
+        MidpJarIndex* index = pJarInfo->index;
+
+        /* Names are taken from the directory, no reads or copies needed */
+        entryInfo = getIndexedEntryInfo(index, index->jarInfo.cenOffset);
+        while (entryInfo.status == 0) {
+            nameBuf = index->directory +
+                (entryInfo.nameOffset - index->jarInfo.cenOffset);
+            res = pcsl_string_convert_from_utf8((jbyte*)nameBuf,
+                                                entryInfo.nameLen, &entryName);
+            if (PCSL_STRING_OK != res) {
+                return MIDP_JAR_OUT_OF_MEM_ERROR;
+            }
+
+            if ((*filter)(&entryName)) {
+                /* name match: call action, continue even if it fails */
+                (void)(*action)(&entryName);
+            }
+
+            pcsl_string_free(&entryName);
 
+            entryInfo = getIndexedEntryInfo(index,
+                                            entryInfo.nextCenEntryOffset);
+        }
+
+        return status;
+    }
+#endif
+
+    entryInfo = getFirstJarEntryInfo(&pJarInfo->fileObj, &pJarInfo->jarInfo);
     while (entryInfo.status == 0) {
         
         nameBuf =  (unsigned char*) midpMalloc(entryInfo.nameLen);
@@ -334,6 +334,36 @@ long storageSizeOf(char** ppszError, int handle);
 long storage_size_of_file_by_name(char** ppszError,
                                   const pcsl_string* pFileName);
 
+/**
+ * Maps the whole native-storage file with the given name into memory
+ * for reading. The mapping stays valid when the file is renamed or
+ * deleted, until it is released with storage_unmap_file().
+ * <p>
+ * Mapping is only an optimization: it fails on platforms built without
+ * ENABLE_STORAGE_MMAP and for empty files, callers must fall back to
+ * storage_open() and storageRead() in that case.
+ *
+ * @param ppszError pointer to a string that will hold an error message
+ *        if there is a problem, or null if the function is
+ *        successful (This function sets <tt>ppszError</tt>'s value.)
+ * @param filename the name of the file to map
+ * @param pSize [out] size of the mapped file, in bytes
+ *
+ * @return pointer to the first byte of the file, or NULL if the file
+ *         could not be mapped
+ */
+const unsigned char* storage_map_file(char** ppszError,
+                                      const pcsl_string* filename,
+                                      long* pSize);
+
+/**
+ * Releases a mapping created by storage_map_file().
+ *
+ * @param data pointer returned by storage_map_file()
+ * @param size size of the mapping returned by storage_map_file()
+ */
+void storage_unmap_file(const unsigned char* data, long size);
+
 /**
  * Truncates the size of the given open native-storage file to the
  * given number of bytes.
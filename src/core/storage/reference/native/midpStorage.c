@@ -58,6 +58,25 @@
 #include <pcsl_string_status.h>
 #include <pcsl_memory.h>
 
+/**
+ * Map whole files into memory where the platform provides POSIX mmap(),
+ * define to 0 to make storage_map_file() always fail.
+ */
+#ifndef ENABLE_STORAGE_MMAP
+#if defined(__linux__) && !defined(UNDER_CE)
+#define ENABLE_STORAGE_MMAP 1
+#else
+#define ENABLE_STORAGE_MMAP 0
+#endif
+#endif
+
+#if ENABLE_STORAGE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /* local prototypes */
 static int initializeConfigRoot (char*);
 static char* getLastError(char*);
@@ -684,6 +703,83 @@ storage_size_of_file_by_name(char** ppszError, const pcsl_string* pFileName) {
     return size;
 }
 
+/*
+ * Map a whole file in storage into memory for reading.
+ *
+ * If not successful *ppszError will set to point to an error string,
+ * on success it will be set to NULL.
+ *
+ * @return pointer to the file data if successful, NULL otherwise
+ */
+const unsigned char*
+storage_map_file(char** ppszError, const pcsl_string* filename_str,
+                 long* pSize) {
+#if ENABLE_STORAGE_MMAP
+    const jbyte* pszName;
+    struct stat st;
+    void* data = MAP_FAILED;
+    int fd;
+
+    *ppszError = NULL;
+    *pSize = 0;
+
+    pszName = pcsl_string_get_utf8_data(filename_str);
+    if (pszName == NULL) {
+        *ppszError = (char *)STRING_CORRUPT_ERROR;
+        return NULL;
+    }
+
+    fd = open((const char*)pszName, O_RDONLY);
+    pcsl_string_release_utf8_data(pszName, filename_str);
+    if (fd == -1) {
+        *ppszError = storage_get_last_file_error("storage_map_file()",
+                                                 filename_str);
+        return NULL;
+    }
+
+    if (fstat(fd, &st) == 0 && st.st_size > 0 &&
+            (unsigned long)st.st_size <= (unsigned long)0x7fffffffL) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+
+    if (data == MAP_FAILED) {
+        *ppszError = storage_get_last_file_error("storage_map_file()",
+                                                 filename_str);
+        close(fd);
+        return NULL;
+    }
+
+    /* The mapping does not need the descriptor to stay open */
+    close(fd);
+
+    REPORT_INFO1(LC_CORE, "storage_map_file mapped %ld bytes\n",
+                 (long)st.st_size);
+
+    *pSize = (long)st.st_size;
+    return (const unsigned char*)data;
+#else
+    (void)filename_str;
+    *pSize = 0;
+    *ppszError = "storage_map_file(): not supported";
+    return NULL;
+#endif
+}
+
+/*
+ * Release a mapping created by storage_map_file.
+ */
+void
+storage_unmap_file(const unsigned char* data, long size) {
+#if ENABLE_STORAGE_MMAP
+    if (data != NULL && size > 0) {
+        munmap((void*)data, (size_t)size);
+    }
+#else
+    (void)data;
+    (void)size;
+#endif
+}
+
 /*
  * Truncate the size of an open file in storage.
  *
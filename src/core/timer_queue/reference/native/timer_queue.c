@@ -33,16 +33,21 @@
 
 #include <kni.h>
 #include <stdlib.h>
+#include <string.h>
 #include <midpMalloc.h>
+#include <midp_logging.h>
 #include <timer_queue.h>
 
 /**
  *  TimerHandle
  *
- *  Implementation of data structure to keep an ordered list of
- *  upcoming timers. Operations on data structure:
- *    add    : insert new timer into ordered timers list
- *    get    : fetch first pending timer
+ *  Implementation of data structure to keep an ordered queue of
+ *  upcoming timers. The queue is a binary min-heap ordered by wakeup
+ *  time, timers with equal wakeup time are fetched in the order they
+ *  were added. The timers are also hashed by user data. Operations
+ *  on data structure:
+ *    add    : insert new timer into the heap, O(log n)
+ *    get    : fetch first pending timer, O(log n)
  *    peek   : fetch first pending timer but do not remove from data-structure
  *    new    : create a new entry and enqueue in data-structure
  *    delete : remove an entry from data-structure and free its memory
@@ -52,11 +57,199 @@ struct _TimerHandle {
     jlong timeToWakeup;             /* Absolute time to wakeup */
     void* userData;                 /* User data provided with timer */
     fTimerCallback userCallback;    /* User action on alarm */
-    struct _TimerHandle* next;      /* Next timer handle in the queue */
+    unsigned int order;             /* Sequence number of adding to queue */
+    int heapIndex;                  /* Index in the heap, or NOT_QUEUED */
+    struct _TimerHandle* next;      /* Next timer with the same user data
+                                       hash, or next free timer */
 };
 
-/** Timers queue */
-static TimerHandle* rootTimer = NULL;
+/** Heap index of a timer that is not in the queue */
+#define NOT_QUEUED (-1)
+
+/** Number of timers allocated at once for the pool */
+#define TIMER_POOL_CHUNK 32
+
+/** Initial capacity of the heap, a power of 2 */
+#define TIMER_HEAP_INITIAL 16
+
+/** Timers queue, heap[0] is the first pending timer */
+static TimerHandle** heap = NULL;
+
+/** Number of timers in the queue */
+static int heapSize = 0;
+
+/** Capacity of the heap and number of the user data hash buckets */
+static int heapCapacity = 0;
+
+/** Queued timers by user data */
+static TimerHandle** userDataHash = NULL;
+
+/** Sequence number of the next timer added to the queue */
+static unsigned int nextOrder = 0;
+
+/** Free timers of the pool */
+static TimerHandle* freeTimers = NULL;
+
+/** Tells if timer a should wake up before timer b */
+static int is_earlier(const TimerHandle* a, const TimerHandle* b) {
+    if (a->timeToWakeup != b->timeToWakeup) {
+        return a->timeToWakeup < b->timeToWakeup;
+    }
+    /* the difference is taken to survive the counter wrap */
+    return (int)(a->order - b->order) < 0;
+}
+
+/** Put the timer to the heap slot and remember the slot in the timer */
+static void heap_set(int index, TimerHandle* timer) {
+    heap[index] = timer;
+    timer->heapIndex = index;
+}
+
+/** Move the timer at the given index up to restore the heap order */
+static void sift_up(int index) {
+    TimerHandle* timer = heap[index];
+
+    while (index > 0) {
+        int parent = (index - 1) >> 1;
+        if (!is_earlier(timer, heap[parent])) {
+            break;
+        }
+        heap_set(index, heap[parent]);
+        index = parent;
+    }
+    heap_set(index, timer);
+}
+
+/** Move the timer at the given index down to restore the heap order */
+static void sift_down(int index) {
+    TimerHandle* timer = heap[index];
+
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= heapSize) {
+            break;
+        }
+        if (child + 1 < heapSize && is_earlier(heap[child + 1], heap[child])) {
+            child++;
+        }
+        if (!is_earlier(heap[child], timer)) {
+            break;
+        }
+        heap_set(index, heap[child]);
+        index = child;
+    }
+    heap_set(index, timer);
+}
+
+/** Get hash bucket of the user data */
+static TimerHandle** get_bucket(void* userData) {
+    unsigned long key = (unsigned long)userData;
+
+    key ^= key >> 16;
+    return &userDataHash[(unsigned int)(key * 2654435761U) &
+                         (unsigned int)(heapCapacity - 1)];
+}
+
+/** Remove the timer from the user data hash */
+static void unhash_timer(TimerHandle* timer) {
+    TimerHandle** ptr = get_bucket(timer->userData);
+
+    for (; *ptr != NULL; ptr = &((*ptr)->next)) {
+        if (*ptr == timer) {
+            *ptr = timer->next;
+            break;
+        }
+    }
+    timer->next = NULL;
+}
+
+/**
+ * Double the heap capacity and the number of user data hash buckets
+ *
+ * @return KNI_TRUE if successful, KNI_FALSE if out of memory
+ */
+static jboolean grow_heap() {
+    int capacity = (heapCapacity == 0) ? TIMER_HEAP_INITIAL : 2 * heapCapacity;
+    TimerHandle** newHeap;
+    TimerHandle** newHash;
+    int i;
+
+    newHash = (TimerHandle**)midpMalloc(capacity * sizeof(TimerHandle*));
+    if (newHash == NULL) {
+        return KNI_FALSE;
+    }
+
+    newHeap = (TimerHandle**)midpRealloc(heap,
+                                         capacity * sizeof(TimerHandle*));
+    if (newHeap == NULL) {
+        midpFree(newHash);
+        return KNI_FALSE;
+    }
+
+    midpFree(userDataHash);
+    memset(newHash, 0, capacity * sizeof(TimerHandle*));
+    heap = newHeap;
+    userDataHash = newHash;
+    heapCapacity = capacity;
+
+    /* rehash queued timers */
+    for (i = 0; i < heapSize; i++) {
+        TimerHandle** bucket = get_bucket(heap[i]->userData);
+        heap[i]->next = *bucket;
+        *bucket = heap[i];
+    }
+
+    return KNI_TRUE;
+}
+
+/** Take a timer from the pool, allocating more timers if needed */
+static TimerHandle* alloc_timer() {
+    TimerHandle* timer;
+
+    if (freeTimers == NULL) {
+        /* the chunks are never released, they are reused by new timers */
+        TimerHandle* chunk = (TimerHandle*)midpMalloc(
+            TIMER_POOL_CHUNK * sizeof(TimerHandle));
+        int i;
+
+        if (chunk == NULL) {
+            return NULL;
+        }
+        for (i = 0; i < TIMER_POOL_CHUNK; i++) {
+            chunk[i].next = freeTimers;
+            freeTimers = &chunk[i];
+        }
+    }
+
+    timer = freeTimers;
+    freeTimers = timer->next;
+    return timer;
+}
+
+/** Return the timer to the pool */
+static void free_timer(TimerHandle* timer) {
+    timer->next = freeTimers;
+    freeTimers = timer;
+}
+
+/** Remove the queued timer from the heap and the user data hash */
+static void dequeue_timer(TimerHandle* timer) {
+    int index = timer->heapIndex;
+    TimerHandle* last;
+
+    unhash_timer(timer);
+    timer->heapIndex = NOT_QUEUED;
+
+    last = heap[--heapSize];
+    if (last != timer) {
+        heap_set(index, last);
+        if (index > 0 && is_earlier(last, heap[(index - 1) >> 1])) {
+            sift_up(index);
+        } else {
+            sift_down(index);
+        }
+    }
+}
 
 /**
  * Insert new timer to the correct place in timer queue
@@ -65,16 +258,25 @@ static TimerHandle* rootTimer = NULL;
  * @param newTimer new timer to add to queue
  */
 void add_timer(TimerHandle* newTimer) {
-    TimerHandle **ptr = &rootTimer;
+    TimerHandle** bucket;
     REPORT_INFO1(LC_PUSH, "[add_timer] newTimer=%p", newTimer);
 
-    for(; *ptr != NULL; ptr = &((*ptr)->next)) {
-        if ((*ptr)->timeToWakeup > newTimer->timeToWakeup) {
-           break;
-        }
+    if (newTimer == NULL || newTimer->heapIndex != NOT_QUEUED) {
+        return;
     }
-    newTimer->next = *ptr;
-    (*ptr) = newTimer;
+
+    if (heapSize == heapCapacity && !grow_heap()) {
+        REPORT_ERROR(LC_PUSH, "[add_timer] out of memory, timer dropped");
+        return;
+    }
+
+    newTimer->order = nextOrder++;
+    bucket = get_bucket(newTimer->userData);
+    newTimer->next = *bucket;
+    *bucket = newTimer;
+
+    heap_set(heapSize++, newTimer);
+    sift_up(newTimer->heapIndex);
 }
 
 /**
@@ -90,43 +292,38 @@ void add_timer(TimerHandle* newTimer) {
 TimerHandle* new_timer(
     jlong timeToWakeup, void* userData, fTimerCallback userCallback) {
 
-    TimerHandle* newTimer = (TimerHandle*)midpMalloc(sizeof(TimerHandle));
+    TimerHandle* newTimer;
+
+    if (heapSize == heapCapacity && !grow_heap()) {
+        return NULL;
+    }
+
+    newTimer = alloc_timer();
     if (newTimer != NULL) {
         REPORT_INFO3(LC_PUSH, "[new_timer] timeToWakeup=%#lx userData=%p userCallback=%p",
             (long)timeToWakeup, userData, (void *)userCallback);
 
         newTimer->next = NULL;
- 		newTimer->timeToWakeup = timeToWakeup;
-		newTimer->userData = userData;
+        newTimer->heapIndex = NOT_QUEUED;
+        newTimer->timeToWakeup = timeToWakeup;
+        newTimer->userData = userData;
         newTimer->userCallback = userCallback;
         add_timer(newTimer);
     }
     return newTimer;
 }
 
-/** Search for handle instance in the sockets list and return its reference */
-static TimerHandle** get_timer_ptr(TimerHandle* timer) {
-    TimerHandle** ptr;
-    if (timer != NULL) {
-        for (ptr = &rootTimer; *ptr != NULL; ptr = &((*ptr)->next)) {
-            if (*ptr == timer) return ptr;
-        }
-    }
-    return NULL;
-}
-
 /**
  * Remove specified timer handler from queue and free allocated memory
  *
  * @param timer instance of timer that should be remove
  */
 void delete_timer(TimerHandle* timer) {
-    TimerHandle **ptr = get_timer_ptr(timer);
     REPORT_INFO1(LC_PUSH, "[delete_timer] timer=%p", timer);
 
-    if (ptr != NULL) {
-        *ptr = timer->next;
-        midpFree(timer);
+    if (timer != NULL && timer->heapIndex != NOT_QUEUED) {
+        dequeue_timer(timer);
+        free_timer(timer);
     }
 }
 
@@ -139,11 +336,10 @@ void delete_timer(TimerHandle* timer) {
  * @return poitner to timer instance that should be remove from queue
  */
 TimerHandle* remove_timer(TimerHandle* timer) {
-    TimerHandle **ptr = get_timer_ptr(timer);
     REPORT_INFO1(LC_PUSH, "[remove_timer] timer=%p", timer);
 
-    if (ptr != NULL) {
-        *ptr = timer->next;
+    if (timer != NULL && timer->heapIndex != NOT_QUEUED) {
+        dequeue_timer(timer);
     }
 
     return timer;
@@ -157,14 +353,21 @@ TimerHandle* remove_timer(TimerHandle* timer) {
  */
 void delete_timer_by_userdata(void* userdata) {
     TimerHandle* timer;
+    TimerHandle* first = NULL;
     REPORT_INFO1(LC_PUSH, "[delete_timer_by_userdata] userdata=%p", userdata);
 
-    for(timer = rootTimer; timer != NULL; timer = timer->next) {
-        if (timer->userData == userdata) {
-            delete_timer(timer);
-            return;
+    if (heapSize == 0) {
+        return;
+    }
+
+    for (timer = *get_bucket(userdata); timer != NULL; timer = timer->next) {
+        if (timer->userData == userdata &&
+                (first == NULL || is_earlier(timer, first))) {
+            first = timer;
         }
     }
+
+    delete_timer(first);
 }
 
 /**
@@ -175,10 +378,9 @@ void delete_timer_by_userdata(void* userdata) {
  */
 TimerHandle* get_timer() {
     TimerHandle* timer;
-    if (rootTimer != NULL) {
-        timer = rootTimer;
-        rootTimer = rootTimer->next;
-        timer->next = NULL;
+    if (heapSize > 0) {
+        timer = heap[0];
+        dequeue_timer(timer);
         return timer;
     }
     return NULL;
@@ -191,7 +393,7 @@ TimerHandle* get_timer() {
  * NULL if there is not timer
  */
 TimerHandle* peek_timer() {
-    return rootTimer;
+    return (heapSize > 0) ? heap[0] : NULL;
 }
 
 
@@ -231,7 +433,17 @@ jlong get_timer_wakeup(const TimerHandle *timer) {
  */
 void set_timer_wakeup(TimerHandle *timer, jlong timeToWakeup) {
     if (timer != NULL) {
+        jlong oldTime = timer->timeToWakeup;
         timer->timeToWakeup = timeToWakeup;
+
+        /* Keep the queue ordered if the timer is queued */
+        if (timer->heapIndex != NOT_QUEUED) {
+            if (timeToWakeup < oldTime) {
+                sift_up(timer->heapIndex);
+            } else {
+                sift_down(timer->heapIndex);
+            }
+        }
     }
 }
 
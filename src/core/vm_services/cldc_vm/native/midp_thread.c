@@ -30,11 +30,27 @@
 #include <jvmspi.h>
 #include <sni.h>
 
+#include <midpMalloc.h>
 #include <midp_logging.h>
 #include <midp_thread.h>
 
 static VmThreadTimesliceProc vm_thread_timeslice_proc = NULL;
 
+/**
+ * Index of blocked threads by the signal they wait for, used by
+ * midp_thread_signal_batch. The buffers are reused between the calls
+ * and only accessed in the VM thread.
+ */
+static int* signal_index_heads = NULL;
+static int* signal_index_next = NULL;
+static int signal_index_buckets = 0;
+static int signal_index_capacity = 0;
+
+/** Hash of a signal key, buckets must be a power of two */
+#define SIGNAL_HASH(waitingFor, descriptor, buckets) \
+    ((int)((((unsigned int)(descriptor) * 31u + (unsigned int)(waitingFor)) \
+            * 2654435761u) >> 8) & ((buckets) - 1))
+
 /**
  * Sets the routine for implementation-specific request for a VM time slice.
  * This routine will be called every time after a VM thread is unblocked.
@@ -137,6 +153,167 @@ midp_thread_signal_list(
     }
 }
 
+/**
+ * Makes sure the index buffers can hold the given number of threads.
+ *
+ * @param blocked_threads_count number of blocked threads to index
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+static int
+reserve_signal_index(int blocked_threads_count)
+{
+    int buckets;
+
+    if (blocked_threads_count > signal_index_capacity) {
+        int* next = (int*)midpMalloc(blocked_threads_count * sizeof (int));
+        if (next == NULL) {
+            return -1;
+        }
+        midpFree(signal_index_next);
+        signal_index_next = next;
+        signal_index_capacity = blocked_threads_count;
+    }
+
+    /* Keep the load factor at or below one half */
+    for (buckets = 16; buckets < 2 * blocked_threads_count; buckets <<= 1);
+
+    if (buckets > signal_index_buckets) {
+        int* heads = (int*)midpMalloc(buckets * sizeof (int));
+        if (heads == NULL) {
+            return -1;
+        }
+        midpFree(signal_index_heads);
+        signal_index_heads = heads;
+        signal_index_buckets = buckets;
+    }
+
+    return 0;
+}
+
+/**
+ * Find and unblock the Java threads waiting for any of the given
+ * signals. The blocked threads are indexed by the signal they wait for
+ * once, so the cost does not grow with the product of the number of
+ * threads and signals. A thread is unblocked at most once even if
+ * several signals match it, in which case it gets the status of the
+ * first one.
+ *
+ * @param blocked_threads list of blocked threads
+ * @param blocked_threads_count number of blocked threads in the list
+ * @param signals signals to deliver, the waitingFor, descriptor and
+ *                status fields are used
+ * @param signals_count number of signals
+ * @param first_only if not NULL, a non-zero entry means the signal
+ *                   unblocks only the first thread waiting for it
+ * @param unblocked if not NULL, receives for each signal the number of
+ *                  threads it unblocked
+ *
+ * @return total number of threads unblocked
+ */
+int
+midp_thread_signal_batch(
+        JVMSPI_BlockedThreadInfo *blocked_threads,
+        int blocked_threads_count, const MidpReentryData* signals,
+        int signals_count, const int* first_only, int* unblocked)
+{
+    int i, j, total = 0;
+    int buckets;
+    MidpReentryData* pThreadReentryData;
+
+    if (unblocked != NULL) {
+        for (j = 0; j < signals_count; j++) {
+            unblocked[j] = 0;
+        }
+    }
+
+    if (signals_count <= 0 || blocked_threads_count <= 0) {
+        return 0;
+    }
+
+    if (reserve_signal_index(blocked_threads_count) != 0) {
+        REPORT_WARN(LC_CORE,
+            "midp_thread_signal_batch: out of memory, scanning threads");
+        /* Slower path; a thread is unblocked once per matching signal */
+        for (j = 0; j < signals_count; j++) {
+            for (i = 0; i < blocked_threads_count; i++) {
+                pThreadReentryData =
+                    (MidpReentryData*)(blocked_threads[i].reentry_data);
+                if (pThreadReentryData != NULL
+                        && pThreadReentryData->descriptor ==
+                           signals[j].descriptor
+                        && pThreadReentryData->waitingFor ==
+                           signals[j].waitingFor) {
+                    pThreadReentryData->status = signals[j].status;
+                    midp_thread_unblock(blocked_threads[i].thread_id);
+                    total++;
+                    if (unblocked != NULL) {
+                        unblocked[j]++;
+                    }
+                    if (first_only != NULL && first_only[j]) {
+                        break;
+                    }
+                }
+            }
+        }
+        return total;
+    }
+
+    buckets = signal_index_buckets;
+    for (i = 0; i < buckets; i++) {
+        signal_index_heads[i] = -1;
+    }
+
+    /* Index in reverse so each chain keeps the order of the threads */
+    for (i = blocked_threads_count - 1; i >= 0; i--) {
+        int bucket;
+
+        pThreadReentryData =
+            (MidpReentryData*)(blocked_threads[i].reentry_data);
+        if (pThreadReentryData == NULL) {
+            continue;
+        }
+
+        bucket = SIGNAL_HASH(pThreadReentryData->waitingFor,
+                             pThreadReentryData->descriptor, buckets);
+        signal_index_next[i] = signal_index_heads[bucket];
+        signal_index_heads[bucket] = i;
+    }
+
+    for (j = 0; j < signals_count; j++) {
+        int* link = &signal_index_heads[SIGNAL_HASH(signals[j].waitingFor,
+            signals[j].descriptor, buckets)];
+
+        while (*link != -1) {
+            i = *link;
+            pThreadReentryData =
+                (MidpReentryData*)(blocked_threads[i].reentry_data);
+
+            if (pThreadReentryData->descriptor != signals[j].descriptor
+                    || pThreadReentryData->waitingFor !=
+                       signals[j].waitingFor) {
+                link = &signal_index_next[i];
+                continue;
+            }
+
+            /* Unlink the thread so it is not unblocked again */
+            *link = signal_index_next[i];
+
+            pThreadReentryData->status = signals[j].status;
+            midp_thread_unblock(blocked_threads[i].thread_id);
+            total++;
+            if (unblocked != NULL) {
+                unblocked[j]++;
+            }
+            if (first_only != NULL && first_only[j]) {
+                break;
+            }
+        }
+    }
+
+    return total;
+}
+
 /**
  * A midp internal function that unblocks the given Java thread. This should 
  * be called in preference to calling SNI_UnblockThread directly, since 
@@ -100,6 +100,31 @@ void midp_thread_signal_list(
         int blocked_threads_count, midpSignalType waitingFor,
         int descriptor, int status);
 
+/**
+ * Finds and unblocks the Java threads waiting for any of the given
+ * signals. Prefer this to calling midp_thread_signal_list for each of
+ * several signals found at once: the blocked threads are indexed once
+ * instead of being searched for every signal. A thread is unblocked at
+ * most once, with the status of the first signal that matches it.
+ *
+ * @param blocked_threads list of blocked threads
+ * @param blocked_threads_count number of blocked threads in the list
+ * @param signals signals to deliver, the waitingFor, descriptor and
+ *                status fields are used
+ * @param signals_count number of signals
+ * @param first_only if not NULL, a non-zero entry means the signal
+ *                   unblocks only the first thread waiting for it;
+ *                   otherwise all the waiting threads are unblocked
+ * @param unblocked if not NULL, receives for each signal the number of
+ *                  threads it unblocked
+ *
+ * @return total number of threads unblocked
+ */
+int midp_thread_signal_batch(
+        JVMSPI_BlockedThreadInfo *blocked_threads,
+        int blocked_threads_count, const MidpReentryData* signals,
+        int signals_count, const int* first_only, int* unblocked);
+
 /**
  * A midp internal function that unblocks the given Java thread. This should 
  * be called in preference to calling SNI_UnblockThread directly, since 
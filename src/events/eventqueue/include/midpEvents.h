@@ -395,6 +395,39 @@ void StoreMIDPEventInVmThread(MidpEvent event, int isolateId);
  */
 int GetEventQueueFreeCount(int isolateId);
 
+/**
+ * Reports the largest number of events that were pending in a queue
+ * at the same time.
+ *
+ * @param isolateId  ID of an Isolate, 0 for SVM mode
+ *
+ * @return high water mark of the queue
+ *         negative value on error
+ */
+int GetEventQueueHighWaterMark(int isolateId);
+
+/**
+ * Reports how many events were dropped because a queue was over
+ * its limit or could not grow.
+ *
+ * @param isolateId  ID of an Isolate, 0 for SVM mode
+ *
+ * @return number of dropped events
+ *         negative value on error
+ */
+int GetEventQueueDropCount(int isolateId);
+
+/**
+ * Reports how many events were merged into a later event of the same
+ * kind instead of being delivered.
+ *
+ * @param isolateId  ID of an Isolate, 0 for SVM mode
+ *
+ * @return number of merged events
+ *         negative value on error
+ */
+int GetEventQueueMergeCount(int isolateId);
+
 /**
  * Initialize event sub-system, not for general use.
  *
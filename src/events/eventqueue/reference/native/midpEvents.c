@@ -83,15 +83,145 @@ typedef struct Java_com_sun_midp_events_EventQueue _eventQueue;
  * in the configuration module 
  */
 
+/**
+ * Number of events in one chunk of a queue. Queues grow and shrink
+ * by whole chunks.
+ */
+#ifndef EVENT_QUEUE_CHUNK_EVENTS
+#define EVENT_QUEUE_CHUNK_EVENTS 32
+#endif
+
+/**
+ * Maximum number of pending events in one queue. A queue that nobody
+ * reads must not take all the memory, so events are dropped past
+ * this limit. MAX_EVENTS is kept as the guaranteed capacity.
+ */
+#ifndef EVENT_QUEUE_MAX_EVENTS
+#define EVENT_QUEUE_MAX_EVENTS (MAX_EVENTS * 64)
+#endif
+
+/**
+ * By default consecutive pointer drags and screen repaints are merged
+ * when read from a queue, define to 0 to deliver every event.
+ */
+#ifndef ENABLE_EVENT_COALESCING
+#define ENABLE_EVENT_COALESCING 1
+#endif
+
+/** Maximum number of free chunks kept for reuse by all queues */
+#ifndef EVENT_QUEUE_POOL_CHUNKS
+#define EVENT_QUEUE_POOL_CHUNKS 8
+#endif
+
+/*
+ * Atomic operations used by the event producers. Where the compiler
+ * does not provide them producers serialize on the event queue lock
+ * as before and the operations below are plain memory accesses.
+ */
+#if defined(__GNUC__) && \
+    ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define EVQ_LOCK_FREE 1
+#define EVQ_FETCH_ADD(p, v)       __sync_fetch_and_add((p), (v))
+#define EVQ_CAS(p, o, n)          __sync_bool_compare_and_swap((p), (o), (n))
+#define EVQ_CAS_PTR(p, o, n)      __sync_bool_compare_and_swap((p), (o), (n))
+#define EVQ_SWAP_PTR(p, n)        __sync_lock_test_and_set((p), (n))
+#define EVQ_BARRIER()             __sync_synchronize()
+#elif defined(_WIN32) && !defined(_WIN32_WCE)
+#include <windows.h>
+#define EVQ_LOCK_FREE 1
+#define EVQ_FETCH_ADD(p, v) \
+    InterlockedExchangeAdd((LONG volatile *)(p), (LONG)(v))
+#define EVQ_CAS(p, o, n) \
+    (InterlockedCompareExchange((LONG volatile *)(p), \
+                                (LONG)(n), (LONG)(o)) == (LONG)(o))
+#define EVQ_CAS_PTR(p, o, n) \
+    (InterlockedCompareExchangePointer((PVOID volatile *)(p), \
+                                       (PVOID)(n), (PVOID)(o)) == (PVOID)(o))
+#define EVQ_SWAP_PTR(p, n) \
+    InterlockedExchangePointer((PVOID volatile *)(p), (PVOID)(n))
+#define EVQ_BARRIER()             MemoryBarrier()
+#else
+#define EVQ_LOCK_FREE 0
+#endif
+
+#if !EVQ_LOCK_FREE
+static int evq_fetch_add(volatile int* p, int v) {
+    int old = *p;
+    *p = old + v;
+    return old;
+}
+
+static int evq_cas(volatile int* p, int o, int n) {
+    if (*p != o) {
+        return 0;
+    }
+    *p = n;
+    return 1;
+}
+
+static int evq_cas_ptr(void* volatile* p, void* o, void* n) {
+    if (*p != o) {
+        return 0;
+    }
+    *p = n;
+    return 1;
+}
+
+static void* evq_swap_ptr(void* volatile* p, void* n) {
+    void* old = *p;
+    *p = n;
+    return old;
+}
+
+#define EVQ_FETCH_ADD(p, v)   evq_fetch_add((p), (v))
+#define EVQ_CAS(p, o, n)      evq_cas((p), (o), (n))
+#define EVQ_CAS_PTR(p, o, n)  evq_cas_ptr((void* volatile*)(p), (o), (n))
+#define EVQ_SWAP_PTR(p, n)    evq_swap_ptr((void* volatile*)(p), (n))
+#define EVQ_BARRIER()
+#endif
+
+/**
+ * A chunk of event slots. Producers reserve a slot by incrementing
+ * <tt>reserved</tt>, store the event and then set its ready flag,
+ * the consumer takes events in slot order as they become ready.
+ */
+typedef struct _EventChunk {
+    /** Next chunk in the queue */
+    struct _EventChunk* volatile next;
+    /** Next chunk in the retired list or in the pool */
+    struct _EventChunk* nextFree;
+    /** Number of slots reserved by producers, may exceed the size */
+    volatile int reserved;
+    /** Nonzero when the event in the slot has been fully stored */
+    volatile int ready[EVENT_QUEUE_CHUNK_EVENTS];
+    /** Event slots */
+    MidpEvent events[EVENT_QUEUE_CHUNK_EVENTS];
+} EventChunk;
+
 typedef struct _EventQueue {
-    /** Queue of pending events */
-    MidpEvent events[MAX_EVENTS];
-    /** Number of events in the queue */
-    int numEvents;
-    /** The queue position of the next event to be processed */
-    int eventIn;
-    /** The queue position of the next event to be stored */
+    /** Chunk holding the next event to be processed, consumer only */
+    EventChunk* head;
+    /** The slot of the next event to be processed in the head chunk */
     int eventOut;
+    /** Chunk to store new events into */
+    EventChunk* volatile tail;
+    /** Free chunk ready to be linked by a producer without allocation */
+    EventChunk* volatile spare;
+    /**
+     * Chunks already consumed that producers may still look at,
+     * they are reused once no producer is active. Consumer only.
+     */
+    EventChunk* retired;
+    /** Number of producers currently storing events */
+    volatile int activeProducers;
+    /** Number of events in the queue, including ones being stored */
+    volatile int numEvents;
+    /** Largest number of events ever pending in the queue */
+    volatile int highWaterMark;
+    /** Number of events dropped because the queue could not grow */
+    volatile int droppedEvents;
+    /** Number of events merged into a later event, consumer only */
+    int mergedEvents;
     /** 
      * Indicates if the queue is currently active, that is, there is 
      * an actual Java queue associated with this native data. Queue 
@@ -101,7 +231,7 @@ typedef struct _EventQueue {
      */
     jboolean isActive;    
     /** Thread state for each Java native event monitor. */
-    jboolean isMonitorBlocked;
+    volatile jboolean isMonitorBlocked;
 } EventQueue;
 
 /** Queues of pending events, one per Isolate or 1 for SVM mode */
@@ -110,6 +240,12 @@ static EventQueue* gsEventQueues = NULL;
 /** Total event queues allocated */
 static int gsTotalQueues = 1;
 
+/** Free event chunks shared by all queues, used by the VM thread only */
+static EventChunk* gsChunkPool = NULL;
+
+/** Number of chunks in the pool */
+static int gsChunkPoolSize = 0;
+
 /** Max number of Isolates allowed in the system */
 #if ENABLE_MULTIPLE_ISOLATES
 static int gsMaxIsolates = 1;
@@ -279,10 +415,224 @@ duplicateMIDPEventFields(MidpEvent *event) {
 #endif
 
 /**
- * Gets the next pending event for an isolate.
+ * Allocates an empty event chunk.
+ *
+ * @return new chunk or NULL if out of memory
+ */
+static EventChunk* allocEventChunk(void) {
+    EventChunk* pChunk = (EventChunk*)midpMalloc(sizeof (EventChunk));
+
+    if (pChunk != NULL) {
+        memset((void*)pChunk, 0, sizeof (EventChunk));
+    }
+
+    return pChunk;
+}
+
+/**
+ * Returns a consumed chunk to the per-queue spare slot or to the pool,
+ * freeing it if the pool is full. Must be called in the VM thread.
+ *
+ * @param pEventQueue queue the chunk was used by
+ * @param pChunk chunk no producer can reference any more
+ */
+static void recycleEventChunk(EventQueue* pEventQueue, EventChunk* pChunk) {
+    /* Slots were reinitialized and ready flags cleared when consumed */
+    pChunk->next = NULL;
+    pChunk->nextFree = NULL;
+    pChunk->reserved = 0;
+
+    if (pEventQueue->spare == NULL) {
+        EVQ_BARRIER();
+        pEventQueue->spare = pChunk;
+    } else if (gsChunkPoolSize < EVENT_QUEUE_POOL_CHUNKS) {
+        pChunk->nextFree = gsChunkPool;
+        gsChunkPool = pChunk;
+        gsChunkPoolSize++;
+    } else {
+        midpFree(pChunk);
+    }
+}
+
+/**
+ * Recycles the retired chunks of a queue if no producer can be looking
+ * at them. A producer that starts later loads the current tail, which
+ * has moved past all of the retired chunks.
+ *
+ * @param pEventQueue queue to process
+ */
+static void reclaimRetiredChunks(EventQueue* pEventQueue) {
+    EventChunk* pChunk;
+
+    if (pEventQueue->retired == NULL) {
+        return;
+    }
+
+    EVQ_BARRIER();
+    if (pEventQueue->activeProducers != 0) {
+        return;
+    }
+
+    while (pEventQueue->retired != NULL) {
+        pChunk = pEventQueue->retired;
+        pEventQueue->retired = pChunk->nextFree;
+        recycleEventChunk(pEventQueue, pChunk);
+    }
+
+    /* Keep a spare chunk so the next producer does not allocate */
+    if (pEventQueue->spare == NULL && gsChunkPool != NULL) {
+        pChunk = gsChunkPool;
+        gsChunkPool = pChunk->nextFree;
+        gsChunkPoolSize--;
+        pChunk->nextFree = NULL;
+        EVQ_BARRIER();
+        pEventQueue->spare = pChunk;
+    }
+}
+
+/**
+ * Gets a chunk for a producer to link to the end of a queue.
+ * Takes the spare chunk of the queue without locking, and allocates
+ * a new one only if the spare has already been taken.
+ *
+ * @param pEventQueue queue to grow
+ *
+ * @return empty chunk or NULL if out of memory
+ */
+static EventChunk* takeEventChunk(EventQueue* pEventQueue) {
+    EventChunk* pChunk;
+
+    pChunk = (EventChunk*)EVQ_SWAP_PTR(&pEventQueue->spare, NULL);
+    if (pChunk != NULL) {
+        return pChunk;
+    }
+
+    return allocEventChunk();
+}
+
+/**
+ * Finds the next event to be read from a queue without removing it.
+ * Moves the head of the queue to the next chunk when the current one
+ * has been consumed. Must be called in the VM thread.
+ *
+ * @param pEventQueue queue to look at
+ *
+ * @return pointer to the next event or NULL if there is none ready
+ */
+static MidpEvent* peekPendingEvent(EventQueue* pEventQueue) {
+    EventChunk* pChunk;
+    EventChunk* pNext;
+
+    pChunk = pEventQueue->head;
+    if (pChunk == NULL) {
+        return NULL;
+    }
+
+    if (pEventQueue->eventOut == EVENT_QUEUE_CHUNK_EVENTS) {
+        pNext = pChunk->next;
+        if (pNext == NULL) {
+            reclaimRetiredChunks(pEventQueue);
+            return NULL;
+        }
+
+        /*
+         * Move the tail past the consumed chunk if the producer that
+         * linked the next chunk has not done it yet, so the chunk can be
+         * retired.
+         */
+        EVQ_CAS_PTR(&pEventQueue->tail, pChunk, pNext);
+
+        pEventQueue->head = pNext;
+        pEventQueue->eventOut = 0;
+
+        /*
+         * The next link is left intact for producers that still
+         * have the chunk as their tail.
+         */
+        pChunk->nextFree = pEventQueue->retired;
+        pEventQueue->retired = pChunk;
+        reclaimRetiredChunks(pEventQueue);
+
+        pChunk = pNext;
+    }
+
+    if (!pChunk->ready[pEventQueue->eventOut]) {
+        /* Empty, or the next event is still being stored */
+        return NULL;
+    }
+
+    EVQ_BARRIER();
+
+    return &pChunk->events[pEventQueue->eventOut];
+}
+
+/**
+ * Removes the event returned by peekPendingEvent from a queue.
+ *
+ * @param pEventQueue queue to remove the event from
+ * @param pEvent the next event of the queue
+ * @param pResult where to put the event
+ */
+static void removePendingEvent(EventQueue* pEventQueue, MidpEvent* pEvent,
+                               MidpEvent* pResult) {
+    *pResult = *pEvent;
+
+    /* Empty out the events so we do not free it when finalizing. */
+    MIDP_EVENT_INITIALIZE(*pEvent);
+    pEventQueue->head->ready[pEventQueue->eventOut] = 0;
+
+    pEventQueue->eventOut++;
+    EVQ_FETCH_ADD(&pEventQueue->numEvents, -1);
+}
+
+#if ENABLE_EVENT_COALESCING
+/**
+ * Checks if an event can be replaced by the event that follows it.
+ * Only pointer drags and screen repaints of the same display are
+ * merged, any other event in between keeps both of them. Repaint
+ * regions are merged by the Java RepaintEventProducer.
+ * <p>
+ * Screen change events are not handled here, they carry a Displayable
+ * and are only posted to the Java event queue, where
+ * LCDUIEventListener drops a change to a screen that is already
+ * pending.
+ *
+ * @param pEvent the event just read from a queue
+ * @param pNext the next event in the queue
+ *
+ * @return KNI_TRUE if pEvent may be dropped in favor of pNext
+ */
+static jboolean canMergeEvents(const MidpEvent* pEvent,
+                               const MidpEvent* pNext) {
+    if (pEvent->type != pNext->type || pEvent->DISPLAY != pNext->DISPLAY) {
+        return KNI_FALSE;
+    }
+
+    switch (pEvent->type) {
+    case MIDP_PEN_EVENT:
+        /* The latest position of a drag is all that is needed */
+        return (jboolean)(pEvent->ACTION == MIDP_DRAGGED &&
+                          pNext->ACTION == MIDP_DRAGGED);
+
+    case SCREEN_REPAINT_EVENT:
+        return KNI_TRUE;
+
+    default:
+        return KNI_FALSE;
+    }
+}
+#endif
+
+/**
+ * Gets the next pending event for an isolate. A run of events that
+ * only matters by its last element, like pointer drags, is returned
+ * as the last event of the run.
  * <p>
  * <b>NOTE:</b> Any string parameter data must be de-allocated with
  * <tt>midpFree</tt>.
+ * <p>
+ * Events are only consumed in the VM thread, so there is a single
+ * consumer for each queue.
  *
  * @param pResult where to put the pending event
  * @param queueId queue ID 
@@ -293,26 +643,42 @@ duplicateMIDPEventFields(MidpEvent *event) {
 static int
 getPendingMIDPEvent(MidpEvent* pResult, jint queueId) {
     EventQueue* pEventQueue;
+    MidpEvent* pEvent;
     
+    int result = -1;
+
     GET_EVENT_QUEUE_BY_ID(pEventQueue, queueId);
 
-    if (pEventQueue->numEvents == 0) {
-        return -1;
-    }
+#if !EVQ_LOCK_FREE
+    /*
+     * Without atomic operations the spare chunk, the chunk pool, the
+     * tail and the event count are only updated under the lock the
+     * producers hold.
+     */
+    midp_waitAndLockEventQueue();
+#endif
 
-    *pResult = pEventQueue->events[pEventQueue->eventOut];
+    pEvent = peekPendingEvent(pEventQueue);
+    if (pEvent != NULL) {
+        removePendingEvent(pEventQueue, pEvent, pResult);
 
-    /* Empty out the events so we do not free it when finalizing. */
-    MIDP_EVENT_INITIALIZE(pEventQueue->events[pEventQueue->eventOut]);
+#if ENABLE_EVENT_COALESCING
+        while ((pEvent = peekPendingEvent(pEventQueue)) != NULL &&
+               canMergeEvents(pResult, pEvent)) {
+            freeMIDPEventFields(*pResult);
+            removePendingEvent(pEventQueue, pEvent, pResult);
+            pEventQueue->mergedEvents++;
+        }
+#endif
 
-    pEventQueue->numEvents--;
-    pEventQueue->eventOut++;
-    if (pEventQueue->eventOut == MAX_EVENTS) {
-        /* This is a circular queue start back a zero. */
-        pEventQueue->eventOut = 0;
+        result = pEventQueue->numEvents;
     }
 
-    return pEventQueue->numEvents;
+#if !EVQ_LOCK_FREE
+    midp_unlockEventQueue();
+#endif
+
+    return result;
 }
 
 /**
@@ -334,6 +700,42 @@ static void resetEventQueue(jint queueId) {
     }
 }
 
+/**
+ * Frees all the chunks of an event queue. No producer may be
+ * storing events at the moment.
+ *
+ * @param pEventQueue queue to free the chunks of
+ */
+static void freeEventQueueChunks(EventQueue* pEventQueue) {
+    EventChunk* pChunk;
+    int i;
+
+    while (pEventQueue->head != NULL) {
+        pChunk = pEventQueue->head;
+        pEventQueue->head = pChunk->next;
+        /* Events that were still being stored when the queue was reset */
+        for (i = 0; i < EVENT_QUEUE_CHUNK_EVENTS; i++) {
+            if (pChunk->ready[i]) {
+                freeMIDPEventFields(pChunk->events[i]);
+            }
+        }
+        midpFree(pChunk);
+    }
+
+    while (pEventQueue->retired != NULL) {
+        pChunk = pEventQueue->retired;
+        pEventQueue->retired = pChunk->nextFree;
+        midpFree(pChunk);
+    }
+
+    if (pEventQueue->spare != NULL) {
+        midpFree(pEventQueue->spare);
+    }
+
+    pEventQueue->tail = NULL;
+    pEventQueue->spare = NULL;
+}
+
 /**
  * Blocks Java thread that monitors specified event queue.
  *
@@ -410,6 +812,7 @@ static void unblockMonitorThread(jint queueId) {
 int
 InitializeEvents(void) {
     int sizeInBytes;
+    int i;
 
     if (NULL != gsEventQueues) {
         /* already done */
@@ -442,6 +845,22 @@ InitializeEvents(void) {
 
     memset(gsEventQueues, 0, sizeInBytes);
 
+    for (i = 0; i < gsTotalQueues; i++) {
+        EventChunk* pChunk = allocEventChunk();
+
+        if (NULL == pChunk) {
+            while (i-- > 0) {
+                freeEventQueueChunks(&gsEventQueues[i]);
+            }
+            midpFree(gsEventQueues);
+            gsEventQueues = NULL;
+            return -1;
+        }
+
+        gsEventQueues[i].head = pChunk;
+        gsEventQueues[i].tail = pChunk;
+    }
+
     midp_createEventQueueLock();
 
     return 0;
@@ -455,10 +874,25 @@ FinalizeEvents(void) {
     midp_destroyEventQueueLock();
 
     if (gsEventQueues != NULL) {
+        int i;
+
         midp_resetEvents();
+
+        for (i = 0; i < gsTotalQueues; i++) {
+            freeEventQueueChunks(&gsEventQueues[i]);
+        }
+
         midpFree(gsEventQueues);
         gsEventQueues = NULL;
     }
+
+    while (gsChunkPool != NULL) {
+        EventChunk* pChunk = gsChunkPool;
+
+        gsChunkPool = pChunk->nextFree;
+        midpFree(pChunk);
+    }
+    gsChunkPoolSize = 0;
 }
 
 /**
@@ -483,6 +917,89 @@ midp_resetEvents(void) {
 #endif
 }
 
+/**
+ * Updates the high water mark of a queue.
+ *
+ * @param pEventQueue queue to update
+ * @param numEvents number of events now pending in the queue
+ */
+static void updateHighWaterMark(EventQueue* pEventQueue, int numEvents) {
+    int mark;
+
+    do {
+        mark = pEventQueue->highWaterMark;
+        if (numEvents <= mark) {
+            return;
+        }
+    } while (!EVQ_CAS(&pEventQueue->highWaterMark, mark, numEvents));
+}
+
+/**
+ * Stores an event at the end of a queue. Slots are reserved with
+ * atomic operations, so producers do not need to lock. The queue grows
+ * by linking a new chunk when the last one is full.
+ *
+ * @param pEventQueue queue to store the event in
+ * @param pEvent the event to store
+ *
+ * @return 0 if the event was stored, or -1 if it has to be dropped
+ */
+static int putEvent(EventQueue* pEventQueue, MidpEvent* pEvent) {
+    EventChunk* pChunk;
+    EventChunk* pNext;
+    int numEvents;
+    int slot;
+    int result = -1;
+
+    numEvents = EVQ_FETCH_ADD(&pEventQueue->numEvents, 1) + 1;
+    if (numEvents > EVENT_QUEUE_MAX_EVENTS) {
+        EVQ_FETCH_ADD(&pEventQueue->numEvents, -1);
+        return -1;
+    }
+
+    updateHighWaterMark(pEventQueue, numEvents);
+
+    /* Chunks cannot be reused while a producer is active */
+    EVQ_FETCH_ADD(&pEventQueue->activeProducers, 1);
+
+    for (;;) {
+        pChunk = pEventQueue->tail;
+        slot = EVQ_FETCH_ADD(&pChunk->reserved, 1);
+
+        if (slot < EVENT_QUEUE_CHUNK_EVENTS) {
+            pChunk->events[slot] = *pEvent;
+            EVQ_BARRIER();
+            pChunk->ready[slot] = 1;
+            result = 0;
+            break;
+        }
+
+        /* The chunk is full, make sure the next one exists and move on */
+        pNext = pChunk->next;
+        if (pNext == NULL) {
+            pNext = takeEventChunk(pEventQueue);
+            if (pNext == NULL) {
+                EVQ_FETCH_ADD(&pEventQueue->numEvents, -1);
+                break;
+            }
+
+            if (!EVQ_CAS_PTR(&pChunk->next, NULL, pNext)) {
+                /* Another producer linked a chunk first */
+                if (!EVQ_CAS_PTR(&pEventQueue->spare, NULL, pNext)) {
+                    midpFree(pNext);
+                }
+                pNext = pChunk->next;
+            }
+        }
+
+        EVQ_CAS_PTR(&pEventQueue->tail, pChunk, pNext);
+    }
+
+    EVQ_FETCH_ADD(&pEventQueue->activeProducers, -1);
+
+    return result;
+}
+
 /**
  * Helper function used by StoreMIDPEventInVmThread. Enqueues an event 
  * to be processed by the Java event thread for a given event queue.
@@ -492,39 +1009,46 @@ midp_resetEvents(void) {
  */
 static void StoreMIDPEventInVmThreadImp(MidpEvent event, jint queueId) {
     EventQueue* pEventQueue;
+    int result;
 
     GET_EVENT_QUEUE_BY_ID(pEventQueue, queueId);
 
     midp_logThreadId("StoreMIDPEventInVmThread");
 
+#if !EVQ_LOCK_FREE
     midp_waitAndLockEventQueue();
+#endif
 
-    if (pEventQueue->numEvents != MAX_EVENTS) {
+    result = putEvent(pEventQueue, &event);
+    if (result != 0) {
+        EVQ_FETCH_ADD(&pEventQueue->droppedEvents, 1);
+    }
 
-        pEventQueue->events[pEventQueue->eventIn] = event;
-        pEventQueue->eventIn++;
-        if (pEventQueue->eventIn == MAX_EVENTS) {
-            /* This is a circular queue, so start back at zero. */
-            pEventQueue->eventIn = 0;
-        }
-      
-        pEventQueue->numEvents++;
+#if !EVQ_LOCK_FREE
+    midp_unlockEventQueue();
+#endif
 
+    if (result == 0) {
+        EVQ_BARRIER();
         if (pEventQueue->isMonitorBlocked) {
-            unblockMonitorThread(queueId);
+            /* Only one producer may wake up the monitor thread */
+            midp_waitAndLockEventQueue();
+            if (pEventQueue->isMonitorBlocked) {
+                unblockMonitorThread(queueId);
+            }
+            midp_unlockEventQueue();
         }
     } else {
         /*
-         * Ignore the event; there is no space to store it.
-         * IMPL NOTE: this should be fixed, or it should be a fatal error; 
-         * dropping an event can lead to a full system deadlock.
+         * Ignore the event; the queue is over its limit or out of memory.
+         * Dropping an event can lead to a full system deadlock, the count
+         * of dropped events can be read with GetEventQueueDropCount.
          */
-        REPORT_CRIT1(LC_CORE,"**event queue %d full, dropping event",
-                     queueId); 
+        REPORT_CRIT2(LC_CORE,
+                     "**event queue %d full, dropping event (%d dropped)",
+                     queueId, pEventQueue->droppedEvents);
     }
 
-    midp_unlockEventQueue();
-
 #if ENABLE_EVENT_SPYING
     if (queueId != gsEventSpyingQueueId) {
         GET_EVENT_QUEUE_BY_ID(pEventQueue, gsEventSpyingQueueId);
@@ -607,7 +1131,73 @@ int GetEventQueueFreeCount(int isolateId) {
     }
     GET_EVENT_QUEUE_BY_ID(pEventQueue, queueId);
 
-    return MAX_EVENTS - pEventQueue->numEvents;
+    return EVENT_QUEUE_MAX_EVENTS - pEventQueue->numEvents;
+}
+
+/**
+ * Reports the largest number of events that were pending in a queue
+ * at the same time.
+ *
+ * @param isolateId  ID of an Isolate, 0 for SVM mode
+ *
+ * @return high water mark of the queue
+ *         negative value on error
+ */
+int GetEventQueueHighWaterMark(int isolateId) {
+    jint queueId;
+    EventQueue* pEventQueue;
+
+    queueId = ISOLATE_ID_TO_QUEUE_ID(isolateId);
+    if (queueId < 0 || queueId >= gsTotalQueues) {
+        return -1;
+    }
+    GET_EVENT_QUEUE_BY_ID(pEventQueue, queueId);
+
+    return pEventQueue->highWaterMark;
+}
+
+/**
+ * Reports how many events were dropped because a queue was over
+ * its limit or could not grow.
+ *
+ * @param isolateId  ID of an Isolate, 0 for SVM mode
+ *
+ * @return number of dropped events
+ *         negative value on error
+ */
+int GetEventQueueDropCount(int isolateId) {
+    jint queueId;
+    EventQueue* pEventQueue;
+
+    queueId = ISOLATE_ID_TO_QUEUE_ID(isolateId);
+    if (queueId < 0 || queueId >= gsTotalQueues) {
+        return -1;
+    }
+    GET_EVENT_QUEUE_BY_ID(pEventQueue, queueId);
+
+    return pEventQueue->droppedEvents;
+}
+
+/**
+ * Reports how many events were merged into a later event of the same
+ * kind instead of being delivered.
+ *
+ * @param isolateId  ID of an Isolate, 0 for SVM mode
+ *
+ * @return number of merged events
+ *         negative value on error
+ */
+int GetEventQueueMergeCount(int isolateId) {
+    jint queueId;
+    EventQueue* pEventQueue;
+
+    queueId = ISOLATE_ID_TO_QUEUE_ID(isolateId);
+    if (queueId < 0 || queueId >= gsTotalQueues) {
+        return -1;
+    }
+    GET_EVENT_QUEUE_BY_ID(pEventQueue, queueId);
+
+    return pEventQueue->mergedEvents;
 }
 
 /**
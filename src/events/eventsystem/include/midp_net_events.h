@@ -58,6 +58,41 @@ jboolean midp_check_net_status_signal(int* pStatus);
  */
 void midp_network_status_event(int isInit, int status);
 
+/**
+ * Set by the ports that keep the descriptors of the open sockets
+ * registered with the system between the checks for signals. Such a
+ * port is told when a socket is opened and before it is closed,
+ * other ports get no calls.
+ */
+#ifndef ENABLE_SOCKET_REGISTRATION
+#define ENABLE_SOCKET_REGISTRATION 0
+#endif
+
+#if ENABLE_SOCKET_REGISTRATION
+
+/**
+ * This function is called when a socket is opened or accepted and
+ * its PCSL handle becomes known.
+ *
+ * @param handle PCSL handle of the socket
+ */
+void midp_socket_opened(void* handle);
+
+/**
+ * This function is called before a socket is closed. Calls for
+ * a handle that is not registered are ignored.
+ *
+ * @param handle PCSL handle of the socket
+ */
+void midp_socket_closed(void* handle);
+
+#else
+
+#define midp_socket_opened(handle)
+#define midp_socket_closed(handle)
+
+#endif /* ENABLE_SOCKET_REGISTRATION */
+
 #ifdef __cplusplus
 }
 #endif
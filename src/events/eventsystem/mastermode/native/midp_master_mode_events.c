@@ -56,6 +56,29 @@ static MidpReentryData newSignal;
 static MidpEvent newMidpEvent;
 static MidpEvent newCompMidpEvent;
 
+/**
+ * Socket signals found by the port in one midp_check_events call are
+ * delivered together with midp_thread_signal_batch. The thread support
+ * of the CDC VM lives outside of this module, so it is not done there.
+ */
+#ifndef ENABLE_SIGNAL_BATCHING
+#if ENABLE_CDC
+#define ENABLE_SIGNAL_BATCHING 0
+#else
+#define ENABLE_SIGNAL_BATCHING 1
+#endif
+#endif
+
+#if ENABLE_SIGNAL_BATCHING
+/** Maximum number of signals delivered together */
+#define SIGNAL_BATCH_SIZE 32
+
+static MidpReentryData signalBatch[SIGNAL_BATCH_SIZE];
+static midpSignalType signalBatchReceived[SIGNAL_BATCH_SIZE];
+static int signalBatchFirstOnly[SIGNAL_BATCH_SIZE];
+static int signalBatchUnblocked[SIGNAL_BATCH_SIZE];
+#endif
+
 /**
  * Unblock a Java thread.
  * Returns 1 if a thread was unblocked, otherwise 0.
@@ -93,6 +116,161 @@ eventUnblockJavaThread(
     return 0;
 }
 
+#if ENABLE_SIGNAL_BATCHING
+/**
+ * Checks if a signal only unblocks the threads waiting for it and can
+ * be delivered with other signals of this kind.
+ */
+static int
+isBatchedSignal(midpSignalType waitingFor) {
+    switch (waitingFor) {
+    case NETWORK_READ_SIGNAL:
+    case NETWORK_EXCEPTION_SIGNAL:
+        return 1;
+#if !(ENABLE_JSR_120 || ENABLE_JSR_205)
+    case NETWORK_WRITE_SIGNAL:
+        /* WMA may claim write signals before the threads */
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Checks if the batch has a signal for a descriptor.
+ *
+ * @param waitingFor type of the signal
+ * @param descriptor descriptor of the signal
+ * @param count number of signals in the batch
+ *
+ * @return 1 if the signal is in the batch, 0 otherwise
+ */
+static int
+isSignalInBatch(midpSignalType waitingFor, int descriptor, int count) {
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (signalBatch[i].descriptor == descriptor &&
+                signalBatch[i].waitingFor == waitingFor) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Adds a signal to the batch unless it is already there.
+ *
+ * @param pSignal signal to add, as received from the port
+ * @param waitingFor type of the signal to add
+ * @param firstOnly 1 if only the first thread waiting for the signal
+ *                  is to be unblocked, 0 to unblock all of them
+ * @param count number of signals in the batch
+ *
+ * @return new number of signals in the batch
+ */
+static int
+addSignalToBatch(const MidpReentryData* pSignal, midpSignalType waitingFor,
+                 int firstOnly, int count) {
+    if (!isSignalInBatch(waitingFor, pSignal->descriptor, count)) {
+        signalBatch[count] = *pSignal;
+        signalBatch[count].waitingFor = waitingFor;
+        signalBatchReceived[count] = pSignal->waitingFor;
+        signalBatchFirstOnly[count] = firstOnly;
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Adds a socket signal to the batch. The threads are unblocked as the
+ * switch in midp_check_events does for a single signal: a read signal
+ * unblocks the first thread reading the descriptor, an exception
+ * signal the first reading and the first writing thread, a write
+ * signal all the writing threads.
+ *
+ * @param pSignal signal to add
+ * @param count number of signals in the batch
+ *
+ * @return new number of signals in the batch
+ */
+static int
+addSocketSignalToBatch(const MidpReentryData* pSignal, int count) {
+    if (pSignal->waitingFor == NETWORK_EXCEPTION_SIGNAL) {
+        count = addSignalToBatch(pSignal, NETWORK_READ_SIGNAL, 1, count);
+        return addSignalToBatch(pSignal, NETWORK_WRITE_SIGNAL, 1, count);
+    }
+
+    return addSignalToBatch(pSignal, pSignal->waitingFor,
+                            pSignal->waitingFor == NETWORK_READ_SIGNAL,
+                            count);
+}
+
+/**
+ * Collects the socket signals the port has already queued after the
+ * one just received and unblocks all of the waiting threads at once.
+ * The port is not polled again: the threads of the signals in the
+ * batch have not run yet, so their descriptors would be reported again.
+ * A signal of another kind taken from the queue is left in newSignal.
+ *
+ * @param blocked_threads Array of blocked threads
+ * @param blocked_threads_count Number of threads in blocked_threads array
+ */
+static void
+deliverSignalBatch(JVMSPI_BlockedThreadInfo *blocked_threads,
+                   int blocked_threads_count) {
+    int count;
+    int i;
+
+    count = addSocketSignalToBatch(&newSignal, 0);
+    newSignal.waitingFor = 0;
+
+    /* Leave room for an exception signal, which takes two entries */
+    while (count + 2 <= SIGNAL_BATCH_SIZE) {
+        newSignal.waitingFor = 0;
+        newSignal.status = 0;
+        newSignal.pResult = NULL;
+
+        if (!checkForQueuedSignal(&newSignal)) {
+            newSignal.waitingFor = 0;
+            break;
+        }
+
+        if (!isBatchedSignal(newSignal.waitingFor)) {
+            break;
+        }
+
+        count = addSocketSignalToBatch(&newSignal, count);
+        newSignal.waitingFor = 0;
+    }
+
+    midp_thread_signal_batch(blocked_threads, blocked_threads_count,
+        signalBatch, count, signalBatchFirstOnly, signalBatchUnblocked);
+
+    for (i = 0; i < count; i++) {
+        if (signalBatchReceived[i] != NETWORK_READ_SIGNAL ||
+                signalBatchUnblocked[i] != 0) {
+            continue;
+        }
+
+        /* Nobody waits for the data, it may be for push or WMA */
+        if (findPushBlockedHandle(signalBatch[i].descriptor) != 0) {
+            /* The push system is waiting for a read on this descriptor */
+            midp_thread_signal_list(blocked_threads, blocked_threads_count,
+                                    PUSH_SIGNAL, 0, 0);
+        }
+#if (ENABLE_JSR_120 || ENABLE_JSR_205)
+        else
+            jsr120_check_signal(signalBatch[i].waitingFor,
+                signalBatch[i].descriptor, signalBatch[i].status);
+#endif
+    }
+}
+#endif /* ENABLE_SIGNAL_BATCHING */
+
 /**
  * This function is called by the VM periodically. It has to check if
  * any of the blocked threads are ready for execution, and call
@@ -125,6 +303,16 @@ void midp_check_events(JVMSPI_BlockedThreadInfo *blocked_threads,
 
     checkForSystemSignal(&newSignal, &newMidpEvent, timeout);
 
+#if ENABLE_SIGNAL_BATCHING
+    if (isBatchedSignal(newSignal.waitingFor)) {
+        deliverSignalBatch(blocked_threads, blocked_threads_count);
+        /*
+         * Process the signal that ended the batch below, if there is
+         * none the default case still checks the external events
+         */
+    }
+#endif
+
     switch (newSignal.waitingFor) {
 #if ENABLE_JAVA_DEBUGGER
     case VM_DEBUG_SIGNAL:
@@ -119,3 +119,12 @@ void checkForSystemSignal(MidpReentryData* pNewSignal,
         }
     } while (forever || midp_getCurrentTime() < end);
 }
+
+/*
+ * Returns a socket signal queued by the port without polling the system.
+ * This port does not queue signals.
+ */
+jboolean checkForQueuedSignal(MidpReentryData* pNewSignal) {
+    (void)pNewSignal;
+    return KNI_FALSE;
+}
@@ -65,6 +65,20 @@ extern void checkForSystemSignal(MidpReentryData* pNewSignal,
                                  MidpEvent* pNewMidpEvent,
                                  jlong timeout);
 
+/**
+ * Returns a socket signal the port has already queued, for example
+ * the remaining descriptors found ready by the last wait. Unlike
+ * checkForSystemSignal, this function never polls the system, so the
+ * same descriptor is not reported again before its thread has run.
+ * Ports that do not queue signals always return KNI_FALSE.
+ *
+ * @param pNewSignal OUT reentry data to unblock threads waiting for
+ *                   the signal
+ *
+ * @return KNI_TRUE if a queued signal was returned, KNI_FALSE otherwise
+ */
+extern jboolean checkForQueuedSignal(MidpReentryData* pNewSignal);
+
 #ifdef __cplusplus
 }
 #endif
@@ -632,3 +632,12 @@ void midpFreeEventResult(int waitingFor, void* pResult) {
     (void)waitingFor;
     (void)pResult;
 }
+
+/*
+ * Returns a socket signal queued by the port without polling the system.
+ * This port does not queue signals.
+ */
+jboolean checkForQueuedSignal(MidpReentryData* pNewSignal) {
+    (void)pNewSignal;
+    return KNI_FALSE;
+}
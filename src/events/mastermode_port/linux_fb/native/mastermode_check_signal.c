@@ -49,6 +49,7 @@
 
 #include "mastermode_check_signal.h"
 #include "mastermode_handle_signal.h"
+#include "mastermode_epoll.h"
 
 /* Forward declarations */
 static jboolean checkForSocketPointerAndKeyboardSignal(MidpReentryData* pNewSignal,
@@ -68,6 +69,53 @@ fCheckForSignal checkForSignal[] = {
 int checkForSignalNum =
     sizeof(checkForSignal) / sizeof(fCheckForSignal);
 
+#if ENABLE_EPOLL
+/**
+ * Check and handle socket & pointer & keyboard system signals with epoll.
+ * All the sockets that are ready after the wait are queued and returned
+ * one by one by checkForPendingSignals() without further waits.
+ *
+ * @param pNewSignal        OUT reentry data to unblock threads waiting for a signal
+ * @param pNewMidpEvent     OUT a native MIDP event to be stored to Java event queue
+ * @param timeout64         IN  >0 the time system can be blocked waiting for a signal
+ *                              =0 don't block the system, check for signals instantly
+ *                              <0 block the system until a signal received
+ * @param pResult           OUT KNI_TRUE if signal received, KNI_FALSE otherwise
+ *
+ * @return KNI_FALSE if epoll is not available, KNI_TRUE otherwise
+ */
+static jboolean checkForSignalWithEpoll(MidpReentryData* pNewSignal,
+    MidpEvent* pNewMidpEvent, jlong timeout64, jboolean* pResult) {
+
+    jboolean keyReady, pointerReady;
+    int num_ready;
+
+    num_ready = pollDescriptors(fbapp_get_keyboard_fd(),
+        fbapp_get_mouse_fd(), timeout64, &keyReady, &pointerReady);
+    if (num_ready < 0) {
+        return KNI_FALSE;
+    }
+
+    *pResult = KNI_TRUE;
+    if (keyReady) {
+        /* Handle keyboard event */
+        REPORT_INFO(LC_CORE, "[checkForSignalWithEpoll] keyboard signal detected");
+        handleKey(pNewSignal, pNewMidpEvent);
+    } else if (pointerReady) {
+        /* Handle pointer event */
+        REPORT_INFO(LC_CORE, "[checkForSignalWithEpoll] pointer signal detected");
+        handlePointer(pNewSignal, pNewMidpEvent);
+    } else if (getPendingSocketSignal(pNewSignal)) {
+        REPORT_INFO1(LC_CORE,
+            "[checkForSignalWithEpoll] %d descriptors ready", num_ready);
+    } else {
+        *pResult = KNI_FALSE;
+    }
+
+    return KNI_TRUE;
+}
+#endif /* ENABLE_EPOLL */
+
 /**
  * Check and handle socket & pointer & keyboard system signals.
  * The function groups signals that can be checked with a single system call.
@@ -98,6 +146,15 @@ static jboolean checkForSocketPointerAndKeyboardSignal(MidpReentryData* pNewSign
     const SocketHandle* btSocketsList = GetRegisteredBtSocketHandles();
 #endif /* ENABLE_JSR_82_SOCK */
 
+#if ENABLE_EPOLL
+    jboolean result;
+
+    if (checkForSignalWithEpoll(pNewSignal, pNewMidpEvent, timeout64,
+            &result)) {
+        return result;
+    }
+#endif /* ENABLE_EPOLL */
+
     FD_ZERO(&read_fds);
     FD_ZERO(&write_fds);
     FD_ZERO(&except_fds);
@@ -259,6 +316,12 @@ jboolean checkForPendingSignals(MidpReentryData* pNewSignal,
     if (checkForPendingKeySignal(pNewSignal, pNewMidpEvent)) {
         return KNI_TRUE;
     }
+#if ENABLE_EPOLL
+    /* Sockets found ready by the last wait */
+    if (getPendingSocketSignal(pNewSignal)) {
+        return KNI_TRUE;
+    }
+#endif /* ENABLE_EPOLL */
     return checkForPendingTimerSignal(currentTime);
 }
 
@@ -0,0 +1,443 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ *
+ * Descriptor polling with epoll for the master mode event loop.
+ */
+
+#include <kni.h>
+
+#include "mastermode_epoll.h"
+
+#if ENABLE_EPOLL
+
+#include <sys/epoll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include <midpMalloc.h>
+#include <midp_logging.h>
+
+/** Size hint for the epoll instance */
+#define EPOLL_SIZE_HINT 256
+
+#ifdef EPOLLRDHUP
+#define EPOLL_READ_EVENTS (EPOLLIN | EPOLLRDHUP)
+#else
+#define EPOLL_READ_EVENTS EPOLLIN
+#endif
+
+/** A descriptor that may be registered with the epoll instance */
+typedef struct _PolledFd {
+    /** Previous open socket, unused for input devices */
+    struct _PolledFd* prev;
+    /** Next open socket, unused for input devices */
+    struct _PolledFd* next;
+    /** The descriptor, -1 if none */
+    int fd;
+    /** Socket the descriptor belongs to, NULL for input devices */
+    const SocketHandle* socket;
+    /** Events the descriptor is registered for, 0 if not registered */
+    unsigned int events;
+} PolledFd;
+
+/** A socket signal waiting to be returned */
+typedef struct _PendingSignal {
+    /** Socket the signal is for, NULL if the socket has been closed */
+    const SocketHandle* socket;
+    /** Type of the signal */
+    midpSignalType waitingFor;
+} PendingSignal;
+
+/** The epoll instance, -1 before it is created */
+static int epollFd = -1;
+
+/** Set if epoll cannot be used and select() is to be used instead */
+static jboolean epollFailed = KNI_FALSE;
+
+/** The keyboard descriptor */
+static PolledFd keyboardFd = { NULL, NULL, -1, NULL, 0 };
+
+/** The pointer descriptor */
+static PolledFd mouseFd = { NULL, NULL, -1, NULL, 0 };
+
+/** Sockets opened since the epoll instance was created */
+static PolledFd* openSockets = NULL;
+
+/** Number of descriptors registered with the epoll instance */
+static int numRegistered = 0;
+
+/**
+ * Signals found by the last wait. Each descriptor gives at most
+ * a read and a write signal.
+ */
+static PendingSignal pendingSignals[2 * EPOLL_BATCH_SIZE];
+
+/** Number of signals in pendingSignals */
+static int numPendingSignals = 0;
+
+/** Index of the next signal to return from pendingSignals */
+static int nextPendingSignal = 0;
+
+/**
+ * Create the epoll instance on the first use.
+ *
+ * @return KNI_TRUE if epoll is available, KNI_FALSE otherwise
+ */
+static jboolean initEpoll(void) {
+    if (epollFd != -1) {
+        return KNI_TRUE;
+    }
+    if (epollFailed) {
+        return KNI_FALSE;
+    }
+
+    epollFd = epoll_create(EPOLL_SIZE_HINT);
+    if (epollFd == -1) {
+        REPORT_WARN1(LC_CORE,
+            "[initEpoll] epoll_create failed (errno=%d), using select()",
+            errno);
+        epollFailed = KNI_TRUE;
+        return KNI_FALSE;
+    }
+
+    fcntl(epollFd, F_SETFD, FD_CLOEXEC);
+    return KNI_TRUE;
+}
+
+/**
+ * Change the events a descriptor is registered for. The descriptor is
+ * added when it was not registered and removed when no event is left.
+ *
+ * @param entry the descriptor
+ * @param events events to wait for, 0 to stop waiting
+ */
+static void setPolledEvents(PolledFd* entry, unsigned int events) {
+    struct epoll_event ev;
+    int op;
+
+    if (entry->events == events) {
+        return;
+    }
+
+    if (events == 0) {
+        op = EPOLL_CTL_DEL;
+    } else if (entry->events == 0) {
+        op = EPOLL_CTL_ADD;
+    } else {
+        op = EPOLL_CTL_MOD;
+    }
+
+    ev.events = events;
+    ev.data.ptr = entry;
+
+    if (epoll_ctl(epollFd, op, entry->fd, &ev) != 0) {
+        REPORT_ERROR2(LC_CORE,
+            "[setPolledEvents] cannot update fd %d (errno=%d)",
+            entry->fd, errno);
+        if (op != EPOLL_CTL_DEL) {
+            return;
+        }
+    }
+
+    if (entry->events == 0) {
+        numRegistered++;
+    } else if (events == 0) {
+        numRegistered--;
+    }
+    entry->events = events;
+}
+
+/**
+ * Keep an input device registered when its descriptor changes.
+ *
+ * @param entry the device entry
+ * @param fd the current descriptor of the device or -1
+ */
+static void updateDeviceFd(PolledFd* entry, int fd) {
+    if (entry->fd == fd) {
+        return;
+    }
+
+    if (entry->fd != -1) {
+        setPolledEvents(entry, 0);
+    }
+    entry->fd = fd;
+    if (fd != -1) {
+        setPolledEvents(entry, EPOLLIN);
+    }
+}
+
+/**
+ * Apply the changes of the signals the open sockets wait for. Only
+ * the sockets whose interest changed since the previous check are
+ * passed to the kernel, and a socket that waits for nothing is not
+ * registered.
+ */
+static void updateSocketInterest(void) {
+    PolledFd* entry;
+
+    for (entry = openSockets; entry != NULL; entry = entry->next) {
+        unsigned int flags = 0;
+
+        if (entry->socket->check_flags & (CHECK_READ | CHECK_WRITE)) {
+            flags = EPOLLPRI;
+            if (entry->socket->check_flags & CHECK_READ) {
+                flags |= EPOLL_READ_EVENTS;
+            }
+            if (entry->socket->check_flags & CHECK_WRITE) {
+                flags |= EPOLLOUT;
+            }
+        }
+
+        setPolledEvents(entry, flags);
+    }
+}
+
+/**
+ * Queue the signals of a ready socket.
+ *
+ * @param socket the socket
+ * @param events events reported for the socket descriptor
+ */
+static void queueSocketSignals(const SocketHandle* socket,
+        unsigned int events) {
+    if (events & EPOLLPRI) {
+        pendingSignals[numPendingSignals].socket = socket;
+        pendingSignals[numPendingSignals].waitingFor =
+            NETWORK_EXCEPTION_SIGNAL;
+        numPendingSignals++;
+        return;
+    }
+
+    /* As with select(), an error or hang up makes the socket ready */
+    if ((socket->check_flags & CHECK_READ) &&
+            (events & (EPOLL_READ_EVENTS | EPOLLERR | EPOLLHUP))) {
+        pendingSignals[numPendingSignals].socket = socket;
+        pendingSignals[numPendingSignals].waitingFor = NETWORK_READ_SIGNAL;
+        numPendingSignals++;
+    }
+    if ((socket->check_flags & CHECK_WRITE) &&
+            (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+        pendingSignals[numPendingSignals].socket = socket;
+        pendingSignals[numPendingSignals].waitingFor = NETWORK_WRITE_SIGNAL;
+        numPendingSignals++;
+    }
+}
+
+/**
+ * Start tracking a socket. It is registered with the kernel once it
+ * waits for a signal.
+ *
+ * @param handle PCSL handle of the socket
+ */
+void midp_socket_opened(void* handle) {
+    PolledFd* entry;
+
+    if (!initEpoll()) {
+        return;
+    }
+
+    entry = (PolledFd*)midpMalloc(sizeof (PolledFd));
+    if (entry == NULL) {
+        REPORT_CRIT1(LC_CORE,
+            "[midp_socket_opened] out of memory, socket 0x%x is not polled",
+            (int)handle);
+        return;
+    }
+
+    entry->socket = (const SocketHandle*)handle;
+    entry->fd = entry->socket->fd;
+    entry->events = 0;
+    entry->prev = NULL;
+    entry->next = openSockets;
+    if (openSockets != NULL) {
+        openSockets->prev = entry;
+    }
+    openSockets = entry;
+}
+
+/**
+ * Stop tracking a socket before its descriptor is closed, so the
+ * descriptor can be reused by another socket.
+ *
+ * @param handle PCSL handle of the socket
+ */
+void midp_socket_closed(void* handle) {
+    PolledFd* entry;
+    int i;
+
+    for (entry = openSockets; entry != NULL; entry = entry->next) {
+        if (entry->socket == (const SocketHandle*)handle) {
+            break;
+        }
+    }
+    if (entry == NULL) {
+        return;
+    }
+
+    setPolledEvents(entry, 0);
+
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        openSockets = entry->next;
+    }
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    }
+    midpFree(entry);
+
+    /* A new socket may get the same handle */
+    for (i = nextPendingSignal; i < numPendingSignals; i++) {
+        if (pendingSignals[i].socket == (const SocketHandle*)handle) {
+            pendingSignals[i].socket = NULL;
+        }
+    }
+}
+
+/**
+ * Wait for the keyboard, pointer and socket descriptors to become
+ * ready. The sockets are registered by midp_socket_opened() and only
+ * those whose interest changed since the previous call are updated.
+ * Ready sockets are queued as reentry signals to be returned by
+ * getPendingSocketSignal().
+ *
+ * @param keyboard_fd keyboard descriptor or -1
+ * @param mouse_fd pointer descriptor or -1
+ * @param timeout64 >0 the time system can be blocked waiting for a signal
+ *                  =0 don't block the system, check for signals instantly
+ *                  <0 block the system until a signal received
+ * @param pKeyReady OUT set to KNI_TRUE if the keyboard is ready
+ * @param pPointerReady OUT set to KNI_TRUE if the pointer is ready
+ *
+ * @return number of ready descriptors, 0 if no descriptor is ready,
+ *         or -1 if epoll is not available and select() must be used
+ */
+int pollDescriptors(int keyboard_fd, int mouse_fd, jlong timeout64,
+        /*OUT*/ jboolean* pKeyReady, /*OUT*/ jboolean* pPointerReady) {
+
+    struct epoll_event events[EPOLL_BATCH_SIZE];
+    PolledFd* entry;
+    int timeout;
+    int num_ready;
+    int i;
+
+    *pKeyReady = KNI_FALSE;
+    *pPointerReady = KNI_FALSE;
+
+    if (!initEpoll()) {
+        return -1;
+    }
+
+    updateDeviceFd(&keyboardFd, keyboard_fd);
+    updateDeviceFd(&mouseFd, mouse_fd);
+    updateSocketInterest();
+
+    if (numRegistered == 0) {
+        /* Nothing to wait for, same as select() with no descriptors */
+        return 0;
+    }
+
+    if (timeout64 < 0) {
+        timeout = -1;
+    } else if (timeout64 > INT_MAX) {
+        timeout = INT_MAX;
+    } else {
+        timeout = (int)timeout64;
+    }
+
+    num_ready = epoll_wait(epollFd, events, EPOLL_BATCH_SIZE, timeout);
+    if (num_ready <= 0) {
+        /* Timeout or an interrupt */
+        return 0;
+    }
+
+    numPendingSignals = 0;
+    nextPendingSignal = 0;
+
+    for (i = 0; i < num_ready; i++) {
+        entry = (PolledFd*)events[i].data.ptr;
+
+        if (entry == &keyboardFd) {
+            *pKeyReady = KNI_TRUE;
+        } else if (entry == &mouseFd) {
+            *pPointerReady = KNI_TRUE;
+        } else {
+            queueSocketSignals(entry->socket, events[i].events);
+        }
+    }
+
+    return num_ready;
+}
+
+/**
+ * Return the next socket signal queued by pollDescriptors().
+ *
+ * @param pNewSignal OUT reentry data to unblock a thread waiting for
+ *                   a socket signal
+ *
+ * @return KNI_TRUE if a signal was returned, KNI_FALSE if none is queued
+ */
+jboolean getPendingSocketSignal(/*OUT*/ MidpReentryData* pNewSignal) {
+    while (nextPendingSignal < numPendingSignals) {
+        PendingSignal* signal = &pendingSignals[nextPendingSignal++];
+
+        if (signal->socket != NULL) {
+            pNewSignal->descriptor = (int)signal->socket;
+            pNewSignal->waitingFor = signal->waitingFor;
+            return KNI_TRUE;
+        }
+    }
+
+    return KNI_FALSE;
+}
+
+#else
+
+/**
+ * Sockets are found in the PCSL socket lists by select().
+ *
+ * @param handle PCSL handle of the socket
+ */
+void midp_socket_opened(void* handle) {
+    (void)handle;
+}
+
+/**
+ * Sockets are found in the PCSL socket lists by select().
+ *
+ * @param handle PCSL handle of the socket
+ */
+void midp_socket_closed(void* handle) {
+    (void)handle;
+}
+
+#endif /* ENABLE_EPOLL */
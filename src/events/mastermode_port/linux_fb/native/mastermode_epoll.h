@@ -0,0 +1,108 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ * 
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ * 
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ * 
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _MASTERMODE_EPOLL_H_
+#define _MASTERMODE_EPOLL_H_
+
+/**
+ * @file
+ *
+ * Descriptor polling with epoll for the master mode event loop.
+ * Sockets are registered with the kernel when they are opened and
+ * unregistered before they are closed, only the changes of the signals
+ * they wait for are applied on each check, and all the descriptors
+ * that are ready after a single wait are turned into reentry signals.
+ */
+
+#include <midpServices.h>
+#include <midp_net_events.h>
+#include <pcsl_network_generic.h>
+
+/**
+ * By default use epoll instead of select() to wait for descriptors,
+ * which is not limited by FD_SETSIZE and does not rebuild descriptor
+ * sets on each check. Define to 0 to always use select(). Bluetooth
+ * sockets are opened outside of MIDP and do not report their opening
+ * and closing, so they are always waited for with select().
+ */
+#ifndef ENABLE_EPOLL
+#ifdef ENABLE_JSR_82_SOCK
+#define ENABLE_EPOLL 0
+#else
+#define ENABLE_EPOLL 1
+#endif
+#endif
+
+#if ENABLE_EPOLL
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Maximum number of ready descriptors taken from a single wait.
+ * Descriptors that do not fit are reported by the next wait.
+ */
+#define EPOLL_BATCH_SIZE 64
+
+/**
+ * Wait for the keyboard, pointer and socket descriptors to become
+ * ready. The sockets are registered by midp_socket_opened() and only
+ * those whose interest changed since the previous call are updated.
+ * Ready sockets are queued as reentry signals to be returned by
+ * getPendingSocketSignal().
+ *
+ * @param keyboard_fd keyboard descriptor or -1
+ * @param mouse_fd pointer descriptor or -1
+ * @param timeout64 >0 the time system can be blocked waiting for a signal
+ *                  =0 don't block the system, check for signals instantly
+ *                  <0 block the system until a signal received
+ * @param pKeyReady OUT set to KNI_TRUE if the keyboard is ready
+ * @param pPointerReady OUT set to KNI_TRUE if the pointer is ready
+ *
+ * @return number of ready descriptors, 0 if no descriptor is ready,
+ *         or -1 if epoll is not available and select() must be used
+ */
+int pollDescriptors(int keyboard_fd, int mouse_fd, jlong timeout64,
+        /*OUT*/ jboolean* pKeyReady, /*OUT*/ jboolean* pPointerReady);
+
+/**
+ * Return the next socket signal queued by pollDescriptors().
+ *
+ * @param pNewSignal OUT reentry data to unblock a thread waiting for
+ *                   a socket signal
+ *
+ * @return KNI_TRUE if a signal was returned, KNI_FALSE if none is queued
+ */
+jboolean getPendingSocketSignal(/*OUT*/ MidpReentryData* pNewSignal);
+
+#ifdef __cplusplus
+} /* extern C */
+#endif
+
+#endif /* ENABLE_EPOLL */
+
+#endif /* _MASTERMODE_EPOLL_H_ */
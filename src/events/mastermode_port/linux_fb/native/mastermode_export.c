@@ -29,6 +29,7 @@
 #include <timer_queue.h>
 
 #include "mastermode_check_signal.h"
+#include "mastermode_epoll.h"
 
 KNIEXPORT KNI_RETURNTYPE_LONG JVM_JavaMilliSeconds();
 
@@ -84,3 +85,16 @@ void checkForSystemSignal(MidpReentryData* pNewSignal,
         checkForAllSignals(pNewSignal, pNewMidpEvent, timeout);
     }
 }
+
+/*
+ * Returns a socket signal queued by the last epoll wait without polling
+ * the system again.
+ */
+jboolean checkForQueuedSignal(MidpReentryData* pNewSignal) {
+#if ENABLE_EPOLL
+    return getPendingSocketSignal(pNewSignal);
+#else
+    (void)pNewSignal;
+    return KNI_FALSE;
+#endif
+}
@@ -49,3 +49,12 @@ void checkForSystemSignal(MidpReentryData* pNewSignal,
     
     REPORT_CALL_TRACE(LC_HIGHUI, "LF:STUB:checkForSystemSignal()\n");
 }
+
+/*
+ * Returns a socket signal queued by the port without polling the system.
+ * This port does not queue signals.
+ */
+jboolean checkForQueuedSignal(MidpReentryData* pNewSignal) {
+    (void)pNewSignal;
+    return KNI_FALSE;
+}
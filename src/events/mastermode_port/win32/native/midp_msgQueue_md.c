@@ -116,3 +116,12 @@ void checkForSystemSignal(MidpReentryData* pNewSignal,
         }
     } while (timeout > 0);
 }
+
+/*
+ * Returns a socket signal queued by the port without polling the system.
+ * This port does not queue signals.
+ */
+jboolean checkForQueuedSignal(MidpReentryData* pNewSignal) {
+    (void)pNewSignal;
+    return KNI_FALSE;
+}
@@ -50,12 +50,16 @@
 #include <termios.h>
 #include <sys/vt.h>
 #include <signal.h>
+#include <pthread.h>
 #ifdef VESA_NO_BLANKING
 #include <linux/input.h>
 #endif
 
 #include <gxj_putpixel.h>
 #include <gxj_screen_buffer.h>
+#include <gxj_span.h>
+#include <gxj_damage.h>
+#include <gxj_rotate.h>
 #include <midp_logging.h>
 #include <midpMalloc.h>
 #include <midp_constants_data.h>
@@ -65,11 +69,18 @@
 #include "fb_port.h"
 
 /**
- * By default use fast copying of rotated pixel data.
- * The assumptions required by fast copying implementation are supposed.
+ * By default show frames by page flipping when the frame buffer
+ * driver is able to pan over a virtual screen twice the screen
+ * height. The screen buffer is copied into the hidden page, which
+ * is then shown on the next vertical sync. Drivers without panning
+ * support use copying to the visible screen memory.
  */
-#ifndef ENABLE_FAST_COPY_ROTATED
-#define ENABLE_FAST_COPY_ROTATED    1
+#ifndef ENABLE_FB_PAGE_FLIP
+#define ENABLE_FB_PAGE_FLIP    1
+#endif
+
+#ifndef FBIO_WAITFORVSYNC
+#define FBIO_WAITFORVSYNC _IOW('F', 0x20, __u32)
 #endif
 
 /** @def PERROR Prints diagnostic message. */
@@ -99,6 +110,48 @@ gxj_screen_buffer gxj_system_screen_buffer;
 static struct termios origTermData;
 static struct termios termdata;
 
+/** Page flipping state */
+static struct {
+    /** Frame buffer device, -1 if page flipping is not used */
+    int fd;
+    /** Size of one page in bytes */
+    int pageBytes;
+    /** Index of the hidden page the next frame is drawn into */
+    int back;
+    /** Page to be shown by the flip thread, -1 if none */
+    int pending;
+    /** KNI_TRUE if the driver supports FBIO_WAITFORVSYNC */
+    jboolean vsync;
+    /** KNI_TRUE if the whole hidden page must be redrawn */
+    jboolean full;
+    /** Screen orientation the pages were drawn with */
+    jboolean rotated;
+    /** KNI_TRUE if the flip thread is running */
+    jboolean threadStarted;
+    /** KNI_TRUE to stop the flip thread */
+    jboolean quit;
+    /** Areas of the screen buffer drawn into the shown page only */
+    gxj_damage_rect prev[GXJ_DAMAGE_MAX_RECTS];
+    /** Number of valid entries in prev */
+    int prevCount;
+    /** Screen mode used for panning */
+    struct fb_var_screeninfo vinfo;
+    /** Screen mode to restore on exit */
+    struct fb_var_screeninfo origVinfo;
+    pthread_t thread;
+} flip = {
+    -1, 0, 0, -1,
+    KNI_FALSE, KNI_FALSE, KNI_FALSE, KNI_FALSE, KNI_FALSE,
+    { { 0 } }, 0,
+    { 0 }, { 0 },
+    0
+};
+
+/** Protects the pending flip of the flip state */
+static pthread_mutex_t flipLock = PTHREAD_MUTEX_INITIALIZER;
+/** Signalled when a flip is requested or done */
+static pthread_cond_t flipCond = PTHREAD_COND_INITIALIZER;
+
 /** Allocate system screen buffer according to the screen geometry */
 void initScreenBuffer(int width, int height) {
     if (gxj_init_screen_buffer(width, height) != ALL_OK) {
@@ -182,6 +235,148 @@ static void restoreConsole() {
     }
 }
 
+/**
+ * Pan the screen to the page and wait for it to be shown.
+ *
+ * @param page index of the page to show
+ */
+static void showPage(int page) {
+    __u32 crtc = 0;
+
+    flip.vinfo.yoffset = page * flip.vinfo.yres;
+    if (ioctl(flip.fd, FBIOPAN_DISPLAY, &flip.vinfo) < 0) {
+        PERROR("FBIOPAN_DISPLAY");
+    }
+    if (flip.vsync) {
+        ioctl(flip.fd, FBIO_WAITFORVSYNC, &crtc);
+    }
+}
+
+/**
+ * Flip thread routine. Waiting for the vertical sync is done here so
+ * that the VM thread may render the next frame meanwhile.
+ */
+static void *flipThread(void *arg) {
+    int page;
+    (void)arg;
+
+    pthread_mutex_lock(&flipLock);
+    for (;;) {
+        while (flip.pending < 0 && !flip.quit) {
+            pthread_cond_wait(&flipCond, &flipLock);
+        }
+        if (flip.quit) {
+            break;
+        }
+        page = flip.pending;
+        pthread_mutex_unlock(&flipLock);
+
+        showPage(page);
+
+        pthread_mutex_lock(&flipLock);
+        flip.pending = -1;
+        pthread_cond_broadcast(&flipCond);
+    }
+    pthread_mutex_unlock(&flipLock);
+    return NULL;
+}
+
+/** Wait until the requested flip is done and the hidden page is free */
+static void waitFlip() {
+    if (flip.threadStarted) {
+        pthread_mutex_lock(&flipLock);
+        while (flip.pending >= 0) {
+            pthread_cond_wait(&flipCond, &flipLock);
+        }
+        pthread_mutex_unlock(&flipLock);
+    }
+}
+
+/** Show the hidden page and hide the shown one */
+static void requestFlip() {
+    if (flip.threadStarted) {
+        pthread_mutex_lock(&flipLock);
+        flip.pending = flip.back;
+        pthread_cond_broadcast(&flipCond);
+        pthread_mutex_unlock(&flipLock);
+    } else {
+        showPage(flip.back);
+    }
+    flip.back ^= 1;
+}
+
+/**
+ * Try to switch the frame buffer to a virtual screen of two pages.
+ * The screen info is updated for the new mode on success and left
+ * unchanged otherwise.
+ *
+ * @param fd frame buffer device
+ * @param finfo fixed screen info of the device
+ * @param vinfo variable screen info of the device
+ */
+static void initPageFlip(int fd, struct fb_fix_screeninfo *finfo,
+                         struct fb_var_screeninfo *vinfo) {
+    struct fb_var_screeninfo v = *vinfo;
+    __u32 crtc = 0;
+
+    v.yres_virtual = v.yres * 2;
+    v.xoffset = 0;
+    v.yoffset = 0;
+
+    if (ioctl(fd, FBIOPUT_VSCREENINFO, &v) < 0 ||
+            ioctl(fd, FBIOGET_VSCREENINFO, &v) < 0 ||
+            ioctl(fd, FBIOGET_FSCREENINFO, finfo) < 0 ||
+            v.yres_virtual < v.yres * 2 ||
+            v.bits_per_pixel != vinfo->bits_per_pixel ||
+            finfo->smem_len < finfo->line_length * v.yres * 2 ||
+            ioctl(fd, FBIOPAN_DISPLAY, &v) < 0) {
+        REPORT_INFO(LC_HIGHUI, "fb_port: no page flipping, copying\n");
+        ioctl(fd, FBIOPUT_VSCREENINFO, vinfo);
+        ioctl(fd, FBIOGET_FSCREENINFO, finfo);
+        return;
+    }
+
+    flip.origVinfo = *vinfo;
+    flip.vinfo = v;
+    *vinfo = v;
+
+    flip.fd = fd;
+    flip.pageBytes = finfo->line_length * v.yres;
+    flip.back = 1;
+    flip.pending = -1;
+    flip.full = KNI_TRUE;
+    flip.vsync = (ioctl(fd, FBIO_WAITFORVSYNC, &crtc) == 0) ?
+        KNI_TRUE : KNI_FALSE;
+
+    if (pthread_create(&flip.thread, NULL, flipThread, NULL) == 0) {
+        flip.threadStarted = KNI_TRUE;
+    } else {
+        REPORT_WARN(LC_HIGHUI, "fb_port: flipping pages synchronously\n");
+    }
+
+    REPORT_INFO1(LC_HIGHUI, "fb_port: page flipping, vsync %s\n",
+        flip.vsync ? "on" : "off");
+}
+
+/** Stop page flipping and restore the original screen mode */
+static void finalizePageFlip() {
+    if (flip.fd < 0) {
+        return;
+    }
+
+    if (flip.threadStarted) {
+        pthread_mutex_lock(&flipLock);
+        flip.quit = KNI_TRUE;
+        pthread_cond_broadcast(&flipCond);
+        pthread_mutex_unlock(&flipLock);
+        pthread_join(flip.thread, NULL);
+        flip.threadStarted = KNI_FALSE;
+    }
+
+    ioctl(flip.fd, FBIOPUT_VSCREENINFO, &flip.origVinfo);
+    flip.fd = -1;
+}
+
 /** Inits frame buffer device */
 void initFrameBuffer() {
     struct fb_fix_screeninfo finfo;
@@ -209,6 +404,10 @@ void initFrameBuffer() {
         exit(1);
     }
 
+#if ENABLE_FB_PAGE_FLIP
+    initPageFlip(fd, &finfo, &vinfo);
+#endif
+
     fb.depth = vinfo.bits_per_pixel;
     fb.lstep = finfo.line_length;
     fb.xoff  = vinfo.xoffset;
@@ -216,8 +415,10 @@ void initFrameBuffer() {
     fb.width = vinfo.xres;
     fb.height= vinfo.yres;
 
-    if (fb.depth != 16) {
-        fprintf(stderr, "Supports only 16-bit, 5:6:5 display\n");
+    /* Screen buffer pixels are copied to the device without conversion */
+    if (fb.depth != GXJ_PIXEL_BYTES * 8) {
+        fprintf(stderr, "Supports only %d-bit display\n",
+            GXJ_PIXEL_BYTES * 8);
         exit(1);
     }
 
@@ -227,14 +428,16 @@ void initFrameBuffer() {
     fb.dataoffset = fb.yoff * fb.lstep + fb.xoff * fb.depth / 8;
     fb.mapsize = finfo.smem_len;
 
-    fb.data = (unsigned short *)mmap(0, fb.mapsize,
+    fb.data = (gxj_pixel_type *)mmap(0, fb.mapsize,
         PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    fb.data += fb.dataoffset;
 
-    if ((int)fb.data == -1) {
+    if ((void *)fb.data == MAP_FAILED) {
         PERROR("mapping /dev/fb0");
         exit(1);
     } else {
+        /* The offset is in bytes whatever the pixel size is */
+        fb.data = (gxj_pixel_type *)((char *)fb.data + fb.dataoffset);
+
       /* IMPL_NOTE - CDC disabled.*/
 #if 0 /* Don't draw into the screen area outside of the main midp window. */
         int n;
@@ -258,6 +461,7 @@ void reverseScreenOrientation() {
     // resize event, the artefacts from the old screen content can appear.
     // That's why the buffer content is not preserved.
     gxj_rotate_screen_buffer(KNI_FALSE);
+    flip.full = KNI_TRUE;
 }
 
 /** Initialize frame buffer video device */
@@ -269,13 +473,17 @@ void connectFrameBuffer() {
 
 /** Clear screen content */
 void clearScreen() {
-    int n;
-    gxj_pixel_type *p = fb.data;
     gxj_pixel_type color =
 	(gxj_pixel_type)GXJ_RGB2PIXEL(0xa0, 0xa0, 0x80);
-    for (n = fb.width * fb.height; n > 0; n--) {
-	    *p ++ = color;
+
+    if (flip.fd >= 0) {
+        // Clear both pages, the screen buffer is copied in full next time
+        waitFlip();
+        gxj_span_fill((gxj_pixel_type *)((char *)fb.data + flip.pageBytes),
+            color, fb.width * fb.height);
+        flip.full = KNI_TRUE;
     }
+    gxj_span_fill(fb.data, color, fb.width * fb.height);
 }
 
 /**
@@ -324,11 +532,49 @@ int getScreenY(int screenRotated) {
     return y;
 }
 
-/** Refresh screen from offscreen buffer */
-void refreshScreenNormal(int x1, int y1, int x2, int y2) {
+/**
+ * Copy a rectangular area of the screen buffer to the frame buffer
+ * row by row.
+ *
+ * @param src pointer to the upper left pixel of the screen buffer
+ * @param dst pointer to the frame buffer pixel matching src
+ * @param x1 x-coordinate of the left upper corner of the copied area
+ * @param y1 y-coordinate of the left upper corner of the copied area
+ * @param x2 x-coordinate of the right lower corner of the copied area
+ * @param y2 y-coordinate of the right lower corner of the copied area
+ * @param bufWidth width of the screen buffer
+ * @param dstWidth width of the frame buffer
+ */
+static void copy_rect(gxj_pixel_type *src, gxj_pixel_type *dst,
+        int x1, int y1, int x2, int y2, int bufWidth, int dstWidth) {
+    int rowBytes;
+
+    // Make sure the copied lines are 4-byte aligned for faster memcpy
+    if ((x1 & 1) == 1) x1 -= 1;
+    if ((x2 & 1) == 1 && x2 < bufWidth) x2 += 1;
+
+    rowBytes = (x2 - x1) * sizeof(gxj_pixel_type);
+    src += y1 * bufWidth + x1;
+    dst += y1 * dstWidth + x1;
+
+    for (; y1 < y2; y1++) {
+        memcpy(dst, src, rowBytes);
+        src += bufWidth;
+        dst += dstWidth;
+    }
+}
+
+/**
+ * Copy an area of the screen buffer to the screen memory.
+ *
+ * @param dst pointer to the screen memory page to copy to
+ * @param x1 x-coordinate of the left upper corner of the copied area
+ * @param y1 y-coordinate of the left upper corner of the copied area
+ * @param x2 x-coordinate of the right lower corner of the copied area
+ * @param y2 y-coordinate of the right lower corner of the copied area
+ */
+static void blitNormal(gxj_pixel_type *dst, int x1, int y1, int x2, int y2) {
     gxj_pixel_type *src = gxj_system_screen_buffer.pixelData;
-    gxj_pixel_type *dst = (gxj_pixel_type*)fb.data;
-    int srcWidth, srcHeight;
     int dstWidth = fb.width;
     int dstHeight = fb.height;
 
@@ -336,22 +582,12 @@ void refreshScreenNormal(int x1, int y1, int x2, int y2) {
     int bufWidth = gxj_system_screen_buffer.width;
     int bufHeight = gxj_system_screen_buffer.height;
 
-    // Check if frame buffer is big enough
-    checkScreenBufferSize(bufWidth, bufHeight);    
-
     if (linuxFbDeviceType == LINUX_FB_OMAP730) {
         // Needed by the P2 board
         // Max screen size is 176x220 but can only display 176x208
         dstHeight = bufHeight;
     }
 
-    // Make sure the copied lines are 4-byte aligned for faster memcpy
-    if ((x1 & 1) == 1) x1 -= 1;
-    if ((x2 & 1) == 1) x2 += 1;
-    
-    srcWidth = x2 - x1;
-    srcHeight = y2 - y1;
-
     if (bufWidth < dstWidth || bufHeight < dstHeight) {
         // We are drawing into a frame buffer that's larger than what MIDP
         // needs. Center it.
@@ -359,164 +595,147 @@ void refreshScreenNormal(int x1, int y1, int x2, int y2) {
         dst += (dstWidth - bufWidth) / 2;
     }
 
-    if (srcWidth == dstWidth && srcHeight == dstHeight &&
-        x1 == 0 && y1 == 0) {
+    if (x1 == 0 && y1 == 0 && x2 == dstWidth && y2 == dstHeight) {
         // copy the entire screen with one memcpy
-        memcpy(dst, src, srcWidth * sizeof(gxj_pixel_type) * srcHeight);
+        memcpy(dst, src, dstWidth * sizeof(gxj_pixel_type) * dstHeight);
     } else {
-        src += y1 * bufWidth + x1;
-        dst += y1 * dstWidth + x1;
-
-        for (; y1 < y2; y1++) {
-            memcpy(dst, src, srcWidth * sizeof(gxj_pixel_type));
-            src += bufWidth;
-            dst += dstWidth;
-        }
+        copy_rect(src, dst, x1, y1, x2, y2, bufWidth, dstWidth);
     }
 }
 
-#if ENABLE_FAST_COPY_ROTATED
 /**
- * Fast rotated copying of screen buffer area to the screen memory.
- * The copying is optimized for 32bit architecture with read caching
- * to copy 16bit pixel data with 90 CCW rotation.
- *
- * The data is copied by 2x2 pixel blocks to operate with machine words.
- * Source data is traversed by lines to benefit from read caching.
+ * Copy an area of the screen buffer to the screen memory rotating
+ * it by 90 CCW.
  *
- * IMPL_NOTE ASSUMPTIONS:
- * 1) Source and target buffers are word aligned
- * 2) Source and target widths are even, so column pixels are equally aligned
- *
- * @param src pointer to source pixel data to start copying from
- * @param dst pointer to destination pixel data to start copying to
+ * @param dst pointer to the screen memory page to copy to
  * @param x1 x-coordinate of the left upper corner of the copied area
  * @param y1 y-coordinate of the left upper corner of the copied area
  * @param x2 x-coordinate of the right lower corner of the copied area
  * @param y2 y-coordinate of the right lower corner of the copied area
- * @param bufWidth width of the source screen buffer
- * @param dstWidth width of the screen
- * @param srcInc source pointer increment at the end of source row
- * @param dstInc dest pointer increment at the end of source row
  */
-static void fast_copy_rotated(short *src, short *dst, int x1, int y1, int x2, int y2,
-        int bufWidth, int dstWidth, int srcInc, int dstInc) {
-
-  int x;
-  unsigned a, b;
-  while(y1 < y2) {
-    y1 += 2;
-    for (x = x1; x < x2; x += 2) {
-      a = *(unsigned*)src;
-      b = *(unsigned*)(src + bufWidth);
-      src += 2;
-      
-      *(unsigned*)dst = (b << 16) | (a & 0x0000ffff);
-      dst -= dstWidth;
-      *(unsigned*)dst = (b & 0xffff0000) | (a >> 16);
-      dst -= dstWidth;
-    }
-    dst += dstInc + 1;
-    src += srcInc + bufWidth;
-  }
-}
-
-#else /* ENABLE_FAST_COPY_ROTATED */
-/**
- * Simple rotated copying of screen buffer area to the screen memory.
- * Source data is traversed by lines to benefit from read caching,
- * the target data is rotated by 90 CCW.
- *
- * IMPL_NOTE:
- *   The method can be used if IMPL_NOTE ASSUMPTIONS for fast copy
- *   routine can not be satisfied. On ARM 201MHz fast copying is about
- *   2x better than the simple one.
- *
- * @param src pointer to source pixel data to start copying from
- * @param dst pointer to destination pixel data to start copying to
- * @param x1 x-coordinate of the left upper corner of the copied area
- * @param y1 y-coordinate of the left upper corner of the copied area
- * @param x2 x-coordinate of the right lower corner of the copied area
- * @param y2 y-coordinate of the right lower corner of the copied area
- * @param bufWidth width of the source screen buffer
- * @param dstWidth width of the screen
- * @param srcInc source pointer increment at the end of source row
- * @param dstInc dest pointer increment at the end of source row
- */
-static void simple_copy_rotated(short *src, short *dst, int x1, int y1, int x2, int y2,
-		int bufWidth, int dstWidth, int srcInc, int dstInc) {
-
-    int x;
-    (void)bufWidth;
-    while(y1++ < y2) {
-        for (x = x1; x < x2; x++) {
-            *dst = *src++;
-            dst -= dstWidth;
-         }
-         dst += dstInc;
-         src += srcInc;
-    }
-}
-#endif /* ENABLE_FAST_COPY_ROTATED */
-
-/** Refresh rotated screen with offscreen buffer content */
-void refreshScreenRotated(int x1, int y1, int x2, int y2) {
-
+static void blitRotated(gxj_pixel_type *dst, int x1, int y1, int x2, int y2) {
     gxj_pixel_type *src = gxj_system_screen_buffer.pixelData;
-    gxj_pixel_type *dst = (gxj_pixel_type*)fb.data;
-    int srcWidth, srcHeight;
     int dstWidth = fb.width;
     int dstHeight = fb.height;
 
-    int srcInc;
-    int dstInc;
-
     // System screen buffer geometry
     int bufWidth = gxj_system_screen_buffer.width;
     int bufHeight = gxj_system_screen_buffer.height;
 
-    // Check if frame buffer is big enough
-    checkScreenBufferSize(bufHeight, bufWidth);
-
     if (linuxFbDeviceType == LINUX_FB_OMAP730) {
         // Needed by the P2 board
         // Max screen size is 176x220 but can only display 176x208
         dstHeight = bufWidth;
     }
 
-    // Make sure the copied lines are 4-byte aligned for faster memcpy
-    if ((x1 & 1) == 1) x1 -= 1;
-    if ((x2 & 1) == 1) x2 += 1;
-    if ((y1 & 1) == 1) y1 -= 1;
-    if ((y2 & 1) == 1) y2 += 1;
+    if (bufWidth < dstHeight || bufHeight < dstWidth) {
+        // We are drawing into a frame buffer that's larger than what MIDP
+        // needs. Center it.
+        dst += (dstHeight - bufWidth) / 2 * dstWidth;
+        dst += ((dstWidth - bufHeight) / 2);
+    }
 
-    srcWidth = x2 - x1;
-    srcHeight = y2 - y1;
+    // Buffer column x is shown as screen line bufWidth - 1 - x
+    gxj_rotate_rect(dst + (bufWidth - x2) * dstWidth + y1, dstWidth,
+        src + y1 * bufWidth + x1, bufWidth,
+        x2 - x1, y2 - y1, sizeof(gxj_pixel_type), GXJ_ROTATE_90);
+}
 
-    if (bufWidth < dstHeight || bufHeight < dstWidth) {
-            // We are drawing into a frame buffer that's larger than what MIDP
-            // needs. Center it.
-            dst += (dstHeight - bufWidth) / 2 * dstWidth;
-            dst += ((dstWidth - bufHeight) / 2);
+/**
+ * Copy areas of the screen buffer to the screen. With page flipping
+ * the areas are copied to the hidden page together with the areas
+ * of the previous frame, which the hidden page still lacks, and the
+ * page is shown then.
+ *
+ * @param rects areas of the screen buffer to copy
+ * @param n number of the areas
+ * @param rotated KNI_TRUE if the screen is rotated
+ */
+static void present(const gxj_damage_rect *rects, int n, jboolean rotated) {
+    void (*blit)(gxj_pixel_type *, int, int, int, int) =
+        rotated ? blitRotated : blitNormal;
+    gxj_pixel_type *dst;
+    int i, j;
+
+    if (flip.fd < 0) {
+        for (i = 0; i < n; i++) {
+            blit(fb.data, rects[i].x1, rects[i].y1, rects[i].x2, rects[i].y2);
         }
+        return;
+    }
 
-    src += x1 + y1 * bufWidth;
-    dst += y1 + (bufWidth - x1 - 1) * dstWidth;
+    if (n == 0) {
+        return;
+    }
 
-    srcInc = bufWidth - srcWidth;      // increment for src pointer at the end of row
-    dstInc = srcWidth * dstWidth + 1;  // increment for dst pointer at the end of column
+    // The hidden page is scanned out until the pending flip is done
+    waitFlip();
+    dst = (gxj_pixel_type *)((char *)fb.data + flip.back * flip.pageBytes);
+
+    if (flip.full || flip.rotated != rotated) {
+        flip.prev[0].x1 = 0;
+        flip.prev[0].y1 = 0;
+        flip.prev[0].x2 = gxj_system_screen_buffer.width;
+        flip.prev[0].y2 = gxj_system_screen_buffer.height;
+        flip.prevCount = 1;
+        blit(dst, 0, 0, flip.prev[0].x2, flip.prev[0].y2);
+    } else {
+        for (i = 0; i < flip.prevCount; i++) {
+            const gxj_damage_rect *p = &flip.prev[i];
+            for (j = 0; j < n; j++) {
+                if (p->x1 >= rects[j].x1 && p->y1 >= rects[j].y1 &&
+                        p->x2 <= rects[j].x2 && p->y2 <= rects[j].y2) {
+                    break;
+                }
+            }
+            if (j == n) {
+                blit(dst, p->x1, p->y1, p->x2, p->y2);
+            }
+        }
+        for (i = 0; i < n; i++) {
+            blit(dst, rects[i].x1, rects[i].y1, rects[i].x2, rects[i].y2);
+            flip.prev[i] = rects[i];
+        }
+        flip.prevCount = n;
+    }
 
-#if ENABLE_FAST_COPY_ROTATED
-    fast_copy_rotated(src, dst, x1, y1, x2, y2,
-        bufWidth, dstWidth, srcInc, dstInc);
-#else
-    simple_copy_rotated(src, dst, x1, y1, x2, y2,
-        bufWidth, dstWidth, srcInc, dstInc);
-#endif
+    flip.full = KNI_FALSE;
+    flip.rotated = rotated;
+    requestFlip();
+}
+
+/**
+ * Refresh screen from offscreen buffer. Only the areas drawn since
+ * the previous refresh are copied, see gxj_damage_flush().
+ */
+void refreshScreenNormal(int x1, int y1, int x2, int y2) {
+    gxj_damage_rect rects[GXJ_DAMAGE_MAX_RECTS];
+    int n;
+
+    // Check if frame buffer is big enough
+    checkScreenBufferSize(gxj_system_screen_buffer.width,
+        gxj_system_screen_buffer.height);
+
+    n = gxj_damage_flush(x1, y1, x2, y2, rects);
+    present(rects, n, KNI_FALSE);
+}
+
+/** Refresh rotated screen with offscreen buffer content */
+void refreshScreenRotated(int x1, int y1, int x2, int y2) {
+    gxj_damage_rect rects[GXJ_DAMAGE_MAX_RECTS];
+    int n;
+
+    // Check if frame buffer is big enough
+    checkScreenBufferSize(gxj_system_screen_buffer.height,
+        gxj_system_screen_buffer.width);
+
+    n = gxj_damage_flush(x1, y1, x2, y2, rects);
+    present(rects, n, KNI_TRUE);
 }
 
 /** Frees allocated resources and restore system state */
 void finalizeFrameBuffer() {
+    finalizePageFlip();
     gxj_free_screen_buffer();
     restoreConsole();
 }
@@ -32,12 +32,14 @@
  * Internal declarations specific for generic fb application
  */
 
+#include <gxj_putpixel.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 struct {
-    unsigned short *data;
+    gxj_pixel_type *data;
     int width;
     int height;
     int depth;
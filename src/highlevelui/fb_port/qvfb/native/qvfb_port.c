@@ -44,6 +44,7 @@
 
 #include <gxj_putpixel.h>
 #include <gxj_screen_buffer.h>
+#include <gxj_rotate.h>
 #include <midp_logging.h>
 #include <midpMalloc.h>
 #include <midp_constants_data.h>
@@ -145,8 +146,9 @@ void connectFrameBuffer() {
                bufWidth, bufHeight);
         exit(1);
     }
-    if (hdr->depth != 16) {
-        fprintf(stderr, "QVFB depth must be 16. Please run qvfb -depth 16\n");
+    if (hdr->depth != GXJ_PIXEL_BYTES * 8) {
+        fprintf(stderr, "QVFB depth must be %d. Please run qvfb -depth %d\n",
+            GXJ_PIXEL_BYTES * 8, GXJ_PIXEL_BYTES * 8);
         exit(1);
     }
 
@@ -260,23 +262,15 @@ void refreshScreenRotated(int x1, int y1, int x2, int y2) {
 
     gxj_pixel_type *src = gxj_system_screen_buffer.pixelData;
     gxj_pixel_type *dst = (gxj_pixel_type *)qvfbPixels;
-    int srcWidth, srcHeight;
     int lineStep =  hdr->lineStep / sizeof(gxj_pixel_type);
 
     // System screen buffer geometry
     int bufWidth = gxj_system_screen_buffer.width;
     int bufHeight = gxj_system_screen_buffer.height;
 
-    int x;
-    int srcInc;
-    int dstInc;
-
     // Check if frame buffer is big enough
     checkScreenBufferSize(bufHeight, bufWidth);
 
-    srcWidth = x2 - x1;
-    srcHeight = y2 - y1;
-
     // Center the LCD output area
     if (bufWidth < hdr->height) {
         dst += (hdr->height - bufWidth) / 2 * lineStep;
@@ -285,20 +279,10 @@ void refreshScreenRotated(int x1, int y1, int x2, int y2) {
         dst += ((hdr->width - bufHeight) / 2);
     }
 
-    src += x1 + y1 * bufWidth;
-    dst += y1 + (bufWidth - x1 - 1) * lineStep;
-
-    srcInc = bufWidth - srcWidth;      // increment for src pointer at the end of row
-    dstInc = srcWidth * lineStep + 1;  // increment for dst pointer at the end of column
-
-    while(y1++ < y2) {
-        for (x = x1; x < x2; x++) {
-            *dst = *src++;
-            dst -= lineStep;
-         }
-         dst += dstInc;
-         src += srcInc;
-    }
+    // Buffer column x is shown as screen line bufWidth - 1 - x
+    gxj_rotate_rect(dst + (bufWidth - x2) * lineStep + y1, lineStep,
+        src + y1 * bufWidth + x1, bufWidth,
+        x2 - x1, y2 - y1, sizeof(gxj_pixel_type), GXJ_ROTATE_90);
 
     hdr->dirty_x1 = 0;
     hdr->dirty_y1 = 0;
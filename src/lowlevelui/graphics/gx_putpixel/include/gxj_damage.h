@@ -0,0 +1,142 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _GXJ_DAMAGE_H
+#define _GXJ_DAMAGE_H
+
+/**
+ * @file
+ * @ingroup lowui_port
+ *
+ * @brief Damage region tracking of the system screen buffer
+ */
+
+#include <kni.h>
+#include <gxj_putpixel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * IMPL_NOTE: The putpixel primitives report the area they draw into
+ *   the system screen buffer. The areas are accumulated in a short list
+ *   of rectangles, close or overlapping rectangles are merged. On
+ *   refresh the screen port copies only the damaged rectangles that
+ *   lie in the refreshed area instead of its whole bounding box.
+ *
+ *   Code writing to the system screen buffer other than by the gx_*
+ *   primitives must report the area with gxj_damage_add(), or call
+ *   gxj_damage_invalidate() to have the next refreshes copied in full.
+ *
+ *   Define ENABLE_GXJ_DAMAGE to 0 to always copy the whole refreshed
+ *   area.
+ */
+#ifndef ENABLE_GXJ_DAMAGE
+#define ENABLE_GXJ_DAMAGE 1
+#endif
+
+/** Maximal number of separately tracked damaged rectangles */
+#define GXJ_DAMAGE_MAX_RECTS 8
+
+/** Damaged rectangle, the right and bottom edges are exclusive */
+typedef struct _gxj_damage_rect {
+    int x1; /**< left edge */
+    int y1; /**< top edge */
+    int x2; /**< right edge, exclusive */
+    int y2; /**< bottom edge, exclusive */
+} gxj_damage_rect;
+
+/** Counters of pixels drawn and copied to the screen */
+typedef struct _gxj_damage_stats {
+    unsigned long frames;       /**< number of flushed frames */
+    unsigned long touched;      /**< pixels drawn in the last frame */
+    unsigned long flushed;      /**< pixels flushed in the last frame */
+    unsigned long totalTouched; /**< pixels drawn in all frames */
+    unsigned long totalFlushed; /**< pixels flushed in all frames */
+} gxj_damage_stats;
+
+/**
+ * Report an area drawn into a screen buffer. Only areas of the system
+ * screen buffer are recorded, other buffers are ignored.
+ *
+ * @param sbuf screen buffer the area was drawn into
+ * @param x1 left edge of the area
+ * @param y1 top edge of the area
+ * @param x2 right edge of the area, exclusive
+ * @param y2 bottom edge of the area, exclusive
+ */
+void gxj_damage_add(const gxj_screen_buffer *sbuf,
+                    int x1, int y1, int x2, int y2);
+
+/**
+ * Report an area drawn into a screen buffer with a clip applied.
+ *
+ * @param sbuf screen buffer the area was drawn into
+ * @param clip clip rectangle of the drawing, x1, y1, x2, y2
+ * @param x1 left edge of the area
+ * @param y1 top edge of the area
+ * @param x2 right edge of the area, exclusive
+ * @param y2 bottom edge of the area, exclusive
+ */
+void gxj_damage_add_clipped(const gxj_screen_buffer *sbuf,
+                            const jshort *clip,
+                            int x1, int y1, int x2, int y2);
+
+/**
+ * Mark the whole system screen buffer as damaged. Refreshes copy
+ * the whole refreshed area until the whole screen is refreshed.
+ */
+void gxj_damage_invalidate(void);
+
+/**
+ * Get the damaged rectangles within the refreshed area and end the
+ * frame. The rectangles lying completely within the refreshed area
+ * are removed from the damage region.
+ *
+ * @param x1 left edge of the refreshed area
+ * @param y1 top edge of the refreshed area
+ * @param x2 right edge of the refreshed area, exclusive
+ * @param y2 bottom edge of the refreshed area, exclusive
+ * @param rects array for at least GXJ_DAMAGE_MAX_RECTS rectangles
+ *   to copy to the screen, clipped to the refreshed area
+ * @return number of rectangles stored to rects
+ */
+int gxj_damage_flush(int x1, int y1, int x2, int y2,
+                     gxj_damage_rect *rects);
+
+/**
+ * Get the counters of pixels drawn and copied to the screen.
+ *
+ * @param stats structure to fill with the counters
+ */
+void gxj_damage_get_stats(gxj_damage_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GXJ_DAMAGE_H */
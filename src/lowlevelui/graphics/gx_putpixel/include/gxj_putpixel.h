@@ -37,6 +37,7 @@
 
 #include <gx_image.h>
 #include <imgapi_image.h>
+#include <img_pixel_format.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -52,11 +53,14 @@ extern "C" {
 #endif
 
 /**
- * 16-bit pixel.
- * The color encoding used in pixels is 565, that is,
- * 5+6+5=16 bits for red, green, blue.
+ * Screen buffer pixel.
+ * The color encoding is selected at build time, see img_pixel_format.h.
+ * By default it is 565, that is, 5+6+5=16 bits for red, green, blue.
  */
-typedef unsigned short gxj_pixel_type;
+typedef img_native_pixel_type gxj_pixel_type;
+
+/** Size of a pixel in bytes */
+#define GXJ_PIXEL_BYTES IMG_PIXEL_SIZE
 
 /** 8-bit alpha */
 typedef unsigned char gxj_alpha_type;
@@ -80,20 +84,31 @@ extern gxj_screen_buffer gxj_system_screen_buffer;
 
 /**
  * @name Accessing pixel colors
- * These macros return separate colors packed as 5- and 6-bit fields
- * in a pixel.
- * The pixel color encoding is 565, that is, 5+6+5=16 bits for red, green,
- * blue.
+ * These macros return separate colors packed in a pixel.
  * The returned separate colors are 8 bits as in Java RGB.
  * @{
  */
-#define GXJ_GET_RED_FROM_PIXEL(P)   (((P) >> 8) & 0xF8)
-#define GXJ_GET_GREEN_FROM_PIXEL(P) (((P) >> 3) & 0xFC)
-#define GXJ_GET_BLUE_FROM_PIXEL(P)  (((P) << 3) & 0xF8)
+#define GXJ_GET_RED_FROM_PIXEL(P)   IMG_PIXEL_GET_RED(P)
+#define GXJ_GET_GREEN_FROM_PIXEL(P) IMG_PIXEL_GET_GREEN(P)
+#define GXJ_GET_BLUE_FROM_PIXEL(P)  IMG_PIXEL_GET_BLUE(P)
 /** @} */
 
-/** Convert pre-masked triplet r, g, b to 16 bit pixel. */
+/**
+ * Convert pre-masked triplet r, g, b to pixel. The colors are given
+ * in the width of the pixel fields, 5+6+5 bits for 565 pixels and
+ * 8 bits for 32-bit pixels.
+ */
+#if IMG_PIXEL_SIZE == 2
 #define GXJ_RGB2PIXEL(r, g, b) ( b +(g << 5)+ (r << 11) )
+#else
+#define GXJ_RGB2PIXEL(r, g, b) ((b + (g << 8) + (r << 16)) | IMG_PIXEL_OPAQUE)
+#endif
+
+/** Convert 24-bit RGB color to pixel */
+#define GXJ_RGB24TOPIXEL(x) IMG_RGB24TOPIXEL(x)
+
+/** Convert pixel to 24-bit RGB color */
+#define GXJ_PIXELTORGB24(x) IMG_PIXELTORGB24(x)
 
 /** Convert 24-bit RGB color to 16bit (565) color */
 #define GXJ_RGB24TORGB16(x) (((( x ) & 0x00F80000) >> 8) + \
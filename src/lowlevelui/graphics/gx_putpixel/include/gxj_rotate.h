@@ -0,0 +1,86 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _GXJ_ROTATE_H
+#define _GXJ_ROTATE_H
+
+/**
+ * @file
+ * @ingroup lowui_port
+ *
+ * @brief Rotated copying of pixel areas
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * IMPL_NOTE: Screens mounted in landscape orientation show the screen
+ *   buffer rotated, so every refresh copies the refreshed area with
+ *   rotation. The area is processed by square tiles small enough for
+ *   both source and destination lines to stay in the data cache,
+ *   the tiles are made of 8x8 pixel blocks transposed in vector
+ *   registers where the CPU supports it (SSE2 on x86, NEON on ARM).
+ *   Areas of any position and size are supported, blocks on the
+ *   right and bottom edges are copied pixel by pixel.
+ *
+ *   Define ENABLE_GXJ_SIMD to 0 to build the portable kernels only.
+ */
+
+/** Copy without rotation */
+#define GXJ_ROTATE_0    0
+/** Rotate by 90 degrees counterclockwise */
+#define GXJ_ROTATE_90   1
+/** Rotate by 180 degrees */
+#define GXJ_ROTATE_180  2
+/** Rotate by 270 degrees counterclockwise */
+#define GXJ_ROTATE_270  3
+
+/**
+ * Copy a rectangular area of pixels rotating it. The destination area
+ * is height x width pixels for GXJ_ROTATE_90 and GXJ_ROTATE_270, and
+ * width x height pixels otherwise. The areas must not overlap.
+ *
+ * @param dst pointer to the upper left pixel of the destination area
+ * @param dstScanLength number of pixels in one line of the destination
+ * @param src pointer to the upper left pixel of the source area
+ * @param srcScanLength number of pixels in one line of the source
+ * @param width number of pixels in one line of the source area
+ * @param height number of lines in the source area
+ * @param pixelBytes size of one pixel in bytes, 2 or 4
+ * @param rotation one of GXJ_ROTATE_0, GXJ_ROTATE_90, GXJ_ROTATE_180
+ *   or GXJ_ROTATE_270
+ */
+void gxj_rotate_rect(void *dst, int dstScanLength,
+                     const void *src, int srcScanLength,
+                     int width, int height, int pixelBytes, int rotation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GXJ_ROTATE_H */
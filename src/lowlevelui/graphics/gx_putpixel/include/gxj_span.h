@@ -0,0 +1,93 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _GXJ_SPAN_H
+#define _GXJ_SPAN_H
+
+/**
+ * @file
+ * @ingroup lowui_port
+ *
+ * @brief Solid span kernels used by the putpixel rasterizer
+ */
+
+#include <gxj_putpixel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * IMPL_NOTE: All the putpixel primitives (rectangles, round rectangles,
+ *   arcs and triangles) reduce their filled area to horizontal or
+ *   vertical runs of one color. The kernels below are the only place
+ *   where such runs are written to the pixel data, so that the best
+ *   store loop for the running CPU is chosen once. Vector kernels
+ *   (SSE2/AVX2 on x86, NEON on ARM) are selected on the first call,
+ *   the portable word-store kernel is used otherwise.
+ *
+ *   Define ENABLE_GXJ_SIMD to 0 to build the portable kernel only.
+ */
+
+/**
+ * Fill consecutive pixels with one color, this is memset()
+ * for the pixel type.
+ *
+ * @param dst pointer to the first pixel to fill
+ * @param color pixel value to fill with
+ * @param count number of pixels to fill, may be 0 or negative
+ */
+void gxj_span_fill(gxj_pixel_type *dst, gxj_pixel_type color, int count);
+
+/**
+ * Fill a column of pixels with one color.
+ *
+ * @param dst pointer to the top pixel of the column
+ * @param scanLength number of pixels between vertically adjacent pixels
+ * @param color pixel value to fill with
+ * @param count number of pixels to fill, may be 0 or negative
+ */
+void gxj_span_fill_vert(gxj_pixel_type *dst, int scanLength,
+                        gxj_pixel_type color, int count);
+
+/**
+ * Fill a rectangular area of pixels with one color.
+ * Rows that cover the whole scan line are filled as one span.
+ *
+ * @param dst pointer to the upper left pixel of the area
+ * @param scanLength number of pixels in one scan line of the buffer
+ * @param color pixel value to fill with
+ * @param width number of pixels in one row of the area
+ * @param height number of rows in the area
+ */
+void gxj_span_fill_rect(gxj_pixel_type *dst, int scanLength,
+                        gxj_pixel_type color, int width, int height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GXJ_SPAN_H */
@@ -0,0 +1,746 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * Batched pixel conversion and alpha compositing kernels.
+ *
+ * Vector kernels process a batch of pixels per iteration and check
+ * the whole batch for being fully transparent (skipped) or fully
+ * opaque (copied without blending) before doing any per-channel
+ * arithmetic. There is a set of kernels for 565 pixels and another
+ * one for 32-bit pixels, see img_pixel_format.h.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <kni.h>
+#include <midp_logging.h>
+
+#include "gxj_intern_blend.h"
+#include "gxj_intern_simd.h"
+
+/** Signature of ARGB row kernels */
+typedef void (*argb_row_func)(gxj_pixel_type *dst, const jint *src,
+                              int count);
+
+/** Signature of screen pixel plus alpha row kernels */
+typedef void (*pixel_row_func)(gxj_pixel_type *dst,
+                               const gxj_pixel_type *src,
+                               const gxj_alpha_type *alpha, int count);
+
+/** Set of row kernels selected for the running CPU */
+typedef struct _blend_kernels {
+    argb_row_func convert_argb;
+    argb_row_func blend_argb;
+    pixel_row_func blend_pixel;
+} blend_kernels;
+
+#if GXJ_PIXEL_BYTES == 2
+
+/**
+ * Composite one ARGB8888 pixel over a 565 pixel, the destination
+ * channels are expanded to 8 bits before blending.
+ */
+static gxj_pixel_type
+blend_argb_pixel(unsigned int src, gxj_pixel_type dst, unsigned int As) {
+    unsigned int Ad = 0xFF - As;
+    unsigned int Rd = ((dst >> 8) & 0xF8) | (dst >> 13);
+    unsigned int Gd = ((dst >> 3) & 0xFC) | ((dst >> 9) & 0x03);
+    unsigned int Bd = ((dst << 3) & 0xF8) | ((dst >> 2) & 0x07);
+    unsigned int Rr = GXJ_DIV255(((src >> 16) & 0xFF) * As + Rd * Ad);
+    unsigned int Gr = GXJ_DIV255(((src >> 8) & 0xFF) * As + Gd * Ad);
+    unsigned int Br = GXJ_DIV255((src & 0xFF) * As + Bd * Ad);
+
+    return (gxj_pixel_type)
+        (((Rr & 0xF8) << 8) | ((Gr & 0xFC) << 3) | (Br >> 3));
+}
+
+/**
+ * Composite one 565 pixel over another one, blending is done
+ * on the 5 and 6 bit channels directly.
+ */
+static gxj_pixel_type
+blend_pixel_pixel(unsigned int src, unsigned int dst, unsigned int As) {
+    unsigned int Ad = 0xFF - As;
+    unsigned int Rr = GXJ_DIV255((src >> 11) * As + (dst >> 11) * Ad);
+    unsigned int Gr = GXJ_DIV255(((src >> 5) & 0x3F) * As +
+                                 ((dst >> 5) & 0x3F) * Ad);
+    unsigned int Br = GXJ_DIV255((src & 0x1F) * As + (dst & 0x1F) * Ad);
+
+    return (gxj_pixel_type)((Rr << 11) | (Gr << 5) | Br);
+}
+
+static void
+convert_argb_row_scalar(gxj_pixel_type *dst, const jint *src, int count) {
+    while (count >= 4) {
+        dst[0] = (gxj_pixel_type)GXJ_RGB24TORGB16(src[0]);
+        dst[1] = (gxj_pixel_type)GXJ_RGB24TORGB16(src[1]);
+        dst[2] = (gxj_pixel_type)GXJ_RGB24TORGB16(src[2]);
+        dst[3] = (gxj_pixel_type)GXJ_RGB24TORGB16(src[3]);
+        dst += 4;
+        src += 4;
+        count -= 4;
+    }
+    while (count-- > 0) {
+        *dst++ = (gxj_pixel_type)GXJ_RGB24TORGB16(*src);
+        src++;
+    }
+}
+
+static void
+blend_argb_row_scalar(gxj_pixel_type *dst, const jint *src, int count) {
+    for (; count > 0; count--, dst++, src++) {
+        unsigned int s = (unsigned int)*src;
+        unsigned int As = s >> 24;
+
+        if (As == 0xFF) {
+            *dst = (gxj_pixel_type)GXJ_RGB24TORGB16(s);
+        } else if (As != 0) {
+            *dst = blend_argb_pixel(s, *dst, As);
+        }
+    }
+}
+
+static void
+blend_pixel_row_scalar(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                       const gxj_alpha_type *alpha, int count) {
+    for (; count > 0; count--, dst++, src++, alpha++) {
+        unsigned int As = *alpha;
+
+        if (As == 0xFF) {
+            *dst = *src;
+        } else if (As != 0) {
+            *dst = blend_pixel_pixel(*src, *dst, As);
+        }
+    }
+}
+
+#if GXJ_SIMD_SSE2
+/** Divide each 16-bit lane by 255, see GXJ_DIV255 */
+#define SSE2_DIV255(t) \
+    _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16((t), _mm_srli_epi16((t), 8)), \
+                                 _mm_set1_epi16(1)), 8)
+
+/** Convert four ARGB pixels to 565, one per 32-bit lane */
+GXJ_SIMD_TARGET("sse2") static __m128i
+sse2_argb_to_565(__m128i s) {
+    __m128i r = _mm_and_si128(_mm_srli_epi32(s, 8), _mm_set1_epi32(0xF800));
+    __m128i g = _mm_and_si128(_mm_srli_epi32(s, 5), _mm_set1_epi32(0x07E0));
+    __m128i b = _mm_and_si128(_mm_srli_epi32(s, 3), _mm_set1_epi32(0x001F));
+    __m128i p = _mm_or_si128(_mm_or_si128(r, g), b);
+
+    /* Sign extend the 16-bit value so that signed packing keeps it */
+    return _mm_srai_epi32(_mm_slli_epi32(p, 16), 16);
+}
+
+/** Pack 8-bit fields at the given shift of eight ARGB pixels to 16 bits */
+#define SSE2_CHANNEL(s0, s1, shift) \
+    _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32((s0), (shift)), ff), \
+                    _mm_and_si128(_mm_srli_epi32((s1), (shift)), ff))
+
+GXJ_SIMD_TARGET("sse2") static void
+convert_argb_row_sse2(gxj_pixel_type *dst, const jint *src, int count) {
+    while (count >= 8) {
+        __m128i s0 = _mm_loadu_si128((const __m128i *)src);
+        __m128i s1 = _mm_loadu_si128((const __m128i *)(src + 4));
+
+        _mm_storeu_si128((__m128i *)dst,
+            _mm_packs_epi32(sse2_argb_to_565(s0), sse2_argb_to_565(s1)));
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    convert_argb_row_scalar(dst, src, count);
+}
+
+GXJ_SIMD_TARGET("sse2") static void
+blend_argb_row_sse2(gxj_pixel_type *dst, const jint *src, int count) {
+    const __m128i ff = _mm_set1_epi32(0xFF);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opaque = _mm_set1_epi16(0xFF);
+
+    while (count >= 8) {
+        __m128i s0 = _mm_loadu_si128((const __m128i *)src);
+        __m128i s1 = _mm_loadu_si128((const __m128i *)(src + 4));
+        __m128i a = _mm_packs_epi32(_mm_srli_epi32(s0, 24),
+                                    _mm_srli_epi32(s1, 24));
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(a, zero)) == 0xFFFF) {
+            /* Fully transparent batch, nothing to draw */
+        } else if (_mm_movemask_epi8(_mm_cmpeq_epi16(a, opaque)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i *)dst,
+                _mm_packs_epi32(sse2_argb_to_565(s0), sse2_argb_to_565(s1)));
+        } else {
+            __m128i d = _mm_loadu_si128((const __m128i *)dst);
+            __m128i ia = _mm_sub_epi16(opaque, a);
+            __m128i r, g, b, dr, dg, db;
+
+            dr = _mm_srli_epi16(d, 11);
+            dr = _mm_or_si128(_mm_slli_epi16(dr, 3), _mm_srli_epi16(dr, 2));
+            dg = _mm_and_si128(_mm_srli_epi16(d, 5), _mm_set1_epi16(0x3F));
+            dg = _mm_or_si128(_mm_slli_epi16(dg, 2), _mm_srli_epi16(dg, 4));
+            db = _mm_and_si128(d, _mm_set1_epi16(0x1F));
+            db = _mm_or_si128(_mm_slli_epi16(db, 3), _mm_srli_epi16(db, 2));
+
+            r = SSE2_CHANNEL(s0, s1, 16);
+            g = SSE2_CHANNEL(s0, s1, 8);
+            b = SSE2_CHANNEL(s0, s1, 0);
+
+            r = SSE2_DIV255(_mm_add_epi16(_mm_mullo_epi16(r, a),
+                                          _mm_mullo_epi16(dr, ia)));
+            g = SSE2_DIV255(_mm_add_epi16(_mm_mullo_epi16(g, a),
+                                          _mm_mullo_epi16(dg, ia)));
+            b = SSE2_DIV255(_mm_add_epi16(_mm_mullo_epi16(b, a),
+                                          _mm_mullo_epi16(db, ia)));
+
+            r = _mm_slli_epi16(_mm_and_si128(r, _mm_set1_epi16(0xF8)), 8);
+            g = _mm_slli_epi16(_mm_and_si128(g, _mm_set1_epi16(0xFC)), 3);
+            b = _mm_srli_epi16(b, 3);
+            _mm_storeu_si128((__m128i *)dst,
+                             _mm_or_si128(_mm_or_si128(r, g), b));
+        }
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    blend_argb_row_scalar(dst, src, count);
+}
+
+GXJ_SIMD_TARGET("sse2") static void
+blend_pixel_row_sse2(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                     const gxj_alpha_type *alpha, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opaque = _mm_set1_epi16(0xFF);
+    const __m128i m6 = _mm_set1_epi16(0x3F);
+    const __m128i m5 = _mm_set1_epi16(0x1F);
+
+    while (count >= 8) {
+        __m128i a = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)alpha), zero);
+        __m128i s = _mm_loadu_si128((const __m128i *)src);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(a, zero)) == 0xFFFF) {
+            /* Fully transparent batch, nothing to draw */
+        } else if (_mm_movemask_epi8(_mm_cmpeq_epi16(a, opaque)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i *)dst, s);
+        } else {
+            __m128i d = _mm_loadu_si128((const __m128i *)dst);
+            __m128i ia = _mm_sub_epi16(opaque, a);
+            __m128i r, g, b;
+
+            r = _mm_add_epi16(_mm_mullo_epi16(_mm_srli_epi16(s, 11), a),
+                              _mm_mullo_epi16(_mm_srli_epi16(d, 11), ia));
+            g = _mm_add_epi16(
+                _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(s, 5), m6), a),
+                _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(d, 5), m6), ia));
+            b = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(s, m5), a),
+                              _mm_mullo_epi16(_mm_and_si128(d, m5), ia));
+
+            r = _mm_slli_epi16(SSE2_DIV255(r), 11);
+            g = _mm_slli_epi16(SSE2_DIV255(g), 5);
+            b = SSE2_DIV255(b);
+            _mm_storeu_si128((__m128i *)dst,
+                             _mm_or_si128(_mm_or_si128(r, g), b));
+        }
+        dst += 8;
+        src += 8;
+        alpha += 8;
+        count -= 8;
+    }
+    blend_pixel_row_scalar(dst, src, alpha, count);
+}
+#endif /* GXJ_SIMD_SSE2 */
+
+#if GXJ_SIMD_NEON
+/** Divide each 16-bit lane by 255, see GXJ_DIV255 */
+#define NEON_DIV255(t) \
+    vshrq_n_u16(vaddq_u16(vaddq_u16((t), vshrq_n_u16((t), 8)), \
+                          vdupq_n_u16(1)), 8)
+
+/** Convert eight deinterleaved 8-bit pixels to 565 */
+static uint16x8_t
+neon_rgb_to_565(uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+    uint16x8_t p = vshll_n_u8(vand_u8(r, vdup_n_u8(0xF8)), 8);
+    p = vorrq_u16(p, vshlq_n_u16(vmovl_u8(vshr_n_u8(g, 2)), 5));
+    return vorrq_u16(p, vmovl_u8(vshr_n_u8(b, 3)));
+}
+
+static void
+convert_argb_row_neon(gxj_pixel_type *dst, const jint *src, int count) {
+    while (count >= 8) {
+        /* Little endian ARGB words deinterleave to B, G, R, A planes */
+        uint8x8x4_t s = vld4_u8((const uint8_t *)src);
+
+        vst1q_u16(dst, neon_rgb_to_565(s.val[2], s.val[1], s.val[0]));
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    convert_argb_row_scalar(dst, src, count);
+}
+
+static void
+blend_argb_row_neon(gxj_pixel_type *dst, const jint *src, int count) {
+    while (count >= 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t *)src);
+        uint8x8_t a = s.val[3];
+        uint64_t aBits = vget_lane_u64(vreinterpret_u64_u8(a), 0);
+
+        if (aBits == 0) {
+            /* Fully transparent batch, nothing to draw */
+        } else if (aBits == ~(uint64_t)0) {
+            vst1q_u16(dst, neon_rgb_to_565(s.val[2], s.val[1], s.val[0]));
+        } else {
+            uint16x8_t d = vld1q_u16(dst);
+            uint8x8_t ia = vmvn_u8(a);
+            uint8x8_t dr, dg, db;
+            uint16x8_t r, g, b;
+
+            dr = vshrn_n_u16(d, 8);
+            dr = vorr_u8(vand_u8(dr, vdup_n_u8(0xF8)), vshr_n_u8(dr, 5));
+            dg = vshrn_n_u16(d, 3);
+            dg = vorr_u8(vand_u8(dg, vdup_n_u8(0xFC)), vshr_n_u8(dg, 6));
+            db = vshl_n_u8(vmovn_u16(d), 3);
+            db = vorr_u8(db, vshr_n_u8(db, 5));
+
+            r = NEON_DIV255(vmlal_u8(vmull_u8(s.val[2], a), dr, ia));
+            g = NEON_DIV255(vmlal_u8(vmull_u8(s.val[1], a), dg, ia));
+            b = NEON_DIV255(vmlal_u8(vmull_u8(s.val[0], a), db, ia));
+
+            vst1q_u16(dst, neon_rgb_to_565(vmovn_u16(r), vmovn_u16(g),
+                                           vmovn_u16(b)));
+        }
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    blend_argb_row_scalar(dst, src, count);
+}
+
+static void
+blend_pixel_row_neon(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                     const gxj_alpha_type *alpha, int count) {
+    const uint16x8_t m6 = vdupq_n_u16(0x3F);
+    const uint16x8_t m5 = vdupq_n_u16(0x1F);
+
+    while (count >= 8) {
+        uint8x8_t a8 = vld1_u8(alpha);
+        uint64_t aBits = vget_lane_u64(vreinterpret_u64_u8(a8), 0);
+        uint16x8_t s = vld1q_u16(src);
+
+        if (aBits == 0) {
+            /* Fully transparent batch, nothing to draw */
+        } else if (aBits == ~(uint64_t)0) {
+            vst1q_u16(dst, s);
+        } else {
+            uint16x8_t d = vld1q_u16(dst);
+            uint16x8_t a = vmovl_u8(a8);
+            uint16x8_t ia = vmovl_u8(vmvn_u8(a8));
+            uint16x8_t r, g, b;
+
+            r = vmlaq_u16(vmulq_u16(vshrq_n_u16(s, 11), a),
+                          vshrq_n_u16(d, 11), ia);
+            g = vmlaq_u16(vmulq_u16(vandq_u16(vshrq_n_u16(s, 5), m6), a),
+                          vandq_u16(vshrq_n_u16(d, 5), m6), ia);
+            b = vmlaq_u16(vmulq_u16(vandq_u16(s, m5), a),
+                          vandq_u16(d, m5), ia);
+
+            r = vshlq_n_u16(NEON_DIV255(r), 11);
+            g = vshlq_n_u16(NEON_DIV255(g), 5);
+            vst1q_u16(dst, vorrq_u16(vorrq_u16(r, g), NEON_DIV255(b)));
+        }
+        dst += 8;
+        src += 8;
+        alpha += 8;
+        count -= 8;
+    }
+    blend_pixel_row_scalar(dst, src, alpha, count);
+}
+#endif /* GXJ_SIMD_NEON */
+
+#else /* GXJ_PIXEL_BYTES == 2 */
+
+/**
+ * Composite one 8888 pixel over another one, the alpha byte of the
+ * source pixel is ignored and the result is opaque.
+ */
+static gxj_pixel_type
+blend_rgb_pixel(unsigned int src, unsigned int dst, unsigned int As) {
+    unsigned int Ad = 0xFF - As;
+    unsigned int Rr = GXJ_DIV255(((src >> 16) & 0xFF) * As +
+                                 ((dst >> 16) & 0xFF) * Ad);
+    unsigned int Gr = GXJ_DIV255(((src >> 8) & 0xFF) * As +
+                                 ((dst >> 8) & 0xFF) * Ad);
+    unsigned int Br = GXJ_DIV255((src & 0xFF) * As + (dst & 0xFF) * Ad);
+
+    return (gxj_pixel_type)((Rr << 16) | (Gr << 8) | Br | IMG_PIXEL_OPAQUE);
+}
+
+static void
+convert_argb_row_scalar(gxj_pixel_type *dst, const jint *src, int count) {
+    while (count >= 4) {
+        dst[0] = (gxj_pixel_type)GXJ_RGB24TOPIXEL(src[0]);
+        dst[1] = (gxj_pixel_type)GXJ_RGB24TOPIXEL(src[1]);
+        dst[2] = (gxj_pixel_type)GXJ_RGB24TOPIXEL(src[2]);
+        dst[3] = (gxj_pixel_type)GXJ_RGB24TOPIXEL(src[3]);
+        dst += 4;
+        src += 4;
+        count -= 4;
+    }
+    while (count-- > 0) {
+        *dst++ = (gxj_pixel_type)GXJ_RGB24TOPIXEL(*src);
+        src++;
+    }
+}
+
+static void
+blend_argb_row_scalar(gxj_pixel_type *dst, const jint *src, int count) {
+    for (; count > 0; count--, dst++, src++) {
+        unsigned int s = (unsigned int)*src;
+        unsigned int As = s >> 24;
+
+        if (As == 0xFF) {
+            *dst = (gxj_pixel_type)GXJ_RGB24TOPIXEL(s);
+        } else if (As != 0) {
+            *dst = blend_rgb_pixel(s, *dst, As);
+        }
+    }
+}
+
+static void
+blend_pixel_row_scalar(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                       const gxj_alpha_type *alpha, int count) {
+    for (; count > 0; count--, dst++, src++, alpha++) {
+        unsigned int As = *alpha;
+
+        if (As == 0xFF) {
+            *dst = *src;
+        } else if (As != 0) {
+            *dst = blend_rgb_pixel(*src, *dst, As);
+        }
+    }
+}
+
+#if GXJ_SIMD_SSE2
+/** Divide each 16-bit lane by 255, see GXJ_DIV255 */
+#define SSE2_DIV255(t) \
+    _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16((t), _mm_srli_epi16((t), 8)), \
+                                 _mm_set1_epi16(1)), 8)
+
+/**
+ * Composite four 8888 pixels, the alpha of each pixel is
+ * replicated over the four 16-bit lanes of its channels.
+ */
+GXJ_SIMD_TARGET("sse2") static __m128i
+sse2_blend_rgb(__m128i s, __m128i d, __m128i aLo, __m128i aHi) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opaque = _mm_set1_epi16(0xFF);
+    __m128i lo, hi;
+
+    lo = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), aLo),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero),
+                        _mm_sub_epi16(opaque, aLo)));
+    hi = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), aHi),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero),
+                        _mm_sub_epi16(opaque, aHi)));
+    lo = _mm_packus_epi16(SSE2_DIV255(lo), SSE2_DIV255(hi));
+
+    return _mm_or_si128(_mm_and_si128(lo, _mm_set1_epi32(0x00FFFFFF)),
+                        _mm_set1_epi32((int)IMG_PIXEL_OPAQUE));
+}
+
+GXJ_SIMD_TARGET("sse2") static void
+convert_argb_row_sse2(gxj_pixel_type *dst, const jint *src, int count) {
+    const __m128i rgb = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i bits = _mm_set1_epi32((int)IMG_PIXEL_OPAQUE);
+
+    while (count >= 8) {
+        __m128i s0 = _mm_loadu_si128((const __m128i *)src);
+        __m128i s1 = _mm_loadu_si128((const __m128i *)(src + 4));
+
+        _mm_storeu_si128((__m128i *)dst,
+                         _mm_or_si128(_mm_and_si128(s0, rgb), bits));
+        _mm_storeu_si128((__m128i *)(dst + 4),
+                         _mm_or_si128(_mm_and_si128(s1, rgb), bits));
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    convert_argb_row_scalar(dst, src, count);
+}
+
+GXJ_SIMD_TARGET("sse2") static void
+blend_argb_row_sse2(gxj_pixel_type *dst, const jint *src, int count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opaque = _mm_set1_epi32(0xFF);
+
+    while (count >= 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)src);
+        __m128i a = _mm_srli_epi32(s, 24);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, zero)) == 0xFFFF) {
+            /* Fully transparent batch, nothing to draw */
+        } else if (_mm_movemask_epi8(_mm_cmpeq_epi32(a, opaque)) == 0xFFFF) {
+            _mm_storeu_si128((__m128i *)dst,
+                _mm_or_si128(_mm_and_si128(s, _mm_set1_epi32(0x00FFFFFF)),
+                             _mm_set1_epi32((int)IMG_PIXEL_OPAQUE)));
+        } else {
+            __m128i d = _mm_loadu_si128((const __m128i *)dst);
+            __m128i aLo = _mm_unpacklo_epi8(s, zero);
+            __m128i aHi = _mm_unpackhi_epi8(s, zero);
+
+            /* Replicate the alpha lane over the channel lanes */
+            aLo = _mm_shufflehi_epi16(_mm_shufflelo_epi16(aLo, 0xFF), 0xFF);
+            aHi = _mm_shufflehi_epi16(_mm_shufflelo_epi16(aHi, 0xFF), 0xFF);
+            _mm_storeu_si128((__m128i *)dst, sse2_blend_rgb(s, d, aLo, aHi));
+        }
+        dst += 4;
+        src += 4;
+        count -= 4;
+    }
+    blend_argb_row_scalar(dst, src, count);
+}
+
+GXJ_SIMD_TARGET("sse2") static void
+blend_pixel_row_sse2(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                     const gxj_alpha_type *alpha, int count) {
+    const __m128i zero = _mm_setzero_si128();
+
+    while (count >= 4) {
+        unsigned int aBits;
+
+        memcpy(&aBits, alpha, sizeof(aBits));
+        if (aBits == 0) {
+            /* Fully transparent batch, nothing to draw */
+        } else if (aBits == 0xFFFFFFFF) {
+            _mm_storeu_si128((__m128i *)dst,
+                             _mm_loadu_si128((const __m128i *)src));
+        } else {
+            __m128i s = _mm_loadu_si128((const __m128i *)src);
+            __m128i d = _mm_loadu_si128((const __m128i *)dst);
+            __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)aBits), zero);
+
+            /* Replicate each alpha over the channel lanes */
+            a = _mm_unpacklo_epi16(a, a);
+            _mm_storeu_si128((__m128i *)dst,
+                sse2_blend_rgb(s, d, _mm_unpacklo_epi32(a, a),
+                               _mm_unpackhi_epi32(a, a)));
+        }
+        dst += 4;
+        src += 4;
+        alpha += 4;
+        count -= 4;
+    }
+    blend_pixel_row_scalar(dst, src, alpha, count);
+}
+#endif /* GXJ_SIMD_SSE2 */
+
+#if GXJ_SIMD_NEON
+/** Divide each 16-bit lane by 255, see GXJ_DIV255 */
+#define NEON_DIV255(t) \
+    vshrq_n_u16(vaddq_u16(vaddq_u16((t), vshrq_n_u16((t), 8)), \
+                          vdupq_n_u16(1)), 8)
+
+/**
+ * Composite eight deinterleaved 8888 pixels, little endian words
+ * deinterleave to B, G, R, A planes.
+ */
+static uint8x8x4_t
+neon_blend_rgb(uint8x8x4_t s, uint8x8x4_t d, uint8x8_t a) {
+    uint8x8_t ia = vmvn_u8(a);
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        d.val[i] = vmovn_u16(NEON_DIV255(
+            vmlal_u8(vmull_u8(s.val[i], a), d.val[i], ia)));
+    }
+    d.val[3] = vdup_n_u8((uint8_t)(IMG_PIXEL_OPAQUE >> 24));
+    return d;
+}
+
+static void
+convert_argb_row_neon(gxj_pixel_type *dst, const jint *src, int count) {
+    const uint32x4_t rgb = vdupq_n_u32(0x00FFFFFF);
+    const uint32x4_t bits = vdupq_n_u32(IMG_PIXEL_OPAQUE);
+
+    while (count >= 8) {
+        uint32x4_t s0 = vld1q_u32((const uint32_t *)src);
+        uint32x4_t s1 = vld1q_u32((const uint32_t *)(src + 4));
+
+        vst1q_u32(dst, vorrq_u32(vandq_u32(s0, rgb), bits));
+        vst1q_u32(dst + 4, vorrq_u32(vandq_u32(s1, rgb), bits));
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    convert_argb_row_scalar(dst, src, count);
+}
+
+static void
+blend_argb_row_neon(gxj_pixel_type *dst, const jint *src, int count) {
+    while (count >= 8) {
+        uint8x8x4_t s = vld4_u8((const uint8_t *)src);
+        uint64_t aBits = vget_lane_u64(vreinterpret_u64_u8(s.val[3]), 0);
+
+        if (aBits == 0) {
+            /* Fully transparent batch, nothing to draw */
+        } else if (aBits == ~(uint64_t)0) {
+            convert_argb_row_neon(dst, src, 8);
+        } else {
+            uint8x8x4_t d = vld4_u8((const uint8_t *)dst);
+
+            vst4_u8((uint8_t *)dst, neon_blend_rgb(s, d, s.val[3]));
+        }
+        dst += 8;
+        src += 8;
+        count -= 8;
+    }
+    blend_argb_row_scalar(dst, src, count);
+}
+
+static void
+blend_pixel_row_neon(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                     const gxj_alpha_type *alpha, int count) {
+    while (count >= 8) {
+        uint8x8_t a = vld1_u8(alpha);
+        uint64_t aBits = vget_lane_u64(vreinterpret_u64_u8(a), 0);
+
+        if (aBits == 0) {
+            /* Fully transparent batch, nothing to draw */
+        } else if (aBits == ~(uint64_t)0) {
+            vst1q_u32(dst, vld1q_u32(src));
+            vst1q_u32(dst + 4, vld1q_u32(src + 4));
+        } else {
+            uint8x8x4_t s = vld4_u8((const uint8_t *)src);
+            uint8x8x4_t d = vld4_u8((const uint8_t *)dst);
+
+            vst4_u8((uint8_t *)dst, neon_blend_rgb(s, d, a));
+        }
+        dst += 8;
+        src += 8;
+        alpha += 8;
+        count -= 8;
+    }
+    blend_pixel_row_scalar(dst, src, alpha, count);
+}
+#endif /* GXJ_SIMD_NEON */
+
+#endif /* GXJ_PIXEL_BYTES == 2 */
+
+static void select_convert_argb(gxj_pixel_type *dst, const jint *src,
+                                int count);
+static void select_blend_argb(gxj_pixel_type *dst, const jint *src,
+                              int count);
+static void select_blend_pixel(gxj_pixel_type *dst,
+                               const gxj_pixel_type *src,
+                               const gxj_alpha_type *alpha, int count);
+
+/**
+ * Row kernels in use. Initially they refer to the selectors which
+ * replace all the kernels on the first call of any of them.
+ */
+static blend_kernels kernels = {
+    select_convert_argb,
+    select_blend_argb,
+    select_blend_pixel
+};
+
+/** Probe the CPU and install the best row kernels */
+static void
+select_kernels(void) {
+    blend_kernels k;
+
+    k.convert_argb = convert_argb_row_scalar;
+    k.blend_argb = blend_argb_row_scalar;
+    k.blend_pixel = blend_pixel_row_scalar;
+
+#if GXJ_SIMD_SSE2
+    if (GXJ_SIMD_HAS_SSE2()) {
+        k.convert_argb = convert_argb_row_sse2;
+        k.blend_argb = blend_argb_row_sse2;
+        k.blend_pixel = blend_pixel_row_sse2;
+    }
+#endif
+#if GXJ_SIMD_NEON
+    k.convert_argb = convert_argb_row_neon;
+    k.blend_argb = blend_argb_row_neon;
+    k.blend_pixel = blend_pixel_row_neon;
+#endif
+
+    REPORT_INFO1(LC_LOWUI, "gxj_blend: using %s kernels\n",
+        (k.blend_argb == blend_argb_row_scalar) ? "scalar" :
+        (GXJ_SIMD_NEON ? "NEON" : "SSE2"));
+
+    kernels = k;
+}
+
+static void
+select_convert_argb(gxj_pixel_type *dst, const jint *src, int count) {
+    select_kernels();
+    kernels.convert_argb(dst, src, count);
+}
+
+static void
+select_blend_argb(gxj_pixel_type *dst, const jint *src, int count) {
+    select_kernels();
+    kernels.blend_argb(dst, src, count);
+}
+
+static void
+select_blend_pixel(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                   const gxj_alpha_type *alpha, int count) {
+    select_kernels();
+    kernels.blend_pixel(dst, src, alpha, count);
+}
+
+/**
+ * Convert a row of ARGB8888 pixels ignoring the alpha channel.
+ */
+void
+gxj_convert_argb_row(gxj_pixel_type *dst, const jint *src, int count) {
+    kernels.convert_argb(dst, src, count);
+}
+
+/**
+ * Composite a row of ARGB8888 pixels over the destination pixels.
+ */
+void
+gxj_blend_argb_row(gxj_pixel_type *dst, const jint *src, int count) {
+    kernels.blend_argb(dst, src, count);
+}
+
+/**
+ * Composite a row of screen pixels with alpha plane over the
+ * destination pixels.
+ */
+void
+gxj_blend_pixel_row(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                    const gxj_alpha_type *alpha, int count) {
+    kernels.blend_pixel(dst, src, alpha, count);
+}
@@ -0,0 +1,274 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * Damage region of the system screen buffer: a short list of
+ * rectangles accumulated by the putpixel primitives and consumed
+ * by the screen refresh.
+ */
+
+#include <kni.h>
+
+#include <gxj_putpixel.h>
+#include <gxj_damage.h>
+
+/**
+ * Two rectangles are merged when their bounding box wastes not more
+ * than a quarter of their own area. Rectangles of one widget or of
+ * adjacent text lines are merged this way, distant ones are not.
+ */
+#define DAMAGE_MERGE_NUM   5
+#define DAMAGE_MERGE_DEN   4
+
+/** Damaged rectangles, none of them contains another one */
+static gxj_damage_rect damageRects[GXJ_DAMAGE_MAX_RECTS];
+
+/** Number of valid entries in damageRects */
+static int damageCount = 0;
+
+/** Whole screen must be flushed, damageRects is not used */
+static jboolean damageAll = KNI_TRUE;
+
+/** Pixel counters */
+static gxj_damage_stats damageStats;
+
+/** Pixels drawn since the last flush */
+static unsigned long damageTouched = 0;
+
+#define RECT_AREA(x1, y1, x2, y2) \
+    ((unsigned long)((x2) - (x1)) * (unsigned long)((y2) - (y1)))
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+/**
+ * Area of the bounding box of two rectangles.
+ */
+static unsigned long
+union_area(const gxj_damage_rect *a, const gxj_damage_rect *b) {
+    return RECT_AREA(MIN(a->x1, b->x1), MIN(a->y1, b->y1),
+                     MAX(a->x2, b->x2), MAX(a->y2, b->y2));
+}
+
+/**
+ * Extend the first rectangle to the bounding box of both.
+ */
+static void
+union_rect(gxj_damage_rect *a, const gxj_damage_rect *b) {
+    a->x1 = MIN(a->x1, b->x1);
+    a->y1 = MIN(a->y1, b->y1);
+    a->x2 = MAX(a->x2, b->x2);
+    a->y2 = MAX(a->y2, b->y2);
+}
+
+/**
+ * Check whether the first rectangle contains the second one.
+ */
+static jboolean
+contains_rect(const gxj_damage_rect *a, const gxj_damage_rect *b) {
+    return (a->x1 <= b->x1 && a->y1 <= b->y1 &&
+            a->x2 >= b->x2 && a->y2 >= b->y2) ? KNI_TRUE : KNI_FALSE;
+}
+
+/**
+ * Add a clipped non-empty rectangle to the damage list keeping
+ * the list invariant.
+ */
+static void
+add_rect(gxj_damage_rect r) {
+    int i;
+    int best;
+    unsigned long rArea;
+    unsigned long growth;
+    unsigned long bestGrowth;
+
+    for (;;) {
+        rArea = RECT_AREA(r.x1, r.y1, r.x2, r.y2);
+        for (i = 0; i < damageCount; i++) {
+            gxj_damage_rect *d = &damageRects[i];
+            if (contains_rect(d, &r)) {
+                return;
+            }
+            if (contains_rect(&r, d) ||
+                    union_area(d, &r) * DAMAGE_MERGE_DEN <=
+                    (RECT_AREA(d->x1, d->y1, d->x2, d->y2) + rArea) *
+                        DAMAGE_MERGE_NUM) {
+                break;
+            }
+        }
+        if (i == damageCount) {
+            break;
+        }
+        /* Absorb the entry and look again with the grown rectangle */
+        union_rect(&r, &damageRects[i]);
+        damageRects[i] = damageRects[--damageCount];
+    }
+
+    if (damageCount < GXJ_DAMAGE_MAX_RECTS) {
+        damageRects[damageCount++] = r;
+        return;
+    }
+
+    /* The list is full, grow the entry that grows the least */
+    best = 0;
+    bestGrowth = (unsigned long)-1;
+    for (i = 0; i < damageCount; i++) {
+        gxj_damage_rect *d = &damageRects[i];
+        growth = union_area(d, &r) - RECT_AREA(d->x1, d->y1, d->x2, d->y2);
+        if (growth < bestGrowth) {
+            bestGrowth = growth;
+            best = i;
+        }
+    }
+    union_rect(&r, &damageRects[best]);
+    damageRects[best] = damageRects[--damageCount];
+    add_rect(r);
+}
+
+/**
+ * Report an area drawn into a screen buffer.
+ */
+void
+gxj_damage_add(const gxj_screen_buffer *sbuf,
+               int x1, int y1, int x2, int y2) {
+#if ENABLE_GXJ_DAMAGE
+    gxj_damage_rect r;
+
+    if (sbuf != &gxj_system_screen_buffer) {
+        return;
+    }
+
+    r.x1 = MAX(x1, 0);
+    r.y1 = MAX(y1, 0);
+    r.x2 = MIN(x2, sbuf->width);
+    r.y2 = MIN(y2, sbuf->height);
+    if (r.x1 >= r.x2 || r.y1 >= r.y2) {
+        return;
+    }
+
+    damageTouched += RECT_AREA(r.x1, r.y1, r.x2, r.y2);
+    if (!damageAll) {
+        add_rect(r);
+    }
+#else
+    (void)sbuf; (void)x1; (void)y1; (void)x2; (void)y2;
+#endif
+}
+
+/**
+ * Report an area drawn into a screen buffer with a clip applied.
+ */
+void
+gxj_damage_add_clipped(const gxj_screen_buffer *sbuf, const jshort *clip,
+                       int x1, int y1, int x2, int y2) {
+    gxj_damage_add(sbuf,
+                   MAX(x1, clip[0]), MAX(y1, clip[1]),
+                   MIN(x2, clip[2]), MIN(y2, clip[3]));
+}
+
+/**
+ * Mark the whole system screen buffer as damaged.
+ */
+void
+gxj_damage_invalidate(void) {
+    damageAll = KNI_TRUE;
+    damageCount = 0;
+}
+
+/**
+ * Get the damaged rectangles within the refreshed area and end
+ * the frame.
+ */
+int
+gxj_damage_flush(int x1, int y1, int x2, int y2, gxj_damage_rect *rects) {
+    int i;
+    int n = 0;
+    unsigned long flushed = 0;
+
+    if (x1 >= x2 || y1 >= y2) {
+        return 0;
+    }
+
+#if ENABLE_GXJ_DAMAGE
+    if (!damageAll) {
+        i = 0;
+        while (i < damageCount) {
+            gxj_damage_rect *d = &damageRects[i];
+            gxj_damage_rect *r = &rects[n];
+
+            r->x1 = MAX(d->x1, x1);
+            r->y1 = MAX(d->y1, y1);
+            r->x2 = MIN(d->x2, x2);
+            r->y2 = MIN(d->y2, y2);
+            if (r->x1 < r->x2 && r->y1 < r->y2) {
+                flushed += RECT_AREA(r->x1, r->y1, r->x2, r->y2);
+                n++;
+            }
+
+            if (d->x1 >= x1 && d->y1 >= y1 && d->x2 <= x2 && d->y2 <= y2) {
+                /* Fully flushed, the entries are not ordered */
+                *d = damageRects[--damageCount];
+            } else {
+                i++;
+            }
+        }
+    } else
+#endif
+    {
+        rects[0].x1 = x1;
+        rects[0].y1 = y1;
+        rects[0].x2 = x2;
+        rects[0].y2 = y2;
+        flushed = RECT_AREA(x1, y1, x2, y2);
+        n = 1;
+
+        /* A partial refresh leaves the rest of the screen stale */
+        if (x1 <= 0 && y1 <= 0 &&
+                x2 >= gxj_system_screen_buffer.width &&
+                y2 >= gxj_system_screen_buffer.height) {
+            damageAll = KNI_FALSE;
+            damageCount = 0;
+        }
+    }
+
+    damageStats.frames++;
+    damageStats.touched = damageTouched;
+    damageStats.flushed = flushed;
+    damageStats.totalTouched += damageTouched;
+    damageStats.totalFlushed += flushed;
+    damageTouched = 0;
+
+    return n;
+}
+
+/**
+ * Get the counters of pixels drawn and copied to the screen.
+ */
+void
+gxj_damage_get_stats(gxj_damage_stats *stats) {
+    *stats = damageStats;
+}
@@ -0,0 +1,406 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * Cache of the built-in font glyphs expanded to runs of foreground
+ * pixels, and of the coverage font glyphs expanded to runs of
+ * 8-bit coverage values.
+ */
+
+#include <stddef.h>
+#include <kni.h>
+#include <midp_logging.h>
+
+#include "gxj_intern_font_bitmap.h"
+#include "gxj_intern_glyph_cache.h"
+
+#if ENABLE_GXJ_GLYPH_CACHE
+
+/** Cached glyph, direct mapped by the low bits of the character code */
+typedef struct _glyph_entry {
+    jchar code;             /**< character code of the glyph */
+    jboolean valid;         /**< KNI_TRUE if the entry holds a glyph */
+    int offset;             /**< offset of the glyph runs in the storage */
+} glyph_entry;
+
+/**
+ * Cached glyphs of one font. The storage of glyph runs is filled
+ * sequentially, and all the glyphs are dropped when it is full.
+ */
+typedef struct _glyph_cache {
+    glyph_entry entries[GXJ_GLYPH_CACHE_SIZE];
+    unsigned char *data;    /**< storage of glyph runs */
+    int size;               /**< size of the storage */
+    int used;               /**< number of used bytes of the storage */
+} glyph_cache;
+
+/**
+ * Expand a glyph to runs at the end of the cache storage.
+ *
+ * @return KNI_TRUE on success, KNI_FALSE if there is no space left
+ */
+typedef jboolean (*glyph_expand_func)(glyph_cache *cache,
+                                      pfontbitmap fontbitmap, jchar c,
+                                      int fontWidth, int fontHeight);
+
+/** Storage of the 1-bit glyph runs */
+static unsigned char glyphRuns[GXJ_GLYPH_CACHE_BYTES];
+
+/** Cached 1-bit glyphs */
+static glyph_cache bitmapCache = {
+    {{0, KNI_FALSE, 0}}, glyphRuns, GXJ_GLYPH_CACHE_BYTES, 0
+};
+
+/**
+ * Find the table of a font where the character is stored,
+ * the same way selectFontBitmap() does.
+ *
+ * @return the table or NULL if no table holds the character
+ */
+static pfontbitmap
+glyph_table(pfontbitmap *pfonts, jchar c0) {
+    unsigned char c_hi = (c0 >> 8) & 0xff;
+    unsigned char c_lo = c0 & 0xff;
+    int i;
+
+    for (i = 1; i <= (int)pfonts[0]; i++) {
+        if (c_hi == pfonts[i][FONT_CODE_RANGE_HIGH]
+          && c_lo >= pfonts[i][FONT_CODE_FIRST_LOW]
+          && c_lo <= pfonts[i][FONT_CODE_LAST_LOW]) {
+            return pfonts[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Check whether a pixel of a glyph is a foreground one. The bitmap
+ * is read the same way the bit by bit drawing does.
+ */
+static int
+glyph_pixel(pfontbitmap fontbitmap, jchar c0, int x, int y,
+            int fontWidth, int fontHeight) {
+    jchar c = (c0 & 0xff) - fontbitmap[FONT_CODE_FIRST_LOW];
+    unsigned long mapLen =
+        ((fontbitmap[FONT_CODE_LAST_LOW]
+        - fontbitmap[FONT_CODE_FIRST_LOW]
+        + 1) * fontWidth * fontHeight + 7) >> 3;
+    unsigned long pixelIndex = (unsigned long)c * fontHeight * fontWidth +
+        y * fontWidth + x;
+
+    if ((pixelIndex >> 3) >= mapLen) {
+        return 0;
+    }
+    return (fontbitmap[FONT_DATA + (pixelIndex >> 3)] &
+            (0x80 >> (pixelIndex & 7))) != 0;
+}
+
+/** Expand a 1-bit glyph to runs of foreground pixels */
+static jboolean
+glyph_expand(glyph_cache *cache, pfontbitmap fontbitmap, jchar c,
+             int fontWidth, int fontHeight) {
+    unsigned char *runs = cache->data;
+    int used = cache->used;
+    int x, y, start, count;
+    int countPos;
+
+    for (y = 0; y < fontHeight; y++) {
+        if (used >= cache->size) {
+            return KNI_FALSE;
+        }
+        countPos = used++;
+        count = 0;
+        for (x = 0; x < fontWidth; ) {
+            if (!glyph_pixel(fontbitmap, c, x, y, fontWidth, fontHeight)) {
+                x++;
+                continue;
+            }
+            start = x;
+            while (x < fontWidth &&
+                    glyph_pixel(fontbitmap, c, x, y, fontWidth, fontHeight)) {
+                x++;
+            }
+            if (used + 2 > cache->size) {
+                return KNI_FALSE;
+            }
+            runs[used++] = (unsigned char)start;
+            runs[used++] = (unsigned char)(x - start);
+            count++;
+        }
+        runs[countPos] = (unsigned char)count;
+    }
+
+    cache->used = used;
+    return KNI_TRUE;
+}
+
+/**
+ * Look a glyph up in a cache, expanding it on a miss.
+ *
+ * @return pointer to the runs of the first glyph line, or NULL if
+ *   the glyph does not fit into the empty cache
+ */
+static const unsigned char *
+glyph_cache_lookup(glyph_cache *cache, glyph_expand_func expand,
+                   pfontbitmap fontbitmap, jchar c,
+                   int fontWidth, int fontHeight) {
+    glyph_entry *e = &cache->entries[c & (GXJ_GLYPH_CACHE_SIZE - 1)];
+    int offset;
+    int i;
+
+    if (e->valid && e->code == c) {
+        return &cache->data[e->offset];
+    }
+
+    offset = cache->used;
+    if (!expand(cache, fontbitmap, c, fontWidth, fontHeight)) {
+        /* The storage is full, start over with an empty cache */
+        REPORT_INFO(LC_LOWUI, "gxj_glyph_cache: dropping all glyphs\n");
+        for (i = 0; i < GXJ_GLYPH_CACHE_SIZE; i++) {
+            cache->entries[i].valid = KNI_FALSE;
+        }
+        cache->used = 0;
+        offset = 0;
+        if (!expand(cache, fontbitmap, c, fontWidth, fontHeight)) {
+            return NULL;
+        }
+    }
+
+    /* The replaced glyph's runs stay unused until the storage is reset */
+    e->code = c;
+    e->offset = offset;
+    e->valid = KNI_TRUE;
+    return &cache->data[offset];
+}
+
+/**
+ * Get the runs of foreground pixels of a character of the built-in
+ * font, expanding the glyph on a cache miss.
+ */
+const unsigned char *
+gxj_glyph_cache_get(jchar c) {
+    int fontWidth = FontBitmaps[1][FONT_WIDTH];
+    int fontHeight = FontBitmaps[1][FONT_HEIGHT];
+    pfontbitmap fontbitmap = glyph_table(FontBitmaps, c);
+
+    /* Run offsets and lengths are stored in bytes */
+    if (fontWidth > 0xff) {
+        return NULL;
+    }
+
+    /* the first table must cover the range 0-nn */
+    if (fontbitmap == NULL) {
+        fontbitmap = FontBitmaps[1];
+    }
+
+    return glyph_cache_lookup(&bitmapCache, glyph_expand, fontbitmap, c,
+                              fontWidth, fontHeight);
+}
+
+#if ENABLE_GXJ_AA_FONT
+
+/** Storage of the coverage glyph runs */
+static unsigned char coverageRuns[GXJ_GLYPH_COVERAGE_BYTES];
+
+/** Cached coverage glyphs */
+static glyph_cache coverageCache = {
+    {{0, KNI_FALSE, 0}}, coverageRuns, GXJ_GLYPH_COVERAGE_BYTES, 0
+};
+
+/** Coverage font state: -1 not checked yet, 0 unusable, 1 usable */
+static int coverageState = -1;
+
+/**
+ * Get the coverage of a glyph pixel scaled to 0..255.
+ */
+static int
+coverage_pixel(pfontbitmap fontbitmap, jchar c0, int x, int y,
+               int fontWidth, int fontHeight) {
+    jchar c = (c0 & 0xff) - fontbitmap[FONT_CODE_FIRST_LOW];
+    unsigned long pixelIndex = (unsigned long)c * fontHeight * fontWidth +
+        y * fontWidth + x;
+    unsigned char const *data = fontbitmap + FONT_COVERAGE_DATA;
+
+    if (fontbitmap[FONT_COVERAGE_BITS] == 8) {
+        return data[pixelIndex];
+    }
+    /* Two pixels per byte, the first one in the high nibble */
+    return ((data[pixelIndex >> 1] >> ((pixelIndex & 1) ? 0 : 4)) & 0xf)
+        * 0x11;
+}
+
+/**
+ * Expand a coverage glyph to runs of covered pixels, each run is
+ * followed by the coverage of its pixels.
+ */
+static jboolean
+coverage_expand(glyph_cache *cache, pfontbitmap fontbitmap, jchar c,
+                int fontWidth, int fontHeight) {
+    unsigned char *runs = cache->data;
+    int used = cache->used;
+    int x, y, start, count, a;
+    int countPos, lengthPos;
+
+    for (y = 0; y < fontHeight; y++) {
+        if (used >= cache->size) {
+            return KNI_FALSE;
+        }
+        countPos = used++;
+        count = 0;
+        for (x = 0; x < fontWidth; ) {
+            a = coverage_pixel(fontbitmap, c, x, y, fontWidth, fontHeight);
+            if (a == 0) {
+                x++;
+                continue;
+            }
+            if (used + 2 > cache->size) {
+                return KNI_FALSE;
+            }
+            start = x;
+            runs[used++] = (unsigned char)start;
+            lengthPos = used++;
+            do {
+                if (used >= cache->size) {
+                    return KNI_FALSE;
+                }
+                runs[used++] = (unsigned char)a;
+                if (++x >= fontWidth) {
+                    break;
+                }
+                a = coverage_pixel(fontbitmap, c, x, y,
+                                   fontWidth, fontHeight);
+            } while (a != 0);
+            runs[lengthPos] = (unsigned char)(x - start);
+            count++;
+        }
+        runs[countPos] = (unsigned char)count;
+    }
+
+    cache->used = used;
+    return KNI_TRUE;
+}
+
+/**
+ * Check whether a coverage font matching the built-in font is linked
+ * and anti-aliased drawing is enabled.
+ */
+jboolean
+gxj_glyph_cache_has_coverage(void) {
+    int i;
+
+    if (coverageState < 0) {
+        coverageState = 0;
+        for (i = 1; i <= (int)FontCoverage[0]; i++) {
+            if (FontCoverage[i][FONT_WIDTH] != FontBitmaps[1][FONT_WIDTH]
+                || FontCoverage[i][FONT_HEIGHT] !=
+                   FontBitmaps[1][FONT_HEIGHT]
+                || (FontCoverage[i][FONT_COVERAGE_BITS] != 4 &&
+                    FontCoverage[i][FONT_COVERAGE_BITS] != 8)) {
+                REPORT_WARN(LC_LOWUI,
+                    "gxj_glyph_cache: coverage font does not match "
+                    "the built-in font, ignored\n");
+                return KNI_FALSE;
+            }
+        }
+        coverageState = (i > 1);
+    }
+
+    return coverageState ? KNI_TRUE : KNI_FALSE;
+}
+
+/**
+ * Get the runs and pixel coverage of a character of the coverage
+ * font, expanding the glyph on a cache miss.
+ */
+const unsigned char *
+gxj_glyph_cache_get_coverage(jchar c) {
+    pfontbitmap fontbitmap;
+
+    if (!gxj_glyph_cache_has_coverage()) {
+        return NULL;
+    }
+
+    fontbitmap = glyph_table(FontCoverage, c);
+    if (fontbitmap == NULL) {
+        return NULL;
+    }
+
+    return glyph_cache_lookup(&coverageCache, coverage_expand, fontbitmap,
+                              c, FontBitmaps[1][FONT_WIDTH],
+                              FontBitmaps[1][FONT_HEIGHT]);
+}
+
+#else /* ENABLE_GXJ_AA_FONT */
+
+/**
+ * Anti-aliased drawing is disabled, the 1-bit font is always used.
+ */
+jboolean
+gxj_glyph_cache_has_coverage(void) {
+    return KNI_FALSE;
+}
+
+/**
+ * Anti-aliased drawing is disabled, the 1-bit font is always used.
+ */
+const unsigned char *
+gxj_glyph_cache_get_coverage(jchar c) {
+    (void)c;
+    return NULL;
+}
+
+#endif /* ENABLE_GXJ_AA_FONT */
+
+#else /* ENABLE_GXJ_GLYPH_CACHE */
+
+/**
+ * Glyph caching is disabled, the font bitmap is always used.
+ */
+const unsigned char *
+gxj_glyph_cache_get(jchar c) {
+    (void)c;
+    return NULL;
+}
+
+/**
+ * Glyph caching is disabled, the 1-bit font is always used.
+ */
+jboolean
+gxj_glyph_cache_has_coverage(void) {
+    return KNI_FALSE;
+}
+
+/**
+ * Glyph caching is disabled, the 1-bit font is always used.
+ */
+const unsigned char *
+gxj_glyph_cache_get_coverage(jchar c) {
+    (void)c;
+    return NULL;
+}
+
+#endif /* ENABLE_GXJ_GLYPH_CACHE */
@@ -29,7 +29,10 @@
 
 #include <gx_graphics.h>
 #include <gxapi_constants.h>
+#include <gxj_span.h>
+#include <gxj_damage.h>
 
+#include "gxj_intern_blend.h"
 #include "gxj_intern_graphics.h"
 #include "gxj_intern_putpixel.h"
 #include "gxj_intern_image.h"
@@ -44,6 +47,10 @@
  * putpixel primitive graphics. 
  */
 
+/** Bounding box helpers for the damaged area of lines and triangles */
+#define DAMAGE_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define DAMAGE_MAX(a, b) ((a) > (b) ? (a) : (b))
+
 /**
  * Create native representation for a image.
  *
@@ -109,8 +116,14 @@ gx_fill_triangle(jint color, const jshort *clip,
   /* Surpress unused parameter warnings */
   (void)dotted;
 
-  fill_triangle(sbuf, GXJ_RGB24TORGB16(color), 
+  fill_triangle(sbuf, GXJ_RGB24TOPIXEL(color), 
 		clip, x1, y1, x2, y2, x3, y3);
+
+  gxj_damage_add_clipped(sbuf, clip,
+      DAMAGE_MIN(x1, DAMAGE_MIN(x2, x3)),
+      DAMAGE_MIN(y1, DAMAGE_MIN(y2, y3)),
+      DAMAGE_MAX(x1, DAMAGE_MAX(x2, x3)) + 1,
+      DAMAGE_MAX(y1, DAMAGE_MAX(y2, y3)) + 1);
 }
 
 /**
@@ -126,65 +139,16 @@ gx_copy_area(const jshort *clip,
 
   copy_imageregion(sbuf, sbuf, clip, x_dest, y_dest, width, height,
 		   x_src, y_src, 0);
-}
 
-/* 
- * For A in [0..0xffff] 
- *
- *        A / 255 == A / 256 + ((A / 256) + (A % 256) + 1) / 256
- *
- */
-#define div(x)  (((x) >> 8) + ((((x) >> 8) + ((x) & 0xff) + 1) >> 8))
-
-static unsigned short alphaComposition(jint src, 
-                                       unsigned short dst, 
-                                       unsigned char As) {
-  unsigned char Rs = (unsigned char)(src >> 16);
-  unsigned char Rd = (unsigned char)
-    ((((dst & 0xF800) << 5) | (dst & 0xE000)) >> 13);
-  int pRr = ((int)Rs - Rd) * As + Rd * 0xff;
-  unsigned char Rr = 
-    (unsigned char)( div(pRr) );
-
-  unsigned char Gs = (unsigned char)(src >> 8);
-  unsigned char Gd = (unsigned char)
-    (((dst & 0x07E0) >> 3) | ((dst & 0x0600) >> 9));
-  int pGr = ((int)Gs - Gd) * As + Gd * 0xff;
-  unsigned char Gr = 
-    (unsigned char)( div(pGr) );
-
-  unsigned char Bs = (unsigned char)(src);
-  unsigned char Bd = (unsigned char)
-    ((dst & 0x001F) << 3) | ((dst & 0x001C) >> 2);
-  int pBr = ((int)Bs - Bd) * As + Bd * 0xff;
-  unsigned char Br = 
-    (unsigned char)( div(pBr) );
-
-  /* compose RGB from separate color components */
-  return ((Rr & 0xF8) << 8) + ((Gr & 0xFC) << 3) + (Br >> 3);
+  gxj_damage_add_clipped(sbuf, clip, x_dest, y_dest,
+      x_dest + width, y_dest + height);
 }
 
-
-#if (UNDER_CE)
+#if (UNDER_CE) && (IMG_PIXEL_SIZE == 2)
 extern void asm_draw_rgb(jint* src, int srcSpan, unsigned short* dst,
     int dstSpan, int width, int height);
 #endif
 
-#define SRC_PIXEL_TO_DEST_WITH_ALPHA(pSrc, pDest) \
-        src = *pSrc++;  \
-        As = src >> 26; \
-        if (As == 0x3F) {   \
-            *pDest = GXJ_RGB24TORGB16(src);  \
-        } else if (As != 0) {   \
-            *pDest = alphaComposition(src, *pDest, (unsigned char)As);   \
-        }   \
-        pDest++
-
-#define SRC_PIXEL_TO_DEST(pSrc, pDest) \
-        src = *pSrc++;  \
-        *pDest = GXJ_RGB24TORGB16(src); \
-        pDest++
-
 /** Draw image in RGB format */
 void
 gx_draw_rgb(const jshort *clip,
@@ -227,7 +191,9 @@ gx_draw_rgb(const jshort *clip,
         return;
     }
 
-#if (UNDER_CE)
+    gxj_damage_add(sbuf, x, y, x + width, y + height);
+
+#if (UNDER_CE) && (IMG_PIXEL_SIZE == 2)
     if (!processAlpha) {
         asm_draw_rgb(rgbData + offset, scanlen - width,
             sbuf->pixelData + sbufWidth * y + x,
@@ -238,128 +204,25 @@ gx_draw_rgb(const jshort *clip,
 
     CHECK_SBUF_CLIP_BOUNDS(sbuf, clip);
 
-#if USE_SLOW_LOOPS
-    {
-      gxj_pixel_type * pdst = &sbuf->pixelData[y * sbufWidth + x];
-      jint * psrc = &rgbData[offset];
-      int pdst_delta = sbufWidth - width;
-      int psrc_delta = scanlen - width;
-      gxj_pixel_type * pdst_end = pdst + height * sbufWidth;
-
-      if (pdst_delta < 0 || psrc_delta < 0) {
-        return;
-      }
-
-      if (!processAlpha) {
-	do {
-	  gxj_pixel_type * pdst_stop = pdst + width;
-	  
-	  do {
-	    jint src = *psrc++;
-
-	    CHECK_PTR_CLIP(sbuf, pdst);
-
-	    *pdst = GXJ_RGB24TORGB16(src);
-	  } while (++pdst < pdst_stop);
-
-	  psrc += psrc_delta;
-	  pdst += pdst_delta;
-	} while (pdst < pdst_end);
-      } else {
-	do {
-	  gxj_pixel_type * pdst_stop = pdst + width;
-	
-	  do {
-	    jint src = *psrc++;
-	    unsigned char As = (unsigned char)(src >> 24);
-
-	    CHECK_PTR_CLIP(sbuf, pdst);
-
-	    *pdst = alphaComposition(src, *pdst, As);
-	  } while (++pdst < pdst_stop);
-
-	  psrc += psrc_delta;
-	  pdst += pdst_delta;
-	} while (pdst < pdst_end);
-      }
-    }
-#else
     {
-        const unsigned int width16 = width & 0xFFFFFFF0;
-        const unsigned int widthRemain = width & 0xF;
-        unsigned int col;
-        
         gxj_pixel_type * pdst = &sbuf->pixelData[y * sbufWidth + x];
         jint * psrc = &rgbData[offset];
-        int pdst_delta = sbufWidth - width;
-        int psrc_delta = scanlen - width;
-        gxj_pixel_type * pdst_end = pdst + height * sbufWidth;
-        unsigned int  src;
-        unsigned char As;
 
-        if (pdst_delta < 0 || psrc_delta < 0) {
+        if (sbufWidth < width || scanlen < width) {
             return;
         }
 
-        if (processAlpha) {
-            do {
-                for (col = width16; col != 0; col -= 16) {
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                }
-                
-                for (col = widthRemain; col != 0; col--) {
-                    SRC_PIXEL_TO_DEST_WITH_ALPHA(psrc, pdst);
-                }
-                
-                psrc += psrc_delta;
-                pdst += pdst_delta;
-            } while (pdst < pdst_end);
-        } else {
-            do {
-                for (col = width16; col != 0; col -= 16) {
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                    SRC_PIXEL_TO_DEST(psrc, pdst);
-                }
-                
-                for (col = widthRemain; col != 0; col--) {
-                    SRC_PIXEL_TO_DEST(psrc,pdst);
-                }
-
-                psrc += psrc_delta;
-                pdst += pdst_delta;
-            } while (pdst < pdst_end);
+        for (; height > 0; height--) {
+            CHECK_PTR_CLIP(sbuf, pdst);
+            if (processAlpha) {
+                gxj_blend_argb_row(pdst, psrc, width);
+            } else {
+                gxj_convert_argb_row(pdst, psrc, width);
+            }
+            psrc += scanlen;
+            pdst += sbufWidth;
         }
     }
-#endif
 }
 
 /**
@@ -368,7 +231,7 @@ gx_draw_rgb(const jshort *clip,
  */
 jint
 gx_get_displaycolor(jint color) {
-    int newColor = GXJ_RGB16TORGB24(GXJ_RGB24TORGB16(color));
+    int newColor = GXJ_PIXELTORGB24(GXJ_RGB24TOPIXEL(color));
 
     REPORT_CALL_TRACE1(LC_LOWUI, "gx_getDisplayColor(%d)\n", color);
 
@@ -389,7 +252,7 @@ gx_draw_line(jint color, const jshort *clip,
               int x1, int y1, int x2, int y2)
 {
   int lineStyle = (dotted ? DOTTED : SOLID);
-  gxj_pixel_type pixelColor = GXJ_RGB24TORGB16(color);
+  gxj_pixel_type pixelColor = GXJ_RGB24TOPIXEL(color);
   gxj_screen_buffer screen_buffer;
   gxj_screen_buffer *sbuf = gxj_get_image_screen_buffer_impl(dst, &screen_buffer, NULL);
   sbuf = (gxj_screen_buffer *)getScreenBuffer(sbuf);
@@ -397,6 +260,10 @@ gx_draw_line(jint color, const jshort *clip,
   REPORT_CALL_TRACE(LC_LOWUI, "gx_draw_line()\n");
   
   draw_clipped_line(sbuf, pixelColor, lineStyle, clip, x1, y1, x2, y2);
+
+  gxj_damage_add_clipped(sbuf, clip,
+      DAMAGE_MIN(x1, x2), DAMAGE_MIN(y1, y2),
+      DAMAGE_MAX(x1, x2) + 1, DAMAGE_MAX(y1, y2) + 1);
 }
 
 /**
@@ -413,7 +280,7 @@ gx_draw_rect(jint color, const jshort *clip,
 {
 
   int lineStyle = (dotted ? DOTTED : SOLID);
-  gxj_pixel_type pixelColor = GXJ_RGB24TORGB16(color);
+  gxj_pixel_type pixelColor = GXJ_RGB24TOPIXEL(color);
   gxj_screen_buffer screen_buffer;
   gxj_screen_buffer *sbuf = gxj_get_image_screen_buffer_impl(dst, &screen_buffer, NULL);
   sbuf = (gxj_screen_buffer *)getScreenBuffer(sbuf);
@@ -422,26 +289,14 @@ gx_draw_rect(jint color, const jshort *clip,
 
   draw_roundrect(pixelColor, clip, sbuf, lineStyle, x,  y, 
 		 width, height, 0, 0, 0);
-}
-
-
-#if (UNDER_ADS || UNDER_CE) || (defined(__GNUC__) && defined(ARM))
-extern void fast_pixel_set(unsigned * mem, unsigned value, int number_of_pixels);
-#else
-void fast_pixel_set(unsigned * mem, unsigned value, int number_of_pixels)
-{
-   int i;
-   gxj_pixel_type* pBuf = (gxj_pixel_type*)mem;
 
-   for (i = 0; i < number_of_pixels; ++i) {
-      *(pBuf + i) = (gxj_pixel_type)value;
-   }
+  gxj_damage_add_clipped(sbuf, clip, x, y, x + width + 1, y + height + 1);
 }
-#endif
 
-void fastFill_rect(unsigned short color, gxj_screen_buffer *sbuf, int x, int y, int width, int height, int cliptop, int clipbottom) {
+
+void fastFill_rect(gxj_pixel_type color, gxj_screen_buffer *sbuf, int x, int y, int width, int height, int cliptop, int clipbottom) {
 	int screen_horiz=sbuf->width;
-	unsigned short* raster;
+	gxj_pixel_type* raster;
 
     if (width<=0) {return;}
 	if (x > screen_horiz) { return; }
@@ -453,10 +308,7 @@ void fastFill_rect(unsigned short color, gxj_screen_buffer *sbuf, int x, int y,
 
 
 	raster=sbuf->pixelData + y*screen_horiz+x;
-	for(;height>0;height--) {
-		fast_pixel_set((unsigned *)raster, color, width);
-		raster+=screen_horiz;
-	}
+	gxj_span_fill_rect(raster, screen_horiz, color, width, height);
 }
 
 /**
@@ -467,7 +319,7 @@ gx_fill_rect(jint color, const jshort *clip,
 	      const java_imagedata *dst, int dotted, 
               int x, int y, int width, int height) {
 
-  gxj_pixel_type pixelColor = GXJ_RGB24TORGB16(color);
+  gxj_pixel_type pixelColor = GXJ_RGB24TOPIXEL(color);
   gxj_screen_buffer screen_buffer;
   const jshort clipX1 = clip[0];
   const jshort clipY1 = clip[1];
@@ -476,6 +328,7 @@ gx_fill_rect(jint color, const jshort *clip,
   gxj_screen_buffer *sbuf = gxj_get_image_screen_buffer_impl(dst, &screen_buffer, NULL);
   sbuf = (gxj_screen_buffer *)getScreenBuffer(sbuf);
 
+  gxj_damage_add_clipped(sbuf, clip, x, y, x + width, y + height);
 
   if ((clipX1==0)&&(clipX2==sbuf->width)&&(dotted!=DOTTED)) {
     fastFill_rect(pixelColor, sbuf, x, y, width, height, clipY1, clipY2 );
@@ -500,7 +353,7 @@ gx_draw_roundrect(jint color, const jshort *clip,
                    int arcWidth, int arcHeight)
 {
   int lineStyle = (dotted?DOTTED:SOLID);
-  gxj_pixel_type pixelColor = GXJ_RGB24TORGB16(color);
+  gxj_pixel_type pixelColor = GXJ_RGB24TOPIXEL(color);
   gxj_screen_buffer screen_buffer;
   gxj_screen_buffer *sbuf = gxj_get_image_screen_buffer_impl(dst, &screen_buffer, NULL);
   sbuf = (gxj_screen_buffer *)getScreenBuffer(sbuf);
@@ -511,6 +364,8 @@ gx_draw_roundrect(jint color, const jshort *clip,
   draw_roundrect(pixelColor, clip, sbuf, lineStyle, 
 		 x, y, width, height,
 		 0, arcWidth >> 1, arcHeight >> 1);
+
+  gxj_damage_add_clipped(sbuf, clip, x, y, x + width + 1, y + height + 1);
 }
 
 /**
@@ -524,7 +379,7 @@ gx_fill_roundrect(jint color, const jshort *clip,
                    int arcWidth, int arcHeight)
 {
   int lineStyle = (dotted?DOTTED:SOLID);
-  gxj_pixel_type pixelColor = GXJ_RGB24TORGB16(color);
+  gxj_pixel_type pixelColor = GXJ_RGB24TOPIXEL(color);
   gxj_screen_buffer screen_buffer;
   gxj_screen_buffer *sbuf = gxj_get_image_screen_buffer_impl(dst, &screen_buffer, NULL);
   sbuf = (gxj_screen_buffer *)getScreenBuffer(sbuf);
@@ -534,6 +389,8 @@ gx_fill_roundrect(jint color, const jshort *clip,
   draw_roundrect(pixelColor, clip, sbuf, lineStyle, 
 		 x,  y,  width,  height,
 		 1, arcWidth >> 1, arcHeight >> 1);
+
+  gxj_damage_add_clipped(sbuf, clip, x, y, x + width + 1, y + height + 1);
 }
 
 /**
@@ -552,13 +409,15 @@ gx_draw_arc(jint color, const jshort *clip,
              int startAngle, int arcAngle)
 {
   int lineStyle = (dotted?DOTTED:SOLID);
-  gxj_pixel_type pixelColor = GXJ_RGB24TORGB16(color);
+  gxj_pixel_type pixelColor = GXJ_RGB24TOPIXEL(color);
   gxj_screen_buffer screen_buffer;
   gxj_screen_buffer *sbuf = gxj_get_image_screen_buffer_impl(dst, &screen_buffer, NULL);
   sbuf = (gxj_screen_buffer *)getScreenBuffer(sbuf);
 
   draw_arc(pixelColor, clip, sbuf, lineStyle, x, y, 
 	   width, height, 0, startAngle, arcAngle);
+
+  gxj_damage_add_clipped(sbuf, clip, x, y, x + width + 1, y + height + 1);
 }
 
 /**
@@ -574,7 +433,7 @@ gx_fill_arc(jint color, const jshort *clip,
              int startAngle, int arcAngle)
 {
   int lineStyle = (dotted?DOTTED:SOLID);
-  gxj_pixel_type pixelColor = GXJ_RGB24TORGB16(color);
+  gxj_pixel_type pixelColor = GXJ_RGB24TOPIXEL(color);
   gxj_screen_buffer screen_buffer;
   gxj_screen_buffer *sbuf = 
       gxj_get_image_screen_buffer_impl(dst, &screen_buffer, NULL);
@@ -584,6 +443,8 @@ gx_fill_arc(jint color, const jshort *clip,
 
   draw_arc(pixelColor, clip, sbuf, lineStyle, 
 	   x, y, width, height, 1, startAngle, arcAngle);
+
+  gxj_damage_add_clipped(sbuf, clip, x, y, x + width + 1, y + height + 1);
 }
 
 /**
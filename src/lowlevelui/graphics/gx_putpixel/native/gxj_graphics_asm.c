@@ -37,111 +37,6 @@
 extern "C" {
 #endif
 
-/**
- * fast pixel set - perform fast consecutive setting of pixel on raster
- *                  32-bits at a time
- * this function is similar to memset, with the exception that the value is
- * 16bit wide instead of 8bit, and that number of pixels is counter is in 
- * 16bits, instead of bytes/
- *
- * mem:              address of raster to fill
- * value:            uint16 color value to fill 
- * number_of_pixels: number of pixels to fill (total bytes set is 
- *                   2*number_of_pixels)
- */
-
-#if UNDER_ADS
-void fast_pixel_set(void* mem, int value, int number_of_pixels) {
-__asm {
-
-    mov     r0,mem
-    mov     r2,number_of_pixels
-    add     r2, r0, r2, lsl #1
-    add     r3, value, value, lsl #0x10
-
-    and     r1, r0, #0x3
-    cmp     r1,#0
-    strneh  r3, [r0],#2
-    subne   r2, r2, #1
-
-    sub     r1, r2, #0x1f
-
-    cmp     r0, r1
-    bge     loop2
-
-
-#if (__ARMCC_VERSION < 120848)
-    stmfd sp, {r4-r11}
-#endif
-
-    mov r4,  r3
-    mov r5,  r3
-    mov r6,  r3
-    mov r7,  r3
-    mov r8,  r3
-    mov r9,  r3
-    mov r10, r3
-    
-
-loop:
-    stmia r0!, {r3-r10}
-    cmp r0, r1
-    blt loop
-
-#if (__ARMCC_VERSION < 120848)
-    ldmfd sp, {r4-r11}
-#endif 
-
- loop2:
-    cmp    r0,r2;
-    strlth r3, [r0],#2
-    blt    loop2
-
-    } 
-}
-#elif defined(__GNUC__) && defined(ARM)
-// For more info on GNU/ARM inline-asm, see
-// http://www.ibiblio.org/gferg/ldp/GCC-Inline-Assembly-HOWTO.html
-// http://lists.arm.linux.org.uk/pipermail/linux-arm/2005-July/010365.html
-void fast_pixel_set(void* mem, int value, int number_of_pixels) {
-asm volatile(
-   "mov     r0, %0\n\t"   // %0 = mem
-   "mov     r2, %2\n\t"   // %2 = number_of_pixels
-   "add     r2, r0, r2, lsl #1\n\t"
-   "add     r3, %1, %1, lsl #0x10\n\t" // %1 = value
-
-   "and     r1, r0, #0x3\n\t"
-   "cmp     r1, #0\n\t"
-   "strneh  r3, [r0], #2\n\t"
-   "subne   r2, r2, #1\n\t"
-
-   "sub     r1, r2, #0x1f\n\t"
-   "cmp     r0, r1\n\t"
-   "bge     loop2\n\t"
-
-   // GCC doesn't allow us to use too many registers, so we can't
-   // use r7-r10 as in the ADS version.
-   "mov     r4,  r3\n\t"
-   "mov     r5,  r3\n\t"
-   "mov     r6,  r3\n\t"
-
-"\nloop:\n\t"
-   "stmia   r0!, {r3-r6}\n\t"
-   "stmia   r0!, {r3-r6}\n\t"
-   "cmp     r0, r1\n\t"
-   "blt     loop\n\t"
-
-"\nloop2:\n\t"
-   "cmp    r0, r2\n\t"
-   "strlth r3, [r0], #2\n\t"
-   "blt    loop2\n\t"
-  : 
-  : "r" (mem), "r" (value), "r" (number_of_pixels)
-  : "r0", "r1", "r2", "r3", "r4", "r5", "r6"
-  );
-}
-#endif
-
 /**
  * unclippedBlit - low level simple blit of 16bit pixels from src to dst
  * srcRaster - short* aligned pointer into source of pixels
@@ -25,56 +25,6 @@
 
 	AREA |.text|, CODE
 
-; void fast_pixel_set(void* mem, int value, int number_of_pixels);
-;
-; Perform fast consecutive setting of pixel on raster 32-bits at a time,
-; this function is similar to memset, with the exception that the value is
-; 16bit wide instead of 8bit, and that number of pixels is counter is in
-; 16bits, instead of bytes
-;
-; mem              - address of raster to fill
-; value            - uint16 color value to fill
-; number_of_pixels - number of pixels to fill
-;                    (total bytes set is 2*number_of_pixels)
-
-	EXPORT	fast_pixel_set
-fast_pixel_set PROC
-	add     r2, r0, r2, lsl #1
-	add     r3, r1, r1, lsl #0x10
-
-	and     r1, r0, #0x3
-	cmp     r1,#0
-	strneh  r3, [r0],#2
-	subne   r2, r2, #1
-
-	sub     r1, r2, #0x1f
-
-	cmp     r0, r1
-	bge     loop2
-
-        stmfd   sp!, {r4-r11}
-
-	mov     r4,  r3
-	mov     r5,  r3
-	mov     r6,  r3
-	mov     r7,  r3
-	mov     r8,  r3
-	mov     r9,  r3
-	mov     r10, r3
-
-loop
-        stmia   r0!, {r3-r10}
-	cmp     r0, r1
-	blt     loop
-        ldmfd   sp!, {r4-r11} 
-
-loop2
-	cmp     r0,r2;
-	strlth  r3, [r0],#2
-	blt     loop2
-
-        mov     pc, lr
-    
 	EXPORT fast_rect_8x8
 fast_rect_8x8 PROC           ; args (void*first_pixel, int ypitch, int pixel)
         stmfd   sp!, {r4-r5}
@@ -35,7 +35,9 @@
 #include <midp_logging.h>
 
 #include <gxapi_constants.h>
+#include <gxj_damage.h>
 
+#include "gxj_intern_blend.h"
 #include "gxj_intern_graphics.h"
 #include "gxj_intern_image.h"
 #include "gxj_intern_putpixel.h"
@@ -76,10 +78,13 @@ draw_image(gxj_screen_buffer *imageSBuf,
     if (x_dest >= clipX1 && y_dest >= clipY1 &&
        (x_dest + imageSBuf->width) <= clipX2 &&
        (y_dest + imageSBuf->height) <= clipY2) {
-      unclipped_blit(&destSBuf->pixelData[y_dest*destSBuf->width+x_dest],
-		    destSBuf->width<<1,
-		    &imageSBuf->pixelData[0], imageSBuf->width<<1,
-		    imageSBuf->height, imageSBuf->width<<1,destSBuf);
+      unclipped_blit((unsigned short *)
+                    &destSBuf->pixelData[y_dest*destSBuf->width+x_dest],
+		    destSBuf->width * GXJ_PIXEL_BYTES,
+		    (unsigned short *)&imageSBuf->pixelData[0],
+                    imageSBuf->width * GXJ_PIXEL_BYTES,
+		    imageSBuf->height, imageSBuf->width * GXJ_PIXEL_BYTES,
+                    destSBuf);
     } else {
       clipped_blit(destSBuf, x_dest, y_dest, imageSBuf, clip);
     }
@@ -89,6 +94,9 @@ draw_image(gxj_screen_buffer *imageSBuf,
 		     imageSBuf->width, imageSBuf->height,
 		     0, 0, 0);
   }
+
+  gxj_damage_add_clipped(destSBuf, clip, x_dest, y_dest,
+      x_dest + imageSBuf->width, y_dest + imageSBuf->height);
 }
 
 /**
@@ -122,6 +130,14 @@ draw_imageregion(gxj_screen_buffer *imageSBuf,
 
   copy_imageregion(imageSBuf, dstSBuf,
                   clip, x_dest, y_dest, width, height, x_src, y_src, transform);
+
+  if (transform & TRANSFORM_INVERTED_AXES) {
+    gxj_damage_add_clipped(dstSBuf, clip, x_dest, y_dest,
+        x_dest + height, y_dest + width);
+  } else {
+    gxj_damage_add_clipped(dstSBuf, clip, x_dest, y_dest,
+        x_dest + width, y_dest + height);
+  }
 }
 
 
@@ -131,8 +147,8 @@ clipped_blit(gxj_screen_buffer* dst, int dstX, int dstY, gxj_screen_buffer* src,
   int startX; int startY;   /* x,y into the dstRaster */
   int negY, negX;           /* x,y into the srcRaster */
   int diff;
-  unsigned short* srcRaster;
-  unsigned short* dstRaster;
+  gxj_pixel_type* srcRaster;
+  gxj_pixel_type* dstRaster;
   const jshort clipX1 = clip[0];
   const jshort clipY1 = clip[1];
   const jshort clipX2 = clip[2];
@@ -187,8 +203,9 @@ clipped_blit(gxj_screen_buffer* dst, int dstX, int dstY, gxj_screen_buffer* src,
   srcRaster = src->pixelData + (negY ? (negY   * src->width) : 0) + negX;
   dstRaster = dst->pixelData +         (startY * dst->width)      + startX;
 
-  unclipped_blit(dstRaster, dst->width<<1,
-		 srcRaster, src->width<<1, height, width<<1,dst);
+  unclipped_blit((unsigned short *)dstRaster, dst->width * GXJ_PIXEL_BYTES,
+		 (unsigned short *)srcRaster, src->width * GXJ_PIXEL_BYTES,
+		 height, width * GXJ_PIXEL_BYTES, dst);
 }
 
 
@@ -432,55 +449,27 @@ copy_imageregion(gxj_screen_buffer* src, gxj_screen_buffer* dest, const jshort *
         int rowsCopied;
         gxj_pixel_type* pDest = dest->pixelData + (y_dest * dest->width) + x_dest;
         gxj_pixel_type* pSrc = src->pixelData + (y_src * src->width) + x_src;
-        gxj_pixel_type* limit;
-        int destWidthDiff = dest->width - width;
-        int srcWidthDiff = src->width - width;
-        int r1, g1, b1, a2, a3, r2, b2, g2;
 
         if (src->alphaData != NULL) {
-            unsigned char *pSrcAlpha = src->alphaData + (y_src * src->width) + x_src;
+            gxj_alpha_type *pSrcAlpha = src->alphaData + (y_src * src->width) + x_src;
 
-            /* copy the source to the destination */
+            /* composite the source over the destination */
             for (rowsCopied = 0; rowsCopied < height; rowsCopied++) {
-                for (limit = pDest + width; pDest < limit; pDest++, pSrc++, pSrcAlpha++) {
-                    if ((*pSrcAlpha) == 0xFF) {
-                        CHECK_PTR_CLIP(dest, pDest);
-                        *pDest = *pSrc;
-                    }
-                    else if (*pSrcAlpha > 0x3) {
-                        r1 = (*pSrc >> 11);
-                        g1 = ((*pSrc >> 5) & 0x3F);
-                        b1 = (*pSrc & 0x1F);
-
-                        r2 = (*pDest >> 11);
-                        g2 = ((*pDest >> 5) & 0x3F);
-                        b2 = (*pDest & 0x1F);
-
-                        a2 = *pSrcAlpha >> 2;
-                        a3 = *pSrcAlpha >> 3;
-
-                        r1 = (r1 * a3 + r2 * (31 - a3)) >> 5;
-                        g1 = (g1 * a2 + g2 * (63 - a2)) >> 6;
-                        b1 = (b1 * a3 + b2 * (31 - a3)) >> 5;
-
-                        *pDest = (gxj_pixel_type)((r1 << 11) | (g1 << 5) | (b1));
-                    }
-                }
-
-                pDest += destWidthDiff;
-                pSrc += srcWidthDiff;
-                pSrcAlpha += srcWidthDiff;
+                CHECK_PTR_CLIP(dest, pDest);
+                gxj_blend_pixel_row(pDest, pSrc, pSrcAlpha, width);
+
+                pDest += dest->width;
+                pSrc += src->width;
+                pSrcAlpha += src->width;
             }
         } else {
             /* copy the source to the destination */
             for (rowsCopied = 0; rowsCopied < height; rowsCopied++) {
-                for (limit = pDest + width; pDest < limit; pDest++, pSrc++) {
-                    CHECK_PTR_CLIP(dest, pDest);
-                    *pDest = *pSrc;
-                }
+                CHECK_PTR_CLIP(dest, pDest);
+                memcpy(pDest, pSrc, width * sizeof(gxj_pixel_type));
 
-                pDest += destWidthDiff;
-                pSrc += srcWidthDiff;
+                pDest += dest->width;
+                pSrc += src->width;
             }
         }
     }
@@ -0,0 +1,87 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _GXJ_INTERN_BLEND_H_
+#define _GXJ_INTERN_BLEND_H_
+
+#include <gxj_putpixel.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ *
+ * Row kernels converting and alpha compositing pixels into the
+ * screen buffer. Each kernel handles one row of pixels, the callers
+ * walk the rows of the clipped area. Fully transparent runs are
+ * skipped and fully opaque runs are copied without blending.
+ */
+
+/**
+ * Divides a product of two 8-bit values by 255 without division,
+ * exact for any x in [0..0xFE01].
+ */
+#define GXJ_DIV255(x)  (((x) + ((x) >> 8) + 1) >> 8)
+
+/**
+ * Convert a row of ARGB8888 pixels to the screen pixel format
+ * ignoring the alpha channel.
+ *
+ * @param dst pointer to the first destination pixel
+ * @param src pointer to the first source pixel
+ * @param count number of pixels in the row
+ */
+void gxj_convert_argb_row(gxj_pixel_type *dst, const jint *src, int count);
+
+/**
+ * Composite a row of ARGB8888 pixels over the destination pixels
+ * using the source alpha.
+ *
+ * @param dst pointer to the first destination pixel
+ * @param src pointer to the first source pixel
+ * @param count number of pixels in the row
+ */
+void gxj_blend_argb_row(gxj_pixel_type *dst, const jint *src, int count);
+
+/**
+ * Composite a row of screen pixels with a separate 8-bit alpha
+ * plane over the destination pixels.
+ *
+ * @param dst pointer to the first destination pixel
+ * @param src pointer to the first source pixel
+ * @param alpha pointer to the alpha value of the first source pixel
+ * @param count number of pixels in the row
+ */
+void gxj_blend_pixel_row(gxj_pixel_type *dst, const gxj_pixel_type *src,
+                         const gxj_alpha_type *alpha, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GXJ_INTERN_BLEND_H_ */
@@ -54,4 +54,18 @@ typedef unsigned char* pfontbitmap;
  */
 extern pfontbitmap FontBitmaps[];
 
+/* Coverage (anti-aliased) font tables have one more header byte, */
+/* the number of bits per pixel: 4 or 8. Pixels are packed starting */
+/* from the most significant bits, 0 is background and the maximum */
+/* value is a fully covered pixel. */
+#define FONT_COVERAGE_BITS 8
+#define FONT_COVERAGE_DATA 9
+
+/* the 0-th element is the number of coverage tables, which may be 0;
+ * the parameters: width, height, ascent, descent, leading
+ * MUST be the same as in the FontBitmaps tables, characters not
+ * covered by any of these tables are drawn from FontBitmaps.
+ */
+extern pfontbitmap FontCoverage[];
+
 #endif /* _GXJ_INTERN_FONT_BITMAP_H_ */
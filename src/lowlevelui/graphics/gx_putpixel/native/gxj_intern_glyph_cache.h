@@ -0,0 +1,117 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _GXJ_INTERN_GLYPH_CACHE_H_
+#define _GXJ_INTERN_GLYPH_CACHE_H_
+
+#include <kni.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ *
+ * Cache of glyphs of the built-in bitmap font expanded to runs of
+ * foreground pixels, so that text drawing does not unpack the 1-bpp
+ * bitmap bit by bit on every draw.
+ *
+ * The runs of a glyph are stored line by line: a count byte followed
+ * by that many pairs of bytes, the x-offset of the run in the glyph
+ * and its length in pixels.
+ *
+ * Glyphs of the coverage font are cached the same way, except that
+ * each run is followed by the 8-bit coverage of its pixels, so that
+ * drawing an anti-aliased glyph is just blending of its runs.
+ */
+
+/**
+ * By default glyphs of the built-in font are cached, define to 0
+ * to unpack the font bitmap on every draw.
+ */
+#ifndef ENABLE_GXJ_GLYPH_CACHE
+#define ENABLE_GXJ_GLYPH_CACHE    1
+#endif
+
+/** Number of cached glyphs, must be a power of two */
+#ifndef GXJ_GLYPH_CACHE_SIZE
+#define GXJ_GLYPH_CACHE_SIZE      128
+#endif
+
+/** Size of the storage shared by the runs of all cached glyphs */
+#ifndef GXJ_GLYPH_CACHE_BYTES
+#define GXJ_GLYPH_CACHE_BYTES     8192
+#endif
+
+/**
+ * By default characters found in the coverage font are drawn
+ * anti-aliased, define to 0 to always use the 1-bit font.
+ * Requires ENABLE_GXJ_GLYPH_CACHE.
+ */
+#ifndef ENABLE_GXJ_AA_FONT
+#define ENABLE_GXJ_AA_FONT        1
+#endif
+
+/** Size of the storage shared by the runs of cached coverage glyphs */
+#ifndef GXJ_GLYPH_COVERAGE_BYTES
+#define GXJ_GLYPH_COVERAGE_BYTES  16384
+#endif
+
+/**
+ * Get the runs of foreground pixels of a character of the built-in
+ * font, expanding the glyph on a cache miss.
+ *
+ * @param c character code
+ * @return pointer to the runs of the first glyph line, or NULL if the
+ *   glyph can not be cached and the font bitmap must be used instead
+ */
+const unsigned char *gxj_glyph_cache_get(jchar c);
+
+/**
+ * Check whether a coverage font matching the built-in font is linked
+ * and anti-aliased drawing is enabled.
+ *
+ * @return KNI_TRUE if gxj_glyph_cache_get_coverage() may return glyphs
+ */
+jboolean gxj_glyph_cache_has_coverage(void);
+
+/**
+ * Get the runs and pixel coverage of a character of the coverage
+ * font, expanding the glyph on a cache miss.
+ *
+ * @param c character code
+ * @return pointer to the runs of the first glyph line, or NULL if the
+ *   character is not in the coverage font or can not be cached, and
+ *   the 1-bit font must be used instead
+ */
+const unsigned char *gxj_glyph_cache_get_coverage(jchar c);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _GXJ_INTERN_GLYPH_CACHE_H_ */
@@ -0,0 +1,92 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _GXJ_INTERN_SIMD_H_
+#define _GXJ_INTERN_SIMD_H_
+
+/**
+ * @file
+ *
+ * Compile time selection of vector instruction sets available
+ * to the putpixel kernels.
+ *
+ * GXJ_SIMD_SSE2  - SSE2 kernels are compiled
+ * GXJ_SIMD_AVX2  - AVX2 kernels are compiled
+ * GXJ_SIMD_PROBE - the CPU must be probed before SSE2/AVX2 kernels are
+ *                  used, kernels are marked with GXJ_SIMD_TARGET(isa)
+ * GXJ_SIMD_NEON  - NEON kernels are compiled and always usable
+ */
+
+/**
+ * By default use vector kernels where the compiler is able to
+ * produce them, define to 0 to force the portable kernels.
+ */
+#ifndef ENABLE_GXJ_SIMD
+#define ENABLE_GXJ_SIMD    1
+#endif
+
+#if ENABLE_GXJ_SIMD
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+    ((__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define GXJ_SIMD_SSE2      1
+#define GXJ_SIMD_AVX2      1
+#define GXJ_SIMD_PROBE     1
+#include <immintrin.h>
+#elif defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GXJ_SIMD_SSE2      1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define GXJ_SIMD_NEON      1
+#include <arm_neon.h>
+#endif
+#endif /* ENABLE_GXJ_SIMD */
+
+#ifndef GXJ_SIMD_SSE2
+#define GXJ_SIMD_SSE2      0
+#endif
+#ifndef GXJ_SIMD_AVX2
+#define GXJ_SIMD_AVX2      0
+#endif
+#ifndef GXJ_SIMD_PROBE
+#define GXJ_SIMD_PROBE     0
+#endif
+#ifndef GXJ_SIMD_NEON
+#define GXJ_SIMD_NEON      0
+#endif
+
+#if GXJ_SIMD_PROBE
+#define GXJ_SIMD_TARGET(isa) __attribute__((target(isa)))
+#define GXJ_SIMD_HAS_SSE2()  (__builtin_cpu_init(), \
+                              __builtin_cpu_supports("sse2"))
+#define GXJ_SIMD_HAS_AVX2()  (__builtin_cpu_init(), \
+                              __builtin_cpu_supports("avx2"))
+#else
+#define GXJ_SIMD_TARGET(isa)
+#define GXJ_SIMD_HAS_SSE2()  GXJ_SIMD_SSE2
+#define GXJ_SIMD_HAS_AVX2()  GXJ_SIMD_AVX2
+#endif
+
+#endif /* _GXJ_INTERN_SIMD_H_ */
@@ -28,16 +28,11 @@
 #include <midpMalloc.h>
 #include <midp_logging.h>
 
+#include <gxj_span.h>
+
 #include "gxj_intern_putpixel.h"
 #include "gxj_intern_graphics.h"
 
-typedef struct _registers_4 {
-	unsigned int r0;
-	unsigned int r1;
-	unsigned int r2;
-	unsigned int r3;
-} registers_4;
-
 typedef struct _dotted_draw_state { /* the draw state */
     int solidcount; /* how many dots are drawn in the solid fragment */
     int emptycount; /* how many dots are skipped in the empty fragment */
@@ -161,7 +156,6 @@ primDrawVertLine(gxj_screen_buffer *sbuf, gxj_pixel_type color,
   int width = sbuf->width;
   int height = sbuf->height;
   int count;
-  gxj_pixel_type* pPtr;
 
     (void)x2;
 #if PRIM_CLIPPING
@@ -174,22 +168,10 @@ primDrawVertLine(gxj_screen_buffer *sbuf, gxj_pixel_type color,
     y1 = y2;
     count = -count;
   }
-		
-  pPtr = &(sbuf->pixelData[y1 * width + x1]);
-  while (count & ~0x7) {
-    CHECK_PTR_CLIP(sbuf,pPtr);
-    *pPtr = color; pPtr += width; *pPtr = color; pPtr += width;
-    *pPtr = color; pPtr += width; *pPtr = color; pPtr += width;
-    *pPtr = color; pPtr += width; *pPtr = color; pPtr += width;
-    *pPtr = color; pPtr += width;
-    *pPtr = color; CHECK_PTR_CLIP(sbuf,pPtr); pPtr += width;
-    count -= 8;
-  }
-  while (count >= 0) {
-    CHECK_PTR_CLIP(sbuf,pPtr);
-    *pPtr = color; pPtr += width;
-    count -= 1;
-  }
+
+  CHECK_XY_CLIP(sbuf, x1, y1); CHECK_XY_CLIP(sbuf, x1, y1 + count);
+  gxj_span_fill_vert(&(sbuf->pixelData[y1 * width + x1]), width,
+                     color, count + 1);
 }
 
 /**
@@ -200,47 +182,9 @@ static void
 primDrawHorzLine(gxj_screen_buffer *sbuf, gxj_pixel_type color,
     int x1, int y1, int x2, int y2) {
 
-#if 0  
-  int width = sbuf->width;
-  int height = sbuf->height;
-  int count;
-  gxj_pixel_type* pPtr;
-
-#if PRIM_CLIPPING
-  if ((y1 < 0) || (y1 >= height))
-    return;
-  x1 = (x1 < 0) ? 0 : ((x1 >= width) ? width-1 : x1);
-  x2 = (x2 < 0) ? 0 : ((x2 >= width) ? width-1 : x2);
-#endif
-  if ((count=x2-x1) < 0) {
-    x1 = x2;
-    count = -count;
-  }
-		
-  pPtr = &(sbuf->pixelData[y1 * width + x1]);
-  while (count & ~0x7) {
-    CHECK_PTR_CLIP(sbuf,pPtr);
-    *pPtr = color; pPtr += 1; *pPtr = color; pPtr += 1;
-    *pPtr = color; pPtr += 1; *pPtr = color; pPtr += 1;
-    *pPtr = color; pPtr += 1; *pPtr = color; pPtr += 1;
-    *pPtr = color; pPtr += 1;
-    *pPtr = color; CHECK_PTR_CLIP(sbuf,pPtr); pPtr += 1;
-    count -= 8;
-  }
-  while (count >= 0) {
-    CHECK_PTR_CLIP(sbuf,pPtr);
-    *pPtr = color; pPtr += 1;
-    count -= 1;
-  }
-#else
   int width = sbuf->width;
   int height = sbuf->height;
   int count;
-  gxj_pixel_type* pPtr;
-  unsigned int c = ((unsigned int)color) << 16 | ((unsigned int)color);
-  jlong lcol = ((jlong) c) << 32 | ((jlong) c);
-  registers_4 regs;
-  regs.r0 = regs.r1 = regs.r2 = regs.r3 = c;
 
     (void)y2;
 
@@ -250,49 +194,14 @@ primDrawHorzLine(gxj_screen_buffer *sbuf, gxj_pixel_type color,
   x1 = (x1 < 0) ? 0 : ((x1 >= width) ? width-1 : x1);
   x2 = (x2 < 0) ? 0 : ((x2 >= width) ? width-1 : x2);
 #endif
-  y1 *= width;
   if ((count=x2-x1) < 0) {
     x1 = x2;
     count = -count;
   }
-  pPtr = &(sbuf->pixelData[y1 + x1]);
-  if (((unsigned int)pPtr & 0x3) && (count > 0)) {
-    CHECK_PTR_CLIP(sbuf,pPtr);
-    *pPtr++ = color;
-    --count;
-  }
-
-  while (count >= 16) {
-    CHECK_LLPTR_CLIP(sbuf,pPtr);
-    *((registers_4 *)pPtr) = regs;
-    pPtr += 8;
-    CHECK_LLPTR_CLIP(sbuf,pPtr);
-    *((registers_4 *)pPtr) = regs;
-    pPtr += 8;
-    count -= 16;
-  }
-  if (count >= 8) {
-    CHECK_LLPTR_CLIP(sbuf,pPtr);
-    *((registers_4 *)pPtr) = regs;
-    pPtr += 8;
-    count -= 8;
-  }
-  if (count >= 4) {
-    CHECK_LLPTR_CLIP(sbuf,pPtr);
-    *((jlong *)pPtr) = lcol;
-    pPtr += 4;
-    count -= 4;
-  }
-  while (count >= 0) {
-    CHECK_PTR_CLIP(sbuf,pPtr);
-    *pPtr = color; pPtr += 1;
-    count -= 1;
-  }
-#endif
-}
-
-
 
+  CHECK_XY_CLIP(sbuf, x1, y1); CHECK_XY_CLIP(sbuf, x1 + count, y1);
+  gxj_span_fill(&(sbuf->pixelData[y1 * width + x1]), color, count + 1);
+}
 
 /**
  * draw dotted line pixels from (x1,y1) through (x1,y2)
@@ -856,111 +765,21 @@ static void
 primDrawFilledRect(gxj_screen_buffer *sbuf, gxj_pixel_type color,
     int x1, int y1, int x2, int y2) {
 
-#if 0  
     int width = sbuf->width;
     int height = sbuf->height;
-    int count;
-    gxj_pixel_type* pPtr;
-    gxj_pixel_type* lPtr;
 
 #if PRIM_CLIPPING
-    x1 = (x1 < 0) ? 0 : ((x1 > width) ? width : x1);
-    x2 = (x2 < 0) ? 0 : ((x2 > width) ? width : x2);
     y1 = (y1 < 0) ? 0 : ((y1 > height) ? height : y1);
     y2 = (y2 < 0) ? 0 : ((y2 > height) ? height : y2);
-#endif
-    if ((count=x2-x1) < 0) {
-      SWAP(x2, x1);
-      count = -count;
-    }
-		
-    pPtr = &(sbuf->pixelData[y1 * width + x1]);
-    for (lPtr = pPtr; y1 < y2; y1++) {
-      while (count & ~0x7) {
-        CHECK_PTR_CLIP(sbuf,pPtr);
-        *pPtr = color; pPtr += 1; *pPtr = color; pPtr += 1;
-        *pPtr = color; pPtr += 1; *pPtr = color; pPtr += 1;
-        *pPtr = color; pPtr += 1; *pPtr = color; pPtr += 1;
-        *pPtr = color; pPtr += 1;
-        *pPtr = color; CHECK_PTR_CLIP(sbuf,pPtr); pPtr += 1;
-        count -= 8;
-      }
-      while (count > 0) {
-        CHECK_PTR_CLIP(sbuf,pPtr);
-        *pPtr = color; pPtr += 1;
-        count -= 1;
-      }
-      lPtr += width;
-      count = x2 - x1;
-      pPtr = lPtr;
-    }
-#else
-    int width = sbuf->width;
-    int height = sbuf->height;
-    int count;
-    gxj_pixel_type* pPtr;
-    gxj_pixel_type* lPtr;
-    registers_4	regs;
-
-	unsigned int c = ((unsigned int)color) << 16 | ((unsigned int)color);
-    jlong lcol = ((jlong) c) << 32 | ((jlong) c);
-	regs.r0 = regs.r1 = regs.r2 = regs.r3 = c;
-
-#if PRIM_CLIPPING
-    y1 = (y1 < 0) ? 0 : ((y1 > height) ? height : y1);
-    y2 = (y2 < 0) ? 0 : ((y2 > height) ? height : y2);
-#endif
-    pPtr = &(sbuf->pixelData[y1 * width]);
-#if PRIM_CLIPPING
     x1 = (x1 < 0) ? 0 : ((x1 > width) ? width : x1);
     x2 = (x2 < 0) ? 0 : ((x2 > width) ? width : x2);
 #endif
-    if ((count=x2-x1) < 0) {
+    if (x2 < x1) {
       SWAP(x2, x1);
-      count = -count;
-    }
-    pPtr += x1;
-    if (x1 == 0 && x2 == (width)) {
-      count = width*(y2-y1);
-      y2 = y1+1;
-    }
-    for (lPtr = pPtr; y1 < y2; y1++) {
-      if (((unsigned int)pPtr & 0x3) && (count > 0)) {
-        CHECK_PTR_CLIP(sbuf,pPtr);
-        *pPtr++ = color;
-        --count;
-      }
-      while (count >= 16) {
-        CHECK_LLPTR_CLIP(sbuf,pPtr);
-        *((registers_4 *)pPtr) = regs;
-		pPtr += 8;
-		CHECK_LLPTR_CLIP(sbuf,pPtr);
-		*((registers_4 *)pPtr) = regs;
-		pPtr += 8;
-        count -= 16;
-      }
-      if (count >= 8) {
-        CHECK_LLPTR_CLIP(sbuf,pPtr);
-        *((registers_4 *)pPtr) = regs;
-        pPtr += 8;
-        count -= 8;
-      }
-      if (count >= 4) {
-        CHECK_LLPTR_CLIP(sbuf,pPtr);
-        *((jlong *)pPtr) = lcol;
-        pPtr += 4;
-        count -= 4;
-      }
-      while (count > 0) {
-        CHECK_PTR_CLIP(sbuf,pPtr);
-        *pPtr++ = color;
-        count -= 1;
-      }
-      lPtr += width;
-      count = x2 - x1;
-      pPtr = lPtr;
     }
-#endif
+
+    gxj_span_fill_rect(&(sbuf->pixelData[y1 * width + x1]), width,
+                       color, x2 - x1, y2 - y1);
 }
 
 static void
@@ -0,0 +1,423 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * Cache blocked rotated copying of pixel areas with run-time
+ * selection of the vector transpose kernels supported by the CPU.
+ */
+
+#include <string.h>
+#include <kni.h>
+#include <midp_logging.h>
+
+#include <gxj_rotate.h>
+
+#include "gxj_intern_simd.h"
+
+/** Side of a pixel block transposed at once */
+#define ROTATE_BLOCK 8
+
+/** Side of a tile of blocks kept in the data cache */
+#define ROTATE_TILE  32
+
+/**
+ * Signature of transposing kernels. Line k of the destination gets
+ * column k of the source block, line pointers advance by the steps
+ * given in pixels, which may be negative to mirror the block.
+ */
+typedef void (*rotate_block_func)(const void *src, int srcStep,
+                                  void *dst, int dstStep);
+
+/** Transpose a block of 16-bit pixels of any size */
+static void
+transpose16_scalar(const void *src, int srcStep, void *dst, int dstStep,
+                   int cols, int rows) {
+    const unsigned short *s = (const unsigned short *)src;
+    unsigned short *d = (unsigned short *)dst;
+    int c, r;
+
+    for (c = 0; c < cols; c++, d += dstStep) {
+        for (r = 0; r < rows; r++) {
+            d[r] = s[r * srcStep + c];
+        }
+    }
+}
+
+/** Transpose a block of 32-bit pixels of any size */
+static void
+transpose32_scalar(const void *src, int srcStep, void *dst, int dstStep,
+                   int cols, int rows) {
+    const unsigned int *s = (const unsigned int *)src;
+    unsigned int *d = (unsigned int *)dst;
+    int c, r;
+
+    for (c = 0; c < cols; c++, d += dstStep) {
+        for (r = 0; r < rows; r++) {
+            d[r] = s[r * srcStep + c];
+        }
+    }
+}
+
+/** Portable 8x8 kernel for 16-bit pixels */
+static void
+block16_scalar(const void *src, int srcStep, void *dst, int dstStep) {
+    transpose16_scalar(src, srcStep, dst, dstStep,
+                       ROTATE_BLOCK, ROTATE_BLOCK);
+}
+
+/** Portable 8x8 kernel for 32-bit pixels */
+static void
+block32_scalar(const void *src, int srcStep, void *dst, int dstStep) {
+    transpose32_scalar(src, srcStep, dst, dstStep,
+                       ROTATE_BLOCK, ROTATE_BLOCK);
+}
+
+#if GXJ_SIMD_SSE2
+/**
+ * SSE2 kernel for 16-bit pixels: eight lines of eight pixels are
+ * transposed in registers by three rounds of interleaving.
+ */
+GXJ_SIMD_TARGET("sse2") static void
+block16_sse2(const void *src, int srcStep, void *dst, int dstStep) {
+    const unsigned short *s = (const unsigned short *)src;
+    unsigned short *d = (unsigned short *)dst;
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    a0 = _mm_loadu_si128((const __m128i *)(s));
+    a1 = _mm_loadu_si128((const __m128i *)(s + srcStep));
+    a2 = _mm_loadu_si128((const __m128i *)(s + 2 * srcStep));
+    a3 = _mm_loadu_si128((const __m128i *)(s + 3 * srcStep));
+    a4 = _mm_loadu_si128((const __m128i *)(s + 4 * srcStep));
+    a5 = _mm_loadu_si128((const __m128i *)(s + 5 * srcStep));
+    a6 = _mm_loadu_si128((const __m128i *)(s + 6 * srcStep));
+    a7 = _mm_loadu_si128((const __m128i *)(s + 7 * srcStep));
+
+    /* Pairs of lines */
+    b0 = _mm_unpacklo_epi16(a0, a1);
+    b1 = _mm_unpackhi_epi16(a0, a1);
+    b2 = _mm_unpacklo_epi16(a2, a3);
+    b3 = _mm_unpackhi_epi16(a2, a3);
+    b4 = _mm_unpacklo_epi16(a4, a5);
+    b5 = _mm_unpackhi_epi16(a4, a5);
+    b6 = _mm_unpacklo_epi16(a6, a7);
+    b7 = _mm_unpackhi_epi16(a6, a7);
+
+    /* Quads of lines, two columns per register */
+    a0 = _mm_unpacklo_epi32(b0, b2);
+    a1 = _mm_unpackhi_epi32(b0, b2);
+    a2 = _mm_unpacklo_epi32(b1, b3);
+    a3 = _mm_unpackhi_epi32(b1, b3);
+    a4 = _mm_unpacklo_epi32(b4, b6);
+    a5 = _mm_unpackhi_epi32(b4, b6);
+    a6 = _mm_unpacklo_epi32(b5, b7);
+    a7 = _mm_unpackhi_epi32(b5, b7);
+
+    /* Whole columns */
+    _mm_storeu_si128((__m128i *)(d), _mm_unpacklo_epi64(a0, a4));
+    _mm_storeu_si128((__m128i *)(d + dstStep), _mm_unpackhi_epi64(a0, a4));
+    _mm_storeu_si128((__m128i *)(d + 2 * dstStep), _mm_unpacklo_epi64(a1, a5));
+    _mm_storeu_si128((__m128i *)(d + 3 * dstStep), _mm_unpackhi_epi64(a1, a5));
+    _mm_storeu_si128((__m128i *)(d + 4 * dstStep), _mm_unpacklo_epi64(a2, a6));
+    _mm_storeu_si128((__m128i *)(d + 5 * dstStep), _mm_unpackhi_epi64(a2, a6));
+    _mm_storeu_si128((__m128i *)(d + 6 * dstStep), _mm_unpacklo_epi64(a3, a7));
+    _mm_storeu_si128((__m128i *)(d + 7 * dstStep), _mm_unpackhi_epi64(a3, a7));
+}
+
+/** SSE2 transpose of a 4x4 block of 32-bit pixels */
+GXJ_SIMD_TARGET("sse2") static void
+block32x4_sse2(const unsigned int *s, int srcStep,
+               unsigned int *d, int dstStep) {
+    __m128i a0, a1, a2, a3;
+    __m128i b0, b1, b2, b3;
+
+    a0 = _mm_loadu_si128((const __m128i *)(s));
+    a1 = _mm_loadu_si128((const __m128i *)(s + srcStep));
+    a2 = _mm_loadu_si128((const __m128i *)(s + 2 * srcStep));
+    a3 = _mm_loadu_si128((const __m128i *)(s + 3 * srcStep));
+
+    b0 = _mm_unpacklo_epi32(a0, a1);
+    b1 = _mm_unpackhi_epi32(a0, a1);
+    b2 = _mm_unpacklo_epi32(a2, a3);
+    b3 = _mm_unpackhi_epi32(a2, a3);
+
+    _mm_storeu_si128((__m128i *)(d), _mm_unpacklo_epi64(b0, b2));
+    _mm_storeu_si128((__m128i *)(d + dstStep), _mm_unpackhi_epi64(b0, b2));
+    _mm_storeu_si128((__m128i *)(d + 2 * dstStep), _mm_unpacklo_epi64(b1, b3));
+    _mm_storeu_si128((__m128i *)(d + 3 * dstStep), _mm_unpackhi_epi64(b1, b3));
+}
+
+/**
+ * SSE2 kernel for 32-bit pixels: the 8x8 block is transposed as
+ * four 4x4 quarters, each fitting one register per line.
+ */
+GXJ_SIMD_TARGET("sse2") static void
+block32_sse2(const void *src, int srcStep, void *dst, int dstStep) {
+    const unsigned int *s = (const unsigned int *)src;
+    unsigned int *d = (unsigned int *)dst;
+
+    block32x4_sse2(s, srcStep, d, dstStep);
+    block32x4_sse2(s + 4, srcStep, d + 4 * dstStep, dstStep);
+    block32x4_sse2(s + 4 * srcStep, srcStep, d + 4, dstStep);
+    block32x4_sse2(s + 4 * srcStep + 4, srcStep, d + 4 * dstStep + 4, dstStep);
+}
+#endif /* GXJ_SIMD_SSE2 */
+
+#if GXJ_SIMD_NEON
+/** Join the low or high halves of two 32-bit vectors as 16-bit lanes */
+#define NEON_JOIN_LOW(a, b)  vcombine_u16(                   \
+    vreinterpret_u16_u32(vget_low_u32(a)),                   \
+    vreinterpret_u16_u32(vget_low_u32(b)))
+#define NEON_JOIN_HIGH(a, b) vcombine_u16(                   \
+    vreinterpret_u16_u32(vget_high_u32(a)),                  \
+    vreinterpret_u16_u32(vget_high_u32(b)))
+
+/**
+ * NEON kernel for 16-bit pixels: 16-bit and 32-bit lane transposes
+ * followed by swapping the register halves.
+ */
+static void
+block16_neon(const void *src, int srcStep, void *dst, int dstStep) {
+    const uint16_t *s = (const uint16_t *)src;
+    uint16_t *d = (uint16_t *)dst;
+    uint16x8x2_t t01, t23, t45, t67;
+    uint32x4x2_t u02, u13, u46, u57;
+
+    t01 = vtrnq_u16(vld1q_u16(s), vld1q_u16(s + srcStep));
+    t23 = vtrnq_u16(vld1q_u16(s + 2 * srcStep), vld1q_u16(s + 3 * srcStep));
+    t45 = vtrnq_u16(vld1q_u16(s + 4 * srcStep), vld1q_u16(s + 5 * srcStep));
+    t67 = vtrnq_u16(vld1q_u16(s + 6 * srcStep), vld1q_u16(s + 7 * srcStep));
+
+    /* Columns 0/4 and 2/6 are in u02 and u46, 1/5 and 3/7 in u13, u57 */
+    u02 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[0]),
+                    vreinterpretq_u32_u16(t23.val[0]));
+    u13 = vtrnq_u32(vreinterpretq_u32_u16(t01.val[1]),
+                    vreinterpretq_u32_u16(t23.val[1]));
+    u46 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[0]),
+                    vreinterpretq_u32_u16(t67.val[0]));
+    u57 = vtrnq_u32(vreinterpretq_u32_u16(t45.val[1]),
+                    vreinterpretq_u32_u16(t67.val[1]));
+
+    vst1q_u16(d, NEON_JOIN_LOW(u02.val[0], u46.val[0]));
+    vst1q_u16(d + dstStep, NEON_JOIN_LOW(u13.val[0], u57.val[0]));
+    vst1q_u16(d + 2 * dstStep, NEON_JOIN_LOW(u02.val[1], u46.val[1]));
+    vst1q_u16(d + 3 * dstStep, NEON_JOIN_LOW(u13.val[1], u57.val[1]));
+    vst1q_u16(d + 4 * dstStep, NEON_JOIN_HIGH(u02.val[0], u46.val[0]));
+    vst1q_u16(d + 5 * dstStep, NEON_JOIN_HIGH(u13.val[0], u57.val[0]));
+    vst1q_u16(d + 6 * dstStep, NEON_JOIN_HIGH(u02.val[1], u46.val[1]));
+    vst1q_u16(d + 7 * dstStep, NEON_JOIN_HIGH(u13.val[1], u57.val[1]));
+}
+
+/** NEON transpose of a 4x4 block of 32-bit pixels */
+static void
+block32x4_neon(const uint32_t *s, int srcStep, uint32_t *d, int dstStep) {
+    uint32x4x2_t p01, p23;
+
+    p01 = vtrnq_u32(vld1q_u32(s), vld1q_u32(s + srcStep));
+    p23 = vtrnq_u32(vld1q_u32(s + 2 * srcStep), vld1q_u32(s + 3 * srcStep));
+
+    vst1q_u32(d, vcombine_u32(vget_low_u32(p01.val[0]),
+                              vget_low_u32(p23.val[0])));
+    vst1q_u32(d + dstStep, vcombine_u32(vget_low_u32(p01.val[1]),
+                                        vget_low_u32(p23.val[1])));
+    vst1q_u32(d + 2 * dstStep, vcombine_u32(vget_high_u32(p01.val[0]),
+                                            vget_high_u32(p23.val[0])));
+    vst1q_u32(d + 3 * dstStep, vcombine_u32(vget_high_u32(p01.val[1]),
+                                            vget_high_u32(p23.val[1])));
+}
+
+/** NEON kernel for 32-bit pixels, four 4x4 quarters */
+static void
+block32_neon(const void *src, int srcStep, void *dst, int dstStep) {
+    const uint32_t *s = (const uint32_t *)src;
+    uint32_t *d = (uint32_t *)dst;
+
+    block32x4_neon(s, srcStep, d, dstStep);
+    block32x4_neon(s + 4, srcStep, d + 4 * dstStep, dstStep);
+    block32x4_neon(s + 4 * srcStep, srcStep, d + 4, dstStep);
+    block32x4_neon(s + 4 * srcStep + 4, srcStep, d + 4 * dstStep + 4, dstStep);
+}
+#endif /* GXJ_SIMD_NEON */
+
+/**
+ * Currently selected 8x8 kernels, NULL until the CPU is probed.
+ * The selection is idempotent, so no locking is needed when several
+ * threads race.
+ */
+static rotate_block_func block16_impl = NULL;
+static rotate_block_func block32_impl = NULL;
+
+/** Probe the CPU and install the best transposing kernels */
+static void
+rotate_select() {
+    rotate_block_func impl16 = block16_scalar;
+    rotate_block_func impl32 = block32_scalar;
+
+#if GXJ_SIMD_SSE2
+    if (GXJ_SIMD_HAS_SSE2()) {
+        impl16 = block16_sse2;
+        impl32 = block32_sse2;
+    }
+#endif
+#if GXJ_SIMD_NEON
+    impl16 = block16_neon;
+    impl32 = block32_neon;
+#endif
+
+    REPORT_INFO1(LC_LOWUI, "gxj_rotate: using %s kernels\n",
+        (impl16 == block16_scalar) ? "scalar" :
+#if GXJ_SIMD_NEON
+        "NEON");
+#else
+        "SSE2");
+#endif
+
+    block32_impl = impl32;
+    block16_impl = impl16;
+}
+
+/**
+ * Transpose an area tile by tile. Line k of the destination gets
+ * column k of the source, line pointers advance by the steps given
+ * in pixels.
+ */
+static void
+transpose_area(const char *src, int srcStep, char *dst, int dstStep,
+               int cols, int rows, int pixelBytes) {
+    rotate_block_func block =
+        (pixelBytes == 2) ? block16_impl : block32_impl;
+    int it, jt, i, j, iEnd, jEnd;
+
+    for (jt = 0; jt < rows; jt += ROTATE_TILE) {
+        jEnd = (jt + ROTATE_TILE < rows) ? jt + ROTATE_TILE : rows;
+        for (it = 0; it < cols; it += ROTATE_TILE) {
+            iEnd = (it + ROTATE_TILE < cols) ? it + ROTATE_TILE : cols;
+            for (j = jt; j < jEnd; j += ROTATE_BLOCK) {
+                for (i = it; i < iEnd; i += ROTATE_BLOCK) {
+                    const char *s = src +
+                        ((long)j * srcStep + i) * pixelBytes;
+                    char *d = dst + ((long)i * dstStep + j) * pixelBytes;
+
+                    if (i + ROTATE_BLOCK <= cols &&
+                            j + ROTATE_BLOCK <= rows) {
+                        block(s, srcStep, d, dstStep);
+                    } else if (pixelBytes == 2) {
+                        transpose16_scalar(s, srcStep, d, dstStep,
+                            (cols - i < ROTATE_BLOCK) ?
+                                cols - i : ROTATE_BLOCK,
+                            (rows - j < ROTATE_BLOCK) ?
+                                rows - j : ROTATE_BLOCK);
+                    } else {
+                        transpose32_scalar(s, srcStep, d, dstStep,
+                            (cols - i < ROTATE_BLOCK) ?
+                                cols - i : ROTATE_BLOCK,
+                            (rows - j < ROTATE_BLOCK) ?
+                                rows - j : ROTATE_BLOCK);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Copy lines reversing the order of lines and of pixels in them.
+ */
+static void
+rotate_180(char *dst, int dstScanLength,
+           const char *src, int srcScanLength,
+           int width, int height, int pixelBytes) {
+    int i;
+
+    /* Start from the lower right pixel of the destination */
+    dst += ((long)(height - 1) * dstScanLength + width - 1) * pixelBytes;
+
+    for (; height > 0; height--) {
+        if (pixelBytes == 2) {
+            const unsigned short *s = (const unsigned short *)src;
+            unsigned short *d = (unsigned short *)dst;
+            for (i = 0; i < width; i++) {
+                *d-- = *s++;
+            }
+        } else {
+            const unsigned int *s = (const unsigned int *)src;
+            unsigned int *d = (unsigned int *)dst;
+            for (i = 0; i < width; i++) {
+                *d-- = *s++;
+            }
+        }
+        src += (long)srcScanLength * pixelBytes;
+        dst -= (long)dstScanLength * pixelBytes;
+    }
+}
+
+/**
+ * Copy a rectangular area of pixels rotating it.
+ */
+void
+gxj_rotate_rect(void *dst, int dstScanLength,
+                const void *src, int srcScanLength,
+                int width, int height, int pixelBytes, int rotation) {
+    const char *s = (const char *)src;
+    char *d = (char *)dst;
+
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    if (block16_impl == NULL || block32_impl == NULL) {
+        rotate_select();
+    }
+
+    switch (rotation) {
+    case GXJ_ROTATE_90:
+        /* Source column i becomes destination line width - 1 - i */
+        transpose_area(s, srcScanLength,
+            d + (long)(width - 1) * dstScanLength * pixelBytes,
+            -dstScanLength, width, height, pixelBytes);
+        break;
+
+    case GXJ_ROTATE_270:
+        /* Source line j becomes destination column height - 1 - j */
+        transpose_area(s + (long)(height - 1) * srcScanLength * pixelBytes,
+            -srcScanLength, d, dstScanLength, width, height, pixelBytes);
+        break;
+
+    case GXJ_ROTATE_180:
+        rotate_180(d, dstScanLength, s, srcScanLength,
+                   width, height, pixelBytes);
+        break;
+
+    default:
+        for (; height > 0; height--) {
+            memcpy(d, s, width * pixelBytes);
+            s += (long)srcScanLength * pixelBytes;
+            d += (long)dstScanLength * pixelBytes;
+        }
+        break;
+    }
+}
@@ -30,6 +30,7 @@
 #include <midp_logging.h>
 
 #include "gxj_screen_buffer.h"
+#include "gxj_damage.h"
 
 /**
  * Initialize screen buffer for a screen with specified demension,
@@ -46,6 +47,7 @@ MIDPError gxj_init_screen_buffer(int width, int height) {
     gxj_system_screen_buffer.width = width;
     gxj_system_screen_buffer.height = height;
     gxj_system_screen_buffer.alphaData = NULL;
+    gxj_damage_invalidate();
 
     gxj_system_screen_buffer.pixelData =
         (gxj_pixel_type *)midpMalloc(size);
@@ -99,6 +101,7 @@ void gxj_reset_screen_buffer() {
 
         memset(gxj_system_screen_buffer.pixelData, 0, size);
     }
+    gxj_damage_invalidate();
 }
 
 /**
@@ -192,6 +195,7 @@ void gxj_rotate_screen_buffer(jboolean keepContent) {
     height = gxj_system_screen_buffer.height;
     gxj_system_screen_buffer.height = gxj_system_screen_buffer.width;
     gxj_system_screen_buffer.width = height;
+    gxj_damage_invalidate();
 }
 
 /** Free memory allocated for screen buffer */
@@ -0,0 +1,336 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ * Solid span kernels of the putpixel rasterizer with run-time
+ * selection of the vector implementation supported by the CPU.
+ */
+
+#include <stddef.h>
+#include <kni.h>
+#include <midp_logging.h>
+
+#include <gxj_span.h>
+
+#include "gxj_intern_simd.h"
+
+/** Signature of horizontal span kernels */
+typedef void (*span_fill_func)(gxj_pixel_type *dst,
+                               gxj_pixel_type color, int count);
+
+/** Pixels needed before a vector loop pays back its alignment prologue */
+#define SPAN_VECTOR_THRESHOLD 16
+
+/** Pixels in a 128-bit vector */
+#define SPAN_VECTOR_PIXELS (16 / GXJ_PIXEL_BYTES)
+
+#if GXJ_PIXEL_BYTES == 2
+/**
+ * Portable kernel: aligns the destination to a machine word and then
+ * stores four words per iteration.
+ */
+static void
+span_fill_scalar(gxj_pixel_type *dst, gxj_pixel_type color, int count) {
+    unsigned int c = ((unsigned int)color) << 16 | ((unsigned int)color);
+    unsigned int *wPtr;
+
+    if (((unsigned long)dst & 0x3) && (count > 0)) {
+        *dst++ = color;
+        --count;
+    }
+
+    wPtr = (unsigned int *)dst;
+    while (count >= 8) {
+        wPtr[0] = c; wPtr[1] = c; wPtr[2] = c; wPtr[3] = c;
+        wPtr += 4;
+        count -= 8;
+    }
+    while (count >= 2) {
+        *wPtr++ = c;
+        count -= 2;
+    }
+
+    if (count > 0) {
+        *(gxj_pixel_type *)wPtr = color;
+    }
+}
+#else
+/**
+ * Portable kernel: pixels are machine words already, so the stores
+ * are just unrolled.
+ */
+static void
+span_fill_scalar(gxj_pixel_type *dst, gxj_pixel_type color, int count) {
+    while (count >= 4) {
+        dst[0] = color; dst[1] = color; dst[2] = color; dst[3] = color;
+        dst += 4;
+        count -= 4;
+    }
+    while (count-- > 0) {
+        *dst++ = color;
+    }
+}
+#endif
+
+#if GXJ_SIMD_SSE2
+/**
+ * SSE2 kernel: aligns the destination to 16 bytes and stores
+ * four vectors per iteration.
+ */
+GXJ_SIMD_TARGET("sse2") static void
+span_fill_sse2(gxj_pixel_type *dst, gxj_pixel_type color, int count) {
+    __m128i v;
+
+    if (count < SPAN_VECTOR_THRESHOLD) {
+        span_fill_scalar(dst, color, count);
+        return;
+    }
+
+#if GXJ_PIXEL_BYTES == 2
+    v = _mm_set1_epi16((short)color);
+#else
+    v = _mm_set1_epi32((int)color);
+#endif
+    while ((unsigned long)dst & 0xF) {
+        *dst++ = color;
+        --count;
+    }
+    while (count >= 4 * SPAN_VECTOR_PIXELS) {
+        _mm_store_si128((__m128i *)dst, v);
+        _mm_store_si128((__m128i *)(dst + SPAN_VECTOR_PIXELS), v);
+        _mm_store_si128((__m128i *)(dst + 2 * SPAN_VECTOR_PIXELS), v);
+        _mm_store_si128((__m128i *)(dst + 3 * SPAN_VECTOR_PIXELS), v);
+        dst += 4 * SPAN_VECTOR_PIXELS;
+        count -= 4 * SPAN_VECTOR_PIXELS;
+    }
+    while (count >= SPAN_VECTOR_PIXELS) {
+        _mm_store_si128((__m128i *)dst, v);
+        dst += SPAN_VECTOR_PIXELS;
+        count -= SPAN_VECTOR_PIXELS;
+    }
+    while (count-- > 0) {
+        *dst++ = color;
+    }
+}
+#endif /* GXJ_SIMD_SSE2 */
+
+#if GXJ_SIMD_AVX2
+/**
+ * AVX2 kernel: aligns the destination to 32 bytes and stores
+ * four vectors per iteration.
+ */
+GXJ_SIMD_TARGET("avx2") static void
+span_fill_avx2(gxj_pixel_type *dst, gxj_pixel_type color, int count) {
+    __m256i v;
+
+    if (count < 2 * SPAN_VECTOR_THRESHOLD) {
+        span_fill_sse2(dst, color, count);
+        return;
+    }
+
+#if GXJ_PIXEL_BYTES == 2
+    v = _mm256_set1_epi16((short)color);
+#else
+    v = _mm256_set1_epi32((int)color);
+#endif
+    while ((unsigned long)dst & 0x1F) {
+        *dst++ = color;
+        --count;
+    }
+    while (count >= 8 * SPAN_VECTOR_PIXELS) {
+        _mm256_store_si256((__m256i *)dst, v);
+        _mm256_store_si256((__m256i *)(dst + 2 * SPAN_VECTOR_PIXELS), v);
+        _mm256_store_si256((__m256i *)(dst + 4 * SPAN_VECTOR_PIXELS), v);
+        _mm256_store_si256((__m256i *)(dst + 6 * SPAN_VECTOR_PIXELS), v);
+        dst += 8 * SPAN_VECTOR_PIXELS;
+        count -= 8 * SPAN_VECTOR_PIXELS;
+    }
+    while (count >= 2 * SPAN_VECTOR_PIXELS) {
+        _mm256_store_si256((__m256i *)dst, v);
+        dst += 2 * SPAN_VECTOR_PIXELS;
+        count -= 2 * SPAN_VECTOR_PIXELS;
+    }
+    /* Finish the tail shorter than one vector */
+    if (count > 0) {
+        span_fill_scalar(dst, color, count);
+    }
+}
+#endif /* GXJ_SIMD_AVX2 */
+
+#if GXJ_SIMD_NEON
+#if GXJ_PIXEL_BYTES == 2
+typedef uint16x8_t span_vector;
+#define SPAN_NEON_DUP(c)       vdupq_n_u16(c)
+#define SPAN_NEON_STORE(p, v)  vst1q_u16((p), (v))
+#else
+typedef uint32x4_t span_vector;
+#define SPAN_NEON_DUP(c)       vdupq_n_u32(c)
+#define SPAN_NEON_STORE(p, v)  vst1q_u32((p), (v))
+#endif
+
+/**
+ * NEON kernel: aligns the destination to 16 bytes and stores
+ * four vectors per iteration.
+ */
+static void
+span_fill_neon(gxj_pixel_type *dst, gxj_pixel_type color, int count) {
+    span_vector v;
+
+    if (count < SPAN_VECTOR_THRESHOLD) {
+        span_fill_scalar(dst, color, count);
+        return;
+    }
+
+    v = SPAN_NEON_DUP(color);
+    while ((unsigned long)dst & 0xF) {
+        *dst++ = color;
+        --count;
+    }
+    while (count >= 4 * SPAN_VECTOR_PIXELS) {
+        SPAN_NEON_STORE(dst, v);
+        SPAN_NEON_STORE(dst + SPAN_VECTOR_PIXELS, v);
+        SPAN_NEON_STORE(dst + 2 * SPAN_VECTOR_PIXELS, v);
+        SPAN_NEON_STORE(dst + 3 * SPAN_VECTOR_PIXELS, v);
+        dst += 4 * SPAN_VECTOR_PIXELS;
+        count -= 4 * SPAN_VECTOR_PIXELS;
+    }
+    while (count >= SPAN_VECTOR_PIXELS) {
+        SPAN_NEON_STORE(dst, v);
+        dst += SPAN_VECTOR_PIXELS;
+        count -= SPAN_VECTOR_PIXELS;
+    }
+    while (count-- > 0) {
+        *dst++ = color;
+    }
+}
+#endif /* GXJ_SIMD_NEON */
+
+static void
+span_fill_select(gxj_pixel_type *dst, gxj_pixel_type color, int count);
+
+/**
+ * Currently selected horizontal span kernel. It initially refers to
+ * the selector which replaces it on the first call. The selection
+ * is idempotent, so no locking is needed when several threads race.
+ */
+static span_fill_func span_fill_impl = span_fill_select;
+
+/** Probe the CPU and install the best horizontal span kernel */
+static void
+span_fill_select(gxj_pixel_type *dst, gxj_pixel_type color, int count) {
+    span_fill_func impl = span_fill_scalar;
+
+#if GXJ_SIMD_AVX2
+    if (GXJ_SIMD_HAS_AVX2()) {
+        impl = span_fill_avx2;
+    } else
+#endif
+#if GXJ_SIMD_SSE2
+    if (GXJ_SIMD_HAS_SSE2()) {
+        impl = span_fill_sse2;
+    }
+#endif
+#if GXJ_SIMD_NEON
+    impl = span_fill_neon;
+#endif
+
+    REPORT_INFO1(LC_LOWUI, "gxj_span: using %s kernel\n",
+        (impl == span_fill_scalar) ? "scalar" :
+#if GXJ_SIMD_AVX2
+        (impl == span_fill_avx2) ? "AVX2" :
+#endif
+#if GXJ_SIMD_NEON
+        (impl == span_fill_neon) ? "NEON" :
+#endif
+        "SSE2");
+
+    span_fill_impl = impl;
+    impl(dst, color, count);
+}
+
+/**
+ * Fill consecutive pixels with one color.
+ */
+void
+gxj_span_fill(gxj_pixel_type *dst, gxj_pixel_type color, int count) {
+    if (count > 0) {
+        span_fill_impl(dst, color, count);
+    }
+}
+
+/**
+ * Fill a column of pixels with one color. There is nothing to
+ * vectorize in a column, so the loop is just unrolled.
+ */
+void
+gxj_span_fill_vert(gxj_pixel_type *dst, int scanLength,
+                   gxj_pixel_type color, int count) {
+    while (count >= 8) {
+        dst[0] = color;
+        dst[scanLength] = color;
+        dst[2 * scanLength] = color;
+        dst[3 * scanLength] = color;
+        dst += 4 * scanLength;
+        dst[0] = color;
+        dst[scanLength] = color;
+        dst[2 * scanLength] = color;
+        dst[3 * scanLength] = color;
+        dst += 4 * scanLength;
+        count -= 8;
+    }
+    while (count-- > 0) {
+        *dst = color;
+        dst += scanLength;
+    }
+}
+
+/**
+ * Fill a rectangular area of pixels with one color.
+ */
+void
+gxj_span_fill_rect(gxj_pixel_type *dst, int scanLength,
+                   gxj_pixel_type color, int width, int height) {
+    span_fill_func impl;
+
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    if (width == scanLength) {
+        /* Rows are contiguous, fill them as a single span */
+        span_fill_impl(dst, color, width * height);
+        return;
+    }
+
+    impl = span_fill_impl;
+    for (; height > 0; height--) {
+        impl(dst, color, width);
+        /* The selector may have replaced itself on the first row */
+        impl = span_fill_impl;
+        dst += scanLength;
+    }
+}
@@ -31,10 +31,14 @@
 
 #include <gxapi_constants.h>
 #include <gxjport_text.h>
+#include <gxj_damage.h>
+#include <gxj_span.h>
 
 #include "gxj_intern_graphics.h"
+#include "gxj_intern_blend.h"
 #include "gxj_intern_putpixel.h"
 #include "gxj_intern_font_bitmap.h"
+#include "gxj_intern_glyph_cache.h"
 
 /** Text output directions */
 #define LEFT_TO_RIGHT    1
@@ -212,6 +216,133 @@ static void drawChar(gxj_screen_buffer *sbuf, jchar c0,
 #endif
 }
 
+/** Runs this long and longer are filled with the span kernels */
+#define GLYPH_SPAN_THRESHOLD 16
+
+/**
+ * Draw a part of a glyph from its cached runs of foreground pixels.
+ * The parameters are the same as of drawChar().
+ *
+ * @param runs runs of the glyph got from gxj_glyph_cache_get()
+ */
+static void drawCharRuns(gxj_screen_buffer *sbuf, const unsigned char *runs,
+                         gxj_pixel_type pixelColor, int x, int y,
+                         int xSource, int ySource, int xLimit, int yLimit) {
+    int destWidth = sbuf->width;
+    /* Pixel of the destination matching the glyph origin column */
+    gxj_pixel_type *dest = sbuf->pixelData + y*destWidth + x - xSource;
+    int line, count, start, end;
+
+    /* Skip the clipped lines at the top */
+    for (line = 0; line < ySource; line++) {
+        runs += 1 + 2 * runs[0];
+    }
+
+    for (; line < yLimit; line++, dest += destWidth) {
+        for (count = *runs++; count > 0; count--, runs += 2) {
+            start = runs[0];
+            end = start + runs[1];
+            if (start < xSource) {
+                start = xSource;
+            }
+            if (end > xLimit) {
+                end = xLimit;
+            }
+            if (end - start >= GLYPH_SPAN_THRESHOLD) {
+                gxj_span_fill(dest + start, pixelColor, end - start);
+            } else {
+                for (; start < end; start++) {
+                    dest[start] = pixelColor;
+                }
+            }
+        }
+    }
+}
+
+/** Maximal width of a glyph drawn from coverage, wider fonts use bitmaps */
+#define GLYPH_COVERAGE_WIDTH 256
+
+/**
+ * Draw a part of a glyph from its cached runs of coverage, blending
+ * the text color over the destination. Fully covered pixels are just
+ * stored and uncovered ones skipped by the blend kernel.
+ * The parameters are the same as of drawChar().
+ *
+ * @param runs runs of the glyph got from gxj_glyph_cache_get_coverage()
+ * @param colorRow at least xLimit pixels of the text color
+ */
+static void drawCoverageRuns(gxj_screen_buffer *sbuf,
+                             const unsigned char *runs,
+                             const gxj_pixel_type *colorRow, int x, int y,
+                             int xSource, int ySource,
+                             int xLimit, int yLimit) {
+    int destWidth = sbuf->width;
+    /* Pixel of the destination matching the glyph origin column */
+    gxj_pixel_type *dest = sbuf->pixelData + y*destWidth + x - xSource;
+    int line, count, start, end, len;
+
+    /* Skip the clipped lines at the top */
+    for (line = 0; line < ySource; line++) {
+        for (count = *runs++; count > 0; count--) {
+            runs += 2 + runs[1];
+        }
+    }
+
+    for (; line < yLimit; line++, dest += destWidth) {
+        for (count = *runs++; count > 0; count--, runs += 2 + len) {
+            start = runs[0];
+            len = runs[1];
+            end = start + len;
+            if (start < xSource) {
+                start = xSource;
+            }
+            if (end > xLimit) {
+                end = xLimit;
+            }
+            if (start < end) {
+                gxj_blend_pixel_row(dest + start, colorRow,
+                                    runs + 2 + start - runs[0],
+                                    end - start);
+            }
+        }
+    }
+}
+
+/**
+ * Draw a part of a glyph, from the glyph cache if possible.
+ * Characters of the coverage font are drawn anti-aliased.
+ * The parameters are the same as of drawChar().
+ *
+ * @param colorRow GLYPH_COVERAGE_WIDTH pixels of the text color,
+ *   or NULL if there is no coverage font
+ */
+static void drawGlyph(gxj_screen_buffer *sbuf, jchar c0,
+		      gxj_pixel_type pixelColor,
+		      const gxj_pixel_type *colorRow, int x, int y,
+		      int xSource, int ySource, int xLimit, int yLimit,
+		      pfontbitmap* pfonts,
+		      int fontWidth, int fontHeight) {
+    const unsigned char *runs;
+
+    if (colorRow != NULL) {
+        runs = gxj_glyph_cache_get_coverage(c0);
+        if (runs != NULL) {
+            drawCoverageRuns(sbuf, runs, colorRow, x, y,
+                             xSource, ySource, xLimit, yLimit);
+            return;
+        }
+    }
+
+    runs = gxj_glyph_cache_get(c0);
+    if (runs != NULL) {
+        drawCharRuns(sbuf, runs, pixelColor, x, y,
+                     xSource, ySource, xLimit, yLimit);
+    } else {
+        drawChar(sbuf, c0, pixelColor, x, y, xSource, ySource,
+                 xLimit, yLimit, pfonts, fontWidth, fontHeight);
+    }
+}
+
 /*
  * @file
  *
@@ -260,6 +391,8 @@ drawString(jint pixel, const jshort *clip,
     int fontDescent;
     int fontLeading;
     gxj_pixel_type pixelColor;
+    gxj_pixel_type colorRow[GLYPH_COVERAGE_WIDTH];
+    const gxj_pixel_type *coverageColor = NULL;
     int clipX1 = clip[0];
     int clipY1 = clip[1];
     int clipX2 = clip[2];
@@ -304,6 +437,8 @@ drawString(jint pixel, const jshort *clip,
     result = gxjport_draw_chars(pixel, clip, dest, dotted, face, style, size,
                                 xDest, yDest, anchor, charArray, n);
     if (result == KNI_TRUE) { 
+        gxj_damage_add_clipped(dest, clip, xDest, yDest,
+                               xDest + charsWidth, yDest + charsHeight);
         return;
     }
 
@@ -377,8 +512,16 @@ drawString(jint pixel, const jshort *clip,
         return;
     }
 
+    gxj_damage_add(dest, xDest, yDest,
+                   xDest + width, yDest + yLimit - yCharSource);
+
     widthRemaining = width;
-    pixelColor = GXJ_RGB24TORGB16(pixel);
+    pixelColor = GXJ_RGB24TOPIXEL(pixel);
+    if (fontWidth <= GLYPH_COVERAGE_WIDTH && gxj_glyph_cache_has_coverage()) {
+        /* Source pixels for blending the coverage of any glyph line */
+        gxj_span_fill(colorRow, pixelColor, fontWidth);
+        coverageColor = colorRow;
+    }
 
     switch (direction) {
         case RIGHT_TO_LEFT:
@@ -405,9 +548,10 @@ drawString(jint pixel, const jshort *clip,
         }
 
         /* Clipped, draw the right part of the first char. */
-        drawChar(dest, charArray[charToDraw], pixelColor, xDest, yDest,
-                 xStart, yCharSource, xLimit, yLimit,
-                 FontBitmaps, fontWidth, fontHeight);
+        drawGlyph(dest, charArray[charToDraw], pixelColor, coverageColor,
+                  xDest, yDest,
+                  xStart, yCharSource, xLimit, yLimit,
+                  FontBitmaps, fontWidth, fontHeight);
         charToDraw += direction;
         xDest += startWidth;
         widthRemaining -= startWidth;
@@ -417,16 +561,18 @@ drawString(jint pixel, const jshort *clip,
     for (i = charToDraw; i != charToStop && widthRemaining >= fontWidth;
          i+=direction, xDest += fontWidth, widthRemaining -= fontWidth) {
 
-        drawChar(dest, charArray[i], pixelColor, xDest, yDest,
-                 0, yCharSource, fontWidth, yLimit,
-                 FontBitmaps, fontWidth, fontHeight);
+        drawGlyph(dest, charArray[i], pixelColor, coverageColor,
+                  xDest, yDest,
+                  0, yCharSource, fontWidth, yLimit,
+                  FontBitmaps, fontWidth, fontHeight);
     }
 
     if (i != charToStop && widthRemaining > 0) {
         /* Clipped, draw the left part of the last char. */
-        drawChar(dest, charArray[i], pixelColor, xDest, yDest,
-                 0, yCharSource, widthRemaining, yLimit,
-                 FontBitmaps, fontWidth, fontHeight);
+        drawGlyph(dest, charArray[i], pixelColor, coverageColor,
+                  xDest, yDest,
+                  0, yCharSource, widthRemaining, yLimit,
+                  FontBitmaps, fontWidth, fontHeight);
     }
 }
 
@@ -125,7 +125,7 @@ class ImageDataFactory implements AbstractImageDataFactory {
     public ImageData createImmutableCopy(ImageData mutableSource) {
         int width  = mutableSource.getWidth();
         int height = mutableSource.getHeight();
-        int length = width * height * 2;
+        int length = width * height * ImageData.PIXEL_SIZE;
 
         return  new ImageData(width, height, false,
                               mutableSource.getPixelData());
@@ -48,15 +48,11 @@
         get_imagedata(IMGAPI_GET_IMAGEDATA_PTR(jimgData),   \
                       width, height, pixelData, alphaData)
 
-/** Convert 24-bit RGB color to 16bit (565) color */
-#define RGB24TORGB16(x) (((( x ) & 0x00F80000) >> 8) + \
-                             ((( x ) & 0x0000FC00) >> 5) + \
-                             ((( x ) & 0x000000F8) >> 3) )
+/** Convert 24-bit RGB color to the native pixel */
+#define RGB24TOPIXEL(x) IMG_RGB24TOPIXEL(x)
 
-/** Convert 16-bit (565) color to 24-bit RGB color */
-#define RGB16TORGB24(x) ( ((x & 0x001F) << 3) | ((x & 0x001C) >> 2) |\
-                              ((x & 0x07E0) << 5) | ((x & 0x0600) >> 1) |\
-                              ((x & 0xF800) << 8) | ((x & 0xE000) << 3) )
+/** Convert the native pixel to 24-bit RGB color */
+#define PIXELTORGB24(x) IMG_PIXELTORGB24(x)
 
 /**
  * Create native representation for a image.
@@ -260,7 +256,7 @@ void imgj_get_argb(const java_imagedata * srcImageDataPtr,
           pixel = srcPixelData[b*srcWidth + a];
           alpha = srcAlphaData[b*srcWidth + a];
           rgbBuffer[offset + (a - x) + (b - y) * scanlength] =
-            (alpha << 24) + RGB16TORGB24(pixel);
+            (alpha << 24) + PIXELTORGB24(pixel);
         }
       }
     } else {
@@ -268,7 +264,7 @@ void imgj_get_argb(const java_imagedata * srcImageDataPtr,
         for (a = x; a < x + width; a++) {
           pixel = srcPixelData[b*srcWidth + a];
           rgbBuffer[offset + (a - x) + (b - y) * scanlength] =
-            RGB16TORGB24(pixel) | 0xFF000000;
+            PIXELTORGB24(pixel) | 0xFF000000;
         }
       }
     }
@@ -786,12 +782,12 @@ KNIDECL(javax_microedition_lcdui_ImageDataFactory_loadRGB) {
 
         if (alphaData != NULL) {
             for (i = 0; i < len; i++) {
-                pixelData[i] = RGB24TORGB16(rgbBuffer[i]);
+                pixelData[i] = RGB24TOPIXEL(rgbBuffer[i]);
                 alphaData[i] = (rgbBuffer[i] >> 24) & 0x00ff;
             }
         } else {
             for (i = 0; i < len; i++) {
-                pixelData[i] = RGB24TORGB16(rgbBuffer[i]);
+                pixelData[i] = RGB24TOPIXEL(rgbBuffer[i]);
             }
         }
     }
@@ -0,0 +1,137 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+#ifndef _IMG_PIXEL_FORMAT_H_
+#define _IMG_PIXEL_FORMAT_H_
+
+/**
+ * @file
+ * @ingroup lowui_img
+ *
+ * @brief Native pixel format shared by the image decoders, putpixel
+ * graphics and the screen ports
+ *
+ * The format is selected at build time with the PIXEL_FORMAT make
+ * option, which defines IMG_PIXEL_FORMAT to one of the values below.
+ * 32-bit formats avoid the conversion when the screen ports copy the
+ * screen buffer to a 32bpp display.
+ *
+ * In all formats the transparency of image pixels is kept in the
+ * separate 8-bit alpha plane. ARGB8888 pixels always carry 0xFF in
+ * the upper byte so that the screen buffer can be handed as is to
+ * displays that take the alpha channel into account.
+ */
+
+/** 16-bit pixels with 5+6+5 bits for red, green, blue */
+#define IMG_PIXEL_FORMAT_RGB565     0
+/** 32-bit pixels with 8 bits per channel, the upper byte is zero */
+#define IMG_PIXEL_FORMAT_XRGB8888   1
+/** 32-bit pixels with 8 bits per channel, the upper byte is 0xFF */
+#define IMG_PIXEL_FORMAT_ARGB8888   2
+
+#ifndef IMG_PIXEL_FORMAT
+#define IMG_PIXEL_FORMAT IMG_PIXEL_FORMAT_RGB565
+#endif
+
+#if IMG_PIXEL_FORMAT == IMG_PIXEL_FORMAT_RGB565
+
+/** Native pixel, 565 encoded */
+typedef unsigned short img_native_pixel_type;
+
+/** Size of the native pixel in bytes */
+#define IMG_PIXEL_SIZE 2
+
+/** Bits that are always set in a native pixel */
+#define IMG_PIXEL_OPAQUE 0
+
+/**
+ * @name Accessing pixel colors
+ * The returned separate colors are 8 bits as in Java RGB.
+ * @{
+ */
+#define IMG_PIXEL_GET_RED(P)   (((P) >> 8) & 0xF8)
+#define IMG_PIXEL_GET_GREEN(P) (((P) >> 3) & 0xFC)
+#define IMG_PIXEL_GET_BLUE(P)  (((P) << 3) & 0xF8)
+/** @} */
+
+/** Convert 8-bit r, g, b colors to a native pixel */
+#define IMG_RGB2PIXEL(r, g, b) ((((r) & 0xF8) << 8) | \
+                                (((g) & 0xFC) << 3) | \
+                                (((b) & 0xF8) >> 3))
+
+/** Convert 24-bit RGB color to a native pixel */
+#define IMG_RGB24TOPIXEL(x) (((( x ) & 0x00F80000) >> 8) + \
+                             ((( x ) & 0x0000FC00) >> 5) + \
+                             ((( x ) & 0x000000F8) >> 3) )
+
+/** Convert a native pixel to 24-bit RGB color */
+#define IMG_PIXELTORGB24(x) ( ((x & 0x001F) << 3) | ((x & 0x001C) >> 2) |\
+                              ((x & 0x07E0) << 5) | ((x & 0x0600) >> 1) |\
+                              ((x & 0xF800) << 8) | ((x & 0xE000) << 3) )
+
+#elif IMG_PIXEL_FORMAT == IMG_PIXEL_FORMAT_XRGB8888 || \
+      IMG_PIXEL_FORMAT == IMG_PIXEL_FORMAT_ARGB8888
+
+/** Native pixel, 8888 encoded */
+typedef unsigned int img_native_pixel_type;
+
+/** Size of the native pixel in bytes */
+#define IMG_PIXEL_SIZE 4
+
+/** Bits that are always set in a native pixel */
+#if IMG_PIXEL_FORMAT == IMG_PIXEL_FORMAT_ARGB8888
+#define IMG_PIXEL_OPAQUE 0xFF000000U
+#else
+#define IMG_PIXEL_OPAQUE 0
+#endif
+
+/**
+ * @name Accessing pixel colors
+ * The returned separate colors are 8 bits as in Java RGB.
+ * @{
+ */
+#define IMG_PIXEL_GET_RED(P)   (((P) >> 16) & 0xFF)
+#define IMG_PIXEL_GET_GREEN(P) (((P) >> 8) & 0xFF)
+#define IMG_PIXEL_GET_BLUE(P)  ((P) & 0xFF)
+/** @} */
+
+/** Convert 8-bit r, g, b colors to a native pixel */
+#define IMG_RGB2PIXEL(r, g, b) ((((r) & 0xFF) << 16) | \
+                                (((g) & 0xFF) << 8) | \
+                                ((b) & 0xFF) | IMG_PIXEL_OPAQUE)
+
+/** Convert 24-bit RGB color to a native pixel */
+#define IMG_RGB24TOPIXEL(x) (((unsigned int)( x ) & 0x00FFFFFF) | \
+                             IMG_PIXEL_OPAQUE)
+
+/** Convert a native pixel to 24-bit RGB color */
+#define IMG_PIXELTORGB24(x) ((x) & 0x00FFFFFF)
+
+#else
+#error "Unsupported IMG_PIXEL_FORMAT"
+#endif
+
+#endif /* _IMG_PIXEL_FORMAT_H_ */
@@ -61,7 +61,8 @@ KNIDECL(javax_microedition_lcdui_SuiteImageCacheImpl_loadAndCreateImmutableImage
     int len;
     SuiteIdType suiteId;
     jboolean status = KNI_FALSE;
-    unsigned char *rawBuffer = NULL;
+    const unsigned char *rawBuffer = NULL;
+    unsigned char *rawCopy = NULL;
 
     KNI_StartHandles(2);
 
@@ -72,14 +73,15 @@ KNIDECL(javax_microedition_lcdui_SuiteImageCacheImpl_loadAndCreateImmutableImage
 
     suiteId = KNI_GetParameterAsInt(2);
 
-    len = loadImageFromCache(suiteId, &resName, &rawBuffer);
+    /* A mapped cache is copied straight into the ImageData arrays */
+    len = getImageFromCache(suiteId, &resName, &rawBuffer, &rawCopy);
     if (len != -1 && rawBuffer != NULL) {
         /* image is found in cache */
         status = img_load_imagedata_from_raw_buffer(KNIPASSARGS
-            imageData, rawBuffer, len);
+            imageData, (unsigned char *)rawBuffer, len);
     }
 
-    midpFree(rawBuffer);
+    midpFree(rawCopy);
 
     RELEASE_PCSL_STRING_PARAMETER
 
@@ -29,6 +29,7 @@
 
 #include <midpError.h>
 #include <img_errorcodes.h>
+#include <img_pixel_format.h>
 
 /**
  * @file
@@ -43,11 +44,11 @@ extern "C" {
 
 
 /**
- * 16-bit pixel.
- * The color encoding used in pixels is 565, that is,
- * 5+6+5=16 bits for red, green, blue.
+ * Native pixel.
+ * The color encoding is selected at build time, see img_pixel_format.h.
+ * By default it is 565, that is, 5+6+5=16 bits for red, green, blue.
  */
-typedef unsigned short imgdcd_pixel_type;
+typedef img_native_pixel_type imgdcd_pixel_type;
 
 /** 8-bit alpha */
 typedef unsigned char imgdcd_alpha_type;
@@ -41,8 +41,16 @@ const unsigned char imgdcd_png_header[16] = {0x89, 'P', 'N', 'G',
 /* JPEG file header */
 const unsigned char imgdcd_jpeg_header[4] = {0xff, 0xd8, 0xff, 0xe0};
 
-/* RAW platform dependent image file header */
+/*
+ * RAW platform dependent image file header. Raw images with 32-bit
+ * pixels have their own header, so that images cached or romized
+ * for the other pixel size are rejected rather than misread.
+ */
+#if IMG_PIXEL_SIZE == 2
 const unsigned char imgdcd_raw_header[4] = {0x89, 'S', 'U', 'N'};
+#else
+const unsigned char imgdcd_raw_header[4] = {0x89, 'S', 'U', '4'};
+#endif
 
 /**
  * Identify image format from a given image buffer.
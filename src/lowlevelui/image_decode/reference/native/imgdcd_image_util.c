@@ -40,8 +40,8 @@
 #define CT_COLOR    0x02
 #define CT_ALPHA    0x04
 
-/** Convert pre-masked triplet r, g, b to 16 bit pixel. */
-#define IMGDCD_RGB2PIXEL(r, g, b) ( b +(g << 5)+ (r << 11) )
+/** Convert 8-bit r, g, b colors to the native pixel. */
+#define IMGDCD_RGB2PIXEL(r, g, b) IMG_RGB2PIXEL(r, g, b)
 
 typedef struct _imgDst {
   imageDstData   super;
@@ -181,9 +181,9 @@ sendPixelsColor(imageDstPtr self, int y, uchar *pixels, int pixelType) {
   if ((pixelType == CT_COLOR) ||              /* color triplet */
       (pixelType == (CT_COLOR | CT_ALPHA))) { /* color triplet with alpha */
     for (x = 0; x < p->width; ++x) {
-      int r = pixels[0] >> 3;
-      int g = pixels[1] >> 2;
-      int b = pixels[2] >> 3;
+      int r = pixels[0];
+      int g = pixels[1];
+      int b = pixels[2];
       int alpha = 0xff;
 
       if (pixelType & CT_ALPHA) {
@@ -208,9 +208,9 @@ sendPixelsColor(imageDstPtr self, int y, uchar *pixels, int pixelType) {
 
       int color = p->cmap[cmapIndex];
 
-      int r = ((color >> 16) & 0xff) >> 3;
-      int g = ((color >>  8) & 0xff) >> 2;
-      int b = ((color >>  0) & 0xff) >> 3;
+      int r = (color >> 16) & 0xff;
+      int g = (color >>  8) & 0xff;
+      int b = (color >>  0) & 0xff;
 
       int alpha = 0xff;
 
@@ -324,16 +324,14 @@ imgdcd_decode_png
 }
 
 #if ENABLE_JPEG
-#define RGB565_PIXEL_SIZE sizeof(imgdcd_pixel_type)
+#define NATIVE_PIXEL_SIZE sizeof(imgdcd_pixel_type)
 
 
 /**
- * TBD:
- * a). use imageSrcPtr & imageDstPtr instead of direct array pointers
- * b). move to a special file, like decode_png_image() in imgdcd_png_decode.c
+ * Decode with the external JPEG library. Without it the decoder of
+ * imgdcd_jpeg_decode.c is used.
  */
-//static bool decode_jpeg_image(imageSrcPtr src, imageDstPtr dst)
-static int decode_jpeg_image(char* inData, int inDataLen,
+static int decode_jpeg_library(char* inData, int inDataLen,
     char* outData, int outDataWidth, int outDataHeight)
 {
     int result = FALSE;
@@ -356,7 +354,7 @@ static int decode_jpeg_image(char* inData, int inDataLen,
             }
 
             if (JPEG_To_RGB_decodeData2(info, outData,
-                RGB565_PIXEL_SIZE, 0, 0, outDataWidth, outDataHeight) != 0) {
+                NATIVE_PIXEL_SIZE, 0, 0, outDataWidth, outDataHeight) != 0) {
                 result = TRUE;
             }
         }
@@ -405,14 +403,14 @@ imgdcd_decode_jpeg
         ((imageDstPtr)&dstData)->setSize(
             ((imageDstPtr)&dstData), width, height);
         /*
-         pixelData = pcsl_mem_malloc(width * height * RGB565_PIXEL_SIZE);
+         pixelData = pcsl_mem_malloc(width * height * NATIVE_PIXEL_SIZE);
         */
     }
 
     if ((src = create_imagesrc_from_data((char **)(void *)&srcBuffer,
         length)) == NULL) {
         *creationErrorPtr = IMG_NATIVE_IMAGE_OUT_OF_MEMORY_ERROR;
-    } else if (decode_jpeg_image((char*)srcBuffer, length,
+    } else if (decode_jpeg_library((char*)srcBuffer, length,
         (char*)(pixelData), width, height) != FALSE) {
         *creationErrorPtr = IMG_NATIVE_IMAGE_NO_ERROR;
     } else {
@@ -424,10 +422,28 @@ imgdcd_decode_jpeg
     }
 
 #else
-    (void)srcBuffer;
-    (void)length;
-    (void)width; (void) height; 
-    (void)pixelData; (void) alphaData;
-    *creationErrorPtr = IMG_NATIVE_IMAGE_UNSUPPORTED_FORMAT_ERROR;
+    imageSrcPtr src = NULL;
+
+    REPORT_CALL_TRACE(LC_LOWUI,
+                     "LF:decodeJPEG()\n");
+
+    /* JPEG images are opaque, the alpha data is left untouched */
+    (void)alphaData;
+
+    if (pixelData == NULL) {
+        *creationErrorPtr = IMG_NATIVE_IMAGE_DECODING_ERROR;
+    } else if ((src = create_imagesrc_from_data((char **)(void *)&srcBuffer,
+        length)) == NULL) {
+        *creationErrorPtr = IMG_NATIVE_IMAGE_OUT_OF_MEMORY_ERROR;
+    } else if (decode_jpeg_image(src, pixelData,
+        width, height) != FALSE) {
+        *creationErrorPtr = IMG_NATIVE_IMAGE_NO_ERROR;
+    } else {
+        *creationErrorPtr = IMG_NATIVE_IMAGE_DECODING_ERROR;
+    }
+
+    if (src != NULL) {
+        midpFree(src);
+    }
 #endif
 }
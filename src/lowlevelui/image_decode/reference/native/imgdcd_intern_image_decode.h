@@ -27,6 +27,8 @@
 #ifndef _IMGDCD_INTERN_IMAGE_DECODE_H_
 #define _IMGDCD_INTERN_IMAGE_DECODE_H_
 
+#include <img_pixel_format.h>
+
 /**
  * IMPL_NOTE:Document this typedef
  */
@@ -79,4 +81,18 @@ get_decoded_png_imagesize(imageSrcPtr src, int* width, int *height);
 extern bool
 decode_png_image(imageSrcPtr src, imageDstPtr dst);
 
+/**
+ * Decode a JPEG image into native pixels. The part of the pixels the
+ * image does not cover is set to black.
+ *
+ * @param src source of the image data
+ * @param pixels width * height native pixels to fill
+ * @param width width of the requested image
+ * @param height height of the requested image
+ * @return TRUE if the image was decoded
+ */
+extern bool
+decode_jpeg_image(imageSrcPtr src, img_native_pixel_type *pixels,
+                  int width, int height);
+
 #endif /* _IMGDCD_INTERN_IMAGE_DECODE_H_ */
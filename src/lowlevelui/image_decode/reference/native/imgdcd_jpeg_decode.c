@@ -0,0 +1,1569 @@
+/*
+ *
+ *
+ * Copyright  1990-2008 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+/**
+ * @file
+ *
+ * JPEG decoder writing native pixels.
+ *
+ * Huffman coded baseline, extended sequential and progressive images
+ * with 8-bit samples and one (grayscale) or three (YCbCr or RGB)
+ * components are supported. Sequential images with all components in
+ * one scan are decoded an MCU row at a time. Other images keep the
+ * coefficients of all blocks until the last scan. Subsampled
+ * components are upsampled by replication.
+ */
+
+#include <string.h>
+
+#include <midpMalloc.h>
+#include <midp_logging.h>
+
+#include "imgdcd_intern_image_decode.h"
+
+/** Number of bytes read from the image source at once */
+#ifndef JPEG_INPUT_BUFFER_SIZE
+#define JPEG_INPUT_BUFFER_SIZE 4096
+#endif
+
+/**
+ * By default the 8x8 inverse DCT uses vector instructions where the
+ * compiler supports them, define to 0 to use the portable code.
+ */
+#ifndef ENABLE_JPEG_SIMD
+#define ENABLE_JPEG_SIMD 1
+#endif
+
+#if ENABLE_JPEG_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JPEG_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+#endif /* ENABLE_JPEG_SIMD */
+
+#ifndef JPEG_SIMD_SSE2
+#define JPEG_SIMD_SSE2 0
+#endif
+
+/* Markers */
+#define M_SOF0  0xC0
+#define M_SOF1  0xC1
+#define M_SOF2  0xC2
+#define M_SOF3  0xC3
+#define M_DHT   0xC4
+#define M_SOF15 0xCF
+#define M_DAC   0xCC
+#define M_JPG   0xC8
+#define M_RST0  0xD0
+#define M_RST7  0xD7
+#define M_SOI   0xD8
+#define M_EOI   0xD9
+#define M_SOS   0xDA
+#define M_DQT   0xDB
+#define M_DRI   0xDD
+#define M_APP14 0xEE
+#define M_TEM   0x01
+
+#define JPEG_MAX_COMPONENTS 3
+
+/** Bits of the Huffman codes resolved with one table lookup */
+#define JPEG_HUFF_LOOKAHEAD 9
+
+/* Fixed point constants of the inverse DCT */
+#define JPEG_CONST_BITS 13
+#define JPEG_PASS1_BITS 2
+
+#define JPEG_FIX_0_298631336 2446
+#define JPEG_FIX_0_390180644 3196
+#define JPEG_FIX_0_541196100 4433
+#define JPEG_FIX_0_765366865 6270
+#define JPEG_FIX_0_899976223 7373
+#define JPEG_FIX_1_175875602 9633
+#define JPEG_FIX_1_501321110 12299
+#define JPEG_FIX_1_847759065 15137
+#define JPEG_FIX_1_961570560 16069
+#define JPEG_FIX_2_053119869 16819
+#define JPEG_FIX_2_562915447 20995
+#define JPEG_FIX_3_072711026 25172
+
+/** Divide by 2^n rounding to the nearest */
+#define JPEG_DESCALE(x, n) (((x) + (1 << ((n) - 1))) >> (n))
+
+/** Clamp to the range of a sample */
+#define JPEG_CLAMP(v) \
+    ((unsigned int)(v) > 255 ? ((v) < 0 ? 0 : 255) : (v))
+
+/** Level shifted inverse DCT output to a sample */
+#define JPEG_SAMPLE(v) ((unsigned char)JPEG_CLAMP((v) + 128))
+
+/**
+ * Clamp to 16 bits, the range of the inputs of each inverse DCT pass.
+ * Valid data never leaves it, corrupted data is limited so the sums of
+ * products in a pass cannot overflow an int.
+ */
+#define JPEG_LIMIT(v) ((v) < -32768 ? -32768 : ((v) > 32767 ? 32767 : (v)))
+
+/** Dequantized coefficient k of a block */
+#define JPEG_DEQUANT(coefs, quant, k) \
+    JPEG_LIMIT((coefs)[k] * (int)(quant)[k])
+
+/** Wrap a DC prediction around to 16 bits like the coefficients */
+#define JPEG_WRAP_DC(v) \
+    ((int)(((unsigned int)(v) + 0x8000U) & 0xFFFFU) - 0x8000)
+
+/** Sign extension of an n-bit coefficient */
+#define JPEG_EXTEND(v, n) \
+    ((v) < (1 << ((n) - 1)) ? (v) - (1 << (n)) + 1 : (v))
+
+/**
+ * Zigzag order of coefficients to the natural order. Extra entries
+ * keep the run lengths of corrupted data inside the block.
+ */
+static const unsigned char jpegNaturalOrder[64 + 16] = {
+     0,  1,  8, 16,  9,  2,  3, 10,
+    17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34,
+    27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36,
+    29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46,
+    53, 60, 61, 54, 47, 55, 62, 63,
+    63, 63, 63, 63, 63, 63, 63, 63,
+    63, 63, 63, 63, 63, 63, 63, 63
+};
+
+typedef struct _jpegHuffTable {
+    bool           defined;
+    unsigned char  lookLength[1 << JPEG_HUFF_LOOKAHEAD];
+    unsigned char  lookValue[1 << JPEG_HUFF_LOOKAHEAD];
+    long           maxCode[17];   /* largest code of a length, -1 if none */
+    long           minCode[17];   /* smallest code of a length */
+    int            valuePtr[17];  /* index of the value of minCode */
+    unsigned char  values[256];
+} jpegHuffTable;
+
+typedef struct _jpegComponent {
+    int            id;
+    int            h, v;          /* sampling factors */
+    int            hShift, vShift;/* log2 of the upsampling ratios */
+    int            tq;            /* quantization table */
+    int            td, ta;        /* Huffman tables of the current scan */
+    int            blocksW;       /* blocks covering the image */
+    int            blocksH;
+    int            coefW;         /* blocks in a row of whole MCUs */
+    int            dcPred;
+    short         *coefs;         /* all blocks, when buffered */
+    unsigned char *plane;         /* samples of one MCU row */
+    int            planeStride;
+} jpegComponent;
+
+typedef struct _jpegDecoder {
+    imageSrcPtr    src;
+    unsigned char  input[JPEG_INPUT_BUFFER_SIZE];
+    int            inputPos;
+    int            inputLen;
+    bool           inputEnd;
+
+    unsigned int   bitBuf;        /* left aligned entropy coded bits */
+    int            bitCount;
+    int            marker;        /* marker found in entropy coded data */
+
+    unsigned short quant[4][64];  /* natural order */
+    jpegHuffTable  dcTables[4];
+    jpegHuffTable  acTables[4];
+
+    int            width;
+    int            height;
+    int            nComp;
+    jpegComponent  comp[JPEG_MAX_COMPONENTS];
+    int            hMax, vMax;
+    int            mcusX, mcusY;
+    bool           progressive;
+    bool           buffered;
+    int            adobeTransform;/* -1 if there is no Adobe marker */
+    bool           ycc;
+    int            restartInterval;
+
+    int            scanComp[JPEG_MAX_COMPONENTS];
+    int            nScanComp;
+    int            ss, se, ah, al;
+    int            eobRun;
+
+    img_native_pixel_type *pixels;
+    int            dstWidth;
+    int            dstHeight;
+} jpegDecoder;
+
+/**
+ * Read the next byte of the image.
+ *
+ * @return the byte, -1 at the end of data
+ */
+static int
+nextByte(jpegDecoder *d)
+{
+    if (d->inputPos == d->inputLen) {
+        if (d->inputEnd) {
+            return -1;
+        }
+
+        d->inputPos = 0;
+        d->inputLen = d->src->getBytes(d->src, d->input, sizeof(d->input));
+        if (d->inputLen <= 0) {
+            d->inputLen = 0;
+            d->inputEnd = TRUE;
+            return -1;
+        }
+    }
+
+    return d->input[d->inputPos++];
+}
+
+/**
+ * Read a big endian 16-bit value.
+ *
+ * @return the value, -1 at the end of data
+ */
+static int
+read16(jpegDecoder *d)
+{
+    int hi = nextByte(d);
+    int lo = nextByte(d);
+
+    return (hi < 0 || lo < 0) ? -1 : (hi << 8) | lo;
+}
+
+/**
+ * Find the next marker skipping any data before it.
+ *
+ * @return the marker code, -1 at the end of data
+ */
+static int
+nextMarker(jpegDecoder *d)
+{
+    int c;
+
+    if (d->marker != 0) {
+        c = d->marker;
+        d->marker = 0;
+        return c;
+    }
+
+    do {
+        do {
+            c = nextByte(d);
+        } while (c >= 0 && c != 0xFF);
+
+        do {
+            c = nextByte(d);
+        } while (c == 0xFF);
+    } while (c == 0);   /* 0xFF 0x00 is a stuffed data byte */
+
+    return c;
+}
+
+static bool
+skipSegment(jpegDecoder *d)
+{
+    int length = read16(d) - 2;
+
+    if (length < 0) {
+        return FALSE;
+    }
+
+    while (length > 0) {
+        int n = d->inputLen - d->inputPos;
+
+        if (n == 0) {
+            if (nextByte(d) < 0) {
+                return FALSE;
+            }
+            n = 1;
+        } else {
+            if (n > length) {
+                n = length;
+            }
+            d->inputPos += n;
+        }
+        length -= n;
+    }
+
+    return TRUE;
+}
+
+/**
+ * Refill the bit buffer to more than 24 bits. After a marker or the
+ * end of data zero bits are supplied, so that corrupted data is
+ * decoded to the end without further checks.
+ */
+static void
+fillBits(jpegDecoder *d)
+{
+    while (d->bitCount <= 24) {
+        int c = 0;
+
+        if (d->marker == 0) {
+            c = nextByte(d);
+            if (c == 0xFF) {
+                do {
+                    c = nextByte(d);
+                } while (c == 0xFF);
+
+                if (c == 0) {
+                    c = 0xFF;
+                } else {
+                    d->marker = (c < 0) ? M_EOI : c;
+                    c = 0;
+                }
+            } else if (c < 0) {
+                d->marker = M_EOI;
+                c = 0;
+            }
+        }
+
+        d->bitBuf |= (unsigned int)c << (24 - d->bitCount);
+        d->bitCount += 8;
+    }
+}
+
+/** Read 1 to 16 bits */
+static int
+getBits(jpegDecoder *d, int n)
+{
+    int v;
+
+    if (d->bitCount < n) {
+        fillBits(d);
+    }
+
+    v = (int)(d->bitBuf >> (32 - n));
+    d->bitBuf <<= n;
+    d->bitCount -= n;
+
+    return v;
+}
+
+/** Read an n-bit coefficient, corrupted sizes give zero */
+static int
+receiveExtend(jpegDecoder *d, int n)
+{
+    int v;
+
+    if (n == 0 || n > 15) {
+        return 0;
+    }
+
+    v = getBits(d, n);
+    return JPEG_EXTEND(v, n);
+}
+
+static int
+decodeHuffman(jpegDecoder *d, const jpegHuffTable *t)
+{
+    int look;
+    int length;
+
+    if (d->bitCount < 16) {
+        fillBits(d);
+    }
+
+    look = (int)(d->bitBuf >> (32 - JPEG_HUFF_LOOKAHEAD));
+    length = t->lookLength[look];
+    if (length != 0) {
+        d->bitBuf <<= length;
+        d->bitCount -= length;
+        return t->lookValue[look];
+    }
+
+    for (length = JPEG_HUFF_LOOKAHEAD + 1; length <= 16; ++length) {
+        long code = (long)(d->bitBuf >> (32 - length));
+
+        if (code <= t->maxCode[length]) {
+            d->bitBuf <<= length;
+            d->bitCount -= length;
+            return t->values[(t->valuePtr[length] + code -
+                              t->minCode[length]) & 0xFF];
+        }
+    }
+
+    /* No such code, the data is corrupted */
+    return 0;
+}
+
+static bool
+buildHuffman(jpegHuffTable *t, const unsigned char *counts)
+{
+    long code = 0;
+    int length;
+    int k = 0;
+
+    memset(t->lookLength, 0, sizeof(t->lookLength));
+
+    for (length = 1; length <= 16; ++length) {
+        int i;
+
+        t->valuePtr[length] = k;
+        t->minCode[length] = code;
+
+        for (i = 0; i < counts[length]; ++i, ++k, ++code) {
+            if (code >= (1L << length)) {
+                return FALSE;
+            }
+
+            if (length <= JPEG_HUFF_LOOKAHEAD) {
+                int shift = JPEG_HUFF_LOOKAHEAD - length;
+
+                memset(&t->lookLength[code << shift], length, 1 << shift);
+                memset(&t->lookValue[code << shift], t->values[k],
+                       1 << shift);
+            }
+        }
+
+        t->maxCode[length] = (counts[length] != 0) ? code - 1 : -1;
+        code <<= 1;
+    }
+
+    t->defined = TRUE;
+    return TRUE;
+}
+
+static bool
+readHuffmanTables(jpegDecoder *d)
+{
+    int length = read16(d) - 2;
+
+    while (length > 0) {
+        unsigned char counts[17];
+        jpegHuffTable *t;
+        int total = 0;
+        int c = nextByte(d);
+        int i;
+
+        if (c < 0 || (c >> 4) > 1 || (c & 15) > 3) {
+            return FALSE;
+        }
+        t = (c >> 4) ? &d->acTables[c & 15] : &d->dcTables[c & 15];
+
+        for (i = 1; i <= 16; ++i) {
+            counts[i] = (unsigned char)nextByte(d);
+            total += counts[i];
+        }
+        if (total > 256 || 17 + total > length) {
+            return FALSE;
+        }
+
+        for (i = 0; i < total; ++i) {
+            t->values[i] = (unsigned char)nextByte(d);
+        }
+
+        if (!buildHuffman(t, counts)) {
+            return FALSE;
+        }
+        length -= 17 + total;
+    }
+
+    return (length == 0 && !d->inputEnd) ? TRUE : FALSE;
+}
+
+static bool
+readQuantTables(jpegDecoder *d)
+{
+    int length = read16(d) - 2;
+
+    while (length > 0) {
+        int c = nextByte(d);
+        int precision = c >> 4;
+        int i;
+
+        if (c < 0 || precision > 1 || (c & 15) > 3 ||
+                length < 65 + 64 * precision) {
+            return FALSE;
+        }
+
+        for (i = 0; i < 64; ++i) {
+            int q = nextByte(d);
+
+            if (precision) {
+                q = (q << 8) | nextByte(d);
+            }
+            d->quant[c & 15][jpegNaturalOrder[i]] = (unsigned short)q;
+        }
+        length -= 65 + 64 * precision;
+    }
+
+    return (length == 0 && !d->inputEnd) ? TRUE : FALSE;
+}
+
+static bool
+readAdobe(jpegDecoder *d)
+{
+    unsigned char data[12];
+    int length = read16(d) - 2;
+    int i;
+
+    for (i = 0; i < length; ++i) {
+        int c = nextByte(d);
+
+        if (i < (int)sizeof(data)) {
+            data[i] = (unsigned char)c;
+        }
+    }
+
+    if (length >= (int)sizeof(data) && memcmp(data, "Adobe", 5) == 0) {
+        d->adobeTransform = data[11];
+    }
+
+    return (length >= 0 && !d->inputEnd) ? TRUE : FALSE;
+}
+
+/** Read SOFn marker parameters */
+static bool
+readFrame(jpegDecoder *d, int marker)
+{
+    int length = read16(d);
+    int i;
+
+    if (nextByte(d) != 8) {
+        REPORT_WARN(LC_LOWUI, "JPEG: only 8-bit samples are supported\n");
+        return FALSE;
+    }
+
+    d->height = read16(d);
+    d->width = read16(d);
+    d->nComp = nextByte(d);
+    if (d->width <= 0 || d->height <= 0 ||
+            (d->nComp != 1 && d->nComp != 3) ||
+            length != 8 + 3 * d->nComp) {
+        return FALSE;
+    }
+
+    d->hMax = d->vMax = 1;
+    for (i = 0; i < d->nComp; ++i) {
+        jpegComponent *c = &d->comp[i];
+        int sampling;
+
+        c->id = nextByte(d);
+        sampling = nextByte(d);
+        c->h = sampling >> 4;
+        c->v = sampling & 15;
+        c->tq = nextByte(d);
+        if (sampling < 0 || c->h < 1 || c->h > 4 || c->v < 1 || c->v > 4 ||
+                c->tq < 0 || c->tq > 3) {
+            return FALSE;
+        }
+
+        if (d->nComp == 1) {
+            /* The MCU of a single component is one block */
+            c->h = c->v = 1;
+        }
+        if (c->h > d->hMax) {
+            d->hMax = c->h;
+        }
+        if (c->v > d->vMax) {
+            d->vMax = c->v;
+        }
+    }
+
+    d->mcusX = (d->width + 8 * d->hMax - 1) / (8 * d->hMax);
+    d->mcusY = (d->height + 8 * d->vMax - 1) / (8 * d->vMax);
+
+    for (i = 0; i < d->nComp; ++i) {
+        jpegComponent *c = &d->comp[i];
+
+        /* Only upsampling by 1, 2 or 4 is supported */
+        for (c->hShift = 0; (c->h << c->hShift) < d->hMax; ++c->hShift);
+        for (c->vShift = 0; (c->v << c->vShift) < d->vMax; ++c->vShift);
+        if ((c->h << c->hShift) != d->hMax ||
+                (c->v << c->vShift) != d->vMax) {
+            REPORT_WARN(LC_LOWUI, "JPEG: unsupported sampling factors\n");
+            return FALSE;
+        }
+
+        c->blocksW = ((d->width * c->h + d->hMax - 1) / d->hMax + 7) / 8;
+        c->blocksH = ((d->height * c->v + d->vMax - 1) / d->vMax + 7) / 8;
+        c->coefW = d->mcusX * c->h;
+    }
+
+    d->progressive = (marker == M_SOF2) ? TRUE : FALSE;
+
+    return d->inputEnd ? FALSE : TRUE;
+}
+
+/** Read SOS marker parameters */
+static bool
+readScan(jpegDecoder *d)
+{
+    int length = read16(d);
+    int n = nextByte(d);
+    int i;
+    int c;
+
+    if (n < 1 || n > d->nComp || length != 6 + 2 * n) {
+        return FALSE;
+    }
+
+    for (i = 0; i < n; ++i) {
+        int id = nextByte(d);
+        int tables = nextByte(d);
+        int j;
+
+        for (j = 0; j < d->nComp && d->comp[j].id != id; ++j);
+        if (j == d->nComp || tables < 0 ||
+                (tables >> 4) > 3 || (tables & 15) > 3) {
+            return FALSE;
+        }
+
+        d->comp[j].td = tables >> 4;
+        d->comp[j].ta = tables & 15;
+        d->scanComp[i] = j;
+    }
+    d->nScanComp = n;
+
+    d->ss = nextByte(d);
+    d->se = nextByte(d);
+    c = nextByte(d);
+    d->ah = c >> 4;
+    d->al = c & 15;
+
+    if (!d->progressive) {
+        d->ss = 0;
+        d->se = 63;
+        d->ah = d->al = 0;
+    } else if (d->ss > d->se || d->se > 63 || (d->ss == 0 && d->se != 0) ||
+               (d->ss != 0 && n != 1) || d->ah > 13 || d->al > 13) {
+        return FALSE;
+    }
+
+    for (i = 0; i < n; ++i) {
+        jpegComponent *comp = &d->comp[d->scanComp[i]];
+
+        if ((d->ss == 0 && d->ah == 0 && !d->dcTables[comp->td].defined) ||
+                (d->se != 0 && !d->acTables[comp->ta].defined)) {
+            return FALSE;
+        }
+    }
+
+    return d->inputEnd ? FALSE : TRUE;
+}
+
+#if !JPEG_SIMD_SSE2
+
+/**
+ * Scalar 8x8 inverse DCT, the islow algorithm of the IJG library. The
+ * inputs of both passes are limited to 16 bits like in the SSE2 code.
+ */
+static void
+idct8x8(const short *coefs, const unsigned short *quant,
+        unsigned char *out, int stride)
+{
+    int ws[64];
+    int *w;
+    int i;
+
+    /* Pass 1: columns, results are scaled up by 2^PASS1_BITS */
+    for (i = 0, w = ws; i < 8; ++i, ++coefs, ++quant, ++w) {
+        int tmp0, tmp1, tmp2, tmp3, tmp10, tmp11, tmp12, tmp13;
+        int z1, z2, z3, z4, z5;
+
+        if ((coefs[8] | coefs[16] | coefs[24] | coefs[32] |
+             coefs[40] | coefs[48] | coefs[56]) == 0) {
+            int dc = JPEG_LIMIT(JPEG_DEQUANT(coefs, quant, 0) *
+                                (1 << JPEG_PASS1_BITS));
+
+            w[0] = w[8] = w[16] = w[24] = w[32] = w[40] = w[48] = w[56] = dc;
+            continue;
+        }
+
+        /* Even part */
+        z2 = JPEG_DEQUANT(coefs, quant, 16);
+        z3 = JPEG_DEQUANT(coefs, quant, 48);
+        z1 = (z2 + z3) * JPEG_FIX_0_541196100;
+        tmp2 = z1 - z3 * JPEG_FIX_1_847759065;
+        tmp3 = z1 + z2 * JPEG_FIX_0_765366865;
+
+        z2 = JPEG_DEQUANT(coefs, quant, 0);
+        z3 = JPEG_DEQUANT(coefs, quant, 32);
+        tmp0 = (z2 + z3) * (1 << JPEG_CONST_BITS);
+        tmp1 = (z2 - z3) * (1 << JPEG_CONST_BITS);
+
+        tmp10 = tmp0 + tmp3;
+        tmp13 = tmp0 - tmp3;
+        tmp11 = tmp1 + tmp2;
+        tmp12 = tmp1 - tmp2;
+
+        /* Odd part */
+        tmp0 = JPEG_DEQUANT(coefs, quant, 56);
+        tmp1 = JPEG_DEQUANT(coefs, quant, 40);
+        tmp2 = JPEG_DEQUANT(coefs, quant, 24);
+        tmp3 = JPEG_DEQUANT(coefs, quant, 8);
+
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        z4 = tmp1 + tmp3;
+        z5 = (z3 + z4) * JPEG_FIX_1_175875602;
+
+        tmp0 *= JPEG_FIX_0_298631336;
+        tmp1 *= JPEG_FIX_2_053119869;
+        tmp2 *= JPEG_FIX_3_072711026;
+        tmp3 *= JPEG_FIX_1_501321110;
+        z1 *= -JPEG_FIX_0_899976223;
+        z2 *= -JPEG_FIX_2_562915447;
+        z3 = z3 * -JPEG_FIX_1_961570560 + z5;
+        z4 = z4 * -JPEG_FIX_0_390180644 + z5;
+
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+#define JPEG_PASS1(x) \
+    JPEG_LIMIT(JPEG_DESCALE(x, JPEG_CONST_BITS - JPEG_PASS1_BITS))
+        w[0]  = JPEG_PASS1(tmp10 + tmp3);
+        w[56] = JPEG_PASS1(tmp10 - tmp3);
+        w[8]  = JPEG_PASS1(tmp11 + tmp2);
+        w[48] = JPEG_PASS1(tmp11 - tmp2);
+        w[16] = JPEG_PASS1(tmp12 + tmp1);
+        w[40] = JPEG_PASS1(tmp12 - tmp1);
+        w[24] = JPEG_PASS1(tmp13 + tmp0);
+        w[32] = JPEG_PASS1(tmp13 - tmp0);
+#undef JPEG_PASS1
+    }
+
+    /* Pass 2: rows, results are scaled down by 8 and level shifted */
+    for (i = 0, w = ws; i < 8; ++i, w += 8, out += stride) {
+        int tmp0, tmp1, tmp2, tmp3, tmp10, tmp11, tmp12, tmp13;
+        int z1, z2, z3, z4, z5;
+
+        if ((w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) == 0) {
+            memset(out, JPEG_SAMPLE(JPEG_DESCALE(w[0], JPEG_PASS1_BITS + 3)),
+                   8);
+            continue;
+        }
+
+        /* Even part */
+        z2 = w[2];
+        z3 = w[6];
+        z1 = (z2 + z3) * JPEG_FIX_0_541196100;
+        tmp2 = z1 - z3 * JPEG_FIX_1_847759065;
+        tmp3 = z1 + z2 * JPEG_FIX_0_765366865;
+
+        tmp0 = (w[0] + w[4]) * (1 << JPEG_CONST_BITS);
+        tmp1 = (w[0] - w[4]) * (1 << JPEG_CONST_BITS);
+
+        tmp10 = tmp0 + tmp3;
+        tmp13 = tmp0 - tmp3;
+        tmp11 = tmp1 + tmp2;
+        tmp12 = tmp1 - tmp2;
+
+        /* Odd part */
+        tmp0 = w[7];
+        tmp1 = w[5];
+        tmp2 = w[3];
+        tmp3 = w[1];
+
+        z1 = tmp0 + tmp3;
+        z2 = tmp1 + tmp2;
+        z3 = tmp0 + tmp2;
+        z4 = tmp1 + tmp3;
+        z5 = (z3 + z4) * JPEG_FIX_1_175875602;
+
+        tmp0 *= JPEG_FIX_0_298631336;
+        tmp1 *= JPEG_FIX_2_053119869;
+        tmp2 *= JPEG_FIX_3_072711026;
+        tmp3 *= JPEG_FIX_1_501321110;
+        z1 *= -JPEG_FIX_0_899976223;
+        z2 *= -JPEG_FIX_2_562915447;
+        z3 = z3 * -JPEG_FIX_1_961570560 + z5;
+        z4 = z4 * -JPEG_FIX_0_390180644 + z5;
+
+        tmp0 += z1 + z3;
+        tmp1 += z2 + z4;
+        tmp2 += z2 + z3;
+        tmp3 += z1 + z4;
+
+#define JPEG_PASS2(x) \
+    JPEG_SAMPLE(JPEG_DESCALE(x, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3))
+        out[0] = JPEG_PASS2(tmp10 + tmp3);
+        out[7] = JPEG_PASS2(tmp10 - tmp3);
+        out[1] = JPEG_PASS2(tmp11 + tmp2);
+        out[6] = JPEG_PASS2(tmp11 - tmp2);
+        out[2] = JPEG_PASS2(tmp12 + tmp1);
+        out[5] = JPEG_PASS2(tmp12 - tmp1);
+        out[3] = JPEG_PASS2(tmp13 + tmp0);
+        out[4] = JPEG_PASS2(tmp13 - tmp0);
+#undef JPEG_PASS2
+    }
+}
+
+#else
+
+/** Constant pair for _mm_madd_epi16() of interleaved words */
+#define JPEG_PAIR(a, b) _mm_setr_epi16((short)(a), (short)(b), \
+                                       (short)(a), (short)(b), \
+                                       (short)(a), (short)(b), \
+                                       (short)(a), (short)(b))
+
+/**
+ * One pass of the islow inverse DCT over the eight word lanes of
+ * r[0..7]. The products are split into pairs summed by pmaddwd, the
+ * results are the same as those of the scalar code.
+ */
+static void
+idctPassSse2(__m128i *r, int n)
+{
+    const __m128i round = _mm_set1_epi32(1 << (n - 1));
+    const __m128i count = _mm_cvtsi32_si128(n);
+    const __m128i k2 = JPEG_PAIR(JPEG_FIX_0_541196100 + JPEG_FIX_0_765366865,
+                                 JPEG_FIX_0_541196100);
+    const __m128i k6 = JPEG_PAIR(JPEG_FIX_0_541196100,
+                                 JPEG_FIX_0_541196100 - JPEG_FIX_1_847759065);
+    const __m128i k0p = JPEG_PAIR(1 << JPEG_CONST_BITS, 1 << JPEG_CONST_BITS);
+    const __m128i k0m = JPEG_PAIR(1 << JPEG_CONST_BITS,
+                                  -(1 << JPEG_CONST_BITS));
+    const __m128i kz3 = JPEG_PAIR(JPEG_FIX_1_175875602 - JPEG_FIX_1_961570560,
+                                  JPEG_FIX_1_175875602);
+    const __m128i kz4 = JPEG_PAIR(JPEG_FIX_1_175875602,
+                                  JPEG_FIX_1_175875602 - JPEG_FIX_0_390180644);
+    const __m128i k71 = JPEG_PAIR(JPEG_FIX_0_298631336 - JPEG_FIX_0_899976223,
+                                  -JPEG_FIX_0_899976223);
+    const __m128i k17 = JPEG_PAIR(-JPEG_FIX_0_899976223,
+                                  JPEG_FIX_1_501321110 - JPEG_FIX_0_899976223);
+    const __m128i k53 = JPEG_PAIR(JPEG_FIX_2_053119869 - JPEG_FIX_2_562915447,
+                                  -JPEG_FIX_2_562915447);
+    const __m128i k35 = JPEG_PAIR(-JPEG_FIX_2_562915447,
+                                  JPEG_FIX_3_072711026 - JPEG_FIX_2_562915447);
+    __m128i z3 = _mm_add_epi16(r[7], r[3]);
+    __m128i z4 = _mm_add_epi16(r[5], r[1]);
+    __m128i out[8][2];
+    int half;
+
+    for (half = 0; half < 2; ++half) {
+        __m128i p26, p04, p34, p71, p53;
+        __m128i tmp0, tmp1, tmp2, tmp3, tmp10, tmp11, tmp12, tmp13;
+        __m128i z3t, z4t;
+
+        if (half == 0) {
+            p26 = _mm_unpacklo_epi16(r[2], r[6]);
+            p04 = _mm_unpacklo_epi16(r[0], r[4]);
+            p34 = _mm_unpacklo_epi16(z3, z4);
+            p71 = _mm_unpacklo_epi16(r[7], r[1]);
+            p53 = _mm_unpacklo_epi16(r[5], r[3]);
+        } else {
+            p26 = _mm_unpackhi_epi16(r[2], r[6]);
+            p04 = _mm_unpackhi_epi16(r[0], r[4]);
+            p34 = _mm_unpackhi_epi16(z3, z4);
+            p71 = _mm_unpackhi_epi16(r[7], r[1]);
+            p53 = _mm_unpackhi_epi16(r[5], r[3]);
+        }
+
+        /* Even part */
+        tmp3 = _mm_madd_epi16(p26, k2);
+        tmp2 = _mm_madd_epi16(p26, k6);
+        tmp0 = _mm_madd_epi16(p04, k0p);
+        tmp1 = _mm_madd_epi16(p04, k0m);
+
+        tmp10 = _mm_add_epi32(tmp0, tmp3);
+        tmp13 = _mm_sub_epi32(tmp0, tmp3);
+        tmp11 = _mm_add_epi32(tmp1, tmp2);
+        tmp12 = _mm_sub_epi32(tmp1, tmp2);
+
+        /* Odd part */
+        z3t = _mm_madd_epi16(p34, kz3);
+        z4t = _mm_madd_epi16(p34, kz4);
+        tmp0 = _mm_add_epi32(_mm_madd_epi16(p71, k71), z3t);
+        tmp3 = _mm_add_epi32(_mm_madd_epi16(p71, k17), z4t);
+        tmp1 = _mm_add_epi32(_mm_madd_epi16(p53, k53), z4t);
+        tmp2 = _mm_add_epi32(_mm_madd_epi16(p53, k35), z3t);
+
+        out[0][half] = _mm_add_epi32(tmp10, tmp3);
+        out[7][half] = _mm_sub_epi32(tmp10, tmp3);
+        out[1][half] = _mm_add_epi32(tmp11, tmp2);
+        out[6][half] = _mm_sub_epi32(tmp11, tmp2);
+        out[2][half] = _mm_add_epi32(tmp12, tmp1);
+        out[5][half] = _mm_sub_epi32(tmp12, tmp1);
+        out[3][half] = _mm_add_epi32(tmp13, tmp0);
+        out[4][half] = _mm_sub_epi32(tmp13, tmp0);
+    }
+
+    for (half = 0; half < 8; ++half) {
+        r[half] = _mm_packs_epi32(
+            _mm_sra_epi32(_mm_add_epi32(out[half][0], round), count),
+            _mm_sra_epi32(_mm_add_epi32(out[half][1], round), count));
+    }
+}
+
+static void
+transposeSse2(__m128i *r)
+{
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+/** SSE2 8x8 inverse DCT, all eight columns or rows at once */
+static void
+idct8x8(const short *coefs, const unsigned short *quant,
+            unsigned char *out, int stride)
+{
+    const __m128i center = _mm_set1_epi16(128);
+    __m128i r[8];
+    int i;
+
+    for (i = 0; i < 8; ++i) {
+        r[i] = _mm_mullo_epi16(
+            _mm_loadu_si128((const __m128i *)(coefs + 8 * i)),
+            _mm_loadu_si128((const __m128i *)(quant + 8 * i)));
+    }
+
+    idctPassSse2(r, JPEG_CONST_BITS - JPEG_PASS1_BITS);
+    transposeSse2(r);
+    idctPassSse2(r, JPEG_CONST_BITS + JPEG_PASS1_BITS + 3);
+    transposeSse2(r);
+
+    for (i = 0; i < 8; i += 2) {
+        __m128i p = _mm_packus_epi16(_mm_adds_epi16(r[i], center),
+                                     _mm_adds_epi16(r[i + 1], center));
+
+        _mm_storel_epi64((__m128i *)out, p);
+        _mm_storel_epi64((__m128i *)(out + stride), _mm_srli_si128(p, 8));
+        out += 2 * stride;
+    }
+}
+
+#endif /* JPEG_SIMD_SSE2 */
+
+/** Decode a block of a sequential scan */
+static void
+decodeBlock(jpegDecoder *d, jpegComponent *c, short *coefs)
+{
+    const jpegHuffTable *ac = &d->acTables[c->ta];
+    int k;
+
+    c->dcPred = JPEG_WRAP_DC(c->dcPred +
+        receiveExtend(d, decodeHuffman(d, &d->dcTables[c->td])));
+    coefs[0] = (short)c->dcPred;
+
+    for (k = 1; k < 64; ++k) {
+        int rs = decodeHuffman(d, ac);
+        int s = rs & 15;
+
+        if (s != 0) {
+            k += rs >> 4;
+            coefs[jpegNaturalOrder[k]] = (short)receiveExtend(d, s);
+        } else if (rs == 0xF0) {
+            k += 15;
+        } else {
+            break;
+        }
+    }
+}
+
+/** Decode a block of the first DC scan of a progressive image */
+static void
+decodeDCFirst(jpegDecoder *d, jpegComponent *c, short *coefs)
+{
+    c->dcPred = JPEG_WRAP_DC(c->dcPred +
+        receiveExtend(d, decodeHuffman(d, &d->dcTables[c->td])));
+    coefs[0] = (short)(c->dcPred * (1 << d->al));
+}
+
+/** Decode a block of a DC refinement scan */
+static void
+decodeDCRefine(jpegDecoder *d, short *coefs)
+{
+    if (getBits(d, 1)) {
+        coefs[0] |= (short)(1 << d->al);
+    }
+}
+
+/** Decode a block of the first scan of an AC band */
+static void
+decodeACFirst(jpegDecoder *d, jpegComponent *c, short *coefs)
+{
+    const jpegHuffTable *ac = &d->acTables[c->ta];
+    int k;
+
+    if (d->eobRun > 0) {
+        d->eobRun--;
+        return;
+    }
+
+    for (k = d->ss; k <= d->se; ++k) {
+        int rs = decodeHuffman(d, ac);
+        int r = rs >> 4;
+        int s = rs & 15;
+
+        if (s != 0) {
+            k += r;
+            coefs[jpegNaturalOrder[k]] =
+                (short)(receiveExtend(d, s) * (1 << d->al));
+        } else if (r == 15) {
+            k += 15;
+        } else {
+            /* End of band in this and the following 2^r + n - 1 blocks */
+            d->eobRun = (1 << r) - 1;
+            if (r != 0) {
+                d->eobRun += getBits(d, r);
+            }
+            break;
+        }
+    }
+}
+
+/** Decode a block of an AC refinement scan */
+static void
+decodeACRefine(jpegDecoder *d, jpegComponent *c, short *coefs)
+{
+    const jpegHuffTable *ac = &d->acTables[c->ta];
+    int p1 = 1 << d->al;
+    int m1 = -p1;
+    int k = d->ss;
+
+    if (d->eobRun == 0) {
+        for (; k <= d->se; ++k) {
+            int rs = decodeHuffman(d, ac);
+            int r = rs >> 4;
+            int s = rs & 15;
+
+            if (s != 0) {
+                /* New coefficient, its magnitude is always 1 */
+                s = getBits(d, 1) ? p1 : m1;
+            } else if (r != 15) {
+                d->eobRun = 1 << r;
+                if (r != 0) {
+                    d->eobRun += getBits(d, r);
+                }
+                break;
+            }
+
+            /*
+             * Skip r zero coefficients, refining the nonzero ones
+             * passed on the way.
+             */
+            do {
+                short *coef = &coefs[jpegNaturalOrder[k]];
+
+                if (*coef != 0) {
+                    if (getBits(d, 1) && (*coef & p1) == 0) {
+                        *coef += (short)((*coef >= 0) ? p1 : m1);
+                    }
+                } else if (--r < 0) {
+                    break;
+                }
+                ++k;
+            } while (k <= d->se);
+
+            if (s != 0) {
+                coefs[jpegNaturalOrder[k]] = (short)s;
+            }
+        }
+    }
+
+    if (d->eobRun > 0) {
+        /* Refine the nonzero coefficients of the rest of the band */
+        for (; k <= d->se; ++k) {
+            short *coef = &coefs[jpegNaturalOrder[k]];
+
+            if (*coef != 0 && getBits(d, 1) && (*coef & p1) == 0) {
+                *coef += (short)((*coef >= 0) ? p1 : m1);
+            }
+        }
+        d->eobRun--;
+    }
+}
+
+/** Decode a block of the current scan into buffered coefficients */
+static void
+decodeBufferedBlock(jpegDecoder *d, jpegComponent *c, short *coefs)
+{
+    if (!d->progressive) {
+        decodeBlock(d, c, coefs);
+    } else if (d->ss == 0) {
+        if (d->ah == 0) {
+            decodeDCFirst(d, c, coefs);
+        } else {
+            decodeDCRefine(d, coefs);
+        }
+    } else if (d->ah == 0) {
+        decodeACFirst(d, c, coefs);
+    } else {
+        decodeACRefine(d, c, coefs);
+    }
+}
+
+/** Reset the decoder state at the start of a scan or a restart */
+static void
+resetEntropy(jpegDecoder *d)
+{
+    int i;
+
+    d->bitBuf = 0;
+    d->bitCount = 0;
+    d->eobRun = 0;
+    for (i = 0; i < d->nComp; ++i) {
+        d->comp[i].dcPred = 0;
+    }
+}
+
+/** Skip to the data after the next RSTn marker */
+static void
+processRestart(jpegDecoder *d)
+{
+    int marker = nextMarker(d);
+
+    if (marker >= 0 && (marker < M_RST0 || marker > M_RST7)) {
+        /* Keep other markers, the rest of the scan is zeros */
+        d->marker = marker;
+    }
+
+    resetEntropy(d);
+}
+
+/**
+ * Convert the samples of an MCU row to native pixels. Samples of
+ * subsampled components are replicated.
+ */
+static void
+outputRow(jpegDecoder *d, int mcuY)
+{
+    int rows = d->vMax * 8;
+    int y0 = mcuY * rows;
+    int width = (d->width < d->dstWidth) ? d->width : d->dstWidth;
+    int y;
+
+    if (rows > d->height - y0) {
+        rows = d->height - y0;
+    }
+    if (rows > d->dstHeight - y0) {
+        rows = d->dstHeight - y0;
+    }
+
+    for (y = 0; y < rows; ++y) {
+        img_native_pixel_type *dst = d->pixels + (y0 + y) * d->dstWidth;
+        const jpegComponent *c0 = &d->comp[0];
+        const unsigned char *s0 =
+            c0->plane + (y >> c0->vShift) * c0->planeStride;
+        int x;
+
+        if (d->nComp == 1) {
+            for (x = 0; x < width; ++x) {
+                dst[x] = (img_native_pixel_type)
+                    IMG_RGB2PIXEL(s0[x], s0[x], s0[x]);
+            }
+        } else {
+            const jpegComponent *c1 = &d->comp[1];
+            const jpegComponent *c2 = &d->comp[2];
+            const unsigned char *s1 =
+                c1->plane + (y >> c1->vShift) * c1->planeStride;
+            const unsigned char *s2 =
+                c2->plane + (y >> c2->vShift) * c2->planeStride;
+            int h0 = c0->hShift;
+            int h1 = c1->hShift;
+            int h2 = c2->hShift;
+
+            if (!d->ycc) {
+                for (x = 0; x < width; ++x) {
+                    dst[x] = (img_native_pixel_type)
+                        IMG_RGB2PIXEL(s0[x >> h0], s1[x >> h1], s2[x >> h2]);
+                }
+                continue;
+            }
+
+            for (x = 0; x < width; ++x) {
+                int luma = s0[x >> h0];
+                int cb = s1[x >> h1] - 128;
+                int cr = s2[x >> h2] - 128;
+                /* Coefficients of the JFIF conversion scaled by 2^16 */
+                int r = luma + ((91881 * cr + 32768) >> 16);
+                int g = luma + ((-22554 * cb - 46802 * cr + 32768) >> 16);
+                int b = luma + ((116130 * cb + 32768) >> 16);
+
+                r = JPEG_CLAMP(r);
+                g = JPEG_CLAMP(g);
+                b = JPEG_CLAMP(b);
+                dst[x] = (img_native_pixel_type)IMG_RGB2PIXEL(r, g, b);
+            }
+        }
+    }
+}
+
+/**
+ * Decode a sequential scan with all the components, converting each
+ * MCU row as soon as it is complete.
+ */
+static void
+decodeDirect(jpegDecoder *d)
+{
+    short coefs[64];
+    int mcus = 0;
+    int mx, my;
+
+    resetEntropy(d);
+
+    for (my = 0; my < d->mcusY; ++my) {
+        for (mx = 0; mx < d->mcusX; ++mx) {
+            int i;
+
+            if (d->restartInterval != 0 && mcus == d->restartInterval) {
+                processRestart(d);
+                mcus = 0;
+            }
+            ++mcus;
+
+            for (i = 0; i < d->nScanComp; ++i) {
+                jpegComponent *c = &d->comp[d->scanComp[i]];
+                int x, y;
+
+                for (y = 0; y < c->v; ++y) {
+                    for (x = 0; x < c->h; ++x) {
+                        memset(coefs, 0, sizeof(coefs));
+                        decodeBlock(d, c, coefs);
+                        idct8x8(coefs, d->quant[c->tq],
+                                c->plane + y * 8 * c->planeStride +
+                                (mx * c->h + x) * 8,
+                                c->planeStride);
+                    }
+                }
+            }
+        }
+
+        outputRow(d, my);
+    }
+}
+
+/** Decode a scan into the buffered coefficients */
+static void
+decodeBuffered(jpegDecoder *d)
+{
+    int mcus = 0;
+
+    resetEntropy(d);
+
+    if (d->nScanComp == 1) {
+        /* Non-interleaved, the MCU is one block */
+        jpegComponent *c = &d->comp[d->scanComp[0]];
+        int bx, by;
+
+        for (by = 0; by < c->blocksH; ++by) {
+            for (bx = 0; bx < c->blocksW; ++bx) {
+                if (d->restartInterval != 0 && mcus == d->restartInterval) {
+                    processRestart(d);
+                    mcus = 0;
+                }
+                ++mcus;
+
+                decodeBufferedBlock(d, c,
+                    c->coefs + (by * c->coefW + bx) * 64);
+            }
+        }
+    } else {
+        int mx, my;
+
+        for (my = 0; my < d->mcusY; ++my) {
+            for (mx = 0; mx < d->mcusX; ++mx) {
+                int i;
+
+                if (d->restartInterval != 0 && mcus == d->restartInterval) {
+                    processRestart(d);
+                    mcus = 0;
+                }
+                ++mcus;
+
+                for (i = 0; i < d->nScanComp; ++i) {
+                    jpegComponent *c = &d->comp[d->scanComp[i]];
+                    int x, y;
+
+                    for (y = 0; y < c->v; ++y) {
+                        for (x = 0; x < c->h; ++x) {
+                            decodeBufferedBlock(d, c, c->coefs +
+                                ((my * c->v + y) * c->coefW +
+                                 mx * c->h + x) * 64);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/** Transform the buffered coefficients and convert them to pixels */
+static void
+outputBuffered(jpegDecoder *d)
+{
+    int my;
+
+    for (my = 0; my < d->mcusY; ++my) {
+        int i;
+
+        for (i = 0; i < d->nComp; ++i) {
+            jpegComponent *c = &d->comp[i];
+            int x, y;
+
+            for (y = 0; y < c->v; ++y) {
+                const short *coefs =
+                    c->coefs + (my * c->v + y) * c->coefW * 64;
+
+                for (x = 0; x < c->coefW; ++x, coefs += 64) {
+                    idct8x8(coefs, d->quant[c->tq],
+                            c->plane + y * 8 * c->planeStride + x * 8,
+                            c->planeStride);
+                }
+            }
+        }
+
+        outputRow(d, my);
+    }
+}
+
+/** Find the color space and allocate the sample buffers of an MCU row */
+static bool
+initOutput(jpegDecoder *d)
+{
+    int i;
+
+    if (d->nComp == 3) {
+        if (d->adobeTransform >= 0) {
+            d->ycc = (d->adobeTransform != 0) ? TRUE : FALSE;
+        } else {
+            /* JFIF is YCbCr, unless the components are named RGB */
+            d->ycc = (d->comp[0].id == 'R' && d->comp[1].id == 'G' &&
+                      d->comp[2].id == 'B') ? FALSE : TRUE;
+        }
+    }
+
+    for (i = 0; i < d->nComp; ++i) {
+        jpegComponent *c = &d->comp[i];
+
+        c->planeStride = c->coefW * 8;
+        c->plane = (unsigned char *)
+            midpMalloc(c->planeStride * c->v * 8);
+        if (c->plane == NULL) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/** Allocate the coefficients of all blocks, for multi-scan images */
+static bool
+initBuffered(jpegDecoder *d)
+{
+    int i;
+
+    for (i = 0; i < d->nComp; ++i) {
+        jpegComponent *c = &d->comp[i];
+        unsigned long blocks = (unsigned long)c->coefW * d->mcusY * c->v;
+        unsigned long size = blocks * 64 * sizeof(short);
+
+        if (size / (64 * sizeof(short)) != blocks || size > 0x7FFFFFFFUL) {
+            return FALSE;
+        }
+
+        c->coefs = (short *)midpMalloc(size);
+        if (c->coefs == NULL) {
+            return FALSE;
+        }
+        memset(c->coefs, 0, size);
+    }
+
+    d->buffered = TRUE;
+    return TRUE;
+}
+
+/** Fill the part of the destination the image does not cover */
+static void
+clearUncovered(jpegDecoder *d)
+{
+    img_native_pixel_type black = (img_native_pixel_type)
+        IMG_RGB2PIXEL(0, 0, 0);
+    int y;
+
+    for (y = 0; y < d->dstHeight; ++y) {
+        img_native_pixel_type *dst = d->pixels + y * d->dstWidth;
+        int x = (y < d->height) ? d->width : 0;
+
+        for (; x < d->dstWidth; ++x) {
+            dst[x] = black;
+        }
+    }
+}
+
+bool
+decode_jpeg_image(imageSrcPtr src, img_native_pixel_type *pixels,
+                  int width, int height)
+{
+    jpegDecoder *d;
+    bool ok = FALSE;
+    bool done = FALSE;
+    int scans = 0;
+    int i;
+
+    d = (jpegDecoder *)midpMalloc(sizeof(jpegDecoder));
+    if (d == NULL) {
+        return FALSE;
+    }
+    memset(d, 0, sizeof(jpegDecoder));
+
+    d->src = src;
+    d->pixels = pixels;
+    d->dstWidth = width;
+    d->dstHeight = height;
+    d->adobeTransform = -1;
+
+    if (nextByte(d) != 0xFF || nextByte(d) != M_SOI) {
+        goto cleanup;
+    }
+
+    while (!done) {
+        int marker = nextMarker(d);
+
+        switch (marker) {
+        case M_SOF0:
+        case M_SOF1:
+        case M_SOF2:
+            if (d->width != 0 || !readFrame(d, marker) || !initOutput(d)) {
+                goto cleanup;
+            }
+            break;
+
+        case M_DHT:
+            if (!readHuffmanTables(d)) {
+                goto cleanup;
+            }
+            break;
+
+        case M_DQT:
+            if (!readQuantTables(d)) {
+                goto cleanup;
+            }
+            break;
+
+        case M_DRI:
+            if (read16(d) != 4) {
+                goto cleanup;
+            }
+            d->restartInterval = read16(d);
+            break;
+
+        case M_APP14:
+            if (!readAdobe(d)) {
+                goto cleanup;
+            }
+            break;
+
+        case M_SOS:
+            if (d->width == 0 || !readScan(d)) {
+                goto cleanup;
+            }
+
+            if (scans == 0 && !d->progressive &&
+                    d->nScanComp == d->nComp) {
+                decodeDirect(d);
+                done = TRUE;
+            } else {
+                if (!d->buffered && !initBuffered(d)) {
+                    goto cleanup;
+                }
+                decodeBuffered(d);
+            }
+            ++scans;
+            break;
+
+        case M_EOI:
+        case -1:
+            /* Images cut after a scan are shown as far as decoded */
+            done = TRUE;
+            break;
+
+        case M_TEM:
+        case M_RST0: case M_RST0 + 1: case M_RST0 + 2: case M_RST0 + 3:
+        case M_RST0 + 4: case M_RST0 + 5: case M_RST0 + 6: case M_RST7:
+            /* No parameters */
+            break;
+
+        default:
+            if (marker >= M_SOF3 && marker <= M_SOF15 &&
+                    marker != M_DHT && marker != M_JPG && marker != M_DAC) {
+                REPORT_WARN1(LC_LOWUI,
+                    "JPEG: unsupported coding process 0x%X\n", marker);
+                goto cleanup;
+            }
+
+            if (!skipSegment(d)) {
+                goto cleanup;
+            }
+            break;
+        }
+    }
+
+    if (scans == 0) {
+        goto cleanup;
+    }
+
+    if (d->buffered) {
+        outputBuffered(d);
+    }
+    clearUncovered(d);
+    ok = TRUE;
+
+ cleanup:
+    for (i = 0; i < JPEG_MAX_COMPONENTS; ++i) {
+        if (d->comp[i].plane != NULL) {
+            midpFree(d->comp[i].plane);
+        }
+        if (d->comp[i].coefs != NULL) {
+            midpFree(d->comp[i].coefs);
+        }
+    }
+    midpFree(d);
+
+    return ok;
+}
@@ -27,7 +27,7 @@
 #include <string.h>
 
 #include <jar.h>
-#include <pcsl_memory.h>
+#include <midpMalloc.h>
 #include <midp_logging.h>
 
 #include "imgdcd_intern_image_decode.h"
@@ -44,7 +44,42 @@
 #define CT_COLOR    0x02
 #define CT_ALPHA    0x04
 
-#define freeBytes(p) pcsl_mem_free((p))
+#define freeBytes(p) midpFree((p))
+
+/**
+ * Size of the inflater window used to decode non-interlaced images row
+ * by row. Images with less data are inflated into a buffer of their
+ * size, the window must be at least INFLATE_MIN_SINK_BUFFER_SIZE.
+ */
+#ifndef PNG_INFLATE_BUFFER_SIZE
+#define PNG_INFLATE_BUFFER_SIZE (64 * 1024)
+#endif
+
+/**
+ * By default the filters of rows are undone with vector kernels where
+ * the compiler supports them, define to 0 to use the portable loops.
+ */
+#ifndef ENABLE_PNG_SIMD
+#define ENABLE_PNG_SIMD 1
+#endif
+
+#if ENABLE_PNG_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PNG_SIMD_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PNG_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+#endif /* ENABLE_PNG_SIMD */
+
+#ifndef PNG_SIMD_SSE2
+#define PNG_SIMD_SSE2 0
+#endif
+#ifndef PNG_SIMD_NEON
+#define PNG_SIMD_NEON 0
+#endif
 
 typedef struct _pngData {
       signed int   width;
@@ -79,6 +114,8 @@ static unsigned long readPalette(imageSrcPtr, long, pngData *,
 static unsigned long readTransPal(imageSrcPtr, long, pngData *,
                                   unsigned char *, unsigned long);
 static bool handleImageData(unsigned char *, int, imageDstPtr, pngData *);
+static int decodeRows(FileObj *, HeapManObj *, int, int, imageDstPtr,
+                      pngData *);
 static unsigned long getInt(imageSrcPtr);
 static unsigned long skip(imageSrcPtr, int, unsigned long);
 static bool getChunk(imageSrcPtr, unsigned long *, long *);
@@ -163,13 +200,13 @@ static int PNGdecodeImage_seek(void* p, long offset, int whence) {
 /* returns a memory handle, call addrFromHandle to use */
 static void* allocFunction(void* state, int n) {
     (void)state;
-    return pcsl_mem_malloc(n);
+    return midpMalloc(n);
 }
 
 /* handle, is a memory handle */
 static void freeFunction(void* state, void* handle) {
     (void)state;
-    pcsl_mem_free(handle);
+    midpFree(handle);
 }
 
 /* This function is to support heaps that compact memory. */
@@ -407,12 +444,6 @@ PNGdecodeImage_real(imageSrcPtr src, imageDstPtr dst,
 
             src->seek(src, startPos);    /* reset to the first IDAT_CHUNK */
 
-            decompBuf = (unsigned char*)pcsl_mem_malloc(decompLen);
-            if (decompBuf == NULL) {
-                OK = FALSE;
-		goto done;
-            }
-
             /*
              * inflate ignores the method and flags
              */
@@ -431,17 +462,45 @@ PNGdecodeImage_real(imageSrcPtr src, imageDstPtr dst,
             heapManObj.free = freeFunction;
             heapManObj.addrFromHandle = addrFromHandleFunction;
 
-            /* subtract 4 bytes from compLen -- it's the ZLIB trailer */
-            if (inflateData(&fileObj, &heapManObj, compLen - 4,
-                             decompBuf, decompLen, 0) != 0) {
-                freeBytes(decompBuf);
-		goto formaterror;
-	    }
+            if (!data.interlace) {
+                /*
+                 * Rows are unfiltered and sent as soon as they are
+                 * inflated, so the image data is never in memory as
+                 * a whole. Subtract 4 bytes of the ZLIB trailer.
+                 */
+                int status = decodeRows(&fileObj, &heapManObj, compLen - 4,
+                                        decompLen, dst, &data);
+                if (status == OUT_OF_MEMORY_ERROR) {
+                    OK = FALSE;
+                    goto done;
+                } else if (status != 0) {
+                    goto formaterror;
+                }
 
-            OK = handleImageData(decompBuf, decompLen, dst, &data);
+                src->seek(src, lastGoodPos);
+            } else {
+                /*
+                 * Interlaced rows are made of the rows of several
+                 * passes, all of them have to be inflated first.
+                 */
+                decompBuf = (unsigned char*)midpMalloc(decompLen);
+                if (decompBuf == NULL) {
+                    OK = FALSE;
+                    goto done;
+                }
 
-            freeBytes(decompBuf);
-            src->seek(src, lastGoodPos);
+                /* subtract 4 bytes from compLen -- it's the ZLIB trailer */
+                if (inflateData(&fileObj, &heapManObj, compLen - 4,
+                                decompBuf, decompLen, 0) != 0) {
+                    freeBytes(decompBuf);
+                    goto formaterror;
+                }
+
+                OK = handleImageData(decompBuf, decompLen, dst, &data);
+
+                freeBytes(decompBuf);
+                src->seek(src, lastGoodPos);
+            }
         } else if (chunkType == IEND_CHUNK) {
             /* shouldn't happen because getChunk checks for this! */
         } else {
@@ -481,21 +540,21 @@ decode_png_image(imageSrcPtr src, imageDstPtr dst) {
     long * paletteData;
     unsigned char * transData;
 
-    paletteData = pcsl_mem_malloc(sizeof(long) * 256);
+    paletteData = midpMalloc(sizeof(long) * 256);
     if (paletteData == NULL) {
 	/* out of memory */
 	return FALSE;
     } else {
-	transData = pcsl_mem_malloc(sizeof(unsigned char) * 256);
+	transData = midpMalloc(sizeof(unsigned char) * 256);
 	if (transData == NULL) {
 	    /* out of memory */
-	    pcsl_mem_free(paletteData);
+	    midpFree(paletteData);
 	    return FALSE;
 	} else {
 	    bool retval = PNGdecodeImage_real(src, dst, 
 						  paletteData, transData);
-	    pcsl_mem_free(paletteData);
-	    pcsl_mem_free(transData);
+	    midpFree(paletteData);
+	    midpFree(transData);
 	    return retval;
 	}
     }
@@ -663,6 +722,238 @@ readTransPal(imageSrcPtr src, long length, pngData *data,
     return CRC;
 }
 
+#if PNG_SIMD_SSE2 || PNG_SIMD_NEON
+
+/*
+ * Vector kernels undoing the filters of a row. Up is vectorized over
+ * the whole row; Sub, Average and Paeth depend on the pixel to the
+ * left, so for 3 and 4 byte pixels they process the channels of one
+ * pixel at a time in vector lanes. Other pixel sizes use the portable
+ * loops of applyFilter().
+ */
+
+/** Read a 3 or 4 byte pixel into the low bytes of an int */
+static unsigned int
+loadPixel(const unsigned char *p, int bpp)
+{
+    unsigned int v = p[0] | (p[1] << 8) | (p[2] << 16);
+
+    if (bpp == 4) {
+        v |= (unsigned int)p[3] << 24;
+    }
+    return v;
+}
+
+/** Write a 3 or 4 byte pixel from the low bytes of an int */
+static void
+storePixel(unsigned char *p, unsigned int v, int bpp)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    if (bpp == 4) {
+        p[3] = (unsigned char)(v >> 24);
+    }
+}
+
+#if PNG_SIMD_SSE2
+
+static void
+unfilterUp(unsigned char *buf, int n, const unsigned char *prev)
+{
+    int x = 0;
+
+    for (; x + 16 <= n; x += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(buf + x));
+        __m128i b = _mm_loadu_si128((const __m128i *)(prev + x));
+        _mm_storeu_si128((__m128i *)(buf + x), _mm_add_epi8(d, b));
+    }
+    for (; x < n; ++x) {
+        buf[x] += prev[x];
+    }
+}
+
+static void
+unfilterSub(unsigned char *buf, int n, int bpp)
+{
+    __m128i a = _mm_setzero_si128();
+    int x;
+
+    for (x = 0; x < n; x += bpp) {
+        __m128i d = _mm_cvtsi32_si128((int)loadPixel(buf + x, bpp));
+        a = _mm_add_epi8(d, a);
+        storePixel(buf + x, (unsigned int)_mm_cvtsi128_si32(a), bpp);
+    }
+}
+
+static void
+unfilterAvg(unsigned char *buf, int n, const unsigned char *prev, int bpp)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    int x;
+
+    for (x = 0; x < n; x += bpp) {
+        __m128i b = _mm_cvtsi32_si128((int)loadPixel(prev + x, bpp));
+        __m128i d = _mm_cvtsi32_si128((int)loadPixel(buf + x, bpp));
+        /* _mm_avg_epu8 rounds up, take the carry back to round down */
+        __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+                                   _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(d, avg);
+        storePixel(buf + x, (unsigned int)_mm_cvtsi128_si32(a), bpp);
+    }
+}
+
+static void
+unfilterPaeth(unsigned char *buf, int n, const unsigned char *prev, int bpp)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero;
+    __m128i c = zero;
+    int x;
+
+    /* The channels are widened to 16 bits, a + b - 2c does not fit 8 */
+    for (x = 0; x < n; x += bpp) {
+        __m128i b = _mm_unpacklo_epi8(
+            _mm_cvtsi32_si128((int)loadPixel(prev + x, bpp)), zero);
+        __m128i d = _mm_cvtsi32_si128((int)loadPixel(buf + x, bpp));
+        __m128i pa = _mm_sub_epi16(b, c);
+        __m128i pb = _mm_sub_epi16(a, c);
+        __m128i pc = _mm_add_epi16(pa, pb);
+        __m128i useA, useB, nearest;
+
+        pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+        pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+        pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+        /* a if pa <= pb and pa <= pc, else b if pb <= pc, else c */
+        useA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+        useB = _mm_cmpgt_epi16(pb, pc);
+        nearest = _mm_or_si128(_mm_and_si128(useB, c),
+                               _mm_andnot_si128(useB, b));
+        nearest = _mm_or_si128(_mm_and_si128(useA, nearest),
+                               _mm_andnot_si128(useA, a));
+
+        d = _mm_add_epi8(d, _mm_packus_epi16(nearest, nearest));
+        storePixel(buf + x, (unsigned int)_mm_cvtsi128_si32(d), bpp);
+        a = _mm_unpacklo_epi8(d, zero);
+        c = b;
+    }
+}
+
+#else /* PNG_SIMD_NEON */
+
+static void
+unfilterUp(unsigned char *buf, int n, const unsigned char *prev)
+{
+    int x = 0;
+
+    for (; x + 16 <= n; x += 16) {
+        vst1q_u8(buf + x, vaddq_u8(vld1q_u8(buf + x), vld1q_u8(prev + x)));
+    }
+    for (; x < n; ++x) {
+        buf[x] += prev[x];
+    }
+}
+
+static void
+unfilterSub(unsigned char *buf, int n, int bpp)
+{
+    uint8x8_t a = vdup_n_u8(0);
+    int x;
+
+    for (x = 0; x < n; x += bpp) {
+        uint8x8_t d = vcreate_u8((uint64_t)loadPixel(buf + x, bpp));
+        a = vadd_u8(d, a);
+        storePixel(buf + x, vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+    }
+}
+
+static void
+unfilterAvg(unsigned char *buf, int n, const unsigned char *prev, int bpp)
+{
+    uint8x8_t a = vdup_n_u8(0);
+    int x;
+
+    for (x = 0; x < n; x += bpp) {
+        uint8x8_t b = vcreate_u8((uint64_t)loadPixel(prev + x, bpp));
+        uint8x8_t d = vcreate_u8((uint64_t)loadPixel(buf + x, bpp));
+        /* vhadd_u8 is (a + b) >> 1 without overflow */
+        a = vadd_u8(d, vhadd_u8(a, b));
+        storePixel(buf + x, vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+    }
+}
+
+static void
+unfilterPaeth(unsigned char *buf, int n, const unsigned char *prev, int bpp)
+{
+    int16x8_t a = vdupq_n_s16(0);
+    int16x8_t c = vdupq_n_s16(0);
+    int x;
+
+    /* The channels are widened to 16 bits, a + b - 2c does not fit 8 */
+    for (x = 0; x < n; x += bpp) {
+        int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(
+            vcreate_u8((uint64_t)loadPixel(prev + x, bpp))));
+        uint8x8_t d = vcreate_u8((uint64_t)loadPixel(buf + x, bpp));
+        int16x8_t pa = vabdq_s16(b, c);
+        int16x8_t pb = vabdq_s16(a, c);
+        int16x8_t pc = vabsq_s16(vsubq_s16(vaddq_s16(a, b),
+                                           vshlq_n_s16(c, 1)));
+        /* a if pa <= pb and pa <= pc, else b if pb <= pc, else c */
+        uint16x8_t useA = vandq_u16(vcleq_s16(pa, pb), vcleq_s16(pa, pc));
+        uint16x8_t useB = vcleq_s16(pb, pc);
+        int16x8_t nearest = vbslq_s16(useA, a, vbslq_s16(useB, b, c));
+
+        d = vadd_u8(d, vmovn_u16(vreinterpretq_u16_s16(nearest)));
+        storePixel(buf + x, vget_lane_u32(vreinterpret_u32_u8(d), 0), bpp);
+        a = vreinterpretq_s16_u16(vmovl_u8(d));
+        c = b;
+    }
+}
+
+#endif /* PNG_SIMD_SSE2 */
+
+/**
+ * Undo the filter of a row with the vector kernels.
+ *
+ * @return TRUE if the row was unfiltered, FALSE if the portable
+ *         loops have to be used
+ */
+static bool
+applyFilterSimd(int filterType, unsigned char *buf, int n,
+                unsigned char *prev, int bpp)
+{
+    if (filterType == 2) {
+        unfilterUp(buf, n, prev);
+        return TRUE;
+    }
+
+    /* The row length is a multiple of the pixel size for these depths */
+    if ((bpp != 3 && bpp != 4) || (n % bpp) != 0) {
+        return FALSE;
+    }
+
+    switch (filterType) {
+    case 1:
+        unfilterSub(buf, n, bpp);
+        return TRUE;
+
+    case 3:
+        unfilterAvg(buf, n, prev, bpp);
+        return TRUE;
+
+    case 4:
+        unfilterPaeth(buf, n, prev, bpp);
+        return TRUE;
+
+    default:
+        return FALSE;
+    }
+}
+
+#endif /* PNG_SIMD_SSE2 || PNG_SIMD_NEON */
+
 static void
 applyFilter(int filterType, unsigned char *buf, int n,
             unsigned char *prev, int bpp)
@@ -684,6 +975,13 @@ applyFilter(int filterType, unsigned char *buf, int n,
         }
     }
 
+#if PNG_SIMD_SSE2 || PNG_SIMD_NEON
+    /* prev is not NULL here unless the filter is Sub */
+    if (applyFilterSimd(filterType, buf, n, prev, bpp)) {
+        return;
+    }
+#endif
+
     switch (filterType) {
     case 1:
         /*
@@ -1505,7 +1803,7 @@ handleImageData(unsigned char *pixels, int pixelsLength,
     filterAllRows(pixels, data);
 
     if (data->interlace) {
-        scanline = (unsigned char *) pcsl_mem_malloc(data->width * pixelSize);
+        scanline = (unsigned char *) midpMalloc(data->width * pixelSize);
         if (scanline == NULL) {
             return FALSE;
         }
@@ -1524,7 +1822,7 @@ handleImageData(unsigned char *pixels, int pixelsLength,
          i.e. 8 bit Palette or 8 bit RGB/gs without transparency*/
         sendDirect = TRUE;
     } else if (scanline == NULL) {
-        scanline = (unsigned char *) pcsl_mem_malloc(data->width * pixelSize);
+        scanline = (unsigned char *) midpMalloc(data->width * pixelSize);
         if (scanline == NULL) {
             return FALSE;
         }
@@ -1575,12 +1873,141 @@ handleImageData(unsigned char *pixels, int pixelsLength,
     }
 
     if (scanline != NULL) {
-        pcsl_mem_free(scanline);
+        midpFree(scanline);
     }
 
     return TRUE;
 }
 
+/** State of the sink unfiltering and sending the rows of an image */
+typedef struct _pngRowSink {
+    imageDstPtr    dst;
+    pngData       *data;
+    unsigned char *rows[2];    /* the current and the previous row */
+    unsigned char *scanline;   /* NULL when rows are sent directly */
+    int            cur;        /* index of the row being filled */
+    int            filled;     /* bytes of the current row received */
+    int            y;          /* number of the current row */
+} pngRowSink;
+
+/**
+ * Inflater sink receiving non-interlaced image data. The rows are
+ * copied out of the inflater window, because the window has to keep
+ * the bytes as they were inflated, then unfiltered and sent.
+ */
+static int
+PNGdecodeImage_sinkRows(void *p, unsigned char *bytes, int length)
+{
+    pngRowSink *sink = (pngRowSink *)p;
+    pngData *data = sink->data;
+    int n = data->lineBytes[6];
+
+    while (length > 0) {
+        unsigned char *row = sink->rows[sink->cur];
+        int count = n - sink->filled;
+
+        if (sink->y >= data->height) {
+            /* more data than rows */
+            return -1;
+        }
+
+        if (count > length) {
+            count = length;
+        }
+
+        memcpy(row + sink->filled, bytes, count);
+        sink->filled += count;
+        bytes += count;
+        length -= count;
+
+        if (sink->filled == n) {
+            applyFilter(row[0], row + 1, n - 1,
+                        sink->y > 0 ? sink->rows[sink->cur ^ 1] + 1 : NULL,
+                        data->bytesPerPixel);
+
+            if (sink->scanline == NULL) {
+                sink->dst->sendPixels(sink->dst, sink->y, row + 1,
+                                      data->colorType);
+            } else {
+                unpack1(sink->scanline, row + 1, data);
+                sink->dst->sendPixels(sink->dst, sink->y, sink->scanline,
+                                      data->colorType);
+            }
+
+            sink->cur ^= 1;
+            sink->filled = 0;
+            sink->y++;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Inflate, unfilter and send the rows of a non-interlaced image.
+ * Only two rows and a window of the inflated data are kept in
+ * memory instead of the whole image data.
+ *
+ * @return 0 if all the rows were sent, OUT_OF_MEMORY_ERROR if there
+ *         is not enough memory, other inflater error code otherwise
+ */
+static int
+decodeRows(FileObj *fileObj, HeapManObj *heapManObj, int compLen,
+           int decompLen, imageDstPtr dst, pngData *data)
+{
+    int pixelSize = ((data->colorType & (CT_PALETTE | CT_COLOR)) ? 3 : 1) +
+                    (((data->colorType & CT_ALPHA) || (data->trans != NULL))
+                     ? 1 : 0);
+    int n = data->lineBytes[6];
+    int bufferLen = decompLen;
+    unsigned char *buffer;
+    pngRowSink sink;
+    int status;
+
+    if (bufferLen > PNG_INFLATE_BUFFER_SIZE) {
+        bufferLen = PNG_INFLATE_BUFFER_SIZE;
+    }
+
+    sink.dst = dst;
+    sink.data = data;
+    sink.scanline = NULL;
+    sink.cur = 0;
+    sink.filled = 0;
+    sink.y = 0;
+
+    buffer = (unsigned char *)midpMalloc(bufferLen + 2 * n);
+    if (buffer == NULL) {
+        return OUT_OF_MEMORY_ERROR;
+    }
+    sink.rows[0] = buffer + bufferLen;
+    sink.rows[1] = sink.rows[0] + n;
+
+    if ( (data->depth != 8) ||
+         ( !(data->colorType & CT_PALETTE) && (data->trans != NULL) ) ) {
+        /* not in the desired format, rows are unpacked first */
+        sink.scanline = (unsigned char *)
+            midpMalloc(data->width * pixelSize);
+        if (sink.scanline == NULL) {
+            midpFree(buffer);
+            return OUT_OF_MEMORY_ERROR;
+        }
+    }
+
+    status = inflateDataToSink(fileObj, heapManObj, compLen,
+                               buffer, bufferLen, decompLen,
+                               PNGdecodeImage_sinkRows, &sink);
+    if (status == 0 && sink.y != data->height) {
+        status = INFLATE_OUTPUT_OVERFLOW;
+    }
+
+    if (sink.scanline != NULL) {
+        midpFree(sink.scanline);
+    }
+    midpFree(buffer);
+
+    return status;
+}
+
 
 static unsigned long
 getInt(imageSrcPtr src)
@@ -1713,32 +2140,77 @@ check_CRC(imageSrcPtr src, unsigned long CRC)
 /***** CRC support, copied from PNG spec *****/
 
 
-/* Table of CRCs of all 8-bit messages.  */
-static unsigned long crc_table[256];
-
-/* Flag: has the table been computed? Initially false. */
-static int crc_table_computed = 0;
-
-/* Make the table for a fast CRC. */
-static void
-make_crc_table(void)
-{
-    unsigned long c;
-    int n, k;
-
-    for (n = 0; n < 256; n++) {
-        c = (unsigned long) n;
-        for (k = 0; k < 8; k++) {
-            if (c & 1) {
-                c = 0xedb88320L ^ (c >> 1);
-            } else {
-                c = c >> 1;
-            }
-        }
-        crc_table[n] = c;
-    }
-    crc_table_computed = 1;
-}
+/*
+ * Table of CRCs of all 8-bit messages, as computed by make_crc_table()
+ * of the PNG spec. It is constant so that images can be decoded on
+ * several threads at once.
+ */
+static const unsigned long crc_table[256] = {
+    0x00000000UL, 0x77073096UL, 0xee0e612cUL, 0x990951baUL,
+    0x076dc419UL, 0x706af48fUL, 0xe963a535UL, 0x9e6495a3UL,
+    0x0edb8832UL, 0x79dcb8a4UL, 0xe0d5e91eUL, 0x97d2d988UL,
+    0x09b64c2bUL, 0x7eb17cbdUL, 0xe7b82d07UL, 0x90bf1d91UL,
+    0x1db71064UL, 0x6ab020f2UL, 0xf3b97148UL, 0x84be41deUL,
+    0x1adad47dUL, 0x6ddde4ebUL, 0xf4d4b551UL, 0x83d385c7UL,
+    0x136c9856UL, 0x646ba8c0UL, 0xfd62f97aUL, 0x8a65c9ecUL,
+    0x14015c4fUL, 0x63066cd9UL, 0xfa0f3d63UL, 0x8d080df5UL,
+    0x3b6e20c8UL, 0x4c69105eUL, 0xd56041e4UL, 0xa2677172UL,
+    0x3c03e4d1UL, 0x4b04d447UL, 0xd20d85fdUL, 0xa50ab56bUL,
+    0x35b5a8faUL, 0x42b2986cUL, 0xdbbbc9d6UL, 0xacbcf940UL,
+    0x32d86ce3UL, 0x45df5c75UL, 0xdcd60dcfUL, 0xabd13d59UL,
+    0x26d930acUL, 0x51de003aUL, 0xc8d75180UL, 0xbfd06116UL,
+    0x21b4f4b5UL, 0x56b3c423UL, 0xcfba9599UL, 0xb8bda50fUL,
+    0x2802b89eUL, 0x5f058808UL, 0xc60cd9b2UL, 0xb10be924UL,
+    0x2f6f7c87UL, 0x58684c11UL, 0xc1611dabUL, 0xb6662d3dUL,
+    0x76dc4190UL, 0x01db7106UL, 0x98d220bcUL, 0xefd5102aUL,
+    0x71b18589UL, 0x06b6b51fUL, 0x9fbfe4a5UL, 0xe8b8d433UL,
+    0x7807c9a2UL, 0x0f00f934UL, 0x9609a88eUL, 0xe10e9818UL,
+    0x7f6a0dbbUL, 0x086d3d2dUL, 0x91646c97UL, 0xe6635c01UL,
+    0x6b6b51f4UL, 0x1c6c6162UL, 0x856530d8UL, 0xf262004eUL,
+    0x6c0695edUL, 0x1b01a57bUL, 0x8208f4c1UL, 0xf50fc457UL,
+    0x65b0d9c6UL, 0x12b7e950UL, 0x8bbeb8eaUL, 0xfcb9887cUL,
+    0x62dd1ddfUL, 0x15da2d49UL, 0x8cd37cf3UL, 0xfbd44c65UL,
+    0x4db26158UL, 0x3ab551ceUL, 0xa3bc0074UL, 0xd4bb30e2UL,
+    0x4adfa541UL, 0x3dd895d7UL, 0xa4d1c46dUL, 0xd3d6f4fbUL,
+    0x4369e96aUL, 0x346ed9fcUL, 0xad678846UL, 0xda60b8d0UL,
+    0x44042d73UL, 0x33031de5UL, 0xaa0a4c5fUL, 0xdd0d7cc9UL,
+    0x5005713cUL, 0x270241aaUL, 0xbe0b1010UL, 0xc90c2086UL,
+    0x5768b525UL, 0x206f85b3UL, 0xb966d409UL, 0xce61e49fUL,
+    0x5edef90eUL, 0x29d9c998UL, 0xb0d09822UL, 0xc7d7a8b4UL,
+    0x59b33d17UL, 0x2eb40d81UL, 0xb7bd5c3bUL, 0xc0ba6cadUL,
+    0xedb88320UL, 0x9abfb3b6UL, 0x03b6e20cUL, 0x74b1d29aUL,
+    0xead54739UL, 0x9dd277afUL, 0x04db2615UL, 0x73dc1683UL,
+    0xe3630b12UL, 0x94643b84UL, 0x0d6d6a3eUL, 0x7a6a5aa8UL,
+    0xe40ecf0bUL, 0x9309ff9dUL, 0x0a00ae27UL, 0x7d079eb1UL,
+    0xf00f9344UL, 0x8708a3d2UL, 0x1e01f268UL, 0x6906c2feUL,
+    0xf762575dUL, 0x806567cbUL, 0x196c3671UL, 0x6e6b06e7UL,
+    0xfed41b76UL, 0x89d32be0UL, 0x10da7a5aUL, 0x67dd4accUL,
+    0xf9b9df6fUL, 0x8ebeeff9UL, 0x17b7be43UL, 0x60b08ed5UL,
+    0xd6d6a3e8UL, 0xa1d1937eUL, 0x38d8c2c4UL, 0x4fdff252UL,
+    0xd1bb67f1UL, 0xa6bc5767UL, 0x3fb506ddUL, 0x48b2364bUL,
+    0xd80d2bdaUL, 0xaf0a1b4cUL, 0x36034af6UL, 0x41047a60UL,
+    0xdf60efc3UL, 0xa867df55UL, 0x316e8eefUL, 0x4669be79UL,
+    0xcb61b38cUL, 0xbc66831aUL, 0x256fd2a0UL, 0x5268e236UL,
+    0xcc0c7795UL, 0xbb0b4703UL, 0x220216b9UL, 0x5505262fUL,
+    0xc5ba3bbeUL, 0xb2bd0b28UL, 0x2bb45a92UL, 0x5cb36a04UL,
+    0xc2d7ffa7UL, 0xb5d0cf31UL, 0x2cd99e8bUL, 0x5bdeae1dUL,
+    0x9b64c2b0UL, 0xec63f226UL, 0x756aa39cUL, 0x026d930aUL,
+    0x9c0906a9UL, 0xeb0e363fUL, 0x72076785UL, 0x05005713UL,
+    0x95bf4a82UL, 0xe2b87a14UL, 0x7bb12baeUL, 0x0cb61b38UL,
+    0x92d28e9bUL, 0xe5d5be0dUL, 0x7cdcefb7UL, 0x0bdbdf21UL,
+    0x86d3d2d4UL, 0xf1d4e242UL, 0x68ddb3f8UL, 0x1fda836eUL,
+    0x81be16cdUL, 0xf6b9265bUL, 0x6fb077e1UL, 0x18b74777UL,
+    0x88085ae6UL, 0xff0f6a70UL, 0x66063bcaUL, 0x11010b5cUL,
+    0x8f659effUL, 0xf862ae69UL, 0x616bffd3UL, 0x166ccf45UL,
+    0xa00ae278UL, 0xd70dd2eeUL, 0x4e048354UL, 0x3903b3c2UL,
+    0xa7672661UL, 0xd06016f7UL, 0x4969474dUL, 0x3e6e77dbUL,
+    0xaed16a4aUL, 0xd9d65adcUL, 0x40df0b66UL, 0x37d83bf0UL,
+    0xa9bcae53UL, 0xdebb9ec5UL, 0x47b2cf7fUL, 0x30b5ffe9UL,
+    0xbdbdf21cUL, 0xcabac28aUL, 0x53b39330UL, 0x24b4a3a6UL,
+    0xbad03605UL, 0xcdd70693UL, 0x54de5729UL, 0x23d967bfUL,
+    0xb3667a2eUL, 0xc4614ab8UL, 0x5d681b02UL, 0x2a6f2b94UL,
+    0xb40bbe37UL, 0xc30c8ea1UL, 0x5a05df1bUL, 0x2d02ef8dUL
+};
 
 /*
 * Update a running CRC with the bytes buf[0..len-1]
@@ -1749,10 +2221,6 @@ update_crc(unsigned long crc, unsigned char *buf, int len)
     unsigned long c = crc;
     int n;
 
-    if (!crc_table_computed) {
-        make_crc_table();
-    }
-
     for (n = 0; n < len; n++) {
         c = crc_table[(c ^ buf[n]) & 0xff] ^ (c >> 8);
     }
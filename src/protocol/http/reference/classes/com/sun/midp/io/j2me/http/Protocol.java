@@ -127,6 +127,8 @@ public class Protocol extends ConnectionBaseAdapter
     private static boolean isUseAbsUrl;
     /** Maximum number of persistent connections. */
     private static int maxNumberOfPersistentConnections = 4;
+    /** Maximum number of persistent connections to the same host. */
+    private static int maxNumberOfPersistentConnectionsPerHost = 2;
     /** Connection linger time in the pool, default 60 seconds. */
     private static long connectionLingerTime = 60000;
     /** Persistent connection pool. */
@@ -181,6 +183,15 @@ public class Protocol extends ConnectionBaseAdapter
                 "com.sun.midp.io.http.max_persistent_connections",
                 maxNumberOfPersistentConnections);
 
+        /*
+         * Get the maximum number of persistent connections to the same
+         * host, 0 means the only limit is the total number.
+         */
+        maxNumberOfPersistentConnectionsPerHost =
+            Configuration.getNonNegativeIntProperty(
+                "com.sun.midp.io.http.max_persistent_connections_per_host",
+                maxNumberOfPersistentConnectionsPerHost);
+
         // Get how long a "not in use" connection should stay in the pool.
         connectionLingerTime =
             (long)Configuration.getNonNegativeIntProperty(
@@ -189,6 +200,7 @@ public class Protocol extends ConnectionBaseAdapter
 
         connectionPool = new StreamConnectionPool(
                                  maxNumberOfPersistentConnections,
+                                 maxNumberOfPersistentConnectionsPerHost,
                                  connectionLingerTime);
 
         /*
@@ -245,8 +257,11 @@ public class Protocol extends ConnectionBaseAdapter
     protected DataOutputStream streamOutput;
     /** Low level socket input stream. */
     protected DataInputStream streamInput;
-    /** A shared temporary header buffer. */
-    private StringBuffer stringbuffer;
+    /**
+     * Request header held back to be written together with the request
+     * body, null when there is none.
+     */
+    private byte[] pendingRequestHeader;
     /** HTTP version string set with all incoming HTTP responses. */
     private String httpVer = null;
     /** Used when appl calls setRequestProperty("Connection", "close"). */
@@ -281,6 +296,10 @@ public class Protocol extends ConnectionBaseAdapter
     private int bytesleft;
     /** Number of bytes read from the internal input stream buffer. */ 
     private int bytesread;     
+    /** True if a CRLF ends the chunk data before the next chunk size. */
+    private boolean chunkCRLFPending;
+    /** Scratch characters for making strings of header bytes. */
+    private char[] linechars;
     /** Buffered data output for content length calculation. */
     private byte[] writebuf;         
     /** Number of bytes of data that need to be written from the buffer. */
@@ -304,7 +323,6 @@ public class Protocol extends ConnectionBaseAdapter
     public Protocol() {
         reqProperties = new Properties();
         headerFields = new Properties();
-        stringbuffer = new StringBuffer(32);
 
         method = GET;
         responseCode = -1;
@@ -645,15 +663,6 @@ public class Protocol extends ConnectionBaseAdapter
             return 0;
         }
 
-        /*
-         * Regardless of chunked or non-chunked transfers -
-         * if data is already buffered return the amount 
-         * buffered.
-         */
-        if (bytesleft > 0) { 
-            return bytesleft; 
-        }
-                
         if (chunkedIn && totalbytesread == chunksize) { 
             /* 
              * Check if a new chunk size header is available.
@@ -662,12 +671,22 @@ public class Protocol extends ConnectionBaseAdapter
         } 
 
         /*
-         * Otherwise rely on the lower level stream available
-         * count for the nonchunked input stream.
+         * Regardless of chunked or non-chunked transfers -
+         * if data is already buffered return the amount 
+         * buffered, otherwise rely on the lower level stream.
          */
-        bytesAvailable =  streamInput.available();
-        if (chunksize <= bytesAvailable) {
-            return chunksize;
+        if (bytesleft > 0) { 
+            bytesAvailable = bytesleft;
+        } else {
+            bytesAvailable = streamInput.available();
+        }
+
+        /*
+         * The buffer may hold the framing of the next chunk,
+         * do not count beyond the current chunk.
+         */
+        if (chunksize >= 0 && chunksize - totalbytesread < bytesAvailable) {
+            return chunksize - totalbytesread;
         }
 
         return bytesAvailable;
@@ -675,72 +694,29 @@ public class Protocol extends ConnectionBaseAdapter
 
 
     /** 
-     * Read a chunk size header into the readLine buffer
-     * without blocking. The stringbuffer is populated
-     * with characters one at a time. This routine is design
-     * so that a partial chunk size header could be read
-     * and then completed by a blocking read of the chunk 
-     * or a subsequent call to available.
+     * Read a chunk size header into the internal buffer
+     * without blocking. This routine is design so that a
+     * partial chunk size header could be read and then
+     * completed by a blocking read of the chunk or a
+     * subsequent call to available.
      *
      * @return available data that can be read
      */
     int readChunkSizeNonBlocking() throws IOException {
-        /*
-         * Check the underlying stream to see how many bytes are
-         * available. Do not read beyond the available characters,
-         * because that would block.
-         */
-        int len = streamInput.available();
-        
-        /* Reset the last character from the current readLine buffer. */
-        int sblen = stringbuffer.length();
-        char lastchar = '\0';
-        if (sblen > 0) {
-            lastchar = stringbuffer.charAt(sblen - 1);
-        }
+        int size = parseBufferedChunkSize();
+        int len;
 
-        int size = -1;
-        /*
-         * Loop through the available characters until a full 
-         * chunk size header is in the readLine buffer.
-         */
-        for (; len > 0; len--) {
-            char c = (char) streamInput.read();
-            
-            if (lastchar == '\r' && c == '\n') {
-                // remove the '\r' from the buffer
-                stringbuffer.setLength(stringbuffer.length() - 1);
-
-                if (stringbuffer.length() > 0) {
-                    // this is a size, not the CRLF at the end of a chunk
-                    try {
-                        String temp = stringbuffer.toString();
-                        int semi = temp.indexOf(';');
-
-                        // skip extensions
-                        if (semi > 0) {
-                            temp = temp.substring(0, semi);
-                        }
-
-                        /*
-                         * Reset the string buffer length so readline() will
-                         * not parse this line.
-                         */
-                        stringbuffer.setLength(0);
-
-                        size = Integer.parseInt(temp, 16);
-                    } catch (NumberFormatException nfe) {
-                        throw new IOException(
-                            "invalid chunk size number format");
-                    }
-                    break;
-                }
-            } else {
-                stringbuffer.append(c);
-                lastchar = c;
+        if (size < 0) {
+            /*
+             * Do not read beyond the available bytes of the underlying
+             * stream, because that would block.
+             */
+            len = streamInput.available();
+            if (len > 0 && fillBuffer(streamInput, len)) {
+                size = parseBufferedChunkSize();
             }
         }
-        
+
         if (size < 0) {
             // did not get the size
             return 0;
@@ -764,8 +740,13 @@ public class Protocol extends ConnectionBaseAdapter
          * otherwise return the remainder of the available
          * bytes (e.g. partial chunk).
          */
+        if (bytesleft > 0) {
+            len = bytesleft;
+        } else {
+            len = streamInput.available();
+        }
+
         return (chunksize < len ? chunksize : len);
-        
     }
     
     /**
@@ -774,6 +755,10 @@ public class Protocol extends ConnectionBaseAdapter
      * This method reads Chunked and known length non-chunked http connection
      * input streams. For non-chunked set the field <code>chunkedIn</code>
      * should be false.
+     * <p>
+     * Data of the current chunk is taken from the internal buffer first.
+     * When the buffer is empty and the caller's array is big enough the
+     * chunk data is read directly into it.
      *
      * @param      b     the buffer into which the data is read.
      * @param      off   the start offset in array <code>b</code>
@@ -788,100 +773,82 @@ public class Protocol extends ConnectionBaseAdapter
         throws IOException {
 
         int rc;
+        int bytesToRead;
 
-
-        if (bytesleft == 0) {
+        if (totalbytesread == chunksize) {
             /*
-             * the internal input stream buffer is empty, read from the stream
+             * read the end of the chunk and get the size of the
+             * the next if there is one
              */
 
-            if (totalbytesread == chunksize) {
-                /*
-                 * read the end of the chunk and get the size of the
-                 * the next if there is one
-                 */
-
-                if (!chunkedIn) {
-                    /*
-                     * non-chucked data is treated as one big chunk so there
-                     * is no more data so just return as if there are no
-                     * more chunks
-                     */
-                    eof = true;
-                    return -1;
-                }
-
-                skipEndOfChunkCRLF();
-
-                chunksize = readChunkSize();
-                if (chunksize == 0) {
-                    eof = true;
-
-                    /*
-                     * REFERENCE: HTTP1.1 document 
-                     * SECTION: 3.6.1 Chunked Transfer Coding
-                     * in some cases there may be an OPTIONAL trailer
-                     * containing entity-header fields. since we don't support
-                     * the available() method for TCP socket input streams and
-                     * for performance and reuse reasons we do not attempt to
-                     * clean up the current connections input stream. 
-                     * check readResponseMessage() method in this class for
-                     * more details
-                     */
-                    return -1;
-                }
-
+            if (!chunkedIn) {
                 /*
-                 * we have not read any bytes from this new chunk
+                 * non-chucked data is treated as one big chunk so there
+                 * is no more data so just return as if there are no
+                 * more chunks
                  */
-                totalbytesread = 0;
+                eof = true;
+                return -1;
             }
 
-            int bytesToRead = chunksize - totalbytesread;
-
-            if (len >= bytesToRead) {
-
-                /*
-                 * No need to buffer, if the caller has given a big buffer.
-                 */
-                rc = streamInput.read(b, off, bytesToRead);
+            chunksize = readChunkSize();
+            if (chunksize == 0) {
+                eof = true;
 
-            } else if (len >= inputBufferSize) {
                 /*
-                 * No need to buffer, if the caller has given a big buffer.
+                 * REFERENCE: HTTP1.1 document 
+                 * SECTION: 3.6.1 Chunked Transfer Coding
+                 * in some cases there may be an OPTIONAL trailer
+                 * containing entity-header fields. since we don't support
+                 * the available() method for TCP socket input streams and
+                 * for performance and reuse reasons we do not attempt to
+                 * clean up the current connections input stream. 
+                 * check readResponseMessage() method in this class for
+                 * more details
                  */
-                rc = streamInput.read(b, off, len);
-            } else {
-                if (inputBufferSize >= bytesToRead) {
-                    rc = streamInput.read(readbuf, 0, bytesToRead);
-                } else {
-                    rc = streamInput.read(readbuf, 0, inputBufferSize);
-                }
-
-                bytesleft = rc;
-                bytesread = 0;
+                return -1;
             }
 
-            if (rc == -1) {
-                /*
-                 * Network problem or the wrong length was sent by the server.
-                 */
-                eof = true;
-                throw new IOException("unexpected end of stream");
-            }
+            /*
+             * we have not read any bytes from this new chunk
+             */
+            totalbytesread = 0;
+        }
 
-            totalbytesread += rc;
+        bytesToRead = chunksize - totalbytesread;
+        if (len > bytesToRead) {
+            len = bytesToRead;
+        }
 
-            if (bytesleft == 0) {
-                /*
-                 * The data was read directly into the caller's buffer.
-                 */
-                return rc;
+        if (bytesleft > 0) {
+            rc = readFromBuffer(b, off, len);
+        } else if (len >= inputBufferSize) {
+            /*
+             * No need to buffer, if the caller has given a big buffer.
+             */
+            rc = streamInput.read(b, off, len);
+        } else {
+            /*
+             * The framing after the chunk data is buffered too,
+             * data of known length is not read past its end.
+             */
+            if (fillBuffer(streamInput,
+                           chunkedIn ? Integer.MAX_VALUE : bytesToRead)) {
+                rc = readFromBuffer(b, off, len);
+            } else {
+                rc = -1;
             }
         }
 
-        rc = readFromBuffer(b, off, len);
+        if (rc == -1) {
+            /*
+             * Network problem or the wrong length was sent by the server.
+             */
+            eof = true;
+            throw new IOException("unexpected end of stream");
+        }
 
+        totalbytesread += rc;
         return rc;
     }
 
@@ -893,87 +860,64 @@ public class Protocol extends ConnectionBaseAdapter
      * @return size of the buffered read
      */
     private int readChunkSize() throws IOException {
-        int size = -1;
-
-        try {
-            String chunk = null;
+        int size;
 
-            try {
-                chunk = readLine(streamInput);
-            } catch (IOException ioe) {
-                /* throw new IOException(ioe.getMessage()); */
+        for (;;) {
+            size = parseBufferedChunkSize();
+            if (size >= 0) {
+                return size;
             }
 
-            if (chunk == null) {
+            if (!fillBuffer(streamInput, Integer.MAX_VALUE)) {
                 throw new IOException("No Chunk Size");
             }
-
-            int i;
-            for (i = 0; i < chunk.length(); i++) {
-                char ch = chunk.charAt(i);
-                if (Character.digit(ch, 16) == -1)
-                    break;
-            }
-
-            /* look at extensions?.... */
-            size = Integer.parseInt(chunk.substring(0, i), 16);
-        } catch (NumberFormatException e) {
-            throw new IOException("invalid chunk size number format");
         }
-        
-        return size;
     }
-    
+
     /**
-     * Skips the CRLF at the end of each chunk in the InputStream.
+     * Parses a chunk size line in the internal buffer, skipping the
+     * CRLF that ends the data of the previous chunk. Nothing is consumed
+     * unless the whole line is buffered.
      *
-     * @exception IOException if the LF half of the ending CRLF
-     * is missing.
+     * @return size of the chunk or -1 if the line is not buffered yet
+     * @exception IOException if the chunk size is not a hex number
      */
-    private void skipEndOfChunkCRLF() throws IOException { 
-        int ch;
-
-        if (stringbuffer.length() > 1) {
-            /*
-             * readChunkSizeNonBlocking does not leave CRLF in the buffer
-             * so assume that the ending CRLF has been skipped already
-             */
-            return;
+    private int parseBufferedChunkSize() throws IOException {
+        int start = bytesread;
+        int lf = findLineEnd(start);
+        int end;
+        int size;
+
+        if (lf < 0) {
+            return -1;
+        }
+
+        if (chunkCRLFPending && trimLineEnd(start, lf) == start) {
+            // the CRLF at the end of the previous chunk
+            start = lf + 1;
+            lf = findLineEnd(start);
+            if (lf < 0) {
+                return -1;
+            }
         }
 
-        // readChunkSizeNonBlocking could have left a \r single in the buffer
-        if (stringbuffer.length() == 1) {
-            if (stringbuffer.charAt(0) != '\r') {
-                // assume that the ending CRLF has been skipped already
-                return;
-            }
-             
-            // remove the '\r'
-            stringbuffer.setLength(0);
-            ch = streamInput.read();
-            if (ch != '\n') {
-                throw new IOException("missing the LF of an expected CRLF");
+        /* look at extensions?.... */
+        for (end = start; end < lf; end++) {
+            if (Character.digit((char)(readbuf[end] & 0xff), 16) == -1) {
+                break;
             }
-
-            return;
-        }
-                
-        ch = streamInput.read();
-        if (ch != '\r') {
-            /*
-             * assume readChunkSizeNonBlocking has read the end of the chunk
-             * and that this is the next chunk size, so put the char in the
-             * buffer for readChunkSize and return
-             */
-            stringbuffer.append((char)ch);
-            return;
         }
 
-        ch = streamInput.read();
-        if (ch != '\n') {
-            throw new IOException("missing the LF of an expected CRLF");
+        try {
+            size = parseNumber(start, end, 16);
+        } catch (NumberFormatException e) {
+            throw new IOException("invalid chunk size number format");
         }
-    } 
+
+        consumeLine(lf);
+        chunkCRLFPending = true;
+        return size;
+    }
 
     /**
      * Writes <code>len</code> bytes from the specified byte array
@@ -1631,6 +1575,15 @@ public class Protocol extends ConnectionBaseAdapter
 
         streamConnection = connect();
 
+        /*
+         * Bytes buffered from a previous stream, for example one dropped
+         * in the middle of a response line before a retry, must not be
+         * parsed as part of the response on the new one.
+         */
+        bytesleft = 0;
+        bytesread = 0;
+        chunkCRLFPending = false;
+
         /*
          * Because StreamConnection.open*Stream cannot be called twice
          * the HTTP connect method may have already open the streams
@@ -1654,6 +1607,26 @@ public class Protocol extends ConnectionBaseAdapter
         return streamConnection;
     }
      
+    /**
+     * Gets the plain socket under the stream connection, if any.
+     *
+     * @return the socket connection or null if the HTTP requests
+     *         are sent over another kind of stream connection
+     */
+    private com.sun.midp.io.j2me.socket.Protocol getSocketConnection() {
+        StreamConnection sc = streamConnection;
+
+        if (sc instanceof StreamConnectionElement) {
+            sc = ((StreamConnectionElement)sc).getBaseConnection();
+        }
+
+        if (sc instanceof com.sun.midp.io.j2me.socket.Protocol) {
+            return (com.sun.midp.io.j2me.socket.Protocol)sc;
+        }
+
+        return null;
+    }
+
     /**
      * Simplifies the sendRequest() method header functionality into one method
      * this is extremely helpful for persistent connection support and
@@ -1665,6 +1638,7 @@ public class Protocol extends ConnectionBaseAdapter
         StringBuffer reqLine;
         String filename;
         int numberOfKeys;
+        byte[] header;
 
         /*
          * JTWI security policy for untrusted MIDlets says to add a
@@ -1818,7 +1792,16 @@ public class Protocol extends ConnectionBaseAdapter
         
         reqLine.append("\r\n");
 
-        streamOutput.write(reqLine.toString().getBytes());
+        header = reqLine.toString().getBytes();
+        if (getSocketConnection() != null) {
+            /*
+             * The header is written together with the body by
+             * sendRequestBody, so both can go out in one packet.
+             */
+            pendingRequestHeader = header;
+        } else {
+            streamOutput.write(header);
+        }
     }
 
     /**
@@ -1831,8 +1814,15 @@ public class Protocol extends ConnectionBaseAdapter
         int start;
         int endOfData;
         int length;
+        byte[] header = pendingRequestHeader;
+
+        pendingRequestHeader = null;
 
         if ((writebuf == null) || (bytesToWrite == 0)) {
+            if (header != null) {
+                streamOutput.write(header);
+            }
+
             return;
         }
 
@@ -1878,7 +1868,13 @@ public class Protocol extends ConnectionBaseAdapter
             length += 2;
         }           
 
-        streamOutput.write(writebuf, start, length);
+        if (header != null) {
+            getSocketConnection().writeBytes(header, 0, header.length,
+                                             writebuf, start, length);
+        } else {
+            streamOutput.write(writebuf, start, length);
+        }
+
         bytesToWrite = 0;
     }
 
@@ -2089,11 +2085,23 @@ public class Protocol extends ConnectionBaseAdapter
         
         int bytesToRead = chunksize - totalbytesread;
         
+        if (bytesToRead > 0) {
+            // skip the part of the body which is buffered already
+            bytesToRead -= (bytesleft < bytesToRead) ? bytesleft : bytesToRead;
+        }
+
         if (bytesToRead > 0) {
             byte[] b = new byte[bytesToRead];
             is.read(b, 0, bytesToRead);
         }
 
+        /*
+         * Data after the handshake belongs to the tunneled protocol,
+         * which may not read through this buffer.
+         */
+        bytesleft = 0;
+        bytesread = 0;
+
         int errorGroup = responseCode / 100;
         
         if (errorGroup == 4) { // bad request
@@ -2111,18 +2119,23 @@ public class Protocol extends ConnectionBaseAdapter
      * Check the initial response message looking for the 
      * appropriate HTTP version string. Parse the response 
      * code for easy application branching on condition codes.
+     * The status line is parsed in place in the internal buffer.
      *
      * @param in input stream where the response headers are read
      * @exception IOException  is thrown if the header response can 
      *                         not be parsed
      */
     private void readResponseMessage(InputStream in) throws IOException {
+        int lf;
+        int start;
+        int end;
+        int httpEnd;
+        int codeEnd;
 
-        String line = null;
         responseCode = -1;
         responseMsg = null;
 
-        line = readLine(in);
+        lf = nextLine(in);
 
         /*
          * REFERENCE: HTTP1.1 document 
@@ -2134,113 +2147,107 @@ public class Protocol extends ConnectionBaseAdapter
          * stream. the first thing we do here is read the stream and 
          * discard it.
          */
-        if (line != null && line.length() == 0) {
-            line = readLine(in);
+        if (lf >= 0 && trimLineEnd(bytesread, lf) == bytesread) {
+            consumeLine(lf);
+            lf = nextLine(in);
         }
             
-        int httpEnd, codeEnd;
-        
-        responseCode = -1;
-        responseMsg = null;
-
-        if (line == null) {
+        if (lf < 0) {
             throw new IOException("response empty");
         }
 
-        httpEnd = line.indexOf(' ');
-        if (httpEnd < 0) {
-            if (line.length() > 10) {
-                // only put the first 10 chars in the exception
-                line = line.substring(0, 10);
-            }
+        start = bytesread;
+        end = trimLineEnd(start, lf);
+        consumeLine(lf);
 
+        httpEnd = indexOf(' ', start, end);
+        if (httpEnd < 0) {
+            // only put the first 10 chars in the exception
             throw new IOException("cannot find status code in response: " +
-                line);
+                bufferToString(start, (end - start > 10) ? start + 10 : end));
         }
     
-        String temp = line.substring(0, httpEnd);
-        if (!temp.startsWith("HTTP")) {
-            if (httpEnd > 10) {
-                // only put the first 10 chars in the exception
-                temp = temp.substring(0, 10);
-            }
-
+        if (httpEnd - start < 4 || readbuf[start] != 'H' ||
+                readbuf[start + 1] != 'T' || readbuf[start + 2] != 'T' ||
+                readbuf[start + 3] != 'P') {
+            // only put the first 10 chars in the exception
             throw new IOException("response does not start with HTTP " +
-                 "it starts with: " + temp);
+                "it starts with: " + bufferToString(start,
+                    (httpEnd - start > 10) ? start + 10 : httpEnd));
         }
 
-        httpVer = temp;
-        if (line.length() <= httpEnd) {
-            throw new IOException("status line ends after HTTP version");
-        }
-    
-        codeEnd = line.substring(httpEnd + 1).indexOf(' ');
+        httpVer = bufferToString(start, httpEnd);
+
+        codeEnd = indexOf(' ', httpEnd + 1, end);
         if (codeEnd < 0) {
             throw new IOException("cannot find reason phrase in response");
         }
 
-        codeEnd += (httpEnd + 1);
-        if (line.length() <= codeEnd) {
-            throw new IOException("status line end after status code");
-        }
-    
         try {
-            responseCode = Integer.parseInt(line.substring(httpEnd+1, 
-                                                               codeEnd));
+            responseCode = parseNumber(httpEnd + 1, codeEnd, 10);
         } catch (NumberFormatException nfe) {
             throw new IOException("status code in response is not a number");
         }
 
-        responseMsg = line.substring(codeEnd + 1);
+        responseMsg = bufferToString(codeEnd + 1, end);
     }
 
     /** 
      * Read the response message headers.
      * Parse the response headers name value pairs for easy application use.
+     * Lines are parsed in place in the internal buffer, only the keys
+     * and values are made into strings. Data after the headers is left
+     * in the buffer for the readBytes methods.
      *
      * @param in input stream where the response headers are read
      * @exception IOException  is thrown if the response headers cannot 
      *                         be parsed
      */
     private void readHeaders(InputStream in) throws IOException {
-        String line;
         String key = null;
         int prevPropIndex = headerFields.size() - 1;
         boolean firstLine = true;
         String value;
         String prevValue = null;
+        int lf;
+        int start;
+        int end;
         int index;
+        int valueStart;
 
         /*
          * Initialize and set the current input stream variables
          */
-        bytesleft = 0;
         chunksize = -1;
-        bytesread = 0;
         totalbytesread = 0;
         chunkedIn = false;
+        chunkCRLFPending = false;
         eof = false;
 
         
         for (;;) {
-            try {
-                line = readLine(in);
-            } catch (IOException ioe) {
-                throw new IOException(ioe.getMessage());
+            lf = nextLine(in);
+            if (lf < 0) {
+                break;
             }
 
-            if (line == null || line.equals(""))
+            start = bytesread;
+            end = trimLineEnd(start, lf);
+            consumeLine(lf);
+
+            if (start == end) {
                 break;
+            }
 
-            if ((!firstLine) && (line.charAt(0) == ' ' ||
-                                    line.charAt(0) == '\t')) {
+            if ((!firstLine) && (readbuf[start] == ' ' ||
+                                    readbuf[start] == '\t')) {
                 // This line is a continuation of the previous line.
 
                 /*
                  * The continuation is for the user readablility so restore
                  * the CR LF when appending.
                  */
-                value = prevValue + "\r\n" + line;
+                value = prevValue + "\r\n" + bufferToString(start, end);
 
                 /*
                  * Set value by index, since there can be multiple properties
@@ -2251,20 +2258,30 @@ public class Protocol extends ConnectionBaseAdapter
                 continue;
             }
                 
-            index = line.indexOf(':');
+            index = indexOf(':', start, end);
             if (index < 0) {
-                throw new IOException("malformed header field " + line);
+                throw new IOException("malformed header field " +
+                                      bufferToString(start, end));
+            }
+
+            if (index == start) {
+                throw new IOException("malformed header field, no key " +
+                                      bufferToString(start, end));
+            }
+
+            key = bufferToString(start, index);
+
+            // trim the value
+            valueStart = index + 1;
+            while (valueStart < end && (readbuf[valueStart] & 0xff) <= ' ') {
+                valueStart++;
             }
 
-            key = line.substring(0, index);
-            if (key.length() == 0) {
-                throw new IOException("malformed header field, no key "+ line);
+            while (end > valueStart && (readbuf[end - 1] & 0xff) <= ' ') {
+                end--;
             }
 
-            if (line.length() <= index + 1) 
-                value = "";
-            else 
-                value = line.substring(index + 1).trim();
+            value = bufferToString(valueStart, end);
 
             /**
              * Check the response header to see if the server would like
@@ -2290,10 +2307,8 @@ public class Protocol extends ConnectionBaseAdapter
              */
             if (key.equalsIgnoreCase("content-length")) {
                 try {
-                    contentLength =  Integer.parseInt(value);
-                } catch (IllegalArgumentException iae) {
-                    // fall through
-                } catch (NullPointerException npe) {
+                    contentLength = parseNumber(valueStart, end, 10);
+                } catch (NumberFormatException nfe) {
                     // fall through
                 }
             }
@@ -2327,42 +2342,187 @@ public class Protocol extends ConnectionBaseAdapter
     }
 
     /**
-     * Uses the shared stringbuffer to read a line terminated by CRLF 
-     * and return it as string. Blocks until the line is done or end of
-     * stream.
+     * Reads more data into the internal buffer. Buffered data is moved
+     * to the start of the buffer first, a full buffer is grown so that
+     * a long header line fits in it.
+     *
+     * @param     in  InputStream to read the data
+     * @param     max maximum number of bytes to read, must be positive
+     * @return    false if the end of stream was reached
+     * @exception IOException if an I/O error occurs
+     */
+    private boolean fillBuffer(InputStream in, int max) throws IOException {
+        int space;
+        int rc;
+
+        if (bytesread > 0) {
+            System.arraycopy(readbuf, bytesread, readbuf, 0, bytesleft);
+            bytesread = 0;
+        }
+
+        space = readbuf.length - bytesleft;
+        if (space == 0) {
+            byte[] temp = new byte[(readbuf.length < 64) ?
+                                   128 : readbuf.length * 2];
+
+            System.arraycopy(readbuf, 0, temp, 0, bytesleft);
+            readbuf = temp;
+            space = readbuf.length - bytesleft;
+        }
+
+        if (space > max) {
+            space = max;
+        }
+
+        rc = in.read(readbuf, bytesleft, space);
+        if (rc < 0) {
+            return false;
+        }
+
+        bytesleft += rc;
+        return true;
+    }
+
+    /**
+     * Reads until a whole line is in the internal buffer. The line
+     * starts at <code>bytesread</code>. Blocks until the line is done or
+     * end of stream.
      *
      * @param     in  InputStream to read the data
-     * @return    one line of input header or null if end of stream
+     * @return    index of the LF ending the line in the internal buffer
+     *            or -1 if end of stream
      * @exception IOException if error encountered while reading headers
      */
-    private String readLine(InputStream in) throws IOException {
-        int c;
+    private int nextLine(InputStream in) throws IOException {
+        int scanned = 0;
+        int lf;
 
-        try {
-            for (;;) {
-                c = in.read();
-                if (c < 0) {
-                    return null;
-                }
+        for (;;) {
+            lf = findLineEnd(bytesread + scanned);
+            if (lf >= 0) {
+                return lf;
+            }
 
-                if (c == '\r') {
-                    continue;
-                }
+            // bytesread may change, so remember the relative position
+            scanned = bytesleft;
+            if (!fillBuffer(in, Integer.MAX_VALUE)) {
+                return -1;
+            }
+        }
+    }
 
-                if (c == '\n') {
-                    break;
-                }
+    /**
+     * Finds the end of a line in the internal buffer.
+     *
+     * @param from index of the first byte to look at
+     * @return index of the LF or -1 if there is none in the buffer
+     */
+    private int findLineEnd(int from) {
+        int end = bytesread + bytesleft;
 
-                stringbuffer.append((char)c);
+        for (int i = from; i < end; i++) {
+            if (readbuf[i] == '\n') {
+                return i;
             }
+        }
 
-            /* Return a whole line and reset the string buffer. */
-            String line =  stringbuffer.toString(); 
+        return -1;
+    }
 
-            return line;
-        } finally {
-            stringbuffer.setLength(0);
+    /**
+     * Strips the CR characters at the end of a line.
+     *
+     * @param start index of the first byte of the line
+     * @param lf index of the LF ending the line
+     * @return index after the last byte of the line content
+     */
+    private int trimLineEnd(int start, int lf) {
+        while (lf > start && readbuf[lf - 1] == '\r') {
+            lf--;
         }
+
+        return lf;
+    }
+
+    /**
+     * Removes the bytes up to and including a LF from the internal
+     * buffer. The bytes stay valid until the buffer is filled again.
+     *
+     * @param lf index of the LF ending the line
+     */
+    private void consumeLine(int lf) {
+        bytesleft -= lf + 1 - bytesread;
+        bytesread = lf + 1;
+    }
+
+    /**
+     * Finds a character in the internal buffer.
+     *
+     * @param ch character to find
+     * @param start index of the first byte to look at
+     * @param end index after the last byte to look at
+     * @return index of the character or -1 if not found
+     */
+    private int indexOf(char ch, int start, int end) {
+        for (int i = start; i < end; i++) {
+            if (readbuf[i] == ch) {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    /**
+     * Parses a non-negative number in the internal buffer.
+     *
+     * @param start index of the first digit
+     * @param end index after the last digit
+     * @param radix radix of the number
+     * @return value of the number
+     * @exception NumberFormatException if there are no digits, a byte
+     *            is not a digit or the number is too large
+     */
+    private int parseNumber(int start, int end, int radix) {
+        int value = 0;
+        int digit;
+
+        if (start >= end) {
+            throw new NumberFormatException();
+        }
+
+        for (int i = start; i < end; i++) {
+            digit = Character.digit((char)(readbuf[i] & 0xff), radix);
+            if (digit < 0 || value > (Integer.MAX_VALUE - digit) / radix) {
+                throw new NumberFormatException();
+            }
+
+            value = value * radix + digit;
+        }
+
+        return value;
+    }
+
+    /**
+     * Makes a string of bytes in the internal buffer, one character
+     * per byte.
+     *
+     * @param start index of the first byte
+     * @param end index after the last byte
+     * @return the string
+     */
+    private String bufferToString(int start, int end) {
+        int len = end - start;
+
+        if (linechars == null || linechars.length < len) {
+            linechars = new char[(len < 64) ? 64 : len];
+        }
+
+        for (int i = 0; i < len; i++) {
+            linechars[i] = (char)(readbuf[start + i] & 0xff);
+        }
+
+        return new String(linechars, 0, len);
     }
 
     /**
@@ -68,8 +68,14 @@ public class StreamConnectionElement
     boolean                   m_in_use;
     /** Start time in milliseconds. */
     long                      m_time;
-    /** Removed from pool flag while in use. (lingered too long) */
+    /** Removed from pool flag while in use. */
     boolean m_removed;
+    /** Pool key made of the protocol, host and port. */
+    String                    m_key;
+    /** Next older idle connection in the pool, any host. */
+    StreamConnectionElement   m_older;
+    /** Next newer idle connection in the pool, any host. */
+    StreamConnectionElement   m_newer;
     
     /**
      * Create a new instance of this class.
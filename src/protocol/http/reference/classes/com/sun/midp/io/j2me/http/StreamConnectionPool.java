@@ -29,18 +29,15 @@ package com.sun.midp.io.j2me.http;
 /**
  * A class representing a persistent connection pool that is used by the http
  * connection class to store persistent connections. Stream Connection 
- * Element are stored in the internal vector located in this class.
- * Each stream connection element is marked when either in use or
- * not. As new connections are requested - the current connections in the pool
- * are searched for a match and inactivity.
+ * Elements are kept in a hash table keyed by protocol, host and port,
+ * each key has its own list of idle connections, so a lookup does not
+ * depend on the number of connections to other hosts.
  *
  * <p> There is a maximum number of simultaneous connections that can be
- * in the pool at any one time. If for some reason there are no matching
- * connections available - a new one may be created (as long as it does not
- * exceed the maximum). If there number of connections in the pool exceeds 
- * the maximum - an adjustment is made to delete unused connections. Once
- * that happens (if at all) a new connection is created. If it can not create
- * a new connection an exception is raised. Once a connection is close down
+ * in the pool at any one time, and a smaller maximum of connections to
+ * the same host. When a limit is reached the least recently used idle
+ * connection is closed to make room. If no connection is idle the new
+ * connection is not pooled. Once a connection is closed down
  * a connection must be returned to the pool as inactive for another use.
  *
  * <p> Each individual stream connection stream element (or container) 
@@ -48,17 +45,19 @@ package com.sun.midp.io.j2me.http;
  * in-use flag is set to (true) and once that is closed its set to (false).
  * Once the connection stream element is (false) its available for reuse.
  *
+ * <p> Idle connections that lingered too long are closed by a timer
+ * task, not by the threads requesting connections. Connections are
+ * always closed outside of the pool lock.
  */
 
-import java.io.IOException;
-import java.io.InputStream;
-import java.io.OutputStream;
+import java.util.Hashtable;
+import java.util.Timer;
+import java.util.TimerTask;
+import java.util.Vector;
+
 import java.io.DataInputStream;
 import java.io.DataOutputStream;
 
-import java.util.Vector;
-import java.util.Enumeration;
-
 import javax.microedition.io.StreamConnection;
 
 import com.sun.midp.security.Permissions;
@@ -78,10 +77,42 @@ import com.sun.midp.security.SecurityToken;
 public class StreamConnectionPool {
     /** How long a connection can linger after its last use. */
     private long m_connectionLingerTime;
-    /** internal connection hash table */
-    private Vector m_connections;
+    /** Pooled connections of each protocol, host and port. */
+    private Hashtable m_hosts;
     /** maximum connections */
     private int m_max_connections;
+    /** maximum connections to the same protocol, host and port */
+    private int m_max_host_connections;
+    /** Number of connections in the pool, idle or in use. */
+    private int m_size;
+    /** Least recently used idle connection, the first to expire. */
+    private StreamConnectionElement m_oldest;
+    /** Most recently used idle connection. */
+    private StreamConnectionElement m_newest;
+    /** Timer closing lingering connections, created on first use. */
+    private Timer m_timer;
+    /** True if a task closing lingering connections is scheduled. */
+    private boolean m_reaperScheduled;
+
+    /**
+     * Connections in the pool to one protocol, host and port.
+     */
+    private static class HostConnections {
+        /** Idle connections, the most recently used last. */
+        Vector idle = new Vector(2);
+        /** Number of connections, idle or in use. */
+        int count;
+    }
+
+    /**
+     * Timer task closing the connections which lingered too long.
+     */
+    private class Reaper extends TimerTask {
+        /** Closes the expired connections and schedules the next run. */
+        public void run() {
+            closeAll(expire());
+        }
+    }
 
     /**
      * Create a new instance of this class.
@@ -90,21 +121,25 @@ public class StreamConnectionPool {
      *
      * @param number_of_connections initial number of connections 
      *       must greater than zero.
+     * @param connections_per_host maximum number of connections to the
+     *       same host and port, 0 for no limit other than
+     *       <code>number_of_connections</code>
      * @param connectionLingerTime how many milliseconds a connection should
      *       stay in the pool after its last use
      */
     StreamConnectionPool(int number_of_connections,
+                         int connections_per_host,
                          long connectionLingerTime) {
         this.m_max_connections = number_of_connections;
+        this.m_max_host_connections = connections_per_host;
         this.m_connectionLingerTime = connectionLingerTime;
-        m_connections = new Vector(m_max_connections);
+        m_hosts = new Hashtable(m_max_connections * 2 + 1);
     }
     
     /**
      * Tries to add a reuseable connection to the connection pool.
-     * Replace any not in use connections to the same host and port.
-     * Will not add to the same host and port in use. Will replace
-     * oldest not in use element (if any) if the pool is full.
+     * If the pool or the connections to the same host and port are at
+     * their limits, the least recently used idle connection is replaced.
      * 
      * @param p_protocol            The protocol for the connection
      * @param p_host                The Hostname for the connection
@@ -117,58 +152,59 @@ public class StreamConnectionPool {
      *
      * @return true if the connection was added, otherwise false
      */
-    synchronized boolean add(String p_protocol,
+    boolean add(String p_protocol,
             String p_host, int p_port, StreamConnection sc,
             DataOutputStream dos, DataInputStream dis) {
 
-        StreamConnectionElement oldestNotInUse = null;
+        String key = makeKey(p_protocol, p_host, p_port);
+        StreamConnectionElement replaced = null;
+        StreamConnectionElement sce;
+        HostConnections host;
 
-        // find the last unused element
-        Enumeration cons = m_connections.elements();
-        while (cons.hasMoreElements()) {
-            StreamConnectionElement sce =
-                (StreamConnectionElement)cons.nextElement();
+        synchronized (this) {
+            host = (HostConnections)m_hosts.get(key);
+            if (host == null) {
+                host = new HostConnections();
+                m_hosts.put(key, host);
+            }
 
-            if (sce.m_in_use) {
-                if (p_host.equals(sce.m_host) && p_port == sce.m_port) {
+            if (m_max_host_connections > 0 &&
+                    host.count >= m_max_host_connections) {
+                if (host.idle.size() == 0) {
+                    dropIfEmpty(key, host);
                     return false;
                 }
 
-                continue;
-            }
-
-            // if the connection is a duplicate, delete it
-            if (p_host.equals(sce.m_host) && p_port == sce.m_port) {
-                // no protocol duplicates on host and port
-                sce.close();
-                m_connections.removeElement(sce);
-                break;
-            } else {
-                if (oldestNotInUse == null ||
-                    sce.m_time < oldestNotInUse.m_time) {
-                    // save the oldest not in use, it may be removed later
-                    oldestNotInUse = sce;
+                // replace the least recently used connection to the host
+                replaced = (StreamConnectionElement)host.idle.elementAt(0);
+            } else if (m_size >= m_max_connections) {
+                if (m_oldest == null) {
+                    dropIfEmpty(key, host);
+                    return false;
                 }
+
+                // replace the least recently used connection to any host
+                replaced = m_oldest;
             }
-        }
 
-        /*
-         * first check and see if the maximum number of connections
-         * has been reached - if so delete the first one in the list (FIFO)
-         *   or
-         * if this port and host are already in the pool.
-         */
-        if (m_connections.size() >= m_max_connections) {
-            if (oldestNotInUse == null) {
-                return false;
+            // count the new connection first, so its host is not dropped
+            host.count++;
+            m_size++;
+
+            if (replaced != null) {
+                removeIdle(replaced);
             }
 
-            oldestNotInUse.close();
-            m_connections.removeElement(oldestNotInUse);
+            sce = new StreamConnectionElement(p_protocol, p_host, p_port,
+                                              sc, dos, dis);
+            sce.m_key = key;
+            addIdle(host, sce);
         }
-     
-        m_connections.addElement(new StreamConnectionElement(p_protocol,
-                          p_host, p_port, sc, dos, dis));
+
+        if (replaced != null) {
+            replaced.close();
+        }
+
         return true;
     }
     
@@ -178,16 +214,31 @@ public class StreamConnectionPool {
      *
      * @param sce                 The stream connection element to remove
      */
-    synchronized void remove(StreamConnectionElement sce) {
-	sce.close();
-        m_connections.removeElement(sce);
+    void remove(StreamConnectionElement sce) {
+        synchronized (this) {
+            if (!sce.m_removed) {
+                if (sce.m_in_use) {
+                    HostConnections host =
+                        (HostConnections)m_hosts.get(sce.m_key);
+
+                    sce.m_removed = true;
+                    host.count--;
+                    m_size--;
+                    dropIfEmpty(sce.m_key, host);
+                } else {
+                    removeIdle(sce);
+                }
+            }
+        }
+
+        sce.close();
     }
     
     /**
      * get an available connection and set the boolean flag to 
      * true (unavailable) in the connection pool.
-     * Also removes any stale connections, since this method gets
-     * called more than add or remove.
+     * The most recently used idle connection to the host is returned,
+     * it is the least likely to be closed by the server.
      *
      * @param callerSecurityToken   The security token of the caller
      * @param p_protocol            The protocol for the connection
@@ -197,42 +248,37 @@ public class StreamConnectionPool {
      * @return                      A stream connection element or
      *                              null if not found
      */
-    public synchronized StreamConnectionElement get(
+    public StreamConnectionElement get(
             SecurityToken callerSecurityToken,
             String p_protocol, String p_host, int p_port) {
 
-        StreamConnectionElement result = null;
-        long c_time = System.currentTimeMillis();
-        Enumeration cons = m_connections.elements();
+        String key = makeKey(p_protocol, p_host, p_port);
+        StreamConnectionElement result;
+        HostConnections host;
+        int last;
 
         callerSecurityToken.checkIfPermissionAllowed(Permissions.MIDP);
 
-        while (cons.hasMoreElements()) {
-            StreamConnectionElement sce =
-                (StreamConnectionElement)cons.nextElement();
-            
-            if ((c_time - sce.m_time) > m_connectionLingerTime) {
-                if (!sce.m_in_use) {
-                    sce.close();
-                } else {
-                    // signal returnToUse() to close
-                    sce.m_removed = true;
-                }
-
-                m_connections.removeElement(sce);
-                continue;
+        synchronized (this) {
+            host = (HostConnections)m_hosts.get(key);
+            if (host == null) {
+                return null;
             }
 
-            if (p_host.equals(sce.m_host) && p_port == sce.m_port &&
-                    p_protocol.equals(sce.m_protocol) && !sce.m_in_use) {
-                result = sce;
+            last = host.idle.size() - 1;
+            if (last < 0) {
+                return null;
+            }
 
-                // do not break out so old connections can be removed
-                continue;
+            result = (StreamConnectionElement)host.idle.elementAt(last);
+            if ((System.currentTimeMillis() - result.m_time) >
+                    m_connectionLingerTime) {
+                // it is about to be closed by the reaper
+                return null;
             }
-        }
 
-        if (result != null) {
+            host.idle.removeElementAt(last);
+            unlink(result);
             result.m_in_use = true;
         }
 
@@ -246,15 +292,173 @@ public class StreamConnectionPool {
      *
      * @param returned            The stream connection element to return
      */
-    synchronized void returnForReuse(StreamConnectionElement returned) {
-        returned.m_in_use = false;
+    void returnForReuse(StreamConnectionElement returned) {
+        synchronized (this) {
+            returned.m_in_use = false;
+
+            if (!returned.m_removed) {
+                returned.m_time = System.currentTimeMillis();
+                addIdle((HostConnections)m_hosts.get(returned.m_key),
+                        returned);
+                return;
+            }
+        }
+
+        // the connection was removed from the pool while in use
+        returned.close();
+    }
+
+    /**
+     * Makes the pool key of a connection.
+     *
+     * @param p_protocol            The protocol for the connection
+     * @param p_host                The Hostname for the connection
+     * @param p_port                The port number for the connection
+     *
+     * @return                      the key
+     */
+    private static String makeKey(String p_protocol, String p_host,
+                                  int p_port) {
+        StringBuffer key = new StringBuffer(p_protocol.length() +
+                                            p_host.length() + 8);
 
-        if (returned.m_removed) {
-            // the connection was out too long
-            returned.close();
+        key.append(p_protocol).append(':').append(p_host).append(':');
+        key.append(p_port);
+        return key.toString();
+    }
+
+    /**
+     * Makes a connection idle, the newest in the pool. Must be called
+     * with the pool locked.
+     *
+     * @param host                Connections to the host of the element
+     * @param sce                 The stream connection element
+     */
+    private void addIdle(HostConnections host, StreamConnectionElement sce) {
+        host.idle.addElement(sce);
+
+        sce.m_older = m_newest;
+        sce.m_newer = null;
+        if (m_newest != null) {
+            m_newest.m_newer = sce;
+        } else {
+            m_oldest = sce;
+        }
+        m_newest = sce;
+
+        scheduleReaper();
+    }
+
+    /**
+     * Takes an idle connection out of the LRU list. Must be called
+     * with the pool locked.
+     *
+     * @param sce                 The stream connection element
+     */
+    private void unlink(StreamConnectionElement sce) {
+        if (sce.m_older != null) {
+            sce.m_older.m_newer = sce.m_newer;
+        } else {
+            m_oldest = sce.m_newer;
+        }
+
+        if (sce.m_newer != null) {
+            sce.m_newer.m_older = sce.m_older;
+        } else {
+            m_newest = sce.m_older;
+        }
+
+        sce.m_older = null;
+        sce.m_newer = null;
+    }
+
+    /**
+     * Removes an idle connection from the pool, the caller closes it
+     * after releasing the pool lock. Must be called with the pool locked.
+     *
+     * @param sce                 The stream connection element
+     */
+    private void removeIdle(StreamConnectionElement sce) {
+        HostConnections host = (HostConnections)m_hosts.get(sce.m_key);
+
+        unlink(sce);
+        host.idle.removeElement(sce);
+        host.count--;
+        m_size--;
+        sce.m_removed = true;
+        dropIfEmpty(sce.m_key, host);
+    }
+
+    /**
+     * Forgets a host which has no connections in the pool. Must be
+     * called with the pool locked.
+     *
+     * @param key                 The pool key of the host
+     * @param host                Connections to the host
+     */
+    private void dropIfEmpty(String key, HostConnections host) {
+        if (host.count == 0) {
+            m_hosts.remove(key);
+        }
+    }
+
+    /**
+     * Schedules closing of the oldest idle connection when it expires,
+     * unless it is already scheduled. Must be called with the pool locked.
+     */
+    private void scheduleReaper() {
+        long delay;
+
+        if (m_reaperScheduled || m_oldest == null) {
             return;
         }
 
-        returned.m_time = System.currentTimeMillis();
+        delay = m_oldest.m_time + m_connectionLingerTime -
+                System.currentTimeMillis() + 1;
+        if (delay < 0) {
+            delay = 0;
+        }
+
+        if (m_timer == null) {
+            m_timer = new Timer();
+        }
+
+        m_timer.schedule(new Reaper(), delay);
+        m_reaperScheduled = true;
+    }
+
+    /**
+     * Removes the idle connections which lingered too long and
+     * schedules the next check if a connection is still idle. The timer
+     * is kept for the next connection that becomes idle.
+     *
+     * @return the removed connections to be closed by the caller
+     */
+    private synchronized Vector expire() {
+        long c_time = System.currentTimeMillis();
+        Vector expired = new Vector(2);
+
+        m_reaperScheduled = false;
+
+        while (m_oldest != null &&
+                (c_time - m_oldest.m_time) > m_connectionLingerTime) {
+            expired.addElement(m_oldest);
+            removeIdle(m_oldest);
+        }
+
+        scheduleReaper();
+
+        return expired;
+    }
+
+    /**
+     * Closes connections removed from the pool.
+     *
+     * @param connections         The stream connection elements to close
+     */
+    private static void closeAll(Vector connections) {
+        for (int i = 0; i < connections.size(); i++) {
+            ((StreamConnectionElement)connections.elementAt(i)).close();
+        }
     }
 }
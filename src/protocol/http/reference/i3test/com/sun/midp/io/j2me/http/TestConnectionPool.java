@@ -0,0 +1,227 @@
+/*
+ *
+ *
+ * Copyright  1990-2007 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+package com.sun.midp.io.j2me.http;
+
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.InputStream;
+import java.io.OutputStream;
+
+import javax.microedition.io.StreamConnection;
+
+import com.sun.midp.i3test.TestCase;
+
+/**
+ * Tests the limits, the replacement and the expiry of the connections
+ * in the HTTP persistent connection pool.
+ */
+public class TestConnectionPool extends TestCase {
+
+    /** Linger time long enough for no connection to expire in a test. */
+    final long LONG_LINGER = 60000;
+
+    /** Linger time of the expiry test, in milliseconds. */
+    final long SHORT_LINGER = 100;
+
+    StreamConnectionPool pool;
+
+    /**
+     * Adds a new connection to the pool.
+     */
+    PooledStreamConnection add(String host) {
+        PooledStreamConnection sc = new PooledStreamConnection();
+
+        sc.pooled = pool.add("http", host, 80, sc, null, null);
+        return sc;
+    }
+
+    /**
+     * Takes an idle connection to a host from the pool.
+     */
+    StreamConnectionElement get(String host) {
+        return pool.get(getSecurityToken(), "http", host, 80);
+    }
+
+    /**
+     * Tests that the connections to one host are limited and that the
+     * least recently used idle connection to the host is replaced.
+     */
+    void testHostLimit() {
+        PooledStreamConnection a1, a2, a3, a4, b1;
+        StreamConnectionElement sce1, sce2;
+
+        pool = new StreamConnectionPool(4, 2, LONG_LINGER);
+
+        a1 = add("a");
+        a2 = add("a");
+        assertTrue("first two pooled", a1.pooled && a2.pooled);
+
+        a3 = add("a");
+        assertTrue("third pooled", a3.pooled);
+        assertTrue("oldest replaced", a1.closed);
+        assertFalse("newer kept", a2.closed);
+
+        sce1 = get("a");
+        sce2 = get("a");
+        assertSame("newest first", a3, sce1.getBaseConnection());
+        assertSame("older next", a2, sce2.getBaseConnection());
+        assertNull("no more idle", get("a"));
+
+        a4 = add("a");
+        assertFalse("not pooled while all are in use", a4.pooled);
+        assertFalse("in use not closed", a2.closed || a3.closed);
+
+        b1 = add("b");
+        assertTrue("other host pooled", b1.pooled);
+
+        pool.returnForReuse(sce1);
+        assertSame("returned reused", sce1, get("a"));
+    }
+
+    /**
+     * Tests that the least recently used idle connection to any host is
+     * replaced when the pool is full.
+     */
+    void testLruReplacement() {
+        PooledStreamConnection a, b, c;
+        StreamConnectionElement sce;
+
+        pool = new StreamConnectionPool(2, 0, LONG_LINGER);
+
+        a = add("a");
+        b = add("b");
+
+        // using "a" makes "b" the least recently used
+        sce = get("a");
+        pool.returnForReuse(sce);
+
+        c = add("c");
+        assertTrue("pooled", c.pooled);
+        assertTrue("least recently used replaced", b.closed);
+        assertFalse("recently used kept", a.closed);
+        assertNull("replaced gone", get("b"));
+        assertNotNull("recently used idle", get("a"));
+        assertNotNull("new idle", get("c"));
+    }
+
+    /**
+     * Tests that idle connections are closed after the linger time,
+     * including a connection that becomes idle after the pool emptied.
+     */
+    void testExpiry() throws InterruptedException {
+        PooledStreamConnection a, b;
+        StreamConnectionElement sce;
+
+        pool = new StreamConnectionPool(2, 0, SHORT_LINGER);
+
+        a = add("a");
+        b = add("b");
+        sce = get("b");
+
+        Thread.sleep(SHORT_LINGER * 10);
+        assertTrue("idle expired", a.closed);
+        assertNull("expired gone", get("a"));
+        assertFalse("in use not expired", b.closed);
+
+        pool.returnForReuse(sce);
+        Thread.sleep(SHORT_LINGER * 10);
+        assertTrue("expired after the pool emptied", b.closed);
+        assertNull("expired gone", get("b"));
+    }
+
+    /**
+     * Tests removing a connection while it is in use.
+     */
+    void testRemoveInUse() {
+        PooledStreamConnection a1, a2;
+        StreamConnectionElement sce;
+
+        pool = new StreamConnectionPool(2, 1, LONG_LINGER);
+
+        a1 = add("a");
+        sce = get("a");
+        pool.remove(sce);
+        assertTrue("removed closed", a1.closed);
+
+        a2 = add("a");
+        assertTrue("host limit freed", a2.pooled);
+
+        pool.returnForReuse(sce);
+        assertSame("removed not reused", a2,
+                   get("a").getBaseConnection());
+        assertNull("only one idle", get("a"));
+    }
+
+    /**
+     * Runs all the tests.
+     */
+    public void runTests() throws Throwable {
+        declare("testHostLimit");
+        testHostLimit();
+
+        declare("testLruReplacement");
+        testLruReplacement();
+
+        declare("testExpiry");
+        testExpiry();
+
+        declare("testRemoveInUse");
+        testRemoveInUse();
+    }
+
+}
+
+
+/**
+ * A stubbed StreamConnection that records whether the pool closed it.
+ */
+class PooledStreamConnection implements StreamConnection {
+    /** True if the pool accepted the connection. */
+    boolean pooled;
+    /** True once the connection is closed. */
+    boolean closed;
+
+    public InputStream openInputStream() {
+        return null;
+    }
+
+    public DataInputStream openDataInputStream() {
+        return null;
+    }
+
+    public OutputStream openOutputStream() {
+        return null;
+    }
+
+    public DataOutputStream openDataOutputStream() {
+        return null;
+    }
+
+    public void close() {
+        closed = true;
+    }
+}
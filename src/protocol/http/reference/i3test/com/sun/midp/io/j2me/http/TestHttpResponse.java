@@ -0,0 +1,367 @@
+/*
+ *
+ *
+ * Copyright  1990-2007 Sun Microsystems, Inc. All Rights Reserved.
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License version
+ * 2 only, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License version 2 for more details (a copy is
+ * included at /legal/license.txt).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this work; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ * Please contact Sun Microsystems, Inc., 4150 Network Circle, Santa
+ * Clara, CA 95054 or visit www.sun.com if you need additional
+ * information or have any questions.
+ */
+
+package com.sun.midp.io.j2me.http;
+
+import java.io.IOException;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.InputStream;
+import java.io.OutputStream;
+
+import javax.microedition.io.StreamConnection;
+
+import com.sun.midp.i3test.TestCase;
+
+/**
+ * Tests parsing of HTTP responses that arrive in pieces.
+ */
+public class TestHttpResponse extends TestCase {
+
+    final String URL = "http://nonexistent.example.com:8080/foo";
+
+    final String CHUNKED_HEADER =
+        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+
+    SplitHttpProtocol conn;
+
+    void setUp(String[] response) throws IOException {
+        conn = new SplitHttpProtocol(response);
+        conn.openPrim(getSecurityToken(), URL);
+    }
+
+    void tearDown() throws IOException {
+        conn.close();
+    }
+
+    /**
+     * Reads the rest of a stream with small reads, so the data goes
+     * through the internal buffer of the connection.
+     */
+    String readAll(InputStream in) throws IOException {
+        StringBuffer sb = new StringBuffer();
+        byte[] b = new byte[4];
+        int rc;
+
+        while ((rc = in.read(b, 0, b.length)) != -1) {
+            for (int i = 0; i < rc; i++) {
+                sb.append((char)(b[i] & 0xff));
+            }
+        }
+
+        return sb.toString();
+    }
+
+    /**
+     * Tests a status line and headers that are split across reads,
+     * including a CRLF split between two reads.
+     */
+    void testSplitHeaders() throws IOException {
+        setUp(new String[] {
+            "HTTP/1.1 2",
+            "00 OK\r\nContent-Ty",
+            "pe: text/plain\r",
+            "\nContent-Length: 5\r\n\r",
+            "\nhello"
+        });
+
+        assertEquals("code", 200, conn.getResponseCode());
+        assertEquals("message", "OK", conn.getResponseMessage());
+        assertEquals("type", "text/plain",
+                     conn.getHeaderField("content-type"));
+        assertEquals("body", "hello", readAll(conn.openInputStream()));
+        tearDown();
+    }
+
+    /**
+     * Tests that continuation lines are appended to the previous
+     * header value.
+     */
+    void testContinuationLines() throws IOException {
+        setUp(new String[] {
+            "HTTP/1.1 200 OK\r\nX-Long: one\r\n two\r\n",
+            "\tthree\r\nContent-Length: 0\r\n\r\n"
+        });
+
+        assertEquals("code", 200, conn.getResponseCode());
+        assertEquals("value", "one\r\n two\r\n\tthree",
+                     conn.getHeaderField("x-long"));
+        assertEquals("length", "0", conn.getHeaderField("content-length"));
+        tearDown();
+    }
+
+    /**
+     * Tests that chunk extensions after the chunk size are ignored.
+     */
+    void testChunkExtensions() throws IOException {
+        setUp(new String[] {
+            CHUNKED_HEADER +
+            "5;name=value\r\nhello\r\n6;x\r\n world\r\n0;last\r\n\r\n"
+        });
+
+        assertEquals("code", 200, conn.getResponseCode());
+        assertEquals("body", "hello world",
+                     readAll(conn.openInputStream()));
+        tearDown();
+    }
+
+    /**
+     * Tests chunk framing with the CR and LF of the size lines and of
+     * the chunk data ends in different reads.
+     */
+    void testSplitChunkCRLF() throws IOException {
+        setUp(new String[] {
+            CHUNKED_HEADER + "5\r",
+            "\nhello\r",
+            "\n3\r\n",
+            "abc\r\n0\r",
+            "\n\r\n"
+        });
+
+        assertEquals("code", 200, conn.getResponseCode());
+        assertEquals("body", "helloabc", readAll(conn.openInputStream()));
+        tearDown();
+    }
+
+    /**
+     * Tests that a chunk size that does not fit in an int is an error.
+     */
+    void testChunkSizeOverflow() throws IOException {
+        InputStream in;
+
+        setUp(new String[] {
+            CHUNKED_HEADER + "3\r\nabc\r\n100000000\r\n"
+        });
+
+        assertEquals("code", 200, conn.getResponseCode());
+        in = conn.openInputStream();
+
+        try {
+            readAll(in);
+            fail("no exception for an overflowing chunk size");
+        } catch (IOException ioe) {
+            // expected
+        }
+
+        tearDown();
+    }
+
+    /**
+     * Tests that available() does not count the framing of the next
+     * chunk and reads the next chunk size when a chunk is done.
+     */
+    void testAvailableAtChunkBoundary() throws IOException {
+        InputStream in;
+        byte[] b = new byte[16];
+
+        setUp(new String[] {
+            CHUNKED_HEADER + "3\r\nabc\r",
+            "\n4\r\ndefg\r\n0\r\n\r\n"
+        });
+
+        assertEquals("code", 200, conn.getResponseCode());
+        in = conn.openInputStream();
+
+        assertEquals("first chunk", 3, in.available());
+        assertEquals("read first", 3, in.read(b, 0, b.length));
+        assertEquals("second chunk", 4, in.available());
+        assertEquals("read second", 4, in.read(b, 0, b.length));
+        assertEquals("data", "defg", new String(b, 0, 4));
+        assertEquals("last chunk", 0, in.available());
+        assertEquals("eof", -1, in.read(b, 0, b.length));
+        tearDown();
+    }
+
+    /**
+     * Tests body data that arrives in the same read as the headers,
+     * with and without a content length.
+     */
+    void testBodyWithHeaders() throws IOException {
+        setUp(new String[] {
+            "HTTP/1.1 200 OK\r\nContent-Length: 11\r\n\r\nhello world"
+        });
+
+        assertEquals("code", 200, conn.getResponseCode());
+        assertEquals("length", 11, (int)conn.getLength());
+        assertEquals("body", "hello world",
+                     readAll(conn.openInputStream()));
+        tearDown();
+
+        setUp(new String[] {
+            "HTTP/1.0 200 OK\r\n\r\nhello",
+            " world"
+        });
+
+        assertEquals("code", 200, conn.getResponseCode());
+        assertEquals("unknown length body", "hello world",
+                     readAll(conn.openInputStream()));
+        tearDown();
+    }
+
+    /**
+     * Runs all the tests.
+     */
+    public void runTests() throws Throwable {
+        declare("testSplitHeaders");
+        testSplitHeaders();
+
+        declare("testContinuationLines");
+        testContinuationLines();
+
+        declare("testChunkExtensions");
+        testChunkExtensions();
+
+        declare("testSplitChunkCRLF");
+        testSplitChunkCRLF();
+
+        declare("testChunkSizeOverflow");
+        testChunkSizeOverflow();
+
+        declare("testAvailableAtChunkBoundary");
+        testAvailableAtChunkBoundary();
+
+        declare("testBodyWithHeaders");
+        testBodyWithHeaders();
+    }
+
+}
+
+
+/**
+ * A stubbed Protocol class for HTTP that returns the response in the
+ * given pieces. The connection is never put in the connection pool.
+ */
+class SplitHttpProtocol extends Protocol {
+
+    String[] response;
+
+    SplitHttpProtocol(String[] response) {
+        this.response = response;
+    }
+
+    protected StreamConnection connect() throws IOException {
+        return new SplitStreamConnection(response);
+    }
+
+    protected void disconnect() throws IOException {
+        disconnect(getStreamConnection());
+    }
+
+}
+
+
+/**
+ * A stubbed StreamConnection whose input stream returns the pieces of
+ * a response one read at a time and buffers the output.
+ */
+class SplitStreamConnection implements StreamConnection {
+    ByteArrayOutputStream baos;
+    SplitInputStream in;
+
+    SplitStreamConnection(String[] response) {
+        in = new SplitInputStream(response);
+    }
+
+    public InputStream openInputStream() throws IOException {
+        return in;
+    }
+
+    public DataInputStream openDataInputStream() throws IOException {
+        return new DataInputStream(openInputStream());
+    }
+
+    public OutputStream openOutputStream() throws IOException {
+        if (baos == null) {
+            baos = new ByteArrayOutputStream();
+        }
+        return baos;
+    }
+
+    public DataOutputStream openDataOutputStream() throws IOException {
+        return new DataOutputStream(openOutputStream());
+    }
+
+    public void close() { }
+}
+
+
+/**
+ * An input stream that never returns more than the rest of the current
+ * piece from one read. The next piece is available once the current one
+ * has been read.
+ */
+class SplitInputStream extends InputStream {
+    String[] pieces;
+    int piece;
+    int pos;
+
+    SplitInputStream(String[] pieces) {
+        this.pieces = pieces;
+    }
+
+    public int read() throws IOException {
+        byte[] b = new byte[1];
+
+        if (read(b, 0, 1) == -1) {
+            return -1;
+        }
+
+        return b[0] & 0xff;
+    }
+
+    public int read(byte[] b, int off, int len) throws IOException {
+        int rc;
+
+        if (piece == pieces.length) {
+            return -1;
+        }
+
+        rc = pieces[piece].length() - pos;
+        if (rc > len) {
+            rc = len;
+        }
+
+        for (int i = 0; i < rc; i++) {
+            b[off + i] = (byte)pieces[piece].charAt(pos++);
+        }
+
+        if (pos == pieces[piece].length()) {
+            piece++;
+            pos = 0;
+        }
+
+        return rc;
+    }
+
+    public int available() {
+        if (piece == pieces.length) {
+            return 0;
+        }
+
+        return pieces[piece].length() - pos;
+    }
+}
@@ -524,6 +524,54 @@ public class Protocol extends NetworkConnectionBase
         }
     }
 
+    /**
+     * Writes two byte arrays, one after the other, with as few native
+     * calls as possible. The data of both arrays is passed to the
+     * network together, so a short header is not sent in a packet of
+     * its own. Intended for use by protocols layered on top of sockets
+     * that do not have other data buffered in the output stream.
+     *
+     * @param      b1    the data to write first
+     * @param      off1  the start offset in <code>b1</code>
+     * @param      len1  the number of bytes to write from <code>b1</code>
+     * @param      b2    the data to write next
+     * @param      off2  the start offset in <code>b2</code>
+     * @param      len2  the number of bytes to write from <code>b2</code>
+     * @exception  IOException  if an I/O error occurs. In particular,
+     *             an <code>IOException</code> is thrown if the output
+     *             has been shutdown.
+     */
+    public void writeBytes(byte b1[], int off1, int len1,
+                           byte b2[], int off2, int len2)
+           throws IOException {
+        int bytesWritten;
+
+        if (off1 < 0 || len1 < 0 || off1 + len1 > b1.length ||
+                off2 < 0 || len2 < 0 || off2 + len2 > b2.length) {
+            throw new IndexOutOfBoundsException();
+        }
+
+        synchronized (writerLock) {
+            while (len1 + len2 > 0) {
+                if (outputShutdown) {
+                    throw new IOException("output shutdown");
+                }
+
+                bytesWritten = writev0(b1, off1, len1, b2, off2, len2);
+                if (bytesWritten < len1) {
+                    off1 += bytesWritten;
+                    len1 -= bytesWritten;
+                } else {
+                    bytesWritten -= len1;
+                    off1 += len1;
+                    len1 = 0;
+                    off2 += bytesWritten;
+                    len2 -= bytesWritten;
+                }
+            }
+        }
+    }
+
     /**
      * Called once by the child output stream. The output side of the socket
      * will be shutdown and then the parent method will be called.
@@ -722,6 +770,24 @@ public class Protocol extends NetworkConnectionBase
     private native int write0(byte b[], int off, int len)
         throws IOException;
 
+    /**
+     * Writes two byte arrays to the open socket connection in one
+     * native call.
+     *
+     * @param      b1     the buffer of the data to write first
+     * @param      off1   the start offset in array <code>b1</code>
+     * @param      len1   the number of bytes to write from <code>b1</code>
+     * @param      b2     the buffer of the data to write next
+     * @param      off2   the start offset in array <code>b2</code>
+     * @param      len2   the number of bytes to write from <code>b2</code>
+     * @return     the total number of bytes written, counting the bytes
+     *             of <code>b1</code> first
+     * @exception  IOException  if an I/O error occurs.
+     */
+    private native int writev0(byte b1[], int off1, int len1,
+                               byte b2[], int off2, int len2)
+        throws IOException;
+
     /**
      * Gets the number of bytes that can be read without blocking.
      *
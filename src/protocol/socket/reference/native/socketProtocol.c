@@ -38,6 +38,7 @@
 #include <midp_properties_port.h>
 #include <midp_logging.h>
 #include <midpResourceLimit.h>
+#include <midpMalloc.h>
 #include <string.h>
 #include <pcsl_network.h>
 #include <midp_thread.h>
@@ -65,6 +66,158 @@
 typedef struct Java_com_sun_midp_io_j2me_socket_Protocol _socketProtocol;
 #define getMidpSocketProtocolPtr(handle) (unhand(_socketProtocol,(handle)))
 
+/**
+ * By default small reads are served from a native read ahead buffer,
+ * define to 0 to pass every read straight to PCSL.
+ */
+#ifndef ENABLE_SOCKET_READ_AHEAD
+#define ENABLE_SOCKET_READ_AHEAD 1
+#endif
+
+/** Size of the native read ahead buffer of a socket */
+#define SOCKET_READ_AHEAD_SIZE 2048
+
+/** Maximum number of bytes written by one call of writev0 */
+#define SOCKET_GATHER_LIMIT 8192
+
+/** Number of buckets in the table of socket buffers */
+#define SOCKET_BUFFER_BUCKETS 16
+
+/** Bucket of a PCSL handle in the table of socket buffers */
+#define SOCKET_BUFFER_BUCKET(h) \
+    ((((unsigned long)(h)) ^ (((unsigned long)(h)) >> 4)) & \
+     (SOCKET_BUFFER_BUCKETS - 1))
+
+/**
+ * Native buffers of an open socket. The data of the read ahead buffer
+ * and the gathered output are kept outside of the Java heap, so they
+ * stay at the same address while a thread is blocked in PCSL.
+ */
+typedef struct _SocketBuffer {
+    /** PCSL handle of the socket */
+    void *handle;
+    /** Next buffer in the same bucket */
+    struct _SocketBuffer *next;
+    /** Non-zero while a read into <tt>data</tt> is blocked */
+    int readPending;
+    /** Offset of the first unread byte in <tt>data</tt> */
+    int start;
+    /** Number of unread bytes in <tt>data</tt> */
+    int count;
+    /** Gathered output of a blocked writev0, NULL if none */
+    char *gather;
+    /** Number of bytes in <tt>gather</tt> */
+    int gatherLength;
+    /** Read ahead data */
+    unsigned char data[SOCKET_READ_AHEAD_SIZE];
+} SocketBuffer;
+
+/** Buffers of the open sockets hashed by PCSL handle */
+static SocketBuffer *socketBuffers[SOCKET_BUFFER_BUCKETS];
+
+/**
+ * Finds the native buffers of a socket.
+ *
+ * @param handle PCSL handle of the socket
+ * @param create non-zero to allocate the buffers if there are none yet
+ *
+ * @return the buffers or NULL if there are none or out of memory
+ */
+static SocketBuffer *
+getSocketBuffer(void *handle, int create) {
+    SocketBuffer **bucket = &socketBuffers[SOCKET_BUFFER_BUCKET(handle)];
+    SocketBuffer *p;
+
+    for (p = *bucket; p != NULL; p = p->next) {
+        if (p->handle == handle) {
+            return p;
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    p = (SocketBuffer *)midpMalloc(sizeof (SocketBuffer));
+    if (p == NULL) {
+        REPORT_WARN1(LC_PROTOCOL,
+                     "socket: no memory for buffers of fd=%d\n", (int)handle);
+        return NULL;
+    }
+
+    p->handle = handle;
+    p->readPending = 0;
+    p->start = 0;
+    p->count = 0;
+    p->gather = NULL;
+    p->gatherLength = 0;
+    p->next = *bucket;
+    *bucket = p;
+
+    return p;
+}
+
+/**
+ * Releases the gathered output of a socket.
+ *
+ * @param p buffers of the socket
+ */
+static void
+freeGatheredOutput(SocketBuffer *p) {
+    if (p->gather != NULL) {
+        midpFree(p->gather);
+        p->gather = NULL;
+    }
+    p->gatherLength = 0;
+}
+
+/**
+ * Releases the native buffers of a socket. Unread data is discarded.
+ *
+ * @param handle PCSL handle of the socket being closed
+ */
+static void
+freeSocketBuffer(void *handle) {
+    SocketBuffer **pp = &socketBuffers[SOCKET_BUFFER_BUCKET(handle)];
+    SocketBuffer *p;
+
+    for (p = *pp; p != NULL; pp = &p->next, p = p->next) {
+        if (p->handle == handle) {
+            *pp = p->next;
+            freeGatheredOutput(p);
+            midpFree(p);
+            return;
+        }
+    }
+}
+
+#if ENABLE_SOCKET_READ_AHEAD
+/**
+ * Moves read ahead data of a socket to a Java byte array.
+ *
+ * @param p buffers of the socket
+ * @param dst first destination byte
+ * @param length maximum number of bytes to move
+ *
+ * @return number of bytes moved
+ */
+static int
+takeReadAheadData(SocketBuffer *p, unsigned char *dst, int length) {
+    if (length > p->count) {
+        length = p->count;
+    }
+
+    memcpy(dst, p->data + p->start, length);
+    p->start += length;
+    p->count -= length;
+    if (p->count == 0) {
+        p->start = 0;
+    }
+
+    return length;
+}
+#endif
+
 /**
  * Opens a TCP connection to a server.
  * <p>
@@ -116,6 +269,7 @@ Java_com_sun_midp_io_j2me_socket_Protocol_open0(void) {
 
             if (status == PCSL_NET_SUCCESS) {
                 getMidpSocketProtocolPtr(thisObject)->handle = (jint)pcslHandle;
+                midp_socket_opened(pcslHandle);
                 if (midpIncResourceCount(RSC_TYPE_TCP_CLI, 1) == 0) {
                     REPORT_INFO(LC_PROTOCOL, "Resource limit update error"); 
                 }
@@ -134,6 +288,7 @@ Java_com_sun_midp_io_j2me_socket_Protocol_open0(void) {
             } else if (status == PCSL_NET_WOULDBLOCK) {
                 SOCK_ANC_INC_NETWORK_INDICATOR;
                 getMidpSocketProtocolPtr(thisObject)->handle = (jint)pcslHandle;
+                midp_socket_opened(pcslHandle);
                 if (midpIncResourceCount(RSC_TYPE_TCP_CLI, 1) == 0) {
                     REPORT_INFO(LC_PROTOCOL, "Resource limit update error"); 
                 }
@@ -164,6 +319,7 @@ Java_com_sun_midp_io_j2me_socket_Protocol_open0(void) {
             midp_thread_wait(NETWORK_WRITE_SIGNAL, (int)pcslHandle, context);
         } else  {
             SOCK_ANC_DEC_NETWORK_INDICATOR;
+            midp_socket_closed(pcslHandle);
             getMidpSocketProtocolPtr(thisObject)->handle = (jint)INVALID_HANDLE;
             if (midpDecResourceCount(RSC_TYPE_TCP_CLI, 1) == 0) {
                 REPORT_INFO(LC_PROTOCOL, "Resource limit update error"); 
@@ -209,6 +365,9 @@ Java_com_sun_midp_io_j2me_socket_Protocol_read0(void) {
     int status = PCSL_NET_INVALID;
     void* context = NULL;
     MidpReentryData* info;
+#if ENABLE_SOCKET_READ_AHEAD
+    SocketBuffer *buffer = NULL;
+#endif
     
     length = (int)KNI_GetParameterAsInt(3);
     offset = (int)KNI_GetParameterAsInt(2);
@@ -235,6 +394,20 @@ Java_com_sun_midp_io_j2me_socket_Protocol_read0(void) {
         bytesRead = pushgetcachedpacket((int)pcslHandle, &ipAddress, &port,
             (char*)&(JavaByteArray(bufferObject)[offset]), length);
         SNI_END_RAW_POINTERS;
+
+#if ENABLE_SOCKET_READ_AHEAD
+        if (bytesRead <= 0) {
+            /* Serve the read from data read ahead, without a system call */
+            buffer = getSocketBuffer(pcslHandle, 0);
+            if (buffer != NULL && buffer->count > 0) {
+                SNI_BEGIN_RAW_POINTERS;
+                bytesRead = takeReadAheadData(buffer,
+                    (unsigned char*)&(JavaByteArray(bufferObject)[offset]),
+                    length);
+                SNI_END_RAW_POINTERS;
+            }
+        }
+#endif
     }
 
     if (bytesRead <= 0) {
@@ -247,11 +420,33 @@ Java_com_sun_midp_io_j2me_socket_Protocol_read0(void) {
                 KNI_ThrowNew(midpIOException, "invalid handle during socket::read");
             } else {
                 SOCK_ANC_INC_NETWORK_INDICATOR;
-                SNI_BEGIN_RAW_POINTERS;
-                status = pcsl_socket_read_start(pcslHandle,
-                               (unsigned char*)&(JavaByteArray(bufferObject)[offset]),
-                               length, &bytesRead, &context);
-                SNI_END_RAW_POINTERS;
+#if ENABLE_SOCKET_READ_AHEAD
+                /*
+                 * Small reads fill the whole read ahead buffer, so the next
+                 * reads are served from it.
+                 */
+                if (length > 0 && length < SOCKET_READ_AHEAD_SIZE) {
+                    if (buffer == NULL) {
+                        buffer = getSocketBuffer(pcslHandle, 1);
+                    }
+                } else {
+                    buffer = NULL;
+                }
+
+                if (buffer != NULL) {
+                    buffer->readPending = 1;
+                    status = pcsl_socket_read_start(pcslHandle, buffer->data,
+                                   SOCKET_READ_AHEAD_SIZE, &bytesRead,
+                                   &context);
+                } else
+#endif
+                {
+                    SNI_BEGIN_RAW_POINTERS;
+                    status = pcsl_socket_read_start(pcslHandle,
+                                   (unsigned char*)&(JavaByteArray(bufferObject)[offset]),
+                                   length, &bytesRead, &context);
+                    SNI_END_RAW_POINTERS;
+                }
             }
         } else {  /* Reinvocation after unblocking the thread */
             if (INVALID_HANDLE == pcslHandle || iStreams == 0) {
@@ -269,13 +464,42 @@ Java_com_sun_midp_io_j2me_socket_Protocol_read0(void) {
                                  info->descriptor);
                 }
                 context = info->pResult;
+#if ENABLE_SOCKET_READ_AHEAD
+                buffer = getSocketBuffer(pcslHandle, 0);
+                if (buffer != NULL && !buffer->readPending) {
+                    buffer = NULL;
+                }
+
+                if (buffer != NULL) {
+                    status = pcsl_socket_read_finish(pcslHandle, buffer->data,
+                               SOCKET_READ_AHEAD_SIZE, &bytesRead, context);
+                } else
+#endif
+                {
+                    SNI_BEGIN_RAW_POINTERS;
+                    status = pcsl_socket_read_finish(pcslHandle,
+                               (unsigned char*)&(JavaByteArray(bufferObject)[offset]),
+                               length, &bytesRead, context);
+                    SNI_END_RAW_POINTERS;
+                }
+            }
+        }
+
+#if ENABLE_SOCKET_READ_AHEAD
+        if (buffer != NULL && buffer->readPending &&
+                status != PCSL_NET_WOULDBLOCK) {
+            buffer->readPending = 0;
+            if (status == PCSL_NET_SUCCESS && bytesRead > 0) {
+                buffer->start = 0;
+                buffer->count = bytesRead;
                 SNI_BEGIN_RAW_POINTERS;
-                status = pcsl_socket_read_finish(pcslHandle,
-                           (unsigned char*)&(JavaByteArray(bufferObject)[offset]),
-                           length, &bytesRead, context);
+                bytesRead = takeReadAheadData(buffer,
+                    (unsigned char*)&(JavaByteArray(bufferObject)[offset]),
+                    length);
                 SNI_END_RAW_POINTERS;
             }
         }
+#endif
 
         REPORT_INFO1(LC_PROTOCOL, "socket::read0 bytesRead=%d\n", bytesRead);
 
@@ -428,6 +652,185 @@ Java_com_sun_midp_io_j2me_socket_Protocol_write0(void) {
     KNI_ReturnInt((jint)bytesWritten);
 }
 
+/**
+ * Writes two byte arrays to the open socket connection with one call
+ * of PCSL. The arrays are gathered in a native buffer, so a request
+ * header and its body leave in the same system call.
+ * <p>
+ * Java declaration:
+ * <pre>
+ *     writev0([BII[BII)I
+ * </pre>
+ *
+ * @param b1 the buffer of the data to write first
+ * @param off1 the start offset in array <tt>b1</tt>
+ * @param len1 the number of bytes to write from <tt>b1</tt>
+ * @param b2 the buffer of the data to write next
+ * @param off2 the start offset in array <tt>b2</tt>
+ * @param len2 the number of bytes to write from <tt>b2</tt>
+ *
+ * @return the total number of bytes written, counting the bytes of
+ *         <tt>b1</tt> first
+ */
+KNIEXPORT KNI_RETURNTYPE_INT
+Java_com_sun_midp_io_j2me_socket_Protocol_writev0(void) {
+    int length1;
+    int offset1;
+    int length2;
+    int offset2;
+    int oStreams;
+    void *pcslHandle;
+    int bytesWritten = 0;
+    int status = PCSL_NET_INVALID;
+    void *context = NULL;
+    MidpReentryData* info;
+    SocketBuffer *buffer = NULL;
+
+    offset1 = (int)KNI_GetParameterAsInt(2);
+    length1 = (int)KNI_GetParameterAsInt(3);
+    offset2 = (int)KNI_GetParameterAsInt(5);
+    length2 = (int)KNI_GetParameterAsInt(6);
+
+    /* Only a bounded amount of data is gathered at once */
+    if (length1 > SOCKET_GATHER_LIMIT) {
+        length1 = SOCKET_GATHER_LIMIT;
+    }
+    if (length2 > SOCKET_GATHER_LIMIT - length1) {
+        length2 = SOCKET_GATHER_LIMIT - length1;
+    }
+
+    KNI_StartHandles(3);
+
+    KNI_DeclareHandle(firstObject);
+    KNI_DeclareHandle(secondObject);
+    KNI_DeclareHandle(thisObject);
+    KNI_GetThisPointer(thisObject);
+    KNI_GetParameterAsObject(1, firstObject);
+    KNI_GetParameterAsObject(4, secondObject);
+
+    pcslHandle = (void *)(getMidpSocketProtocolPtr(thisObject)->handle);
+    oStreams = (int)(getMidpSocketProtocolPtr(thisObject)->oStreams);
+
+    REPORT_INFO3(LC_PROTOCOL, "socket::writev0 l1=%d l2=%d fd=%d\n",
+                 length1, length2, pcslHandle);
+
+    info = (MidpReentryData*)SNI_GetReentryData(NULL);
+
+    ANC_IND_NETWORK_INDICATOR;
+
+    if (info == NULL) {   /* First invocation */
+        if (INVALID_HANDLE == pcslHandle) {
+            KNI_ThrowNew(midpIOException,
+                         "invalid handle during socket::writev");
+        } else {
+            SOCK_ANC_INC_NETWORK_INDICATOR;
+
+            buffer = getSocketBuffer(pcslHandle, 1);
+            if (buffer != NULL) {
+                freeGatheredOutput(buffer);
+                buffer->gather = (char*)midpMalloc(length1 + length2);
+            }
+
+            if (buffer != NULL && buffer->gather != NULL) {
+                buffer->gatherLength = length1 + length2;
+                SNI_BEGIN_RAW_POINTERS;
+                memcpy(buffer->gather,
+                       &(JavaByteArray(firstObject)[offset1]), length1);
+                memcpy(buffer->gather + length1,
+                       &(JavaByteArray(secondObject)[offset2]), length2);
+                SNI_END_RAW_POINTERS;
+                status = pcsl_socket_write_start(pcslHandle, buffer->gather,
+                               buffer->gatherLength, &bytesWritten, &context);
+            } else if (length1 > 0) {
+                /* Out of memory, write the first array only */
+                SNI_BEGIN_RAW_POINTERS;
+                status = pcsl_socket_write_start(pcslHandle,
+                               (char*)&(JavaByteArray(firstObject)[offset1]),
+                               length1, &bytesWritten, &context);
+                SNI_END_RAW_POINTERS;
+            } else {
+                SNI_BEGIN_RAW_POINTERS;
+                status = pcsl_socket_write_start(pcslHandle,
+                               (char*)&(JavaByteArray(secondObject)[offset2]),
+                               length2, &bytesWritten, &context);
+                SNI_END_RAW_POINTERS;
+            }
+        }
+    } else { /* Reinvocation after unblocking the thread */
+        if (INVALID_HANDLE == pcslHandle || oStreams == 0) {
+            /* connection or its output streams are closed by another thread */
+            KNI_ThrowNew(midpInterruptedIOException,
+                         "Interrupted IO error during socket::writev");
+            SOCK_ANC_DEC_NETWORK_INDICATOR;
+            if (INVALID_HANDLE != pcslHandle) {
+                /* The gathered output of the interrupted write is freed */
+                buffer = getSocketBuffer(pcslHandle, 0);
+            }
+        } else {
+            if ((void *)info->descriptor != pcslHandle) {
+                REPORT_CRIT2(LC_PROTOCOL,
+                             "socket::writev Handles mismatched 0x%x != 0x%x\n",
+                             pcslHandle,
+                             info->descriptor);
+            }
+            context = info->pResult;
+            buffer = getSocketBuffer(pcslHandle, 0);
+            if (buffer != NULL && buffer->gather != NULL) {
+                status = pcsl_socket_write_finish(pcslHandle, buffer->gather,
+                               buffer->gatherLength, &bytesWritten, context);
+            } else if (length1 > 0) {
+                SNI_BEGIN_RAW_POINTERS;
+                status = pcsl_socket_write_finish(pcslHandle,
+                               (char*)&(JavaByteArray(firstObject)[offset1]),
+                               length1, &bytesWritten, context);
+                SNI_END_RAW_POINTERS;
+            } else {
+                SNI_BEGIN_RAW_POINTERS;
+                status = pcsl_socket_write_finish(pcslHandle,
+                               (char*)&(JavaByteArray(secondObject)[offset2]),
+                               length2, &bytesWritten, context);
+                SNI_END_RAW_POINTERS;
+            }
+        }
+    }
+
+    if (buffer != NULL && status != PCSL_NET_WOULDBLOCK) {
+        freeGatheredOutput(buffer);
+    }
+
+    if (INVALID_HANDLE != pcslHandle) {
+        if (status == PCSL_NET_SUCCESS) {
+            SOCK_ANC_DEC_NETWORK_INDICATOR;
+        } else {
+            REPORT_INFO1(LC_PROTOCOL, "socket::writev error=%d\n",
+                         (int)pcsl_network_error(pcslHandle));
+
+            if (status == PCSL_NET_WOULDBLOCK) {
+                midp_thread_wait(NETWORK_WRITE_SIGNAL, (int)pcslHandle, context);
+            } else if (status == PCSL_NET_INTERRUPTED) {
+                midp_snprintf(gKNIBuffer, KNI_BUFFER_SIZE,
+                        "Interrupted IO error %d during socket::writev ",
+                        pcsl_network_error(pcslHandle));
+                KNI_ThrowNew(midpInterruptedIOException, gKNIBuffer);
+                SOCK_ANC_DEC_NETWORK_INDICATOR;
+            } else if (status != PCSL_NET_INVALID) {
+                midp_snprintf(gKNIBuffer, KNI_BUFFER_SIZE,
+                        "IOError %d during socket::writev \n",
+                        pcsl_network_error(pcslHandle));
+                KNI_ThrowNew(midpIOException, gKNIBuffer);
+                SOCK_ANC_DEC_NETWORK_INDICATOR;
+            }
+        }
+    }
+
+    REPORT_INFO1(LC_PROTOCOL, "socket::writev0 bytesWritten=%d\n",
+                 bytesWritten);
+    ANC_IND_NETWORK_INDICATOR;
+    KNI_EndHandles();
+
+    KNI_ReturnInt((jint)bytesWritten);
+}
+
 /**
  * Gets the number of bytes that can be read without blocking.
  * <p>
@@ -461,6 +864,14 @@ Java_com_sun_midp_io_j2me_socket_Protocol_available0(void) {
         /* Check the push cache for a waiting packet. */
         bytesAvailable = pushcacheddatasize((int)pcslHandle);
         if (bytesAvailable <= 0) {
+            int bytesBuffered = 0;
+#if ENABLE_SOCKET_READ_AHEAD
+            SocketBuffer *buffer = getSocketBuffer(pcslHandle, 0);
+
+            if (buffer != NULL) {
+                bytesBuffered = buffer->count;
+            }
+#endif
             status = pcsl_socket_available(pcslHandle, &bytesAvailable);
             /* status is only PCSL_NET_SUCCESS or PCSL_NET_IOERROR */
             if (status == PCSL_NET_IOERROR) {
@@ -469,6 +880,9 @@ Java_com_sun_midp_io_j2me_socket_Protocol_available0(void) {
                         "IOError %d during socket::available0",
                         pcsl_network_error(pcslHandle));
                 KNI_ThrowNew(midpIOException, gKNIBuffer);
+            } else {
+                /* Data read ahead is available without blocking too */
+                bytesAvailable += bytesBuffered;
             }
         }
     }
@@ -508,10 +922,12 @@ Java_com_sun_midp_io_j2me_socket_Protocol_close0(void) {
             KNI_ThrowNew(midpIOException,
                 "invalid handle during socket::close");
         } else {
+            midp_socket_closed(pcslHandle);
             status = pcsl_socket_close_start(pcslHandle, &context);
 
             getMidpSocketProtocolPtr(thisObject)->handle =
                 (jint)INVALID_HANDLE;
+            freeSocketBuffer(pcslHandle);
 
             midp_thread_signal(NETWORK_READ_SIGNAL, (int)pcslHandle, 0);
             midp_thread_signal(NETWORK_WRITE_SIGNAL, (int)pcslHandle, 0);
@@ -573,9 +989,11 @@ Java_com_sun_midp_io_j2me_socket_Protocol_finalize(void) {
     REPORT_INFO1(LC_PROTOCOL, "socket::finalize handle=%d\n", pcslHandle);
 
     if (INVALID_HANDLE != pcslHandle) {
+        midp_socket_closed(pcslHandle);
         status = pcsl_socket_close_start(pcslHandle, &context);
 
         getMidpSocketProtocolPtr(thisObject)->handle = (jint)INVALID_HANDLE;
+        freeSocketBuffer(pcslHandle);
         if (midpDecResourceCount(RSC_TYPE_TCP_CLI, 1) == 0) {
             REPORT_INFO(LC_PROTOCOL, "Resource limit update error"); 
         }
@@ -42,6 +42,7 @@
 #include <midp_logging.h>
 #include <midpResourceLimit.h>
 #include <midp_thread.h>
+#include <midp_net_events.h>
 #include <suitestore_common.h>
 
 /**
@@ -141,6 +142,7 @@ Java_com_sun_midp_io_j2me_serversocket_Socket_open0(void) {
 
             if (status == PCSL_NET_SUCCESS) {
                 getMidpServerSocketProtocolPtr(thisObject)->nativeHandle = (jint)pcslHandle;
+                midp_socket_opened(pcslHandle);
                 REPORT_INFO2(LC_PROTOCOL,
                              "serversocket::open port = %d handle = %d\n",
                              port, pcslHandle);
@@ -211,6 +213,7 @@ Java_com_sun_midp_io_j2me_serversocket_Socket_close0(void) {
              * IMPL NOTE: how to do resource accounting for the push case?
              */
             if (pushcheckin(serverSocketHandle) == -1) {
+                midp_socket_closed((void*)serverSocketHandle);
                 status = pcsl_socket_close_start((void*)serverSocketHandle,
                                                  &context);
                 resUpdate = 1;
@@ -366,6 +369,7 @@ Java_com_sun_midp_io_j2me_serversocket_Socket_accept0(void) {
                          "serversocket::accept connection handle=%d\n",
                          connectionHandle);
             if (status == PCSL_NET_SUCCESS) {
+                midp_socket_opened(connectionHandle);
                 if (midpIncResourceCount(RSC_TYPE_TCP_CLI, 1) == 0) {
                     REPORT_INFO(LC_PROTOCOL,
                                 "serversocket: Resource limit update error");
@@ -427,6 +431,7 @@ Java_com_sun_midp_io_j2me_serversocket_Socket_finalize(void) {
 
     if (serverSocketHandle != (int)INVALID_HANDLE) {
         if (pushcheckin(serverSocketHandle) == -1) {
+            midp_socket_closed((void*)serverSocketHandle);
             status = pcsl_socket_close_start(
                 (void*)serverSocketHandle, &context);
             if (midpDecResourceCount(RSC_TYPE_TCP_SER, 1) == 0) {
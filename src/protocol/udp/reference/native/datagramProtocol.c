@@ -40,6 +40,7 @@
 #include <string.h>
 #include <pcsl_network.h>
 #include <midp_thread.h>
+#include <midp_net_events.h>
 #include <midp_libc_ext.h>
 #include <kni_globals.h>
 #include <pcsl_memory.h>
@@ -125,6 +126,10 @@ Java_com_sun_midp_io_j2me_datagram_Protocol_open0(void) {
                 ANC_INC_NETWORK_INDICATOR;
                 status = pcsl_datagram_open_start(port, &socketHandle,
                     &context);
+                if (status == PCSL_NET_SUCCESS ||
+                        status == PCSL_NET_WOULDBLOCK) {
+                    midp_socket_opened(socketHandle);
+                }
             } else {
                 /* reinvocation */
                 socketHandle = (void *)info->descriptor;
@@ -145,6 +150,9 @@ Java_com_sun_midp_io_j2me_datagram_Protocol_open0(void) {
                     context);
             } else {
                 /* status == PCSL_NET_IOERROR */
+                if (info != NULL) {
+                    midp_socket_closed(socketHandle);
+                }
                 midp_snprintf(gKNIBuffer, KNI_BUFFER_SIZE,
                     "error code %d", pcsl_network_error(socketHandle));
                 REPORT_INFO1(LC_PROTOCOL, "datagram::open0 %s", gKNIBuffer);
@@ -440,6 +448,7 @@ Java_com_sun_midp_io_j2me_datagram_Protocol_close0(void) {
             if (info == NULL) {
                 /* first invocation */
                 ANC_INC_NETWORK_INDICATOR;
+                midp_socket_closed(socketHandle);
                 status = pcsl_datagram_close_start(socketHandle, &context);
 
                 getMidpDatagramProtocolPtr(thisObject)->nativeHandle =
@@ -723,6 +732,7 @@ Java_com_sun_midp_io_j2me_datagram_Protocol_finalize(void) {
 
     if (handle != INVALID_HANDLE) {
         if (pushcheckin((int)handle) == -1) {
+            midp_socket_closed(handle);
             status = pcsl_datagram_close_start(handle, &context);
             if (status == PCSL_NET_SUCCESS) {
                 if (midpDecResourceCount(RSC_TYPE_UDP, 1) == 0) {
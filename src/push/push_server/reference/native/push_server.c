@@ -59,6 +59,7 @@
 #include <midp_libc_ext.h>
 #include <kni_globals.h>
 #include <midp_thread.h>
+#include <midp_net_events.h>
 #include <pcsl_network.h>
 #include <pcsl_socket.h>
 #include <pcsl_serversocket.h>
@@ -860,6 +861,7 @@ static void pushDeleteEntry(PushEntry *p, PushEntry **pPrevNext) {
             /* closing will disconnect any socket notifiers */
             if (pushIsSocketConnection(p->value)) {
 #if ENABLE_SERVER_SOCKET
+                midp_socket_closed((void*)(p->fd));
                 pcsl_socket_close_start((void*)(p->fd), &context);
                 /* Update the resource count */
                 if (midpDecResourceCount(RSC_TYPE_TCP_SER, 1) == 0) {
@@ -868,6 +870,7 @@ static void pushDeleteEntry(PushEntry *p, PushEntry **pPrevNext) {
                 }
 #endif
             } else if (pushIsDatagramConnection(p->value)) {
+                midp_socket_closed((void *)p->fd);
                 pcsl_datagram_close_start((void *)p->fd, &context);
                 /* Update the resource count */
                 if (midpDecResourceCount(RSC_TYPE_UDP, 1) == 0) {
@@ -1253,6 +1256,7 @@ static void pushcleanupentry(PushEntry *p) {
 #if ENABLE_SERVER_SOCKET
         void *context;
 
+        midp_socket_closed((void*)(p->fdsock));
         pcsl_socket_close_start((void*)(p->fdsock), &context);
         /*
          * Update the resource count
@@ -1511,6 +1515,7 @@ static char* pushAcceptConnection(PushEntry* pushp, int prevState) {
     }
 
     pushp->fdsock = (int)clientHandle;
+    midp_socket_opened(clientHandle);
 
     pcsl_socket_getremoteaddr((void *)pushp->fdsock, ipAddress);
 
@@ -2375,6 +2380,7 @@ static int pushProcessPort(PushEntry* pe){
 
             if (status == PCSL_NET_SUCCESS){
                 pe->fd = (int) handle;
+                midp_socket_opened(handle);
                 /* Update the resource count  */
                 if (midpIncResourceCount(RSC_TYPE_UDP, 1) == 0){
                     REPORT_INFO(LC_PROTOCOL, "(Push)Datagrams: Resource"
@@ -2404,6 +2410,7 @@ static int pushProcessPort(PushEntry* pe){
 
             if (status == PCSL_NET_SUCCESS){
                 pe->fd = (int) handle;
+                midp_socket_opened(handle);
 
                 /* Update the resource count  */
                 if (midpIncResourceCount(RSC_TYPE_TCP_SER, 1) == 0){
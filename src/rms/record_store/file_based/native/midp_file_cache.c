@@ -24,6 +24,23 @@
  * information or have any questions.
  */
 
+/**
+ * @file
+ *
+ * Write-back cache of the record store files. The files are cached in
+ * fixed-size pages looked up by (file, page number) through a hash
+ * table. The pages of all open files share one memory budget set by
+ * the RMS_CACHE_LIMIT property, the least recently used page is
+ * evicted when the budget is exhausted. Modified pages are written
+ * in file order, adjacent modified pages with a single write.
+ * Handles that open the same file share its pages.
+ *
+ * Where the storage supports it, the file is also mapped for reading.
+ * The data that is not cached in the pages is then copied from the
+ * mapping instead of being read, the mapping is renewed as the file
+ * grows in the storage.
+ */
+
 #include <kni.h>
 #include "midp_file_cache.h"
 #include <midpMalloc.h>
@@ -39,266 +56,614 @@
         return; \
     }
 
-#define DATA(b) (((char*)b)+sizeof(MidpFileCacheBlock))
+#define PAGE_SIZE MIDP_FILE_CACHE_PAGE_SIZE
+
+#define DATA(p) (((char*)p)+sizeof(MidpFileCachePage))
+
+#define PAGE_START(p) ((p)->pageNumber * PAGE_SIZE)
+
+#define IS_DIRTY(p) ((p)->dirtyEnd > (p)->dirtyStart)
 
 #define UNINITIALIZED_CACHED_VALUE (-1)
 
-/* Cache for a single file */
-static MidpFileCache *mFileCache;
+/* Number of the page hash buckets, a power of 2 */
+#define HASH_BUCKETS 64
+
+/*
+ * Growth of the file in the storage that makes it worth to renew
+ * the mapping. Smaller tails are read into pages.
+ */
+#ifndef MIDP_FILE_CACHE_REMAP_SIZE
+#define MIDP_FILE_CACHE_REMAP_SIZE (16 * PAGE_SIZE)
+#endif
+
+/* Open handles */
+static MidpFileCacheHandle *mHandles;
+
+/* Open files */
+static MidpFileCache *mFiles;
+
+/* Cached pages by (file, page number) */
+static MidpFileCachePage *mPageHash[HASH_BUCKETS];
+
+/* Cached pages, from the most to the least recently used */
+static MidpFileCachePage *mLruHead;
+static MidpFileCachePage *mLruTail;
+
+/* Number of allocated pages */
+static int mPageCount;
+
+/* Maximal number of pages, 0 if the cache is disabled */
+static int mPageLimit;
 
-/* Cache limit for a single file */
+/* Global cache limit */
 static unsigned int fileCacheLimit = 0;
 
-/**
- * Test if region 1 that starts from position x1 with size s1
- * overlaps with region 2 that starts from position x2 with
- * size s2.
+/* Storage which available space is cached */
+static StorageIdType mSpaceStorageId;
+
+/* Available space of mSpaceStorageId less the pending cached writes */
+static jlong cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
+
+/* Initialize file cache limit reading RMS_CACHE_LIMIT property,
+ * using RMS_CACHE_LIMIT constant as default value.
+ * File cache limit is initialized only once.
  */
-static int is_overlap(long x1, long s1, long x2, long s2) {
-    if (x1 <= x2) {
-        if (x2 < x1 + s1) {
-            return 1;
-        } else {
-            return 0;
-        }
-    } else {
-        if (x1 < x2 + s2) {
-            return 1;
-        } else {
-            return 0;
+static void initFileCacheLimit() {
+    if (0 == fileCacheLimit) {
+        int rmsCacheLimit = getInternalPropertyInt("RMS_CACHE_LIMIT");
+        if (0 == rmsCacheLimit) {
+            REPORT_INFO(LC_AMS, "RMS_CACHE_LIMIT property not set");
+            /* set XML constant value as property value */
+            rmsCacheLimit = RMS_CACHE_LIMIT;
         }
+        fileCacheLimit = (unsigned)rmsCacheLimit;
+        mPageLimit = (int)(fileCacheLimit /
+            (sizeof(MidpFileCachePage) + PAGE_SIZE));
     }
 }
 
 /**
- * Test if region 1 that starts from position x1 with size s1
- * completely includes region 2 that starts from position x2 with
- * size s2.
+ * Tells if a request is too large to be cached. Such requests would
+ * evict most of the pages, so they go to the storage directly.
  */
-static int is_include(long x1, long s1, long x2, long s2) {
-    return (x1 <= x2 && x1+s1 >= x2+s2);
+static int is_large(long length) {
+    return length > (long)mPageLimit * PAGE_SIZE / 2;
+}
+
+static MidpFileCacheHandle* find_handle(int handle) {
+    MidpFileCacheHandle *h;
+
+    for (h = mHandles; h != NULL; h = h->next) {
+        if (h->handle == handle) {
+            return h;
+        }
+    }
+
+    return NULL;
+}
+
+static unsigned int page_hash(MidpFileCache *file, long pageNumber) {
+    unsigned int key = (unsigned int)((unsigned long)file >> 4) ^
+                       (unsigned int)pageNumber;
+
+    return ((key * 2654435761U) >> 16) & (HASH_BUCKETS - 1);
+}
+
+static MidpFileCachePage* find_page(MidpFileCache *file, long pageNumber) {
+    MidpFileCachePage *p = mPageHash[page_hash(file, pageNumber)];
+
+    while (p != NULL && (p->file != file || p->pageNumber != pageNumber)) {
+        p = p->hashNext;
+    }
+
+    return p;
+}
+
+static void lru_unlink(MidpFileCachePage *p) {
+    if (p->lruPrev != NULL) {
+        p->lruPrev->lruNext = p->lruNext;
+    } else {
+        mLruHead = p->lruNext;
+    }
+    if (p->lruNext != NULL) {
+        p->lruNext->lruPrev = p->lruPrev;
+    } else {
+        mLruTail = p->lruPrev;
+    }
+}
+
+static void lru_push(MidpFileCachePage *p) {
+    p->lruPrev = NULL;
+    p->lruNext = mLruHead;
+    if (mLruHead != NULL) {
+        mLruHead->lruPrev = p;
+    } else {
+        mLruTail = p;
+    }
+    mLruHead = p;
+}
+
+/* Make the page the most recently used one */
+static void lru_touch(MidpFileCachePage *p) {
+    if (mLruHead != p) {
+        lru_unlink(p);
+        lru_push(p);
+    }
+}
+
+/* Remove the page from the hash table, its file and the LRU list */
+static void unlink_page(MidpFileCachePage *p) {
+    MidpFileCachePage **pp;
+
+    pp = &mPageHash[page_hash(p->file, p->pageNumber)];
+    while (*pp != p) {
+        pp = &(*pp)->hashNext;
+    }
+    *pp = p->hashNext;
+
+    pp = &p->file->pages;
+    while (*pp != p) {
+        pp = &(*pp)->fileNext;
+    }
+    *pp = p->fileNext;
+
+    lru_unlink(p);
+}
+
+static void free_page(MidpFileCachePage *p) {
+    unlink_page(p);
+    midpFree(p);
+    mPageCount--;
+}
+
+static void unmap_file(MidpFileCache *file) {
+    if (file->map != NULL) {
+        storage_unmap_file(file->map, file->mapLength);
+        file->map = NULL;
+    }
+    file->mapLength = 0;
+    file->mapSize = 0;
 }
 
 /**
- * Initializes mFileCache->cachedAvailableSpace with the number
- * of available bytes on the storage defined by mFileCache->storageId.
+ * Tells if the storage data of the file up to the given offset can be
+ * copied from the mapping. The file is mapped again if it has grown
+ * enough since the last mapping.
  */
-static void midp_init_cached_free_space() {
-    if (mFileCache) {
-        mFileCache->cachedAvailableSpace = storage_get_free_space(
-            mFileCache->storageId);
+static int map_covers(MidpFileCache *file, long end) {
+    char *pszError;
+    long size;
+    const unsigned char *map;
+
+    if (end <= file->mapSize) {
+        return 1;
+    }
+
+    if (file->mapFailed || end > file->diskSize || (file->map != NULL &&
+            file->diskSize - file->mapSize < MIDP_FILE_CACHE_REMAP_SIZE)) {
+        return 0;
+    }
+
+    map = storage_map_file(&pszError, &file->name, &size);
+    if (map == NULL) {
+        storageFreeError(pszError);
+        /* Don't try again, read the file instead */
+        file->mapFailed = 1;
+        return 0;
+    }
+
+    unmap_file(file);
+    file->map = map;
+    file->mapLength = size;
+    file->mapSize = (size < file->diskSize) ? size : file->diskSize;
+
+    return end <= file->mapSize;
+}
+
+/* Upon success write to the storage, update the size of the file there */
+static void update_disk_size(MidpFileCache *file, long end) {
+    if (end > file->diskSize) {
+        file->diskSize = end;
     }
 }
 
-/* Upon success write, update file position, size and available space */
-static void updateCachedSizes(long lengthWritten) {
-    mFileCache->cachedPosition += lengthWritten;
-    if (mFileCache->cachedPosition > mFileCache->cachedFileSize) {
-        if (mFileCache->cachedAvailableSpace ==
-                UNINITIALIZED_CACHED_VALUE) {
-            midp_init_cached_free_space();
+/** Writes a series of adjacent bytes of the file from its cached pages. */
+static void write_run(char** ppszError, MidpFileCache *file,
+                      MidpFileCachePage *first, MidpFileCachePage *last) {
+    long start = PAGE_START(first) + first->dirtyStart;
+    long length = PAGE_START(last) + last->dirtyEnd - start;
+    MidpFileCachePage *p;
+    char *buf = NULL;
+
+    storagePosition(ppszError, file->handle, start);
+    CHECK_ERROR(*ppszError);
+
+    if (first != last) {
+        buf = (char*)midpMalloc(length);
+    }
+
+    if (buf != NULL) {
+        char *bufPos = buf;
+
+        for (p = first; ; p = p->fileNext) {
+            memcpy(bufPos, DATA(p) + p->dirtyStart,
+                   p->dirtyEnd - p->dirtyStart);
+            bufPos += p->dirtyEnd - p->dirtyStart;
+            if (p == last) {
+                break;
+            }
         }
 
-        mFileCache->cachedAvailableSpace -= mFileCache->cachedPosition -
-                                            mFileCache->cachedFileSize;
-        mFileCache->cachedFileSize = mFileCache->cachedPosition;
+        storageWrite(ppszError, file->handle, buf, length);
+        midpFree(buf);
+    } else {
+        /* a single page, or no memory to merge the pages */
+        for (p = first; ; p = p->fileNext) {
+            storageWrite(ppszError, file->handle, DATA(p) + p->dirtyStart,
+                         p->dirtyEnd - p->dirtyStart);
+            if (*ppszError != NULL || p == last) {
+                break;
+            }
+        }
     }
-}
+    CHECK_ERROR(*ppszError);
 
-/* Directly write to storage. File position will be updated also. */
-static
-void uncachedWrite(char** ppszError, int handle, char *buffer, int length) {
-    *ppszError = NULL;
-    storagePosition(ppszError, handle, mFileCache->cachedPosition);
-    if (*ppszError == NULL) {
-        storageWrite(ppszError, handle, buffer, length);
-        if (*ppszError == NULL) {
-            updateCachedSizes(length);
+    for (p = first; ; p = p->fileNext) {
+        p->dirtyStart = p->dirtyEnd = 0;
+        if (p == last) {
+            break;
         }
     }
+    file->needsCommit = 1;
+    update_disk_size(file, start + length);
 }
 
-/* Initialize file cache limit reading RMS_CACHE_LIMIT property,
- * using RMS_CACHE_LIMIT constant as default value.
- * File cache limit is initialized only once.
+/**
+ * Writes the modified pages of the file to the storage, merging the
+ * adjacent ones. The pages stay in the cache.
  */
-static void initFileCacheLimit() {
-    if (0 == fileCacheLimit) {
-        int rmsCacheLimit = getInternalPropertyInt("RMS_CACHE_LIMIT");
-        if (0 == rmsCacheLimit) {
-            REPORT_INFO(LC_AMS, "RMS_CACHE_LIMIT property not set");
-            /* set XML constant value as property value */
-            rmsCacheLimit = RMS_CACHE_LIMIT;
+static void write_dirty_pages(char** ppszError, MidpFileCache *file) {
+    MidpFileCachePage *first, *last;
+
+    *ppszError = NULL;
+
+    for (first = file->pages; first != NULL; first = last->fileNext) {
+        last = first;
+        if (!IS_DIRTY(first)) {
+            continue;
         }
-        fileCacheLimit = (unsigned)rmsCacheLimit;
+
+        while (last->dirtyEnd == PAGE_SIZE && last->fileNext != NULL
+               && last->fileNext->pageNumber == last->pageNumber + 1
+               && last->fileNext->dirtyStart == 0
+               && IS_DIRTY(last->fileNext)) {
+            last = last->fileNext;
+        }
+
+        write_run(ppszError, file, first, last);
+        CHECK_ERROR(*ppszError);
+    }
+}
+
+/* Write the pages of all files, so the storage reports actual free space */
+static void write_all_dirty_pages(char** ppszError) {
+    MidpFileCache *file;
+
+    *ppszError = NULL;
+
+    for (file = mFiles; file != NULL && *ppszError == NULL;
+            file = file->next) {
+        write_dirty_pages(ppszError, file);
     }
 }
 
 /**
- * Flush the cache and stop current file caching.
- * Seek cached position for the case the file won't be closed after
- * flushing (it's possible if a few files are openned simultaneously).
+ * Makes room for a new page. The least recently used page is evicted
+ * when the cache is full, the modified pages of its file are written
+ * first.
+ *
+ * @return memory for a new page, NULL if there is no memory or
+ *         in case of an error
  */
-static void midp_file_cache_finalize(char **ppszError, int stayOpen) {
+static MidpFileCachePage* alloc_page(char** ppszError) {
+    MidpFileCachePage *p = NULL;
+
     *ppszError = NULL;
 
-    if (mFileCache != NULL) {
-        midp_file_cache_flush(ppszError, mFileCache->handle);
-        /* Do no seek for the file that is either damaged or to be closed */
-        if (*ppszError == NULL && stayOpen) {
-            storagePosition(ppszError, mFileCache->handle,
-                mFileCache->cachedPosition);
+    if (mPageCount < mPageLimit) {
+        p = (MidpFileCachePage*)midpMalloc(sizeof(MidpFileCachePage) +
+                                           PAGE_SIZE);
+        if (p != NULL) {
+            mPageCount++;
+            return p;
+        }
+    }
+
+    p = mLruTail;
+    if (p != NULL) {
+        if (IS_DIRTY(p)) {
+            write_dirty_pages(ppszError, p->file);
+            if (*ppszError != NULL) {
+                return NULL;
+            }
         }
-        /* If read is cached, free all read blocks here */
-        midpFree(mFileCache);
-        mFileCache = NULL;
+        unlink_page(p);
     }
+
+    return p;
 }
 
-/** A helper function for midp_file_cache_flush(). */
-static
-void midp_file_cache_flush_using_buffer(char** ppszError, int handle,
-                                        char* buf, long bufsize) {
-    MidpFileCacheBlock *b; /* current cache block */
-    MidpFileCacheBlock *n; /* next cache block */
-    MidpFileCacheBlock *q; /* first block not (yet) copied to the buffer,
-                              finally, the value to be stored
-                              in mFileCache->blocks */
-    char *bufPos;          /* first not yet used byte in the write buffer */
-    long startPos, endPos; /* positions in the file cached in a series
-                              of buffers, from...upto */
-    long len;
+/**
+ * Gets a page of the file, reading it from the storage if it is not
+ * cached. When the whole data of the page is going to be overwritten,
+ * the page is not read.
+ *
+ * @return the page, NULL if there is no memory or in case of an error
+ */
+static MidpFileCachePage* get_page(char** ppszError, MidpFileCache *file,
+                                   long pageNumber, int needData) {
+    MidpFileCachePage *p, **pp;
+    long start, length;
+
     *ppszError = NULL;
 
-    while ((b = mFileCache->blocks) != NULL) {
-
-        if (  NULL != buf
-           && NULL != (n = b->next)
-           && n->position == b->position + b->length /* adjacent? */
-           && b->length + n->length < bufsize
-           ) {  /* begin merging blocks */
-
-                /* position in the buffer */
-                bufPos = buf;
-                /* position in the file */
-                startPos = endPos = b->position;
-
-                b = mFileCache->blocks;
-                /* now copy a series of adjacent blocks to the write buffer */
-                do {
-                    len = b->length;
-                    memcpy(bufPos,DATA(b),len);
-                    endPos += len;
-                    bufPos += len;
-                    b = b->next;
-                } while (  NULL != b
-                        && b->position == endPos
-                        && endPos - startPos + b->length < bufsize
-                        );
-
-                q = b; /* q is next to the last copied block */
-                /* the cache state has not been modified yet */
-
-                /* now write from the write buffer */
-                storagePosition(ppszError, handle, startPos);
-                CHECK_ERROR(*ppszError);
-                storageWrite(ppszError, handle, buf, endPos-startPos);
-                CHECK_ERROR(*ppszError);
-
-                /* write successful, now free the cache blocks */
-                while ( q != (b = mFileCache->blocks)) {
-                    mFileCache->size -= b->length + sizeof(MidpFileCacheBlock);
-                    mFileCache->blocks = b->next;
-                        midpFree(b);
-                }
+    p = find_page(file, pageNumber);
+    if (p != NULL) {
+        lru_touch(p);
+        return p;
+    }
+
+    p = alloc_page(ppszError);
+    if (p == NULL) {
+        return NULL;
+    }
+
+    p->file = file;
+    p->pageNumber = pageNumber;
+    p->dirtyStart = p->dirtyEnd = 0;
+
+    start = PAGE_START(p);
+    length = 0;
+    if (needData && start < file->cachedFileSize) {
+        /* The pages that are not cached are up to date in the storage */
+        length = file->cachedFileSize - start;
+        if (length > PAGE_SIZE) {
+            length = PAGE_SIZE;
+        }
+
+        if (map_covers(file, start + length)) {
+            memcpy(DATA(p), file->map + start, length);
         } else {
-            storagePosition(ppszError, handle, b->position);
-            CHECK_ERROR(*ppszError);
-            storageWrite(ppszError, handle, DATA(b), b->length);
-            CHECK_ERROR(*ppszError);
-
-            mFileCache->size -= b->length + sizeof(MidpFileCacheBlock);
-            mFileCache->blocks = b->next;
-            midpFree(b);
+            storagePosition(ppszError, file->handle, start);
+            if (*ppszError == NULL) {
+                length = storageRead(ppszError, file->handle, DATA(p),
+                                     length);
+            }
+        }
+        if (*ppszError != NULL) {
+            midpFree(p);
+            mPageCount--;
+            return NULL;
+        }
+        if (length < 0) {
+            length = 0;
+        }
+    }
+    /* Bytes past the end of file read as zeroes */
+    memset(DATA(p) + length, 0, PAGE_SIZE - length);
+
+    p->hashNext = mPageHash[page_hash(file, pageNumber)];
+    mPageHash[page_hash(file, pageNumber)] = p;
+
+    pp = &file->pages;
+    while (*pp != NULL && (*pp)->pageNumber < pageNumber) {
+        pp = &(*pp)->fileNext;
+    }
+    p->fileNext = *pp;
+    *pp = p;
+
+    lru_push(p);
+
+    return p;
+}
+
+/**
+ * Initializes cachedAvailableSpace with the number of available bytes
+ * on the given storage.
+ */
+static void init_cached_free_space(StorageIdType storageId) {
+    char *pszError;
+
+    /* Make the storage aware of the size of all cached writes */
+    write_all_dirty_pages(&pszError);
+    storageFreeError(pszError);
+
+    mSpaceStorageId = storageId;
+    cachedAvailableSpace = storage_get_free_space(storageId);
+}
+
+/* Upon success write, update file size and available space */
+static void update_cached_size(MidpFileCache *file, long end) {
+    if (end > file->cachedFileSize) {
+        if (cachedAvailableSpace != UNINITIALIZED_CACHED_VALUE) {
+            cachedAvailableSpace -= end - file->cachedFileSize;
         }
+        file->cachedFileSize = end;
     }
-    storageCommitWrite(ppszError, handle);
+}
+
+/**
+ * Directly write to storage. The cached pages in the written range
+ * are updated, so they need not to be flushed.
+ */
+static void uncached_write(char** ppszError, MidpFileCacheHandle *h,
+                           char *buffer, long length) {
+    MidpFileCache *file = h->file;
+    MidpFileCachePage *p;
+    long start = h->cachedPosition;
+    long end = start + length;
+
+    storagePosition(ppszError, file->handle, start);
+    CHECK_ERROR(*ppszError);
+    storageWrite(ppszError, file->handle, buffer, length);
     CHECK_ERROR(*ppszError);
 
-    /* ASSERT (mFileCache->size == 0) */
-    if (mFileCache->size != 0) {
-        REPORT_ERROR(LC_RMS, "File cache out of sync");
+    for (p = file->pages; p != NULL; p = p->fileNext) {
+        long from = PAGE_START(p), to = from + PAGE_SIZE;
+
+        if (from < start) {
+            from = start;
+        }
+        if (to > end) {
+            to = end;
+        }
+        if (from < to) {
+            memcpy(DATA(p) + (from - PAGE_START(p)), buffer + (from - start),
+                   to - from);
+        }
     }
+
+    file->needsCommit = 1;
+    h->cachedPosition = end;
+    update_cached_size(file, end);
+    update_disk_size(file, end);
 }
 
 void midp_file_cache_flush(char** ppszError, int handle) {
-    char *buf;     /* write buffer */
-    long bufsize;  /* its size */
+    MidpFileCacheHandle *h;
     *ppszError = NULL;
 
-    if (mFileCache == NULL || mFileCache->handle != handle
-        || mFileCache->blocks == NULL) {
+    h = find_handle(handle);
+    if (h == NULL) {
         return;
     }
 
-    /* allocate a buffer, as large as possible, but no larger than the cache */
-    /* the buffer will be freed before the function returns */
-    bufsize = mFileCache->size;
-    do {
-         buf = (char*)midpMalloc(bufsize);
+    write_dirty_pages(ppszError, h->file);
+    CHECK_ERROR(*ppszError);
 
-         if (buf != NULL) {
-            midp_file_cache_flush_using_buffer(ppszError, handle, buf, bufsize);
-            midpFree(buf);
-            break;
-         } else if (bufsize > (signed) (4*sizeof(MidpFileCacheBlock))) {
-            /* we prefer to have at least some buffer so that failure to
-               allocate a big buffer does not lead to slowing down write
-               operations by multiple times (e.g. 5x to 12x on non-cached
-               compact flash) */
-            bufsize >>= 1;
-         } else {
-            /* failed to allocate buffer of any size */
-            midp_file_cache_flush_using_buffer(ppszError, handle, NULL, 0);
-            break;
-         }
-    } while(1);
+    if (h->file->needsCommit) {
+        storageCommitWrite(ppszError, h->file->handle);
+        CHECK_ERROR(*ppszError);
+        h->file->needsCommit = 0;
+    }
 }
 
 int midp_file_cache_open(char** ppszError, StorageIdType storageId,
                          const pcsl_string* filename, int ioMode) {
-    int h;
+    MidpFileCacheHandle *h;
+    MidpFileCache *file;
+    int handle;
     *ppszError = NULL;
-    h = storage_open(ppszError, filename, ioMode);
-
-    if (*ppszError == NULL) { /* Open successfully */
-        if (mFileCache == NULL) {
-            initFileCacheLimit();
-            mFileCache = (MidpFileCache *)midpMalloc(sizeof(MidpFileCache));
-            mFileCache->handle = h;
-            mFileCache->size = 0;
-            mFileCache->storageId = storageId;
-            mFileCache->cachedPosition = 0;
-            mFileCache->cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
-            mFileCache->cachedFileSize = storageSizeOf(ppszError, h);
-            mFileCache->blocks = NULL;
-        } else {
-            /* More than one file is open. Available space can no longer been
-             * cached. Stop caching completely. */
-            midp_file_cache_finalize(ppszError, KNI_TRUE);
+
+    (void)storageId;
+
+    handle = storage_open(ppszError, filename, ioMode);
+    if (*ppszError != NULL) {
+        return handle;
+    }
+
+    initFileCacheLimit();
+    if (mPageLimit == 0) {
+        /* The cache is disabled */
+        return handle;
+    }
+
+    h = (MidpFileCacheHandle*)midpMalloc(sizeof(MidpFileCacheHandle));
+    if (h == NULL) {
+        /* Out of memory, the file will not be cached */
+        return handle;
+    }
+
+    for (file = mFiles; file != NULL; file = file->next) {
+        if (pcsl_string_equals(&file->name, filename)) {
+            break;
         }
     }
 
-    return h;
+    if (file == NULL) {
+        file = (MidpFileCache*)midpMalloc(sizeof(MidpFileCache));
+        if (file == NULL ||
+                pcsl_string_dup(filename, &file->name) != PCSL_STRING_OK) {
+            midpFree(file);
+            midpFree(h);
+            return handle;
+        }
+
+        file->handle = handle;
+        file->openCount = 0;
+        file->needsCommit = 0;
+        file->pages = NULL;
+        file->map = NULL;
+        file->mapLength = 0;
+        file->mapSize = 0;
+        file->mapFailed = 0;
+        file->cachedFileSize = storageSizeOf(ppszError, handle);
+        file->diskSize = file->cachedFileSize;
+        file->next = mFiles;
+        mFiles = file;
+    }
+
+    file->openCount++;
+
+    h->handle = handle;
+    h->cachedPosition = 0;
+    h->file = file;
+    h->next = mHandles;
+    mHandles = h;
+
+    return handle;
 }
 
 void midp_file_cache_close(char** ppszError, int handle) {
     char *pszErrorTmp = NULL;
+    MidpFileCacheHandle *h, **hp;
     *ppszError = NULL;
 
-    if (mFileCache != NULL && mFileCache->handle == handle) {
-        midp_file_cache_finalize(ppszError, KNI_FALSE);
-        pszErrorTmp = *ppszError;
+    for (hp = &mHandles; *hp != NULL; hp = &(*hp)->next) {
+        if ((*hp)->handle == handle) {
+            break;
+        }
+    }
+
+    h = *hp;
+    if (h != NULL) {
+        MidpFileCache *file = h->file;
+
+        if (file->openCount == 1) {
+            MidpFileCache **fp;
+
+            midp_file_cache_flush(ppszError, handle);
+            pszErrorTmp = *ppszError;
+
+            while (file->pages != NULL) {
+                free_page(file->pages);
+            }
+            unmap_file(file);
+
+            for (fp = &mFiles; *fp != file; fp = &(*fp)->next) {
+            }
+            *fp = file->next;
+            pcsl_string_free(&file->name);
+            midpFree(file);
+        } else {
+            file->openCount--;
+            if (file->handle == handle) {
+                /* Continue caching the file through another handle */
+                MidpFileCacheHandle *other;
+
+                write_dirty_pages(ppszError, file);
+                pszErrorTmp = *ppszError;
+
+                for (other = mHandles; other->file != file ||
+                        other == h; other = other->next) {
+                }
+                file->handle = other->handle;
+            }
+        }
+
+        *hp = h->next;
+        midpFree(h);
     }
 
     storageClose(ppszError, handle);
@@ -311,10 +676,12 @@ void midp_file_cache_close(char** ppszError, int handle) {
 }
 
 void midp_file_cache_seek(char** ppszError, int handle, long position) {
+    MidpFileCacheHandle *h;
     *ppszError = NULL;
 
-    if (position >= 0 && mFileCache != NULL && mFileCache->handle == handle) {
-        mFileCache->cachedPosition = position;
+    h = find_handle(handle);
+    if (position >= 0 && h != NULL) {
+        h->cachedPosition = position;
     } else {
         storagePosition(ppszError, handle, position);
     }
@@ -322,98 +689,76 @@ void midp_file_cache_seek(char** ppszError, int handle, long position) {
 
 void midp_file_cache_write(char** ppszError, int handle,
                            char* buffer, long length) {
-
-    MidpFileCacheBlock *p, *b;
+    MidpFileCacheHandle *h;
+    MidpFileCache *file;
     *ppszError = NULL;
 
     if (length <= 0) {
         return;
     }
 
-    if (mFileCache == NULL || mFileCache->handle != handle) {
+    h = find_handle(handle);
+    if (h == NULL) {
         storageWrite(ppszError, handle, buffer, length);
         return;
     }
 
-    /* Try to cache it */
-    p = NULL; /* the block previous to b */
-    b = mFileCache->blocks;
-
-    while (b != NULL) {
-        if (is_overlap(b->position, b->length,
-                       mFileCache->cachedPosition, length)) {
-            /* Handle simple overriding case */
-            if (is_include(b->position, b->length,
-                           mFileCache->cachedPosition, length)) {
-                memcpy(DATA(b) + mFileCache->cachedPosition - b->position,
-                        buffer, length);
-                updateCachedSizes(length);
-                return;
-            } else {
-                /* Flush everything out */
-                midp_file_cache_flush(ppszError, handle);
-                /* Reset previous block pointer after flush */
-                p = NULL;
-                /* Try to cache this write below */
-                break;
-            }
-        } else if (mFileCache->cachedPosition+length <= b->position) {
-            /* No match. Try to cache this write below */
-            break;
-        } else {
-            /* Continue to scan the next block */
-            p = b;
-            b = b->next; /* that is, p->next == b */
-        }
-    } /* end of while (b) */
-    /* the current value of b will not be used below */
-
-    /* This is a new write block that has not been cached */
-
-    /* Never try to cache large write that is bigger than cache limit */
-    if (sizeof(MidpFileCacheBlock)+length > fileCacheLimit) {
-        uncachedWrite(ppszError, handle, buffer, length);
+    /* Never try to cache large write */
+    if (is_large(length)) {
+        uncached_write(ppszError, h, buffer, length);
         return;
     }
 
-    /* If cache is full, flush it before caching new write */
-    if (mFileCache->size+sizeof(MidpFileCacheBlock)+length > fileCacheLimit) {
-        midp_file_cache_flush(ppszError, handle);
-        /* Reset previous block pointer after flush */
-        p = NULL;
-    }
+    file = h->file;
+    while (length > 0) {
+        long pageNumber = h->cachedPosition / PAGE_SIZE;
+        long pageStart = pageNumber * PAGE_SIZE;
+        int offset = (int)(h->cachedPosition - pageStart);
+        int n = PAGE_SIZE - offset;
+        MidpFileCachePage *p;
 
-    /* Cache is not full, check if memory is full */
-    b = (MidpFileCacheBlock *)midpMalloc(sizeof(MidpFileCacheBlock)+length);
-    if (b == NULL) {
-        /* Out of memory. Write directly to storage */
-        uncachedWrite(ppszError, handle, buffer, length);
-        return;
-    }
+        if (n > length) {
+            n = (int)length;
+        }
 
-    /* Insert a new cache block (b) between p and p->next */
-    b->position = mFileCache->cachedPosition;
-    b->length = length;
-    memcpy(DATA(b), buffer, length);
+        /* The page must be read unless the write covers all its data */
+        p = get_page(ppszError, file, pageNumber,
+                     pageStart < file->cachedFileSize &&
+                     (offset > 0 || pageStart + offset + n <
+                         file->cachedFileSize));
+        CHECK_ERROR(*ppszError);
+
+        if (p == NULL) {
+            /* Out of memory. Write directly to storage */
+            uncached_write(ppszError, h, buffer, length);
+            return;
+        }
 
-    if (p == NULL) {
-        /* inserting in the beginning of the list */
-        b->next = mFileCache->blocks;
-        mFileCache->blocks = b;
-    } else {
-        /* inserting after p, in the middle of the list */
-        b->next = p->next;
-        p->next = b;
-    }
+        memcpy(DATA(p) + offset, buffer, n);
+        if (IS_DIRTY(p)) {
+            if (offset < p->dirtyStart) {
+                p->dirtyStart = offset;
+            }
+            if (offset + n > p->dirtyEnd) {
+                p->dirtyEnd = offset + n;
+            }
+        } else {
+            p->dirtyStart = offset;
+            p->dirtyEnd = offset + n;
+        }
 
-    mFileCache->size += sizeof(MidpFileCacheBlock)+length;
-    updateCachedSizes(length);
+        h->cachedPosition += n;
+        update_cached_size(file, h->cachedPosition);
+        buffer += n;
+        length -= n;
+    }
 }
 
 long midp_file_cache_read(char** ppszError, int handle,
                           char* buffer, long length) {
-    MidpFileCacheBlock *b;
-    long l;
+    MidpFileCacheHandle *h;
+    MidpFileCache *file;
+    long l = 0;
 
     *ppszError = NULL;
 
@@ -421,109 +766,151 @@ long midp_file_cache_read(char** ppszError, int handle,
         return 0;
     }
 
-    if (mFileCache == NULL || mFileCache->handle != handle) {
+    h = find_handle(handle);
+    if (h == NULL) {
         return storageRead(ppszError, handle, buffer, length);
     }
 
-    /* See if it is in the cache */
-    b = mFileCache->blocks;
-
-    while (b != NULL) {
-        if (is_overlap(b->position, b->length,
-                        mFileCache->cachedPosition, length)) {
-            /* Handle simple inclusive case */
-            if (is_include(b->position, b->length,
-                           mFileCache->cachedPosition, length)) {
-                /* Read from cache */
-                memcpy(buffer,
-                        DATA(b) + mFileCache->cachedPosition - b->position,
-                        length);
-                mFileCache->cachedPosition += length;
-                return length;
-
-            } else {
-                /* Flush everything out */
-                midp_file_cache_flush(ppszError, handle);
-                /* Read from file below */
+    file = h->file;
+    if (h->cachedPosition >= file->cachedFileSize) {
+        /* end of file in java is -1 */
+        return -1;
+    }
+
+    if (length > file->cachedFileSize - h->cachedPosition) {
+        length = file->cachedFileSize - h->cachedPosition;
+    }
+
+    while (l < length) {
+        long pageNumber = h->cachedPosition / PAGE_SIZE;
+        int offset = (int)(h->cachedPosition - pageNumber * PAGE_SIZE);
+        int n = PAGE_SIZE - offset;
+        MidpFileCachePage *p = NULL;
+
+        if (n > length - l) {
+            n = (int)(length - l);
+        }
+
+        p = find_page(file, pageNumber);
+        if (p != NULL) {
+            lru_touch(p);
+        } else if (map_covers(file, h->cachedPosition + n)) {
+            /* Not cached, so the mapping is up to date */
+            memcpy(buffer + l, file->map + h->cachedPosition, n);
+            h->cachedPosition += n;
+            l += n;
+            continue;
+        } else if (!is_large(length)) {
+            p = get_page(ppszError, file, pageNumber, 1);
+            if (*ppszError != NULL) {
                 break;
             }
-        } else if (mFileCache->cachedPosition+length <= b->position) {
-            /* No match. Read from file below */
-            break;
-        } else {
-            /* Continue to scan the next block */
-            b = b->next;
         }
-    } /* end of while (b) */
 
-    /* Read from file */
-    storagePosition(ppszError, handle, mFileCache->cachedPosition);
-    if (*ppszError == NULL) {
-        l = storageRead(ppszError, handle, buffer, length);
-        if (*ppszError == NULL) {
-            mFileCache->cachedPosition += length;
+        if (p == NULL) {
+            /* Read the rest from file, it must be up to date */
+            long r;
+
+            write_dirty_pages(ppszError, file);
+            if (*ppszError != NULL) {
+                break;
+            }
+
+            if (map_covers(file, length - l + h->cachedPosition)) {
+                memcpy(buffer + l, file->map + h->cachedPosition, length - l);
+                h->cachedPosition += length - l;
+                l = length;
+                break;
+            }
+
+            storagePosition(ppszError, file->handle, h->cachedPosition);
+            if (*ppszError != NULL) {
+                break;
+            }
+
+            r = storageRead(ppszError, file->handle, buffer + l, length - l);
+            if (*ppszError == NULL && r > 0) {
+                h->cachedPosition += r;
+                l += r;
+            }
+            break;
         }
-    } else {
-        l = 0;
+
+        memcpy(buffer + l, DATA(p) + offset, n);
+        h->cachedPosition += n;
+        l += n;
     }
 
-    return l;
+    return l > 0 ? l : -1;
 }
 
 jlong midp_file_cache_available_space(char** ppszError, int handle,
                                       StorageIdType storageId) {
-    /* Storage may have more then 2Gb space available so use 64-bit type */
-    jlong availSpace;
     *ppszError = NULL;
 
-    if (mFileCache == NULL) {
-        availSpace = storage_get_free_space(storageId);
-    } else {
-        if (mFileCache->handle != handle) {
-            /* Flush current cache to storage before query for new space */
-            midp_file_cache_flush(ppszError, mFileCache->handle);
-            mFileCache->storageId = storageId;
-            mFileCache->cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
-        }
-
-        if (mFileCache->cachedAvailableSpace == UNINITIALIZED_CACHED_VALUE) {
-            midp_init_cached_free_space();
-        }
+    if (find_handle(handle) == NULL) {
+        return storage_get_free_space(storageId);
+    }
 
-        availSpace = mFileCache->cachedAvailableSpace;
+    if (cachedAvailableSpace == UNINITIALIZED_CACHED_VALUE ||
+            mSpaceStorageId != storageId) {
+        init_cached_free_space(storageId);
     }
 
-    return availSpace;
+    return cachedAvailableSpace;
 }
 
 long midp_file_cache_sizeof(char** ppszError, int handle) {
+    MidpFileCacheHandle *h;
     *ppszError = NULL;
 
-    if (mFileCache == NULL || mFileCache->handle != handle) {
+    h = find_handle(handle);
+    if (h == NULL) {
         return storageSizeOf(ppszError, handle);
     } else {
-        return mFileCache->cachedFileSize;
+        return h->file->cachedFileSize;
     }
 }
 
 void midp_file_cache_truncate(char** ppszError, int handle, long size) {
+    MidpFileCacheHandle *h;
+    MidpFileCache *file;
+    MidpFileCachePage *p, *next;
     *ppszError = NULL;
 
+    h = find_handle(handle);
+    if (h == NULL) {
+        storageTruncate(ppszError, handle, size);
+        cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
+        return;
+    }
+
+    file = h->file;
     midp_file_cache_flush(ppszError, handle);
     CHECK_ERROR(*ppszError);
 
-    storageTruncate(ppszError, handle, size);
+    storageTruncate(ppszError, file->handle, size);
+    CHECK_ERROR(*ppszError);
 
-    if (*ppszError == NULL && mFileCache != NULL) {
-        if (mFileCache->handle != handle) {
-            mFileCache->cachedAvailableSpace = UNINITIALIZED_CACHED_VALUE;
-        } else {
-            if (mFileCache->cachedAvailableSpace !=
-                    UNINITIALIZED_CACHED_VALUE) {
-                mFileCache->cachedAvailableSpace +=
-                    mFileCache->cachedFileSize - size;
-                mFileCache->cachedFileSize = size;
-            }
+    /* Drop the cut off pages and clear the tail of the last page */
+    for (p = file->pages; p != NULL; p = next) {
+        next = p->fileNext;
+        if (PAGE_START(p) >= size) {
+            free_page(p);
+        } else if (PAGE_START(p) + PAGE_SIZE > size) {
+            memset(DATA(p) + (size - PAGE_START(p)), 0,
+                   PAGE_START(p) + PAGE_SIZE - size);
         }
     }
+
+    if (cachedAvailableSpace != UNINITIALIZED_CACHED_VALUE) {
+        cachedAvailableSpace += file->cachedFileSize - size;
+    }
+    file->cachedFileSize = size;
+    file->diskSize = size;
+
+    /* Accessing the mapping past the end of file would fault */
+    if (file->mapSize > size) {
+        file->mapSize = size;
+    }
 }
@@ -31,23 +31,52 @@
 #include <midp_constants_data.h>
 #include <java_types.h>
 
-typedef struct _MidpFileCacheBlock {
-    struct _MidpFileCacheBlock *next;	/* next cache block */
-    long position;			/* file offset */
-    long length;			/* size of the data block */
-    /* char data[0];			   data buffer */
-} MidpFileCacheBlock;
+/*
+ * Size of a cache page in bytes, must be a power of 2. The pages of all
+ * open files are allocated from the global RMS_CACHE_LIMIT budget.
+ */
+#ifndef MIDP_FILE_CACHE_PAGE_SIZE
+#define MIDP_FILE_CACHE_PAGE_SIZE 256
+#endif
+
+struct _MidpFileCache;
+
+typedef struct _MidpFileCachePage {
+    struct _MidpFileCachePage *hashNext;  /* next page in the hash bucket */
+    struct _MidpFileCachePage *fileNext;  /* next page of the same file,
+                                             sorted by pageNumber */
+    struct _MidpFileCachePage *lruPrev;   /* more recently used page */
+    struct _MidpFileCachePage *lruNext;   /* less recently used page */
+    struct _MidpFileCache *file;          /* file the page belongs to */
+    long pageNumber;                      /* file offset / page size */
+    int dirtyStart;                       /* first modified byte */
+    int dirtyEnd;                         /* next to the last modified byte,
+                                             equals dirtyStart if clean */
+    /* char data[MIDP_FILE_CACHE_PAGE_SIZE];  page contents */
+} MidpFileCachePage;
 
 typedef struct _MidpFileCache {
-    int handle;
-    int size;
-    StorageIdType storageId;
-    long cachedPosition;
-    long cachedFileSize;
-    jlong cachedAvailableSpace;
-    MidpFileCacheBlock *blocks;
+    struct _MidpFileCache *next;      /* next open file */
+    pcsl_string name;                 /* name the file was opened with */
+    int handle;                       /* handle used to flush the pages */
+    int openCount;                    /* number of handles sharing the file */
+    int needsCommit;                  /* written since the last commit */
+    long cachedFileSize;              /* file size including cached writes */
+    long diskSize;                    /* file size in the storage */
+    MidpFileCachePage *pages;         /* cached pages, sorted by pageNumber */
+    const unsigned char *map;         /* read-only mapping of the file */
+    long mapLength;                   /* size of the mapping */
+    long mapSize;                     /* bytes of the mapping that are valid */
+    int mapFailed;                    /* the file cannot be mapped */
 } MidpFileCache;
 
+typedef struct _MidpFileCacheHandle {
+    struct _MidpFileCacheHandle *next; /* next open handle */
+    int handle;                        /* storage handle */
+    long cachedPosition;               /* current position of the handle */
+    MidpFileCache *file;               /* file opened by the handle */
+} MidpFileCacheHandle;
+
 void midp_file_cache_flush(char** ppszError, int handle);
 
 int midp_file_cache_open(char** ppszError, StorageIdType storageId,
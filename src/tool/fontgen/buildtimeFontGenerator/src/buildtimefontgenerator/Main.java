@@ -30,7 +30,9 @@ import java.awt.Color;
 import java.awt.Font;
 import java.awt.FontMetrics;
 import java.awt.Graphics;
+import java.awt.Graphics2D;
 import java.awt.Image;
+import java.awt.RenderingHints;
 import java.awt.image.BufferedImage;
 import java.util.Vector;
 
@@ -67,6 +69,7 @@ public class Main {
     private static int fontStyle;
     private static int fontSize;
     private static int overrideWidth;
+    private static boolean antialias;
     private static Vector<Integer> ranges = new Vector<Integer>(2);
 
     private static void fail(String string) {
@@ -80,7 +83,7 @@ public class Main {
     public static void main(String[] args) {
         if (args.length == 0) {
             System.err.println("Arguments are:\n" +
-                    "font-name: <font-name> {font-style: italic|bold} font-size: <font-size> {range: <start> <end>} [override-width: <width>]");
+                    "font-name: <font-name> {font-style: italic|bold} font-size: <font-size> {range: <start> <end>} [override-width: <width>] [antialias: on|off]");
             return;
         }
         
@@ -114,6 +117,14 @@ public class Main {
                 catch (NumberFormatException ex) {
                     fail("Invalid value provided for font-size");
                 }
+            } else if (arg.equals("antialias:")) {
+                String value = args[++i];
+                if (value.equals("on"))
+                    antialias = true;
+                else if (value.equals("off"))
+                    antialias = false;
+                else
+                    fail("Invalid value for antialias");
             } else if (arg.equals("range:")) {
                 try {
                     int start, end;
@@ -155,9 +166,14 @@ public class Main {
         int bitmapHeight = fm.getHeight();
         int baseline = fm.getAscent();
         char[] charToRender = new char[1];
-        glyphBitmap = new BufferedImage(bitmapWidth, bitmapHeight, BufferedImage.TYPE_BYTE_BINARY);
+        glyphBitmap = new BufferedImage(bitmapWidth, bitmapHeight,
+                antialias ? BufferedImage.TYPE_BYTE_GRAY : BufferedImage.TYPE_BYTE_BINARY);
         Graphics gr = glyphBitmap.getGraphics();
         gr.setFont(font);
+        if (antialias) {
+            ((Graphics2D)gr).setRenderingHint(RenderingHints.KEY_TEXT_ANTIALIASING,
+                    RenderingHints.VALUE_TEXT_ANTIALIAS_ON);
+        }
 
         System.out.println(COPYRIGHT);
         System.out.println("# Font parameters:\n        \n# width height ascent descent leading");
@@ -196,6 +212,8 @@ public class Main {
                     code = ' ';
                 else if (color == BLACK_RGB)
                     code = '*';
+                else if (antialias)
+                    code = coverageCode(color);
                 else
                     code = 'x';
                 System.out.print(code);
@@ -205,6 +223,19 @@ public class Main {
         drawHR(width);
     }
 
+    /**
+     * Gray pixels of an anti-aliased glyph are written as hexadecimal
+     * coverage levels 1..e, wrfont turns them into 4- or 8-bit coverage.
+     */
+    private static char coverageCode(int color) {
+        int level = ((0xff - (color & 0xff)) * 15 + 0x7f) / 0xff;
+        if (level == 0)
+            return ' ';
+        if (level == 15)
+            return '*';
+        return Character.forDigit(level, 16);
+    }
+
     private static void drawHR(int width) {
         System.out.print("#");
         for (int i = 0; i < width; i++) {
@@ -26,6 +26,7 @@
 
 #include <stdio.h>
 #include <memory.h>
+#include <string.h>
 #include <stdlib.h>
 #include "gxj_intern_font_bitmap.h"
 
@@ -35,11 +36,16 @@
 
 unsigned char BitMask[8] = {0x80,0x40,0x20,0x10,0x8,0x4,0x2,0x1};
 
+/* 0 for a 1-bit font, 4 or 8 for a coverage font (-c4, -c8 options) */
+int coverageBits = 0;
+/* header size of the generated tables */
+int headerSize = FONT_DATA;
+
 char buf[BUFSIZE];
 int lineno = 0;
 int lastchar = -1;
 
-unsigned char fontbitmap_common_header[FONT_DATA];
+unsigned char fontbitmap_common_header[FONT_COVERAGE_DATA];
 unsigned char *fontbitmaps[MAXFONTBITMAPCOUNT];
 unsigned char *fontbitmap_current = NULL;
 int rangeIndex=-1;
@@ -58,6 +64,32 @@ int define_file()
     fontbitmap_common_header[FONT_ASCENT] = ascent;
     fontbitmap_common_header[FONT_DESCENT] = descent;
     fontbitmap_common_header[FONT_LEADING] = leading;
+    fontbitmap_common_header[FONT_COVERAGE_BITS] = coverageBits;
+}
+
+/* number of bytes taken by the pixels of a range of characters */
+int data_size(int count)
+{
+    int bits = coverageBits == 0 ? 1 : coverageBits;
+    return (count * fontWidth * fontHeight * bits + 7) / 8;
+}
+
+/*
+ * coverage level 0..15 of a pixel data character:
+ * ' ' is background, '*' is fully covered,
+ * hexadecimal digits 1..e are partially covered pixels
+ */
+int pixel_level(char ch)
+{
+    if (ch == '*')
+        return 15;
+    if (ch >= '1' && ch <= '9')
+        return ch - '0';
+    if (ch >= 'a' && ch <= 'e')
+        return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'E')
+        return ch - 'A' + 10;
+    return 0;
 }
 
 int define_range()
@@ -74,13 +106,13 @@ int define_range()
         return -1;
     }
     fontbitmap_current = (unsigned char*)malloc(
-        (last_lo-first_lo+1) * ((fontWidth * fontHeight + 7) / 8) + FONT_DATA);
+        data_size(last_lo-first_lo+1) + headerSize);
     if (fontbitmap_current == NULL) {
         fprintf(stderr, "Memory exhausted");
         return -1;
     }
-    memset(fontbitmap_current,0,(last_lo-first_lo+1) * ((fontWidth * fontHeight + 7) / 8) + FONT_DATA);
-    memcpy(fontbitmap_current, fontbitmap_common_header, FONT_DATA);
+    memset(fontbitmap_current,0,data_size(last_lo-first_lo+1) + headerSize);
+    memcpy(fontbitmap_current, fontbitmap_common_header, headerSize);
     fontbitmap_current[FONT_CODE_RANGE_HIGH] = range_hi;
     fontbitmap_current[FONT_CODE_FIRST_LOW] = first_lo;
     fontbitmap_current[FONT_CODE_LAST_LOW] = last_lo;
@@ -137,7 +169,8 @@ void define_char()
     lastchar = newchar;
     unsigned int c = newchar - (range_hi*0x100 + first_lo);
     unsigned long firstPixelIndex =
-        (FONT_DATA * 8) + (c * fontHeight * fontWidth);
+        c * fontHeight * fontWidth;
+    int bits = coverageBits == 0 ? 1 : coverageBits;
 
     int i,j;
     for (i = 0; i < fontHeight; i++) {
@@ -145,16 +178,23 @@ void define_char()
         {
             for (j = 0; j < fontWidth; j++) {
                 const int pixelIndex = firstPixelIndex + (i * fontWidth) + j;
-                const int byteIndex = pixelIndex / 8;
+                const int bitIndex = headerSize * 8 + pixelIndex * bits;
+                const int byteIndex = bitIndex / 8;
+                const int level = pixel_level(buf[j]);
 
                 if (byteIndex >= mapLen[rangeIndex]) {
                     mapLen[rangeIndex] = byteIndex+1;
                 }
 
-                const int bitOffset = pixelIndex % 8;
+                const int bitOffset = bitIndex % 8;
 
-                /* we don't draw "background" pixels, only foreground */
-                if (buf[j] == '*') {
+                if (coverageBits == 8) {
+                    fontbitmap_current[byteIndex] = level * 0x11;
+                } else if (coverageBits == 4) {
+                    fontbitmap_current[byteIndex] |=
+                        level << (4 - bitOffset);
+                } else if (level >= 8) {
+                    /* 1-bit fonts keep the pixels that are mostly covered */
                     fontbitmap_current[byteIndex] |= BitMask[bitOffset];
                 }
             }
@@ -200,6 +240,7 @@ void print_bitmap()
 {
     int i;
     int printRangeIndex;
+    const char *tableName = coverageBits == 0 ? "Bitmap" : "Coverage";
     char heading[] =
         "/*\n"
         " *\n"
@@ -234,27 +275,31 @@ void print_bitmap()
         fontbitmap_current = fontbitmaps[printRangeIndex];
         printf("// starts off with width, height, ascent, descent, leading, "
                "range_high_byte, first_code_low_byte, last_code_low_byte, "
-               "then data\n"
-               "unsigned char TheFontBitmap%02x%02x[%i] = {\n",
+               "%sthen data\n"
+               "unsigned char TheFont%s%02x%02x[%i] = {\n",
+               coverageBits == 0 ? "" : "bits_per_pixel, ",
+               tableName,
                fontbitmap_current[FONT_CODE_RANGE_HIGH],
                fontbitmap_current[FONT_CODE_FIRST_LOW],
                mapLen[printRangeIndex]);
         for(i=0;i<mapLen[printRangeIndex];i++) {
-            if(i==FONT_DATA) {
+            if(i==headerSize) {
                 printf("/* data starts here */\n");
-            } else if((i-FONT_DATA)%16==0) {
+            } else if(i>headerSize && (i-headerSize)%16==0) {
                 printf("\n");
             }
             printf("0x%02x,",fontbitmap_current[i]);
         }
         printf("\n};\n\n");
     }
-    printf("pfontbitmap FontBitmaps[] =\n"
+    printf("pfontbitmap %s[] =\n"
            "{ (pfontbitmap)%i",
+           coverageBits == 0 ? "FontBitmaps" : "FontCoverage",
            rangeIndex+1);
     for (printRangeIndex = 0; printRangeIndex <= rangeIndex; printRangeIndex++) {
         fontbitmap_current = fontbitmaps[printRangeIndex];
-        printf(", TheFontBitmap%02x%02x",
+        printf(", TheFont%s%02x%02x",
+               tableName,
                fontbitmap_current[FONT_CODE_RANGE_HIGH],
                fontbitmap_current[FONT_CODE_FIRST_LOW]);
         free(fontbitmap_current);
@@ -264,15 +309,27 @@ void print_bitmap()
 }
 void check_size(int range)
 {
-    int calculated_size = ((last_lo-first_lo+1)*fontWidth*fontHeight+7)/8+FONT_DATA;
+    int calculated_size = data_size(last_lo-first_lo+1)+headerSize;
     fprintf(stderr, "info predicted table size is %i bytes\n", calculated_size);
     if( calculated_size != mapLen[range]) {
 	fprintf(stderr, "error calculated size mismatch (bug in our code): %i vs %i\n",
             calculated_size, mapLen[range]);
     }
 }
-main()
+int main(int argc, char *argv[])
 {
+    if (argc > 1) {
+        if (strcmp(argv[1], "-c4") == 0) {
+            coverageBits = 4;
+        } else if (strcmp(argv[1], "-c8") == 0) {
+            coverageBits = 8;
+        } else {
+            fprintf(stderr, "usage: wrfont [-c4|-c8] <fontdef >source\n");
+            return 1;
+        }
+        headerSize = FONT_COVERAGE_DATA;
+    }
     process_file();
     print_bitmap();
+    return 0;
 }